@@ -24,13 +24,27 @@
 
 #include <assert.h>
 #include <ctype.h>
+#include <errno.h>
 #include <inttypes.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
 #include <libproc.h>
 #include <sys/avl.h>
+#include <sys/elf.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 #include <alloca.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "v8dbg.h"
 #include "v8cfg.h"
 #include "mdb_v8_version.h"
@@ -77,6 +91,7 @@ typedef struct {
  * classes, types, and frame types based on the debug metadata.
  */
 static v8_class_t	*v8_classes;
+static boolean_t	v8_configured;
 
 static v8_enum_t	v8_types[128];
 static int 		v8_next_type;
@@ -157,8 +172,10 @@ intptr_t V8_TYPE_HEAPNUMBER = -1;
 intptr_t V8_TYPE_MUTABLEHEAPNUMBER = -1;
 intptr_t V8_TYPE_ODDBALL = -1;
 intptr_t V8_TYPE_FIXEDARRAY = -1;
+intptr_t V8_TYPE_FIXEDDOUBLEARRAY = -1;
 intptr_t V8_TYPE_MAP = -1;
 intptr_t V8_TYPE_JSTYPEDARRAY = -1;
+intptr_t V8_TYPE_JSARRAYBUFFER = -1;
 
 static intptr_t V8_ELEMENTS_KIND_SHIFT;
 static intptr_t V8_ELEMENTS_KIND_BITCOUNT;
@@ -238,8 +255,10 @@ ssize_t V8_OFF_SLICEDSTRING_OFFSET;
 ssize_t V8_OFF_STRING_LENGTH;
 ssize_t V8_OFF_JSTYPEDARRAY_LENGTH;
 ssize_t V8_OFF_JSARRAYBUFFER_BACKINGSTORE;
+ssize_t V8_OFF_JSARRAYBUFFER_BYTE_LENGTH;
 ssize_t V8_OFF_JSARRAYBUFFERVIEW_BUFFER;
 ssize_t V8_OFF_JSARRAYBUFFERVIEW_CONTENT_OFFSET;
+ssize_t V8_OFF_JSARRAYBUFFERVIEW_BYTE_LENGTH;
 
 #define	V8_CONSTANT_OPTIONAL		1
 #define	V8_CONSTANT_HASFALLBACK		2
@@ -565,6 +584,8 @@ static v8_offset_t v8_offsets[] = {
 	    "JSArrayBuffer", "backing_store",
 	    B_FALSE, V8_CONSTANT_FALLBACK(4, 6), 11 },
 #endif
+	{ &V8_OFF_JSARRAYBUFFER_BYTE_LENGTH,
+	    "JSArrayBuffer", "byte_length", B_TRUE },
 #ifdef _LP64
 	{ &V8_OFF_JSARRAYBUFFERVIEW_BUFFER,
 	    "JSArrayBufferView", "buffer",
@@ -583,6 +604,15 @@ static v8_offset_t v8_offsets[] = {
 	    "JSArrayBufferView", "byte_offset",
 	    B_FALSE, V8_CONSTANT_FALLBACK(4, 6), 15 },
 #endif
+#ifdef _LP64
+	{ &V8_OFF_JSARRAYBUFFERVIEW_BYTE_LENGTH,
+	    "JSArrayBufferView", "byte_length",
+	    B_FALSE, V8_CONSTANT_FALLBACK(4, 6), 39 },
+#else
+	{ &V8_OFF_JSARRAYBUFFERVIEW_BYTE_LENGTH,
+	    "JSArrayBufferView", "byte_length",
+	    B_FALSE, V8_CONSTANT_FALLBACK(4, 6), 19 },
+#endif
 };
 
 static int v8_noffsets = sizeof (v8_offsets) / sizeof (v8_offsets[0]);
@@ -606,6 +636,7 @@ static void conf_class_compute_offsets(v8_class_t *);
 
 static int heap_offset(const char *, const char *, ssize_t *);
 static int jsfunc_name(uintptr_t, char **, size_t *);
+static void v8_typecache_configure(void);
 
 
 /*
@@ -750,6 +781,8 @@ autoconfigure(v8_cfg_t *cfgp)
 
 	assert(v8_classes == NULL);
 
+	v8_typecache_configure();
+
 	/*
 	 * Iterate all global symbols looking for metadata.
 	 */
@@ -863,6 +896,12 @@ autoconfigure(v8_cfg_t *cfgp)
 
 		if (strcmp(ep->v8e_name, "JSTypedArray") == 0)
 			V8_TYPE_JSTYPEDARRAY = ep->v8e_value;
+
+		if (strcmp(ep->v8e_name, "JSArrayBuffer") == 0)
+			V8_TYPE_JSARRAYBUFFER = ep->v8e_value;
+
+		if (strcmp(ep->v8e_name, "FixedDoubleArray") == 0)
+			V8_TYPE_FIXEDDOUBLEARRAY = ep->v8e_value;
 	}
 
 	if (V8_TYPE_JSOBJECT == -1) {
@@ -1126,6 +1165,7 @@ again:
 		}
 	}
 
+	v8_configured = !failed;
 	return (failed ? -1 : 0);
 }
 
@@ -1490,6 +1530,16 @@ maybefree(void *arg, size_t sz, int memflags)
 		mdb_free(arg, sz);
 }
 
+/*
+ * Returns true if we've been successfully configured for the target's version
+ * of V8, either when we were loaded or with ::v8load.
+ */
+boolean_t
+v8_isconfigured(void)
+{
+	return (v8_configured);
+}
+
 void
 v8_warn(const char *format, ...)
 {
@@ -1635,7 +1685,7 @@ heap_offset(const char *klass, const char *field, ssize_t *offp)
 int
 read_heap_ptr(uintptr_t *valp, uintptr_t addr, ssize_t off)
 {
-	if (mdb_vread(valp, sizeof (*valp), addr + off) == -1) {
+	if (mdbv8_vread(valp, sizeof (*valp), addr + off) == -1) {
 		v8_warn("failed to read offset %d from %p", off, addr);
 		return (-1);
 	}
@@ -1666,7 +1716,7 @@ read_heap_smi(uintptr_t *valp, uintptr_t addr, ssize_t off)
 static int
 read_heap_double(double *valp, uintptr_t addr, ssize_t off)
 {
-	if (mdb_vread(valp, sizeof (*valp), addr + off) == -1) {
+	if (mdbv8_vread(valp, sizeof (*valp), addr + off) == -1) {
 		v8_warn("failed to read heap value at %p", addr + off);
 		return (-1);
 	}
@@ -1683,20 +1733,28 @@ read_heap_double(double *valp, uintptr_t addr, ssize_t off)
 int
 read_heap_array(uintptr_t addr, uintptr_t **retp, size_t *lenp, int flags)
 {
-	uint8_t type;
-	uintptr_t len;
+	uintptr_t type, len;
+	heap_field_t fields[] = {
+		{ V8_OFF_HEAPOBJECT_MAP, HF_TYPE, &type },
+		{ V8_OFF_FIXEDARRAY_LENGTH, HF_PTR, &len }
+	};
 
 	if (!V8_IS_HEAPOBJECT(addr))
 		return (-1);
 
-	if (read_typebyte(&type, addr) != 0)
+	if (read_heap_fields(addr, fields,
+	    sizeof (fields) / sizeof (fields[0])) != 0)
 		return (-1);
 
 	if (type != V8_TYPE_FIXEDARRAY)
 		return (-1);
 
-	if (read_heap_smi(&len, addr, V8_OFF_FIXEDARRAY_LENGTH) != 0)
+	if (!V8_IS_SMI(len)) {
+		v8_warn("expected SMI, got %p\n", len);
 		return (-1);
+	}
+
+	len = V8_SMI_VALUE(len);
 
 	*lenp = len;
 
@@ -1708,7 +1766,7 @@ read_heap_array(uintptr_t addr, uintptr_t **retp, size_t *lenp, int flags)
 	if ((*retp = mdb_zalloc(len * sizeof (uintptr_t), flags)) == NULL)
 		return (-1);
 
-	if (mdb_vread(*retp, len * sizeof (uintptr_t),
+	if (mdbv8_vread(*retp, len * sizeof (uintptr_t),
 	    addr + V8_OFF_FIXEDARRAY_DATA) == -1) {
 		maybefree(*retp, len * sizeof (uintptr_t), flags);
 		*retp = NULL;
@@ -1721,7 +1779,7 @@ read_heap_array(uintptr_t addr, uintptr_t **retp, size_t *lenp, int flags)
 static int
 read_heap_byte(uint8_t *valp, uintptr_t addr, ssize_t off)
 {
-	if (mdb_vread(valp, sizeof (*valp), addr + off) == -1) {
+	if (mdbv8_vread(valp, sizeof (*valp), addr + off) == -1) {
 		v8_warn("failed to read heap value at %p", addr + off);
 		return (-1);
 	}
@@ -1750,7 +1808,7 @@ read_heap_maybesmi(uintptr_t *valp, uintptr_t addr, ssize_t off)
 #ifdef _LP64
 	uint32_t readval;
 
-	if (mdb_vread(&readval, sizeof (readval), addr + off) == -1) {
+	if (mdbv8_vread(&readval, sizeof (readval), addr + off) == -1) {
 		*valp = -1;
 		v8_warn("failed to read offset %d from %p", off, addr);
 		return (-1);
@@ -1769,6 +1827,353 @@ read_heap_maybesmi(uintptr_t *valp, uintptr_t addr, ssize_t off)
 #endif
 }
 
+/*
+ * Map type cache
+ *
+ * A heap contains at most a few thousand distinct Maps, but we read the
+ * instance type from those Maps an enormous number of times: once for nearly
+ * every object we look at, and once for every candidate object during a heap
+ * scan.  This open-addressing hash table caches the instance type byte for each
+ * map address that we've read.
+ *
+ * We also cache negative entries for addresses that are not Maps: those whose
+ * type byte could not be read, and those that a heap scan has found not to be
+ * Maps.  A heap scan finds far more of these than there are Maps, so they're
+ * kept in a separate, smaller table in which each entry simply replaces
+ * whatever was in its slot.  That way, garbage can't fill the table of Maps
+ * (causing it to be flushed), and it can't displace them.
+ *
+ * The contents of a live process may change between commands, so the cache is
+ * only used when the target is a core file or while some operation (like a
+ * heap scan) holds it with v8_typecache_hold().  The same goes for the cache of
+ * target memory pages (see mdb_v8_mem.c), which is held along with it.
+ */
+#define	V8_TYPECACHE_NENTRIES	(1 << 16)
+#define	V8_TYPECACHE_NNOTMAPS	(1 << 12)
+#define	V8_TYPECACHE_NOTMAP	(-1)
+
+typedef struct v8_typecache_entry {
+	uintptr_t vtce_map;
+	int vtce_type;
+} v8_typecache_entry_t;
+
+static v8_typecache_entry_t *v8_typecache;
+static uintptr_t *v8_typecache_notmaps;
+static size_t v8_typecache_count;
+static int v8_typecache_holds;
+static boolean_t v8_typecache_persist;
+static uint64_t v8_typecache_hits;
+static uint64_t v8_typecache_misses;
+
+static void
+v8_typecache_flush(void)
+{
+	if (v8_typecache != NULL)
+		bzero(v8_typecache,
+		    V8_TYPECACHE_NENTRIES * sizeof (v8_typecache_entry_t));
+
+	if (v8_typecache_notmaps != NULL)
+		bzero(v8_typecache_notmaps,
+		    V8_TYPECACHE_NNOTMAPS * sizeof (uintptr_t));
+
+	v8_typecache_count = 0;
+}
+
+/*
+ * The ELF core file installed as the source of target memory by ::v8target,
+ * if any.  It's owned by the memory layer once installed.
+ */
+static mdbv8_elfcore_t *v8_target_core;
+
+/*
+ * Known-unreadable memory
+ *
+ * The memory layer can reject reads of memory that's known to be unreadable
+ * without consulting the target (see mdb_v8_mem.c).  When the source of
+ * memory is a core file, whose mappings can't change, we tell it up front
+ * about everything that's not covered by a mapping.  It learns about the rest
+ * (like mappings whose contents weren't saved) as reads fail.
+ */
+typedef struct v8_mapping {
+	uintptr_t vm_start;		/* first address in mapping */
+	uintptr_t vm_last;		/* last address in mapping */
+} v8_mapping_t;
+
+typedef struct v8_mappings {
+	v8_mapping_t *vms_maps;		/* array of mappings */
+	size_t vms_count;		/* number of mappings in array */
+	size_t vms_size;		/* allocated size of array */
+} v8_mappings_t;
+
+static void
+v8_mappings_add(v8_mappings_t *vmsp, uintptr_t addr, size_t size)
+{
+	v8_mapping_t *maps;
+	size_t nsize;
+
+	if (size == 0)
+		return;
+
+	if (vmsp->vms_count == vmsp->vms_size) {
+		nsize = vmsp->vms_size == 0 ? 64 : vmsp->vms_size * 2;
+		maps = mdb_alloc(nsize * sizeof (v8_mapping_t), UM_SLEEP);
+
+		if (vmsp->vms_size != 0) {
+			bcopy(vmsp->vms_maps, maps,
+			    vmsp->vms_count * sizeof (v8_mapping_t));
+			mdb_free(vmsp->vms_maps,
+			    vmsp->vms_size * sizeof (v8_mapping_t));
+		}
+
+		vmsp->vms_maps = maps;
+		vmsp->vms_size = nsize;
+	}
+
+	vmsp->vms_maps[vmsp->vms_count].vm_start = addr;
+	vmsp->vms_maps[vmsp->vms_count].vm_last =
+	    addr + (size - 1) < addr ? UINTPTR_MAX : addr + (size - 1);
+	vmsp->vms_count++;
+}
+
+/* ARGSUSED */
+static int
+v8_mappings_proc(v8_mappings_t *vmsp, const prmap_t *pmp, const char *name)
+{
+	v8_mappings_add(vmsp, pmp->pr_vaddr, pmp->pr_size);
+	return (0);
+}
+
+/* ARGSUSED */
+static int
+v8_mappings_elfcore(uintptr_t addr, size_t size, uint_t flags,
+    const char *name, void *arg)
+{
+	v8_mappings_add(arg, addr, size);
+	return (0);
+}
+
+static int
+v8_mapping_cmp(const void *l, const void *r)
+{
+	const v8_mapping_t *lhs = l, *rhs = r;
+
+	if (lhs->vm_start < rhs->vm_start)
+		return (-1);
+
+	return (lhs->vm_start > rhs->vm_start);
+}
+
+/*
+ * Record the gaps between the mappings of the current source of target memory
+ * as unreadable, if that source is a core file.
+ */
+static void
+v8_unreadable_seed(void)
+{
+	struct ps_prochandle *Pr;
+	v8_mappings_t vms;
+	v8_mapping_t *vmp;
+	uintptr_t next = 0;
+	size_t i;
+
+	bzero(&vms, sizeof (vms));
+
+	if (v8_target_core != NULL) {
+		(void) mdbv8_elfcore_iter(v8_target_core,
+		    v8_mappings_elfcore, &vms);
+	} else if (v8_typecache_persist &&
+	    mdb_get_xdata("pshandle", &Pr, sizeof (Pr)) != -1) {
+		(void) Pmapping_iter(Pr, (proc_map_f *)v8_mappings_proc, &vms);
+	}
+
+	if (vms.vms_count == 0)
+		return;
+
+	qsort(vms.vms_maps, vms.vms_count, sizeof (v8_mapping_t),
+	    v8_mapping_cmp);
+
+	for (i = 0; i < vms.vms_count; i++) {
+		vmp = &vms.vms_maps[i];
+
+		if (vmp->vm_start > next)
+			mdbv8_mem_unreadable(next, vmp->vm_start - next);
+
+		if (vmp->vm_last >= next) {
+			if (vmp->vm_last == UINTPTR_MAX)
+				break;
+
+			next = vmp->vm_last + 1;
+		}
+	}
+
+	if (i == vms.vms_count)
+		mdbv8_mem_unreadable(next, UINTPTR_MAX - next + 1);
+
+	mdb_free(vms.vms_maps, vms.vms_size * sizeof (v8_mapping_t));
+}
+
+/*
+ * Invoked when we (re)configure ourselves for a target.  Anything we've cached
+ * about the target's Maps may be interpreted differently under the new
+ * configuration.  If the target is a core file, we can keep what we learn
+ * about Maps for as long as we're loaded.
+ */
+static void
+v8_typecache_configure(void)
+{
+	struct ps_prochandle *Pr;
+
+	v8_typecache_flush();
+	v8_typecache_persist = mdb_get_xdata("pshandle", &Pr,
+	    sizeof (Pr)) != -1 && Pstate(Pr) == PS_DEAD;
+	mdbv8_mem_configure(v8_typecache_persist);
+	v8_unreadable_seed();
+}
+
+static void
+v8_typecache_hold(void)
+{
+	v8_typecache_holds++;
+	mdbv8_mem_hold();
+}
+
+static void
+v8_typecache_rele(void)
+{
+	assert(v8_typecache_holds > 0);
+
+	if (--v8_typecache_holds == 0 && !v8_typecache_persist)
+		v8_typecache_flush();
+
+	mdbv8_mem_rele();
+}
+
+static size_t
+v8_typecache_hash(uintptr_t map)
+{
+	uint64_t hash = (uint64_t)(map >> V8_PointerSizeLog2) *
+	    0x9e3779b97f4a7c15ULL;
+
+	return ((size_t)(hash >> 32));
+}
+
+static v8_typecache_entry_t *
+v8_typecache_slot(uintptr_t map)
+{
+	size_t i = v8_typecache_hash(map) & (V8_TYPECACHE_NENTRIES - 1);
+	v8_typecache_entry_t *vtcep;
+
+	for (;;) {
+		vtcep = &v8_typecache[i];
+
+		if (vtcep->vtce_map == map || vtcep->vtce_map == 0)
+			return (vtcep);
+
+		i = (i + 1) & (V8_TYPECACHE_NENTRIES - 1);
+	}
+}
+
+/*
+ * Look up "map" in the type cache.  Returns 0 if the map is cached, in which
+ * case *typep is either its type byte or V8_TYPECACHE_NOTMAP.  Returns -1 if
+ * the cache is not in use or the map is not cached.
+ */
+static int
+v8_typecache_lookup(uintptr_t map, int *typep)
+{
+	v8_typecache_entry_t *vtcep;
+
+	if (v8_typecache == NULL ||
+	    (v8_typecache_holds == 0 && !v8_typecache_persist))
+		return (-1);
+
+	vtcep = v8_typecache_slot(map);
+
+	if (vtcep->vtce_map != 0) {
+		v8_typecache_hits++;
+		*typep = vtcep->vtce_type;
+		return (0);
+	}
+
+	if (v8_typecache_notmaps[v8_typecache_hash(map) &
+	    (V8_TYPECACHE_NNOTMAPS - 1)] == map) {
+		v8_typecache_hits++;
+		*typep = V8_TYPECACHE_NOTMAP;
+		return (0);
+	}
+
+	v8_typecache_misses++;
+	return (-1);
+}
+
+static void
+v8_typecache_insert(uintptr_t map, int type)
+{
+	v8_typecache_entry_t *vtcep;
+
+	if (map == 0 || (v8_typecache_holds == 0 && !v8_typecache_persist))
+		return;
+
+	if (v8_typecache == NULL) {
+		v8_typecache = mdb_zalloc(V8_TYPECACHE_NENTRIES *
+		    sizeof (v8_typecache_entry_t), UM_SLEEP);
+		v8_typecache_notmaps = mdb_zalloc(V8_TYPECACHE_NNOTMAPS *
+		    sizeof (uintptr_t), UM_SLEEP);
+	}
+
+	if (type == V8_TYPECACHE_NOTMAP) {
+		v8_typecache_notmaps[v8_typecache_hash(map) &
+		    (V8_TYPECACHE_NNOTMAPS - 1)] = map;
+		return;
+	}
+
+	/*
+	 * Keep the table sparse enough for linear probing to work well.  Only
+	 * Maps are stored here, so this should never fill up, but if it does,
+	 * just start over.
+	 */
+	if (v8_typecache_count >= V8_TYPECACHE_NENTRIES / 4 * 3)
+		v8_typecache_flush();
+
+	vtcep = v8_typecache_slot(map);
+
+	if (vtcep->vtce_map == 0) {
+		vtcep->vtce_map = map;
+		v8_typecache_count++;
+	}
+
+	vtcep->vtce_type = type;
+}
+
+/*
+ * Given a Map, returns in *valp its instance type byte, using the type cache
+ * where possible.
+ */
+static int
+read_maptype(uint8_t *valp, uintptr_t mapaddr)
+{
+	int type;
+
+	if (v8_typecache_lookup(mapaddr, &type) == 0) {
+		if (type == V8_TYPECACHE_NOTMAP) {
+			v8_warn("object map %p is not a map\n", mapaddr);
+			return (-1);
+		}
+
+		*valp = (uint8_t)type;
+		return (0);
+	}
+
+	if (read_heap_byte(valp, mapaddr,
+	    V8_OFF_MAP_INSTANCE_ATTRIBUTES) == -1) {
+		v8_typecache_insert(mapaddr, V8_TYPECACHE_NOTMAP);
+		return (-1);
+	}
+
+	v8_typecache_insert(mapaddr, *valp);
+	return (0);
+}
+
 /*
  * Given a heap object, returns in *valp the byte describing the type of the
  * object.  This is shorthand for first retrieving the Map at the start of the
@@ -1780,7 +2185,7 @@ read_typebyte(uint8_t *valp, uintptr_t addr)
 	uintptr_t mapaddr;
 	ssize_t off = V8_OFF_HEAPOBJECT_MAP;
 
-	if (mdb_vread(&mapaddr, sizeof (mapaddr), addr + off) == -1) {
+	if (mdbv8_vread(&mapaddr, sizeof (mapaddr), addr + off) == -1) {
 		v8_warn("failed to read type of %p", addr);
 		return (-1);
 	}
@@ -1790,8 +2195,151 @@ read_typebyte(uint8_t *valp, uintptr_t addr)
 		return (-1);
 	}
 
-	if (read_heap_byte(valp, mapaddr, V8_OFF_MAP_INSTANCE_ATTRIBUTES) == -1)
+	return (read_maptype(valp, mapaddr));
+}
+
+/*
+ * Read several fields of the heap object at "addr" at once.  Loaders typically
+ * need a handful of fields at small offsets from the start of an object, so
+ * rather than reading each one separately, we read the smallest span of the
+ * object covering all of them and decode each field from that, validating it
+ * according to its kind.  (If the fields are unusually far apart, they're read
+ * separately.)  Optional fields whose offset is -1, because they're not
+ * present in this version of V8, are not read, and their value is 0.  Returns
+ * -1 if any field couldn't be read or failed validation.
+ */
+#define	HEAP_FIELDS_MAXSPAN	512
+
+static size_t
+read_heap_field_size(const heap_field_t *hfp)
+{
+	if (hfp->hf_kind == HF_BYTE)
+		return (sizeof (uint8_t));
+
+#ifdef _LP64
+	if (hfp->hf_kind == HF_MAYBESMI)
+		return (sizeof (uint32_t));
+#endif
+
+	return (sizeof (uintptr_t));
+}
+
+static int
+read_heap_field_decode(uintptr_t addr, const heap_field_t *hfp,
+    const uint8_t *p)
+{
+	uintptr_t val = 0;
+	uint32_t val32;
+	uint8_t type;
+
+	switch (hfp->hf_kind) {
+	case HF_BYTE:
+		val = *p;
+		break;
+
+#ifdef _LP64
+	case HF_MAYBESMI:
+		/*
+		 * See read_heap_maybesmi().
+		 */
+		bcopy(p, &val32, sizeof (val32));
+		if ((addr + hfp->hf_off) % sizeof (uintptr_t) == 0)
+			val32 >>= 1;
+		val = val32;
+		break;
+#else
+	case HF_MAYBESMI:
+#endif
+	case HF_SMI:
+		bcopy(p, &val, sizeof (val));
+		if (!V8_IS_SMI(val)) {
+			v8_warn("%p: expected SMI at offset %d, got %p\n",
+			    addr, hfp->hf_off, val);
+			return (-1);
+		}
+		val = V8_SMI_VALUE(val);
+		break;
+
+	case HF_HEAPOBJ:
+	case HF_TYPE:
+		bcopy(p, &val, sizeof (val));
+		if (!V8_IS_HEAPOBJECT(val)) {
+			v8_warn("%p: expected heap object at offset %d, "
+			    "got %p\n", addr, hfp->hf_off, val);
+			return (-1);
+		}
+
+		if (hfp->hf_kind == HF_TYPE) {
+			if (read_maptype(&type, val) != 0)
+				return (-1);
+			val = type;
+		}
+		break;
+
+	default:
+		bcopy(p, &val, sizeof (val));
+		break;
+	}
+
+	*hfp->hf_valp = val;
+	return (0);
+}
+
+int
+read_heap_fields(uintptr_t addr, const heap_field_t *fields, size_t nfields)
+{
+	uint8_t buf[HEAP_FIELDS_MAXSPAN];
+	boolean_t found = B_FALSE, batched;
+	ssize_t lo = 0, hi = 0, off;
+	size_t i, sz;
+
+	for (i = 0; i < nfields; i++) {
+		if (fields[i].hf_optional && fields[i].hf_off == -1)
+			continue;
+
+		off = fields[i].hf_off;
+		sz = read_heap_field_size(&fields[i]);
+
+		if (!found || off < lo)
+			lo = off;
+
+		if (!found || off + (ssize_t)sz > hi)
+			hi = off + sz;
+
+		found = B_TRUE;
+	}
+
+	batched = found && hi - lo <= sizeof (buf);
+
+	if (batched && mdbv8_vread(buf, hi - lo, addr + lo) == -1) {
+		v8_warn("failed to read fields of %p", addr);
 		return (-1);
+	}
+
+	for (i = 0; i < nfields; i++) {
+		off = fields[i].hf_off;
+
+		if (fields[i].hf_optional && off == -1) {
+			*fields[i].hf_valp = 0;
+			continue;
+		}
+
+		if (!batched) {
+			sz = read_heap_field_size(&fields[i]);
+
+			if (mdbv8_vread(buf, sz, addr + off) == -1) {
+				v8_warn("failed to read offset %d from %p",
+				    off, addr);
+				return (-1);
+			}
+
+			lo = off;
+		}
+
+		if (read_heap_field_decode(addr, &fields[i],
+		    buf + (off - lo)) != 0)
+			return (-1);
+	}
 
 	return (0);
 }
@@ -1973,12 +2521,14 @@ obj_jsconstructor(uintptr_t addr, char **bufp, size_t *lenp, boolean_t verbose)
 	    read_typebyte(&type, addr) != 0 ||
 	    (type != V8_TYPE_JSOBJECT &&
 	    type != V8_TYPE_JSARRAY &&
-	    type != V8_TYPE_JSTYPEDARRAY)) {
+	    type != V8_TYPE_JSTYPEDARRAY &&
+	    type != V8_TYPE_JSARRAYBUFFER)) {
 		mdb_warn("%p is not a JSObject\n", addr);
 		return (-1);
 	}
 
-	if (mdb_vread(&map, sizeof (map), addr + V8_OFF_HEAPOBJECT_MAP) == -1 ||
+	if (mdbv8_vread(&map, sizeof (map),
+	    addr + V8_OFF_HEAPOBJECT_MAP) == -1 ||
 	    get_map_constructor(&consfunc, map) == -1) {
 		mdb_warn("unable to read object map\n");
 		return (-1);
@@ -2070,12 +2620,13 @@ obj_jstype(uintptr_t addr, char **bufp, size_t *lenp, uint8_t *typep)
 	}
 
 	if (strcmp(typename, "JSObject") == 0 &&
-	    mdb_vread(&map, sizeof (map), addr + V8_OFF_HEAPOBJECT_MAP) != -1 &&
+	    mdbv8_vread(&map, sizeof (map),
+	    addr + V8_OFF_HEAPOBJECT_MAP) != -1 &&
 	    get_map_constructor(&consfunc, map) != -1 &&
 	    read_typebyte(&typebyte, consfunc) == 0 &&
 	    strcmp(enum_lookup_str(v8_types, typebyte, ""),
 	    "JSFunction") == 0 &&
-	    mdb_vread(&funcinfop, sizeof (funcinfop),
+	    mdbv8_vread(&funcinfop, sizeof (funcinfop),
 	    consfunc + V8_OFF_JSFUNCTION_SHARED) != -1) {
 		(void) bsnprintf(bufp, lenp, ": ");
 		(void) jsfunc_name(funcinfop, bufp, lenp);
@@ -2176,7 +2727,7 @@ obj_print_fields(uintptr_t baddr, v8_class_t *clp)
 
 		if (flp->v8f_isbyte) {
 			uint8_t sv;
-			if (mdb_vread(&sv, sizeof (sv), addr) == -1) {
+			if (mdbv8_vread(&sv, sizeof (sv), addr) == -1) {
 				mdb_printf("%p %s (unreadable)\n",
 				    addr, flp->v8f_name);
 				continue;
@@ -2186,7 +2737,7 @@ obj_print_fields(uintptr_t baddr, v8_class_t *clp)
 			continue;
 		}
 
-		rv = mdb_vread((void *)&value, sizeof (value), addr);
+		rv = mdbv8_vread((void *)&value, sizeof (value), addr);
 
 		if (rv != sizeof (value) ||
 		    obj_jstype(value, &bufp, &len, &type) != 0) {
@@ -2252,18 +2803,13 @@ obj_print_class(uintptr_t addr, v8_class_t *clp)
 }
 
 /*
- * Attempts to determine whether the object at "addr" might contain the address
- * "target".  This is used for low-level heuristic analysis.  Note that it's
- * possible that we cannot tell whether the address is contained (e.g., if this
- * is a variable-length object and we can't read how big it is).
+ * Returns in *sizep the size in bytes of the heap object at "addr", whose type
+ * is "type".  Unlike read_size(), this works for variable-sized sequential
+ * strings and FixedArrays as well as for fixed-size objects.
  */
 static int
-obj_contains(uintptr_t addr, uint8_t type, uintptr_t target,
-    boolean_t *containsp, int memflags)
+obj_size(uintptr_t addr, uint8_t type, size_t *sizep, int memflags)
 {
-	size_t size;
-	uintptr_t objsize;
-
 	/*
 	 * For sequential strings, we need to look at how many characters there
 	 * are, and how many bytes per character are used to encode the string.
@@ -2281,13 +2827,12 @@ obj_contains(uintptr_t addr, uint8_t type, uintptr_t target,
 		length = v8string_length(strp);
 
 		if (V8_STRENC_ASCII(type)) {
-			size = V8_OFF_SEQASCIISTR_CHARS + length;
+			*sizep = V8_OFF_SEQASCIISTR_CHARS + length;
 		} else {
-			size = V8_OFF_SEQTWOBYTESTR_CHARS + (2 * length);
+			*sizep = V8_OFF_SEQTWOBYTESTR_CHARS + (2 * length);
 		}
 
 		v8string_free(strp);
-		*containsp = target < addr + size;
 		return (0);
 	}
 
@@ -2300,17 +2845,40 @@ obj_contains(uintptr_t addr, uint8_t type, uintptr_t target,
 		}
 
 		length = v8fixedarray_length(arrayp);
-		size = V8_OFF_FIXEDARRAY_DATA + length * sizeof (uintptr_t);
+		*sizep = V8_OFF_FIXEDARRAY_DATA + length * sizeof (uintptr_t);
 		v8fixedarray_free(arrayp);
-		*containsp = target < addr + size;
 		return (0);
 	}
 
-	if (read_size(&objsize, addr) != 0) {
-		return (-1);
+	if (type == V8_TYPE_FIXEDDOUBLEARRAY) {
+		uintptr_t length;
+
+		if (read_heap_smi(&length, addr, V8_OFF_FIXEDARRAY_LENGTH) != 0)
+			return (-1);
+
+		*sizep = V8_OFF_FIXEDARRAY_DATA + length * sizeof (double);
+		return (0);
+	}
+
+	return (read_size(sizep, addr));
+}
+
+/*
+ * Attempts to determine whether the object at "addr" might contain the address
+ * "target".  This is used for low-level heuristic analysis.  Note that it's
+ * possible that we cannot tell whether the address is contained (e.g., if this
+ * is a variable-length object and we can't read how big it is).
+ */
+static int
+obj_contains(uintptr_t addr, uint8_t type, uintptr_t target,
+    boolean_t *containsp, int memflags)
+{
+	size_t size;
+
+	if (obj_size(addr, type, &size, memflags) != 0) {
+		return (-1);
 	}
 
-	size = objsize;
 	if (type == V8_TYPE_JSOBJECT) {
 		/*
 		 * Instances of JSObject can also contain a number of property
@@ -2320,12 +2888,12 @@ obj_contains(uintptr_t addr, uint8_t type, uintptr_t target,
 		 */
 		uintptr_t map;
 		uint8_t ninprops;
-		if (mdb_vread(&map, sizeof (map),
+		if (mdbv8_vread(&map, sizeof (map),
 		    addr + V8_OFF_HEAPOBJECT_MAP) == -1) {
 			return (-1);
 		}
 
-		if (mdb_vread(&ninprops, sizeof (ninprops),
+		if (mdbv8_vread(&ninprops, sizeof (ninprops),
 		    map + V8_OFF_MAP_INOBJECT_PROPERTIES) == -1) {
 			return (-1);
 		}
@@ -2578,15 +3146,25 @@ jsobj_properties(uintptr_t addr,
 	jsobj_layout_t layout;
 	v8propvalue_t value;
 	boolean_t untagged;
+	heap_field_t fields[] = {
+		{ V8_OFF_HEAPOBJECT_MAP, HF_PTR, &map },
+		{ V8_OFF_JSOBJECT_PROPERTIES, HF_PTR, &ptr },
+		{ V8_OFF_JSOBJECT_ELEMENTS, HF_PTR, &elements }
+	};
+
+	/*
+	 * The Map, properties, and elements are all in the object's header, so
+	 * we read them together.
+	 */
+	if (read_heap_fields(addr, fields,
+	    sizeof (fields) / sizeof (fields[0])) != 0)
+		return (-1);
 
 	/*
 	 * First, check if the JSObject's "properties" field is a FixedArray.
 	 * If not, then this is something we don't know how to deal with, and
 	 * we'll just pass the caller a NULL value.
 	 */
-	if (mdb_vread(&ptr, ps, addr + V8_OFF_JSOBJECT_PROPERTIES) == -1)
-		return (-1);
-
 	if (read_typebyte(&type, ptr) != 0)
 		return (-1);
 
@@ -2600,12 +3178,9 @@ jsobj_properties(uintptr_t addr,
 	}
 
 	/*
-	 * As described above, we need the Map to figure out how to iterate the
-	 * properties for this object.
+	 * As described above, we need the Map (which we've already read) to
+	 * figure out how to iterate the properties for this object.
 	 */
-	if (mdb_vread(&map, ps, addr + V8_OFF_HEAPOBJECT_MAP) == -1)
-		goto err;
-
 	/*
 	 * Check to see if our elements member is an array and non-zero; if
 	 * so, it contains numerically-named properties.  Whether or not there
@@ -2617,12 +3192,11 @@ jsobj_properties(uintptr_t addr,
 	 */
 	if (V8_ELEMENTS_KIND_SHIFT != -1 &&
 	    type != V8_TYPE_JSTYPEDARRAY &&
-	    read_heap_ptr(&elements, addr, V8_OFF_JSOBJECT_ELEMENTS) == 0 &&
 	    read_heap_array(elements, &elts, &len, UM_SLEEP) == 0 && len != 0) {
 		uint8_t bit_field2, kind;
 		size_t sz = len * sizeof (uintptr_t);
 
-		if (mdb_vread(&bit_field2, sizeof (bit_field2),
+		if (mdbv8_vread(&bit_field2, sizeof (bit_field2),
 		    map + V8_OFF_MAP_BIT_FIELD2) == -1) {
 			mdb_free(elts, sz);
 			goto err;
@@ -2635,7 +3209,7 @@ jsobj_properties(uintptr_t addr,
 		if (kind == V8_ELEMENTS_FAST_ELEMENTS ||
 		    kind == V8_ELEMENTS_FAST_HOLEY_ELEMENTS) {
 			for (ii = 0; ii < len; ii++) {
-				char name[10];
+				char name[sizeof ("-9223372036854775808")];
 
 				if (kind == V8_ELEMENTS_FAST_HOLEY_ELEMENTS &&
 				    jsobj_is_hole(elts[ii]))
@@ -2695,13 +3269,13 @@ jsobj_properties(uintptr_t addr,
 			 * the int-sized not-a-SMI world.
 			 */
 			unsigned int bf3_value;
-			if (mdb_vread(&bf3_value, sizeof (bf3_value),
+			if (mdbv8_vread(&bf3_value, sizeof (bf3_value),
 			    map + V8_OFF_MAP_BIT_FIELD3) == -1)
 				goto err;
 			bit_field3 = (uintptr_t)bf3_value;
 		} else {
 			/* The metadata indicates this is an SMI. */
-			if (mdb_vread(&bit_field3, sizeof (bit_field3),
+			if (mdbv8_vread(&bit_field3, sizeof (bit_field3),
 			    map + V8_OFF_MAP_BIT_FIELD3) == -1)
 					goto err;
 			bit_field3 = V8_SMI_VALUE(bit_field3);
@@ -2716,7 +3290,7 @@ jsobj_properties(uintptr_t addr,
 	} else if (V8_OFF_MAP_INSTANCE_DESCRIPTORS != -1) {
 		uintptr_t bit_field3;
 
-		if (mdb_vread(&bit_field3, sizeof (bit_field3),
+		if (mdbv8_vread(&bit_field3, sizeof (bit_field3),
 		    map + V8_OFF_MAP_INSTANCE_DESCRIPTORS) == -1)
 			goto err;
 
@@ -2759,7 +3333,7 @@ jsobj_properties(uintptr_t addr,
 
 		propinfo |= JPI_HASTRANSITIONS;
 		off = V8_OFF_MAP_TRANSITIONS;
-		if (mdb_vread(&ptr, ps, map + off) == -1)
+		if (mdbv8_vread(&ptr, ps, map + off) == -1)
 			goto err;
 
 		if (read_heap_array(ptr, &trans, &ntrans, UM_SLEEP) != 0)
@@ -2769,7 +3343,7 @@ jsobj_properties(uintptr_t addr,
 		mdb_free(trans, ntrans * sizeof (uintptr_t));
 	} else {
 		off = V8_OFF_MAP_INSTANCE_DESCRIPTORS;
-		if (mdb_vread(&ptr, ps, map + off) == -1)
+		if (mdbv8_vread(&ptr, ps, map + off) == -1)
 			goto err;
 	}
 
@@ -2788,7 +3362,7 @@ jsobj_properties(uintptr_t addr,
 	 */
 	if (read_size(&size, addr) != 0)
 		size = 0;
-	if (mdb_vread(&ninprops, sizeof (ninprops),
+	if (mdbv8_vread(&ninprops, sizeof (ninprops),
 	    map + V8_OFF_MAP_INOBJECT_PROPERTIES) == -1)
 		goto err;
 
@@ -2977,7 +3551,7 @@ jsobj_properties(uintptr_t addr,
 		 */
 		if (propaddr != 0) {
 			/* This is an in-object property. */
-			if (mdb_vread(&ptr, sizeof (ptr), propaddr) == -1) {
+			if (mdbv8_vread(&ptr, sizeof (ptr), propaddr) == -1) {
 				propinfo |= JPI_SKIPPED;
 				v8_warn("object %p: failed to read in-object "
 				    "property at %p", addr, propaddr);
@@ -3213,7 +3787,7 @@ jsobj_layout_load(jsobj_layout_t *layoutp, uintptr_t map)
 		return (-1);
 	}
 
-	if (mdb_vread(layoutp->jl_bitvecs,
+	if (mdbv8_vread(layoutp->jl_bitvecs,
 	    layoutp->jl_length * sizeof (uint32_t),
 	    V8_OFF_HEAP(layoutp->jl_descriptor + off)) == -1) {
 		v8_warn("large-style layout descriptor: failed to read array");
@@ -3316,7 +3890,8 @@ jsfunc_lineno(uintptr_t lendsp, uintptr_t tokpos,
 		return (-1);
 	}
 
-	if (mdb_vread(data, bufsz, lendsp + V8_OFF_FIXEDARRAY_DATA) != bufsz) {
+	if (mdbv8_vread(data, bufsz,
+	    lendsp + V8_OFF_FIXEDARRAY_DATA) != bufsz) {
 		v8_warn("failed to read FixedArray data");
 		mdb_free(data, bufsz);
 		return (-1);
@@ -3531,19 +4106,19 @@ jsobj_print_value(v8propvalue_t *valp, jsobj_print_t *jsop)
 		{ NULL }
 	}, *ent;
 
-	if (jsop->jsop_baseaddr != NULL && jsop->jsop_member == NULL)
+	if (jsop->jsop_baseaddr != 0 && jsop->jsop_member == NULL)
 		(void) bsnprintf(bufp, lenp, "%p: ", jsop->jsop_baseaddr);
 
 	if (jsop->jsop_printaddr && jsop->jsop_member == NULL)
 		(void) bsnprintf(bufp, lenp, "%p: ",
-		    valp == NULL ? NULL : valp->v8v_u.v8vu_addr);
+		    valp == NULL ? 0 : valp->v8v_u.v8vu_addr);
 
 	if (valp != NULL && valp->v8v_isboxeddouble) {
 		jsobj_print_double(bufp, lenp, valp->v8v_u.v8vu_double);
 		return (0);
 	}
 
-	addr = valp == NULL ? NULL : valp->v8v_u.v8vu_addr;
+	addr = valp == NULL ? 0 : valp->v8v_u.v8vu_addr;
 	if (V8_IS_SMI(addr)) {
 		(void) bsnprintf(bufp, lenp, "%d", V8_SMI_VALUE(addr));
 		return (0);
@@ -4462,13 +5037,23 @@ jsframe_print_skipped(jsframe_t *jsf)
 	jsf->jsf_nskipped = 0;
 }
 
-static int
-do_jsframe_special(uintptr_t fptr, uintptr_t raddr, jsframe_t *jsf)
+typedef enum {
+	JSFRAME_NATIVE,		/* native (non-V8) frame */
+	JSFRAME_ADAPTOR,	/* V8 < 5.1 ArgumentsAdaptor frame */
+	JSFRAME_INTERNAL,	/* other internal V8 frame */
+	JSFRAME_JS		/* presumed JavaScript frame */
+} jsframe_kind_t;
+
+/*
+ * Classify the frame at "fptr", whose return address is "raddr".  For
+ * internal frames, "*ftypenamep" is set to the name of the frame type (or
+ * NULL if it's not known).
+ */
+static jsframe_kind_t
+jsframe_classify(uintptr_t fptr, uintptr_t raddr, const char **ftypenamep)
 {
-	uint_t count;
 	uintptr_t ftype;
 	const char *ftypename;
-	char *prop = jsf->jsf_prop;
 	uintptr_t internal_frametype_addr;
 
 	/*
@@ -4477,23 +5062,8 @@ do_jsframe_special(uintptr_t fptr, uintptr_t raddr, jsframe_t *jsf)
 	 * symbolically.  If that works, we assume this was NOT a V8 frame,
 	 * since those are never in the symbol table.
 	 */
-	count = mdb_snprintf(NULL, 0, "%A", raddr);
-	if (count > 1) {
-		if (prop != NULL)
-			return (0);
-
-		jsframe_print_skipped(jsf);
-		if (jsf->jsf_showall) {
-			mdb_printf("%p %a\n", fptr, raddr);
-		} else if (count <= 65) {
-			mdb_printf("native: %a\n", raddr);
-		} else {
-			char buf[65];
-			mdb_snprintf(buf, sizeof (buf), "%a", raddr);
-			mdb_printf("native: %s...\n", buf);
-		}
-		return (0);
-	}
+	if (mdb_snprintf(NULL, 0, "%A", raddr) > 1)
+		return (JSFRAME_NATIVE);
 
 	/*
 	 * Figure out what kind of internal frame this is using the same
@@ -4514,39 +5084,91 @@ do_jsframe_special(uintptr_t fptr, uintptr_t raddr, jsframe_t *jsf)
 	    V8_IS_SMI(ftype) &&
 	    (ftypename = enum_lookup_str(v8_frametypes, V8_SMI_VALUE(ftype),
 	    NULL)) != NULL && strstr(ftypename, "ArgumentsAdaptor") != NULL) {
+		*ftypenamep = ftypename;
+		return (JSFRAME_ADAPTOR);
+	}
+
+	internal_frametype_addr = fptr + V8_OFF_FP_CONTEXT_OR_FRAME_TYPE;
+	if (mdb_vread(&ftype, sizeof (ftype), internal_frametype_addr) != -1 &&
+	    V8_IS_SMI(ftype)) {
+		*ftypenamep = enum_lookup_str(v8_frametypes,
+		    V8_SMI_VALUE(ftype), NULL);
+		return (JSFRAME_INTERNAL);
+	}
+
+	return (JSFRAME_JS);
+}
+
+/*
+ * Read the function slot of the JavaScript frame at "fptr".
+ */
+static int
+jsframe_function(uintptr_t fptr, uintptr_t *funcpp)
+{
+	if (mdb_vread(funcpp, sizeof (*funcpp),
+	    fptr + V8_OFF_FP_FUNCTION) == -1) {
+		v8_warn("failed to read stack at %p",
+		    fptr + V8_OFF_FP_FUNCTION);
+		return (-1);
+	}
+
+	return (0);
+}
+
+/*
+ * Read an argument of the JavaScript frame at "fptr", whose function takes
+ * "nargs" arguments.  Argument 0 is the receiver ("this"); arguments 1
+ * through "nargs" are the function's formal arguments.
+ */
+static int
+jsframe_arg(uintptr_t fptr, uintptr_t nargs, uintptr_t argn,
+    uintptr_t *argp)
+{
+	return (mdb_vread(argp, sizeof (*argp), fptr + V8_OFF_FP_ARGS +
+	    (nargs - argn) * sizeof (uintptr_t)) == -1 ? -1 : 0);
+}
+
+static int
+do_jsframe_special(uintptr_t fptr, uintptr_t raddr, jsframe_t *jsf)
+{
+	uint_t count;
+	const char *ftypename = NULL;
+	char *prop = jsf->jsf_prop;
+
+	switch (jsframe_classify(fptr, raddr, &ftypename)) {
+	case JSFRAME_NATIVE:
 		if (prop != NULL)
 			return (0);
 
+		count = mdb_snprintf(NULL, 0, "%A", raddr);
+		jsframe_print_skipped(jsf);
 		if (jsf->jsf_showall) {
-			jsframe_print_skipped(jsf);
-			mdb_printf("%p %a <%s>\n", fptr, raddr,
-			    ftypename);
+			mdb_printf("%p %a\n", fptr, raddr);
+		} else if (count <= 65) {
+			mdb_printf("native: %a\n", raddr);
 		} else {
-			jsframe_skip(jsf);
+			char buf[65];
+			mdb_snprintf(buf, sizeof (buf), "%a", raddr);
+			mdb_printf("native: %s...\n", buf);
 		}
 		return (0);
-	}
 
-	internal_frametype_addr = fptr + V8_OFF_FP_CONTEXT_OR_FRAME_TYPE;
-	if (mdb_vread(&ftype, sizeof (ftype), internal_frametype_addr) != -1 &&
-	    V8_IS_SMI(ftype)) {
+	case JSFRAME_ADAPTOR:
+	case JSFRAME_INTERNAL:
 		if (prop != NULL)
 			return (0);
 
-		ftypename = enum_lookup_str(v8_frametypes, V8_SMI_VALUE(ftype),
-		    NULL);
-
 		if (jsf->jsf_showall && ftypename != NULL) {
 			jsframe_print_skipped(jsf);
 			mdb_printf("%p %a <%s>\n", fptr, raddr, ftypename);
 		} else {
 			jsframe_skip(jsf);
 		}
-
 		return (0);
-	}
 
-	return (-1);
+	default:
+		return (-1);
+	}
 }
 
 static int
@@ -4577,12 +5199,8 @@ do_jsframe(uintptr_t fptr, uintptr_t raddr, jsframe_t *jsf)
 	 * At this point we assume we're looking at a JavaScript frame.  As with
 	 * native frames, fish the address out of the parent frame.
 	 */
-	if (mdb_vread(&funcp, sizeof (funcp),
-	    fptr + V8_OFF_FP_FUNCTION) == -1) {
-		v8_warn("failed to read stack at %p",
-		    fptr + V8_OFF_FP_FUNCTION);
+	if (jsframe_function(fptr, &funcp) != 0)
 		return (DCMD_ERR);
-	}
 
 	/*
 	 * Check if this thing is really a JSFunction at all. For some frames,
@@ -4706,11 +5324,9 @@ do_jsframe(uintptr_t fptr, uintptr_t raddr, jsframe_t *jsf)
 	if (read_heap_maybesmi(&nargs, funcinfop,
 	    V8_OFF_SHAREDFUNCTIONINFO_LENGTH) == 0) {
 		uintptr_t argptr;
-		char arg[10];
+		char arg[sizeof ("arg18446744073709551615")];
 
-		if (mdb_vread(&argptr, sizeof (argptr),
-		    fptr + V8_OFF_FP_ARGS + nargs * sizeof (uintptr_t)) != -1 &&
-		    argptr != NULL) {
+		if (jsframe_arg(fptr, nargs, 0, &argptr) == 0 && argptr != 0) {
 			(void) snprintf(arg, sizeof (arg), "this");
 			if (prop != NULL && strcmp(arg, prop) == 0) {
 				mdb_printf("%p\n", argptr);
@@ -4727,9 +5343,7 @@ do_jsframe(uintptr_t fptr, uintptr_t raddr, jsframe_t *jsf)
 		}
 
 		for (ii = 0; ii < nargs; ii++) {
-			if (mdb_vread(&argptr, sizeof (argptr),
-			    fptr + V8_OFF_FP_ARGS + (nargs - ii - 1) *
-			    sizeof (uintptr_t)) == -1)
+			if (jsframe_arg(fptr, nargs, ii + 1, &argptr) != 0)
 				continue;
 
 			(void) snprintf(arg, sizeof (arg), "arg%" PRIuPTR,
@@ -4771,7 +5385,8 @@ do_jsframe(uintptr_t fptr, uintptr_t raddr, jsframe_t *jsf)
 
 typedef struct findjsobjects_prop {
 	struct findjsobjects_prop *fjsp_next;
-	char fjsp_desc[1];
+	uint32_t fjsp_id;
+	const char *fjsp_desc;
 } findjsobjects_prop_t;
 
 typedef struct findjsobjects_instance {
@@ -4786,8 +5401,13 @@ typedef struct findjsobjects_obj {
 	size_t fjso_nprops;
 	findjsobjects_instance_t fjso_instances;
 	int fjso_ninstances;
+	const uint64_t *fjso_pending;	/* instances still in loaded index */
+	size_t fjso_npending;		/* number of pending instances */
+	uint64_t fjso_bytes;		/* total shallow size of instances */
 	avl_node_t fjso_node;
 	struct findjsobjects_obj *fjso_next;
+	struct findjsobjects_obj *fjso_hnext;
+	uint64_t fjso_fingerprint;
 	boolean_t fjso_malformed;
 	char fjso_constructor[80];
 } findjsobjects_obj_t;
@@ -4795,16 +5415,20 @@ typedef struct findjsobjects_obj {
 typedef struct findjsobjects_func {
 	findjsobjects_instance_t fjsf_instances;
 	int fjsf_ninstances;
+	const uint64_t *fjsf_pending;	/* instances still in loaded index */
+	size_t fjsf_npending;		/* number of pending instances */
 	avl_node_t fjsf_node;
 	struct findjsobjects_func *fjsf_next;
 	uintptr_t fjsf_shared;
 	char fjsf_funcname[40];
 	char fjsf_scriptname[80];
 	char fjsf_location[20];
+	uint64_t fjsf_ncontexts;
+	uint64_t fjsf_ctxbytes;
 } findjsobjects_func_t;
 
 typedef struct findjsobjects_stats {
-	int fjss_heapobjs;
+	uint64_t fjss_words;
 	int fjss_cached;
 	int fjss_typereads;
 	int fjss_jsobjs;
@@ -4815,8 +5439,71 @@ typedef struct findjsobjects_stats {
 	int fjss_funcs;
 	int fjss_funcs_skipped;
 	int fjss_funcs_unique;
+	int fjss_notmaps;
+	uint64_t fjss_candidates;
+	uint64_t fjss_typecache_hits;
+	uint64_t fjss_typecache_misses;
+	uint64_t fjss_collisions;
+	uint64_t fjss_mapmemo_hits;
+	uint64_t fjss_windows;
+	uint64_t fjss_unreadable;
+	uint64_t fjss_objbytes;		/* shallow bytes of JSObjects */
+	uint64_t fjss_arraybytes;	/* shallow bytes of JSArrays */
+	uint64_t fjss_typedbytes;	/* shallow bytes of JSTypedArrays */
+	uint64_t fjss_externalbytes;	/* typed array data (included above) */
+	hrtime_t fjss_scantime;
 } findjsobjects_stats_t;
 
+/*
+ * The heap scan operates on a list of chunks of the target's address space.
+ * Each chunk is a whole mapping, unless we're scanning in parallel, in which
+ * case large mappings are split into chunks of at most fjs_chunksize bytes so
+ * that the work can be spread evenly across workers.
+ */
+typedef struct findjsobjects_chunk {
+	uintptr_t fjsc_addr;
+	size_t fjsc_size;
+} findjsobjects_chunk_t;
+
+/*
+ * A parallel scan forks one worker process per contiguous run of chunks.  The
+ * worker scans its chunks exactly as a serial scan would and then serializes
+ * what it found into fjsw_results, which the parent merges once the worker
+ * has exited.
+ */
+typedef struct findjsobjects_worker {
+	pid_t fjsw_pid;
+	FILE *fjsw_results;
+	size_t fjsw_first;
+	size_t fjsw_nchunks;
+	uint64_t fjsw_nbytes;
+	hrtime_t fjsw_elapsed;
+	int fjsw_jsobjs;
+	boolean_t fjsw_failed;
+} findjsobjects_worker_t;
+
+/*
+ * Header at the start of each worker's results file.  It's followed by
+ * fjsh_nobjs object records and fjsh_nfuncs function records.
+ */
+typedef struct findjsobjects_wheader {
+	uint32_t fjsh_magic;
+	uint32_t fjsh_nobjs;
+	uint32_t fjsh_nfuncs;
+	findjsobjects_stats_t fjsh_stats;
+	uint64_t fjsh_nbytes;
+	hrtime_t fjsh_elapsed;
+} findjsobjects_wheader_t;
+
+#define	FJS_WORKER_MAGIC	0x666a7377	/* "fjsw" */
+#define	FJS_MAXWORKERS		64
+#define	FJS_CHUNKSIZE		(16 * 1024 * 1024)
+#define	FJS_MAXDESC		(64 * 1024)
+#define	FJS_BLOCKWORDS		64
+#define	FJS_MAXMETAMAPS		8
+#define	FJS_NNOTMETAMAPS	256
+#define	FJS_NISIZES		256
+
 typedef struct findjsobjects_reference {
 	uintptr_t fjsrf_addr;
 	char *fjsrf_desc;
@@ -4832,6 +5519,199 @@ typedef struct findjsobjects_referent {
 	struct findjsobjects_referent *fjsr_next;
 } findjsobjects_referent_t;
 
+/*
+ * The bookkeeping for a heap scan (shapes, their property names and their
+ * instances) is allocated from arenas: large chunks from which we allocate
+ * sequentially and which are only freed all at once, when the results of the
+ * scan are discarded.  Candidate objects are built in a scratch shape whose
+ * properties come from a separate scratch arena that's reset for each
+ * candidate; only shapes that we haven't seen before are copied into the main
+ * arena.
+ */
+typedef struct findjsobjects_arena_chunk {
+	struct findjsobjects_arena_chunk *fjsac_next;
+	size_t fjsac_size;
+	size_t fjsac_used;
+} findjsobjects_arena_chunk_t;
+
+typedef struct findjsobjects_arena {
+	findjsobjects_arena_chunk_t *fjsa_head;
+	findjsobjects_arena_chunk_t *fjsa_current;
+	size_t fjsa_mapped;		/* bytes currently in chunks */
+	size_t fjsa_peak;		/* high-water mark of fjsa_mapped */
+	uint64_t fjsa_total;		/* total bytes ever allocated */
+} findjsobjects_arena_t;
+
+#define	FJS_ARENA_CHUNKSIZE	(1024 * 1024)
+#define	FJS_ROUNDUP(x)		\
+	(((x) + sizeof (uint64_t) - 1) & ~(sizeof (uint64_t) - 1))
+
+/*
+ * Property names are interned as they're found: each distinct name is stored
+ * once, in the arena, and given a small integer ID.  Shapes are deduplicated
+ * through a hash table keyed by a fingerprint of the shape's constructor,
+ * property count and property name IDs, so two shapes are only compared
+ * property-by-property when their fingerprints match.  The AVL tree of shapes
+ * (in findjsobjects_cmp() order) is built only once the scan is complete.
+ */
+typedef struct findjsobjects_name {
+	struct findjsobjects_name *fjsn_next;
+	uint64_t fjsn_hash;
+	uint32_t fjsn_id;
+	char fjsn_str[1];
+} findjsobjects_name_t;
+
+#define	FJS_NAMEBUCKETS		1024
+#define	FJS_SHAPEBUCKETS	4096
+
+/*
+ * Objects that share a Map and whose properties are stored in fast mode
+ * (i.e., not in a dictionary) necessarily have the same property names, so
+ * once we've enumerated the properties of one such object, we remember which
+ * shape its Map corresponds to.  Subsequent objects with the same Map are
+ * attributed to that shape after reading only their headers.
+ */
+typedef struct findjsobjects_mapmemo {
+	uintptr_t fjsm_map;
+	struct findjsobjects_obj *fjsm_obj;
+} findjsobjects_mapmemo_t;
+
+#define	FJS_MAPMEMO_NENTRIES	4096
+
+/*
+ * The reverse reference index records, for each heap object referred to by a
+ * property or element of an object that we found, which objects refer to it
+ * and how.  It's built by a single walk of all of the objects' properties, and
+ * it's stored in compressed sparse row form: fjsri_targets holds the
+ * referred-to addresses in sorted order, and the references to
+ * fjsri_targets[i] are at [fjsri_offsets[i], fjsri_offsets[i + 1]) in
+ * fjsri_referrers and fjsri_labels, in the order in which they were found.  A
+ * label is either the ID of an interned property name or, with
+ * FJS_LABEL_ELEMENT set, an array index.  While the index is being built,
+ * fjsri_targets holds the target of each reference, in the order found.
+ */
+typedef struct findjsobjects_revindex {
+	boolean_t fjsri_built;
+	size_t fjsri_ntargets;
+	size_t fjsri_nedges;
+	size_t fjsri_nalloc;
+	uintptr_t *fjsri_targets;
+	size_t *fjsri_offsets;
+	uintptr_t *fjsri_referrers;
+	uint64_t *fjsri_labels;
+} findjsobjects_revindex_t;
+
+#define	FJS_LABEL_ELEMENT	(1ULL << 63)
+
+/*
+ * ::jsretained treats the reverse reference index as a graph whose nodes are
+ * the objects that we found and the objects that they refer to, and computes
+ * its dominator tree: object A dominates object B if every path to B from a
+ * root passes through A.  Since we don't know the VM's actual roots, the
+ * roots are taken to be the objects that no known object refers to (plus one
+ * object from each cycle that is otherwise unreachable).  The retained size
+ * of an object is the sum of the shallow sizes of the objects that it
+ * dominates, including itself: it's the memory that would be freed if the
+ * object were.  The results are stored by node index (in address order), and
+ * each node has a label: its constructor, or if it has none, its V8 type.
+ * Per-label totals of retained size count only objects that are not
+ * dominated by another object with the same label, so that (for example) the
+ * nodes of a linked list are not counted once for each node that precedes
+ * them.
+ *
+ * All of the per-node and per-edge state is held in flat arrays of 32-bit
+ * indexes, so the memory required is proportional to the size of the graph
+ * and can be estimated (and limited, with "-M") before we start.
+ */
+typedef struct findjsobjects_retained {
+	boolean_t fjsrt_built;
+	uint32_t fjsrt_nnodes;
+	uint32_t fjsrt_nroots;
+	uint32_t fjsrt_nlabels;
+	uintptr_t *fjsrt_addrs;
+	uint32_t *fjsrt_shallow;
+	uint64_t *fjsrt_retained;
+	uint32_t *fjsrt_idom;
+	uint32_t *fjsrt_labels;
+	uint64_t *fjsrt_lcount;
+	uint64_t *fjsrt_lshallow;
+	uint64_t *fjsrt_lretained;
+	uint64_t fjsrt_total;
+} findjsobjects_retained_t;
+
+#define	FJS_DOM_NONE		((uint32_t)-1)
+#define	FJS_RETAINED_NDEFAULT	20
+
+/*
+ * Working state for the Lengauer-Tarjan dominator computation.  Vertices are
+ * identified by their depth-first search numbers; vertex 0 is a synthetic
+ * root whose children are the roots of the graph.  Nodes (in address order)
+ * are numbered from 0, and the synthetic root is node fjsd_nnodes.
+ */
+typedef struct findjsobjects_dom {
+	uint32_t fjsd_nnodes;
+	uint32_t fjsd_n;		/* vertices numbered so far */
+	uint32_t fjsd_nedges;
+	uint32_t *fjsd_dfnum;		/* node -> vertex */
+	uint32_t *fjsd_ptarget;		/* node -> revindex target, if any */
+	uint32_t *fjsd_fwdoff;		/* node -> first edge in fjsd_fwd */
+	uint32_t *fjsd_fwd;		/* edge -> referred-to node */
+	uint32_t *fjsd_referrer;	/* revindex edge -> referring node */
+	uint32_t *fjsd_vertex;		/* vertex -> node */
+	uint32_t *fjsd_parent;		/* vertex -> DFS tree parent */
+	uint32_t *fjsd_semi;		/* vertex -> semidominator */
+	uint32_t *fjsd_idom;		/* vertex -> immediate dominator */
+	uint32_t *fjsd_ancestor;	/* vertex -> forest ancestor */
+	uint32_t *fjsd_label;		/* vertex -> forest label */
+	uint32_t *fjsd_bucket;		/* vertex -> first in bucket */
+	uint32_t *fjsd_bnext;		/* vertex -> next in bucket */
+	uint32_t *fjsd_stack;
+} findjsobjects_dom_t;
+
+/*
+ * A serial heap scan is incremental: it records a cursor (a chunk index and
+ * an offset within that chunk) as it goes, and it can stop at a block
+ * boundary when it's interrupted or runs out of time.  The next scan resumes
+ * from the cursor.  Until the scan has covered every chunk, the results are
+ * partial, and we say so whenever they're used.  While scanning, SIGINT is
+ * blocked so that ^C is only acted upon at a checkpoint, when the state is
+ * consistent.  Every FJS_CHECKWORDS words (counted across windows and chunks,
+ * so that a heap made of many small chunks is checked just as often), we check
+ * for a pending SIGINT and for the time budget, and report progress every
+ * FJS_PROGRESS_INTERVAL.
+ *
+ * Parallel scans are not incremental.  SIGINT is blocked during them too, but
+ * it's checked for only while waiting for the workers.  If one is interrupted,
+ * the workers are killed, and the next scan starts again from the beginning.
+ */
+#define	FJS_CHECKWORDS		(64 * 1024)
+
+/*
+ * Memory is read through a window of (by default) FJS_WINDOWSIZE bytes; see
+ * findjsobjects_range().
+ */
+#define	FJS_WINDOWSIZE		(4 * 1024 * 1024)
+#define	FJS_WINDOW_OVERLAP	(64 * 1024)
+#define	FJS_WINDOW_MIN		4096
+#define	FJS_PROGRESS_INTERVAL	(5 * NANOSEC)
+#define	FJS_WAIT_INTERVAL	100		/* milliseconds */
+
+/*
+ * A heap scan started by findjsobjects_visit() passes each candidate object to
+ * a function like this one, along with the object's map and the instance type
+ * recorded in that map.
+ */
+typedef void findjsobjects_visit_f(void *, uintptr_t, uintptr_t, uint8_t);
+
+/*
+ * An entry in the table of instance addresses of a saved index (see
+ * findjsobjects_save()), which is sorted by address.
+ */
+typedef struct findjsobjects_iaddr {
+	uint64_t fjsia_addr;		/* address of instance */
+	uint64_t fjsia_obj;		/* index of its object record */
+} findjsobjects_iaddr_t;
+
 typedef struct findjsobjects_state {
 	uintptr_t fjs_addr;
 	uintptr_t fjs_size;
@@ -4842,6 +5722,10 @@ typedef struct findjsobjects_state {
 	boolean_t fjs_marking;
 	boolean_t fjs_referred;
 	boolean_t fjs_finished;
+	boolean_t fjs_scanning;
+	boolean_t fjs_aborted;
+	boolean_t fjs_incremental;
+	boolean_t fjs_interrupted;
 	avl_tree_t fjs_tree;
 	avl_tree_t fjs_referents;
 	avl_tree_t fjs_funcinfo;
@@ -4851,32 +5735,156 @@ typedef struct findjsobjects_state {
 	findjsobjects_obj_t *fjs_objects;
 	findjsobjects_func_t *fjs_funcs;
 	findjsobjects_stats_t fjs_stats;
+	findjsobjects_arena_t fjs_arena;
+	findjsobjects_arena_t fjs_scratch;
+	findjsobjects_obj_t fjs_scratchobj;
+	findjsobjects_func_t fjs_scratchfunc;
+	findjsobjects_name_t **fjs_names;
+	size_t fjs_nnamebuckets;
+	uint32_t fjs_nnames;
+	findjsobjects_name_t **fjs_nametab;
+	size_t fjs_nametabsz;
+	findjsobjects_revindex_t fjs_revindex;
+	boolean_t fjs_indexing;
+	findjsobjects_retained_t fjs_retained;
+	findjsobjects_obj_t **fjs_shapes;
+	size_t fjs_nshapebuckets;
+	size_t fjs_nshapes;
+	findjsobjects_mapmemo_t *fjs_mapmemo;
+	size_t fjs_nmapmemo;
+	size_t fjs_mapmemoused;
+	uint_t fjs_nworkers;
+	findjsobjects_chunk_t *fjs_chunks;
+	size_t fjs_nchunks;
+	size_t fjs_chunksalloc;
+	size_t fjs_chunksize;
+	uint64_t fjs_nbytes;
+	size_t fjs_cursor_chunk;
+	size_t fjs_cursor_off;
+	uint64_t fjs_nscanned;
+	size_t fjs_unchecked;
+	size_t fjs_window;
+	uintptr_t fjs_wbase;
+	size_t fjs_wlen;
+	caddr_t fjs_wdata;
+	uintptr_t fjs_budget;
+	hrtime_t fjs_deadline;
+	hrtime_t fjs_progstart;
+	hrtime_t fjs_proglast;
+	uint64_t fjs_progbytes;
+	int fjs_progobjs;
+	findjsobjects_worker_t *fjs_workers;
+	const char *fjs_loadpath;
+	char *fjs_index;
+	size_t fjs_indexsz;
+	const findjsobjects_iaddr_t *fjs_iaddrs;
+	uint64_t fjs_niaddrs;
+	findjsobjects_obj_t **fjs_ishapes;
+	size_t fjs_nishapes;
+	uint_t fjs_nmetamaps;
+	uintptr_t fjs_metamaps[FJS_MAXMETAMAPS];
+	uintptr_t fjs_notmetamaps[FJS_NNOTMETAMAPS];
+	uintptr_t fjs_isizemaps[FJS_NISIZES];
+	size_t fjs_isizes[FJS_NISIZES];
+	findjsobjects_visit_f *fjs_visit;
+	void *fjs_visitarg;
+	boolean_t fjs_ctxvalid;
 } findjsobjects_state_t;
 
-findjsobjects_obj_t *
-findjsobjects_alloc(uintptr_t addr)
+/*
+ * Allocate zeroed memory from an arena.
+ */
+static void *
+findjsobjects_arena_alloc(findjsobjects_arena_t *arena, size_t size)
 {
-	findjsobjects_obj_t *obj;
+	findjsobjects_arena_chunk_t *chunk = arena->fjsa_current;
+	size_t hdrsz = FJS_ROUNDUP(sizeof (*chunk));
+	size_t chunksz;
+	void *rv;
 
-	obj = mdb_zalloc(sizeof (findjsobjects_obj_t), UM_SLEEP);
-	obj->fjso_instances.fjsi_addr = addr;
-	obj->fjso_ninstances = 1;
+	size = FJS_ROUNDUP(size);
+	arena->fjsa_total += size;
 
-	return (obj);
+	/*
+	 * Move on to the next chunk (left over from before the arena was last
+	 * reset) or allocate a new one if this one is full.
+	 */
+	while (chunk == NULL || chunk->fjsac_used + size > chunk->fjsac_size) {
+		if (chunk != NULL && chunk->fjsac_next != NULL) {
+			chunk = chunk->fjsac_next;
+			chunk->fjsac_used = 0;
+			continue;
+		}
+
+		chunksz = MAX(FJS_ARENA_CHUNKSIZE, size);
+		rv = mdb_alloc(hdrsz + chunksz, UM_SLEEP);
+		arena->fjsa_mapped += hdrsz + chunksz;
+		arena->fjsa_peak = MAX(arena->fjsa_peak, arena->fjsa_mapped);
+
+		if (chunk == NULL)
+			arena->fjsa_head = rv;
+		else
+			chunk->fjsac_next = rv;
+
+		chunk = rv;
+		chunk->fjsac_next = NULL;
+		chunk->fjsac_size = chunksz;
+		chunk->fjsac_used = 0;
+	}
+
+	arena->fjsa_current = chunk;
+	rv = (char *)chunk + hdrsz + chunk->fjsac_used;
+	chunk->fjsac_used += size;
+	bzero(rv, size);
+
+	return (rv);
 }
 
-void
-findjsobjects_free(findjsobjects_obj_t *obj)
+/*
+ * Make all of the memory in an arena available for reuse.
+ */
+static void
+findjsobjects_arena_reset(findjsobjects_arena_t *arena)
+{
+	arena->fjsa_current = arena->fjsa_head;
+
+	if (arena->fjsa_head != NULL)
+		arena->fjsa_head->fjsac_used = 0;
+}
+
+/*
+ * Free all of the memory in an arena.
+ */
+static void
+findjsobjects_arena_release(findjsobjects_arena_t *arena)
 {
-	findjsobjects_prop_t *prop, *next;
+	findjsobjects_arena_chunk_t *chunk, *next;
+	size_t hdrsz = FJS_ROUNDUP(sizeof (*chunk));
 
-	for (prop = obj->fjso_props; prop != NULL; prop = next) {
-		next = prop->fjsp_next;
-		mdb_free(prop, sizeof (findjsobjects_prop_t) +
-		    strlen(prop->fjsp_desc));
+	for (chunk = arena->fjsa_head; chunk != NULL; chunk = next) {
+		next = chunk->fjsac_next;
+		mdb_free(chunk, hdrsz + chunk->fjsac_size);
 	}
 
-	mdb_free(obj, sizeof (findjsobjects_obj_t));
+	arena->fjsa_head = NULL;
+	arena->fjsa_current = NULL;
+	arena->fjsa_mapped = 0;
+}
+
+/*
+ * Begin building a new candidate object in the scratch shape.
+ */
+static findjsobjects_obj_t *
+findjsobjects_alloc(findjsobjects_state_t *fjs, uintptr_t addr)
+{
+	findjsobjects_obj_t *obj = &fjs->fjs_scratchobj;
+
+	findjsobjects_arena_reset(&fjs->fjs_scratch);
+	bzero(obj, sizeof (*obj));
+	obj->fjso_instances.fjsi_addr = addr;
+	obj->fjso_ninstances = 1;
+
+	return (obj);
 }
 
 int
@@ -4895,7 +5903,8 @@ findjsobjects_cmp(findjsobjects_obj_t *lhs, findjsobjects_obj_t *rhs)
 	rprop = rhs->fjso_props;
 
 	while (lprop != NULL && rprop != NULL) {
-		if ((rv = strcmp(lprop->fjsp_desc, rprop->fjsp_desc)) != 0)
+		if (lprop->fjsp_id != rprop->fjsp_id &&
+		    (rv = strcmp(lprop->fjsp_desc, rprop->fjsp_desc)) != 0)
 			return (rv > 0 ? 1 : -1);
 
 		lprop = lprop->fjsp_next;
@@ -4969,1616 +5978,9126 @@ findjsobjects_cmp_ninstances(const void *l, const void *r)
 	return (0);
 }
 
-/*ARGSUSED*/
 int
-findjsobjects_prop(const char *desc, v8propvalue_t *val, void *arg)
+findjsobjects_cmp_bytes(const void *l, const void *r)
 {
-	findjsobjects_state_t *fjs = arg;
-	findjsobjects_obj_t *current = fjs->fjs_current;
-	findjsobjects_prop_t *prop;
+	findjsobjects_obj_t *lhs = *((findjsobjects_obj_t **)l);
+	findjsobjects_obj_t *rhs = *((findjsobjects_obj_t **)r);
 
-	if (desc == NULL)
-		desc = "<unknown>";
+	if (lhs->fjso_bytes < rhs->fjso_bytes)
+		return (-1);
 
-	prop = mdb_zalloc(sizeof (findjsobjects_prop_t) +
-	    strlen(desc), UM_SLEEP);
+	if (lhs->fjso_bytes > rhs->fjso_bytes)
+		return (1);
 
-	strcpy(prop->fjsp_desc, desc);
+	return (findjsobjects_cmp_ninstances(l, r));
+}
 
-	if (current->fjso_last != NULL) {
-		current->fjso_last->fjsp_next = prop;
-	} else {
-		current->fjso_props = prop;
-	}
+static uint64_t
+findjsobjects_strhash(const char *str)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
 
-	current->fjso_last = prop;
-	current->fjso_nprops++;
-	current->fjso_malformed =
-	    val == NULL && current->fjso_nprops == 1 && desc[0] == '<';
+	while (*str != '\0') {
+		hash ^= (uint8_t)*str++;
+		hash *= 0x100000001b3ULL;
+	}
 
-	return (0);
+	return (hash);
 }
 
-static void
-findjsobjects_constructor(findjsobjects_obj_t *obj)
+static uint64_t
+findjsobjects_mix(uint64_t hash, uint64_t val)
 {
-	char *bufp = obj->fjso_constructor;
-	size_t len = sizeof (obj->fjso_constructor);
-	uintptr_t map, funcinfop;
-	uintptr_t addr = obj->fjso_instances.fjsi_addr;
-	uint8_t type;
+	hash = (hash ^ val) * 0x9e3779b97f4a7c15ULL;
 
-	v8_silent++;
+	return (hash ^ (hash >> 29));
+}
 
-	if (read_heap_ptr(&map, addr, V8_OFF_HEAPOBJECT_MAP) != 0 ||
-	    get_map_constructor(&addr, map) != 0)
-		goto out;
+/*
+ * Returns the interned copy of the property name "desc", adding it if
+ * necessary.
+ */
+static findjsobjects_name_t *
+findjsobjects_intern(findjsobjects_state_t *fjs, const char *desc)
+{
+	uint64_t hash = findjsobjects_strhash(desc);
+	findjsobjects_name_t *name, *next, **buckets;
+	size_t i, j, nbuckets, len;
+
+	if (fjs->fjs_nnames >= fjs->fjs_nnamebuckets) {
+		nbuckets = fjs->fjs_nnamebuckets == 0 ?
+		    FJS_NAMEBUCKETS : fjs->fjs_nnamebuckets * 2;
+		buckets = mdb_zalloc(nbuckets * sizeof (void *), UM_SLEEP);
+
+		for (i = 0; i < fjs->fjs_nnamebuckets; i++) {
+			for (name = fjs->fjs_names[i]; name != NULL;
+			    name = next) {
+				next = name->fjsn_next;
+				j = name->fjsn_hash & (nbuckets - 1);
+				name->fjsn_next = buckets[j];
+				buckets[j] = name;
+			}
+		}
 
-	if (read_typebyte(&type, addr) != 0)
-		goto out;
+		if (fjs->fjs_names != NULL)
+			mdb_free(fjs->fjs_names,
+			    fjs->fjs_nnamebuckets * sizeof (void *));
 
-	if (type != V8_TYPE_JSFUNCTION)
-		goto out;
+		fjs->fjs_names = buckets;
+		fjs->fjs_nnamebuckets = nbuckets;
+	}
 
-	if (read_heap_ptr(&funcinfop, addr, V8_OFF_JSFUNCTION_SHARED) != 0)
-		goto out;
+	i = hash & (fjs->fjs_nnamebuckets - 1);
 
-	if (jsfunc_name(funcinfop, &bufp, &len) != 0)
-		goto out;
-out:
-	v8_silent--;
+	for (name = fjs->fjs_names[i]; name != NULL; name = name->fjsn_next) {
+		if (name->fjsn_hash == hash &&
+		    strcmp(name->fjsn_str, desc) == 0)
+			return (name);
+	}
+
+	len = strlen(desc);
+	name = findjsobjects_arena_alloc(&fjs->fjs_arena,
+	    sizeof (findjsobjects_name_t) + len);
+	bcopy(desc, name->fjsn_str, len + 1);
+	name->fjsn_hash = hash;
+	name->fjsn_id = fjs->fjs_nnames++;
+	name->fjsn_next = fjs->fjs_names[i];
+	fjs->fjs_names[i] = name;
+
+	if (name->fjsn_id >= fjs->fjs_nametabsz) {
+		nbuckets = fjs->fjs_nametabsz == 0 ?
+		    FJS_NAMEBUCKETS : fjs->fjs_nametabsz * 2;
+		buckets = mdb_zalloc(nbuckets * sizeof (void *), UM_SLEEP);
+
+		if (fjs->fjs_nametab != NULL) {
+			bcopy(fjs->fjs_nametab, buckets,
+			    fjs->fjs_nametabsz * sizeof (void *));
+			mdb_free(fjs->fjs_nametab,
+			    fjs->fjs_nametabsz * sizeof (void *));
+		}
+
+		fjs->fjs_nametab = buckets;
+		fjs->fjs_nametabsz = nbuckets;
+	}
+
+	fjs->fjs_nametab[name->fjsn_id] = name;
+
+	return (name);
 }
 
 static void
-findjsobjects_jsfunc(findjsobjects_state_t *fjs, uintptr_t addr)
+findjsobjects_prop_append(findjsobjects_arena_t *arena,
+    findjsobjects_obj_t *obj, uint32_t id, const char *desc)
 {
-	findjsobjects_func_t *func, *ofunc;
-	findjsobjects_instance_t *inst;
-	uintptr_t funcinfo, script, name;
-	avl_index_t where;
-	int err;
-	char *bufp;
-	size_t len;
+	findjsobjects_prop_t *prop;
 
-	/*
-	 * This may be somewhat expensive to do for all JSFunctions, but in most
-	 * core files, there aren't that many.  We could defer some of this work
-	 * until the user tries to print the function ::jsfunctions, but this
-	 * step is useful to do early to filter out garbage data.
-	 */
+	prop = findjsobjects_arena_alloc(arena, sizeof (findjsobjects_prop_t));
+	prop->fjsp_id = id;
+	prop->fjsp_desc = desc;
 
-	v8_silent++;
-	if (read_heap_ptr(&funcinfo, addr, V8_OFF_JSFUNCTION_SHARED) != 0 ||
-	    read_heap_ptr(&script, funcinfo,
-	    V8_OFF_SHAREDFUNCTIONINFO_SCRIPT) != 0 ||
-	    read_heap_ptr(&name, script, V8_OFF_SCRIPT_NAME) != 0) {
-		fjs->fjs_stats.fjss_funcs_skipped++;
-		v8_silent--;
-		return;
+	if (obj->fjso_last != NULL) {
+		obj->fjso_last->fjsp_next = prop;
+	} else {
+		obj->fjso_props = prop;
 	}
 
-	func = mdb_zalloc(sizeof (findjsobjects_func_t), UM_SLEEP);
-	func->fjsf_ninstances = 1;
-	func->fjsf_instances.fjsi_addr = addr;
-	func->fjsf_shared = funcinfo;
+	obj->fjso_last = prop;
+}
 
-	bufp = func->fjsf_funcname;
-	len = sizeof (func->fjsf_funcname);
-	err = jsfunc_name(funcinfo, &bufp, &len);
+/*
+ * Append the property "desc" to the scratch shape "obj".
+ */
+static void
+findjsobjects_prop_add(findjsobjects_state_t *fjs, findjsobjects_obj_t *obj,
+    const char *desc)
+{
+	findjsobjects_name_t *name = findjsobjects_intern(fjs, desc);
 
-	bufp = func->fjsf_scriptname;
-	len = sizeof (func->fjsf_scriptname);
-	err |= jsstr_print(name, JSSTR_NUDE, &bufp, &len);
+	findjsobjects_prop_append(&fjs->fjs_scratch, obj,
+	    name->fjsn_id, name->fjsn_str);
+}
 
-	v8_silent--;
-	if (err != 0) {
-		fjs->fjs_stats.fjss_funcs_skipped++;
-		mdb_free(func, sizeof (findjsobjects_func_t));
-		return;
-	}
+/*
+ * Record another instance of an object or function.  The representative
+ * instance stays at the head of the list.
+ */
+static void
+findjsobjects_instance_add(findjsobjects_state_t *fjs,
+    findjsobjects_instance_t *head, uintptr_t addr)
+{
+	findjsobjects_instance_t *inst;
 
-	fjs->fjs_stats.fjss_funcs++;
-	ofunc = avl_find(&fjs->fjs_funcinfo, func, &where);
-	if (ofunc == NULL) {
-		avl_add(&fjs->fjs_funcinfo, func);
-		func->fjsf_next = fjs->fjs_funcs;
-		fjs->fjs_funcs = func;
-		fjs->fjs_stats.fjss_funcs_unique++;
-	} else {
-		inst = mdb_alloc(sizeof (findjsobjects_instance_t), UM_SLEEP);
-		inst->fjsi_addr = addr;
-		inst->fjsi_next = ofunc->fjsf_instances.fjsi_next;
-		ofunc->fjsf_instances.fjsi_next = inst;
-		ofunc->fjsf_ninstances++;
-		mdb_free(func, sizeof (findjsobjects_func_t));
-	}
+	inst = findjsobjects_arena_alloc(&fjs->fjs_arena,
+	    sizeof (findjsobjects_instance_t));
+	inst->fjsi_addr = addr;
+	inst->fjsi_next = head->fjsi_next;
+	head->fjsi_next = inst;
 }
 
-int
-findjsobjects_range(findjsobjects_state_t *fjs, uintptr_t addr, uintptr_t size)
+/*
+ * The instances of an object or function loaded from an index stay in the
+ * mapped index file until a query needs them (see findjsobjects_load()).
+ * These add any such instances to the list, returning its head.
+ */
+static findjsobjects_instance_t *
+findjsobjects_pending_add(findjsobjects_state_t *fjs,
+    findjsobjects_instance_t *head, const uint64_t **pendingp,
+    size_t *npendingp)
 {
-	uintptr_t limit;
-	findjsobjects_stats_t *stats = &fjs->fjs_stats;
-	uint8_t type;
-	int jsobject = V8_TYPE_JSOBJECT, jsarray = V8_TYPE_JSARRAY;
-	int jstypedarray = V8_TYPE_JSTYPEDARRAY;
-	int jsfunction = V8_TYPE_JSFUNCTION;
-	caddr_t range = mdb_alloc(size, UM_SLEEP);
-	uintptr_t base = addr, mapaddr;
+	size_t i;
 
-	if (mdb_vread(range, size, addr) == -1)
-		return (0);
+	/*
+	 * Each instance goes immediately after the head, so we add them in
+	 * reverse to preserve their order.
+	 */
+	for (i = *npendingp; i-- > 0; )
+		findjsobjects_instance_add(fjs, head, (*pendingp)[i]);
 
-	for (limit = addr + size; addr < limit; addr++) {
-		findjsobjects_instance_t *inst;
-		findjsobjects_obj_t *obj;
-		avl_index_t where;
+	*pendingp = NULL;
+	*npendingp = 0;
 
-		if (V8_IS_SMI(addr))
-			continue;
+	return (head);
+}
 
-		if (!V8_IS_HEAPOBJECT(addr))
-			continue;
+static findjsobjects_instance_t *
+findjsobjects_obj_instances(findjsobjects_state_t *fjs,
+    findjsobjects_obj_t *obj)
+{
+	return (findjsobjects_pending_add(fjs, &obj->fjso_instances,
+	    &obj->fjso_pending, &obj->fjso_npending));
+}
 
-		stats->fjss_heapobjs++;
+static findjsobjects_instance_t *
+findjsobjects_func_instances(findjsobjects_state_t *fjs,
+    findjsobjects_func_t *func)
+{
+	return (findjsobjects_pending_add(fjs, &func->fjsf_instances,
+	    &func->fjsf_pending, &func->fjsf_npending));
+}
 
-		mapaddr = *((uintptr_t *)((uintptr_t)range +
-		    (addr - base) + V8_OFF_HEAPOBJECT_MAP));
+/*ARGSUSED*/
+int
+findjsobjects_prop(const char *desc, v8propvalue_t *val, void *arg)
+{
+	findjsobjects_state_t *fjs = arg;
+	findjsobjects_obj_t *current = fjs->fjs_current;
 
-		if (!V8_IS_HEAPOBJECT(mapaddr))
-			continue;
+	if (desc == NULL)
+		desc = "<unknown>";
 
-		mapaddr += V8_OFF_MAP_INSTANCE_ATTRIBUTES;
-		stats->fjss_typereads++;
+	findjsobjects_prop_add(fjs, current, desc);
+	current->fjso_nprops++;
+	current->fjso_malformed =
+	    val == NULL && current->fjso_nprops == 1 && desc[0] == '<';
 
-		if (mapaddr >= base && mapaddr < base + size) {
-			stats->fjss_cached++;
+	return (0);
+}
 
-			type = *((uint8_t *)((uintptr_t)range +
-			    (mapaddr - base)));
-		} else {
-			if (mdb_vread(&type, sizeof (uint8_t), mapaddr) == -1)
-				continue;
-		}
+static void
+findjsobjects_constructor(findjsobjects_obj_t *obj)
+{
+	char *bufp = obj->fjso_constructor;
+	size_t len = sizeof (obj->fjso_constructor);
+	uintptr_t map, funcinfop;
+	uintptr_t addr = obj->fjso_instances.fjsi_addr;
+	uint8_t type;
 
-		if (type == jsfunction) {
-			findjsobjects_jsfunc(fjs, addr);
-			continue;
-		}
+	v8_silent++;
 
-		if (type != jsobject && type != jsarray && type != jstypedarray)
-			continue;
+	if (read_heap_ptr(&map, addr, V8_OFF_HEAPOBJECT_MAP) != 0 ||
+	    get_map_constructor(&addr, map) != 0)
+		goto out;
 
-		stats->fjss_jsobjs++;
+	if (read_typebyte(&type, addr) != 0)
+		goto out;
 
-		fjs->fjs_current = findjsobjects_alloc(addr);
+	if (type != V8_TYPE_JSFUNCTION)
+		goto out;
 
-		if (type == jsobject || type == jstypedarray) {
-			if (jsobj_properties(addr,
-			    findjsobjects_prop, fjs,
-			    &fjs->fjs_current->fjso_propinfo) != 0) {
-				findjsobjects_free(fjs->fjs_current);
-				fjs->fjs_current = NULL;
-				continue;
-			}
+	if (read_heap_ptr(&funcinfop, addr, V8_OFF_JSFUNCTION_SHARED) != 0)
+		goto out;
 
-			if ((fjs->fjs_current->fjso_propinfo &
-			    (JPI_MAYBE_GARBAGE)) != 0) {
-				stats->fjss_garbage++;
-				fjs->fjs_current->fjso_malformed = B_TRUE;
-			}
+	if (jsfunc_name(funcinfop, &bufp, &len) != 0)
+		goto out;
+out:
+	v8_silent--;
+}
 
-			findjsobjects_constructor(fjs->fjs_current);
-			stats->fjss_objects++;
-		} else {
-			uintptr_t ptr;
-			size_t *nprops = &fjs->fjs_current->fjso_nprops;
-			ssize_t len = V8_OFF_JSARRAY_LENGTH;
-			ssize_t elems = V8_OFF_JSOBJECT_ELEMENTS;
-			ssize_t flen = V8_OFF_FIXEDARRAY_LENGTH;
-			uintptr_t nelems;
-			uint8_t t;
-
-			if (read_heap_smi(nprops, addr, len) != 0 ||
-			    read_heap_ptr(&ptr, addr, elems) != 0 ||
-			    !V8_IS_HEAPOBJECT(ptr) ||
-			    read_typebyte(&t, ptr) != 0 ||
-			    t != V8_TYPE_FIXEDARRAY ||
-			    read_heap_smi(&nelems, ptr, flen) != 0 ||
-			    nelems < *nprops) {
-				findjsobjects_free(fjs->fjs_current);
-				fjs->fjs_current = NULL;
-				continue;
-			}
+static uint64_t
+findjsobjects_fingerprint(findjsobjects_obj_t *obj)
+{
+	findjsobjects_prop_t *prop;
+	uint64_t fp;
 
-			strcpy(fjs->fjs_current->fjso_constructor, "Array");
-			stats->fjss_arrays++;
-		}
+	fp = findjsobjects_strhash(obj->fjso_constructor);
+	fp = findjsobjects_mix(fp, obj->fjso_nprops);
+	fp = findjsobjects_mix(fp, obj->fjso_malformed ? 1 : 0);
 
-		/*
-		 * Now determine if we already have an object matching our
-		 * properties.  If we don't, we'll add our new object; if we
-		 * do we'll merely enqueue our instance.
-		 */
-		obj = avl_find(&fjs->fjs_tree, fjs->fjs_current, &where);
+	for (prop = obj->fjso_props; prop != NULL; prop = prop->fjsp_next)
+		fp = findjsobjects_mix(fp, prop->fjsp_id);
 
-		if (obj == NULL) {
-			avl_add(&fjs->fjs_tree, fjs->fjs_current);
-			fjs->fjs_current->fjso_next = fjs->fjs_objects;
-			fjs->fjs_objects = fjs->fjs_current;
-			fjs->fjs_current = NULL;
-			stats->fjss_uniques++;
-			continue;
-		}
+	return (fp);
+}
+
+/*
+ * Returns B_TRUE if "lhs" and "rhs" have the same shape -- that is, if
+ * findjsobjects_cmp() would find them equal.  Both must have been
+ * fingerprinted.
+ */
+static boolean_t
+findjsobjects_same(findjsobjects_obj_t *lhs, findjsobjects_obj_t *rhs)
+{
+	findjsobjects_prop_t *lprop, *rprop;
 
-		findjsobjects_free(fjs->fjs_current);
-		fjs->fjs_current = NULL;
+	if (lhs->fjso_fingerprint != rhs->fjso_fingerprint ||
+	    lhs->fjso_nprops != rhs->fjso_nprops ||
+	    lhs->fjso_malformed != rhs->fjso_malformed)
+		return (B_FALSE);
 
-		inst = mdb_alloc(sizeof (findjsobjects_instance_t), UM_SLEEP);
-		inst->fjsi_addr = addr;
-		inst->fjsi_next = obj->fjso_instances.fjsi_next;
-		obj->fjso_instances.fjsi_next = inst;
-		obj->fjso_ninstances++;
+	for (lprop = lhs->fjso_props, rprop = rhs->fjso_props;
+	    lprop != NULL && rprop != NULL;
+	    lprop = lprop->fjsp_next, rprop = rprop->fjsp_next) {
+		if (lprop->fjsp_id != rprop->fjsp_id)
+			return (B_FALSE);
 	}
 
-	mdb_free(range, size);
+	if (lprop != NULL || rprop != NULL)
+		return (B_FALSE);
 
-	return (0);
+	return (strcmp(lhs->fjso_constructor, rhs->fjso_constructor) == 0);
 }
 
-static int
-findjsobjects_mapping(findjsobjects_state_t *fjs, const prmap_t *pmp,
-    const char *name)
+/*
+ * Fingerprint "obj" and return the shape we've already found that matches it,
+ * if any.
+ */
+static findjsobjects_obj_t *
+findjsobjects_lookup(findjsobjects_state_t *fjs, findjsobjects_obj_t *obj)
 {
-	if (name != NULL && !(fjs->fjs_brk && (pmp->pr_mflags & MA_BREAK)))
-		return (0);
+	findjsobjects_obj_t *shape;
 
-	if (fjs->fjs_addr != NULL && (fjs->fjs_addr < pmp->pr_vaddr ||
-	    fjs->fjs_addr >= pmp->pr_vaddr + pmp->pr_size))
-		return (0);
+	obj->fjso_fingerprint = findjsobjects_fingerprint(obj);
 
-	return (findjsobjects_range(fjs, pmp->pr_vaddr, pmp->pr_size));
-}
+	if (fjs->fjs_nshapebuckets == 0)
+		return (NULL);
 
-static void
-findjsobjects_references_add(findjsobjects_state_t *fjs, v8propvalue_t *valp,
-    const char *desc, size_t index)
-{
-	assert(valp != NULL);
+	for (shape = fjs->fjs_shapes[obj->fjso_fingerprint &
+	    (fjs->fjs_nshapebuckets - 1)]; shape != NULL;
+	    shape = shape->fjso_hnext) {
+		if (shape->fjso_fingerprint != obj->fjso_fingerprint)
+			continue;
 
-	findjsobjects_referent_t search, *referent;
-	findjsobjects_reference_t *reference;
+		if (findjsobjects_same(shape, obj))
+			return (shape);
 
-	/*
-	 * Searching for unboxed floating-point values is not supported.
-	 */
-	if (valp->v8v_isboxeddouble) {
-		return;
+		fjs->fjs_stats.fjss_collisions++;
 	}
 
-	search.fjsr_addr = valp->v8v_u.v8vu_addr;
-
-	if ((referent = avl_find(&fjs->fjs_referents, &search, NULL)) == NULL)
-		return;
+	return (NULL);
+}
 
-	reference = mdb_zalloc(sizeof (*reference), UM_SLEEP | UM_GC);
-	reference->fjsrf_addr = fjs->fjs_addr;
+/*
+ * Add the fingerprinted shape "obj" to the hash table of shapes.
+ */
+static void
+findjsobjects_shape_add(findjsobjects_state_t *fjs, findjsobjects_obj_t *obj)
+{
+	findjsobjects_obj_t *shape, *next, **buckets;
+	size_t i, j, nbuckets;
+
+	if (fjs->fjs_nshapes >= fjs->fjs_nshapebuckets) {
+		nbuckets = fjs->fjs_nshapebuckets == 0 ?
+		    FJS_SHAPEBUCKETS : fjs->fjs_nshapebuckets * 2;
+		buckets = mdb_zalloc(nbuckets * sizeof (void *), UM_SLEEP);
+
+		for (i = 0; i < fjs->fjs_nshapebuckets; i++) {
+			for (shape = fjs->fjs_shapes[i]; shape != NULL;
+			    shape = next) {
+				next = shape->fjso_hnext;
+				j = shape->fjso_fingerprint & (nbuckets - 1);
+				shape->fjso_hnext = buckets[j];
+				buckets[j] = shape;
+			}
+		}
 
-	if (desc != NULL) {
-		reference->fjsrf_desc =
-		    mdb_alloc(strlen(desc) + 1, UM_SLEEP | UM_GC);
-		(void) strcpy(reference->fjsrf_desc, desc);
-	} else {
-		reference->fjsrf_index = index;
-	}
+		if (fjs->fjs_shapes != NULL)
+			mdb_free(fjs->fjs_shapes,
+			    fjs->fjs_nshapebuckets * sizeof (void *));
 
-	if (referent->fjsr_head == NULL) {
-		referent->fjsr_head = reference;
-	} else {
-		referent->fjsr_tail->fjsrf_next = reference;
+		fjs->fjs_shapes = buckets;
+		fjs->fjs_nshapebuckets = nbuckets;
 	}
 
-	referent->fjsr_tail = reference;
+	i = obj->fjso_fingerprint & (fjs->fjs_nshapebuckets - 1);
+	obj->fjso_hnext = fjs->fjs_shapes[i];
+	fjs->fjs_shapes[i] = obj;
+	fjs->fjs_nshapes++;
 }
 
-static int
-findjsobjects_references_prop(const char *desc, v8propvalue_t *val, void *arg)
+/*
+ * Build the AVL tree of shapes from the list of shapes once all of them have
+ * been found.
+ */
+static void
+findjsobjects_tree_build(findjsobjects_state_t *fjs)
 {
-	/*
-	 * jsobj_properties will still call us if the layout of the object it's
-	 * inspecting cannot be understood, but with val == NULL. In this case,
-	 * there's no point in adding a reference though.
-	 */
-	if (val != NULL)
-		findjsobjects_references_add(arg, val, desc, -1);
+	findjsobjects_obj_t *obj;
 
-	return (0);
+	for (obj = fjs->fjs_objects; obj != NULL; obj = obj->fjso_next)
+		avl_add(&fjs->fjs_tree, obj);
 }
 
-static void
-findjsobjects_references_array(findjsobjects_state_t *fjs,
-    findjsobjects_obj_t *obj)
+/*
+ * Add the object in fjs_current (the scratch shape) to the set of objects
+ * we've found.  If we already have an object with the same properties, its
+ * address is enqueued as another instance of the existing object; otherwise,
+ * it's copied into the arena as a new object.  Returns the object that now
+ * represents fjs_current's instance.
+ */
+static findjsobjects_obj_t *
+findjsobjects_insert(findjsobjects_state_t *fjs)
 {
-	findjsobjects_instance_t *inst = &obj->fjso_instances;
-	uintptr_t *elts;
-	size_t i, len;
-	v8propvalue_t value;
-
-	for (; inst != NULL; inst = inst->fjsi_next) {
-		uintptr_t addr = inst->fjsi_addr, ptr;
+	findjsobjects_obj_t *current = fjs->fjs_current;
+	findjsobjects_obj_t *obj;
+	findjsobjects_prop_t *prop;
 
-		if (read_heap_ptr(&ptr, addr, V8_OFF_JSOBJECT_ELEMENTS) != 0 ||
-		    read_heap_array(ptr, &elts, &len, UM_SLEEP) != 0)
-			continue;
+	fjs->fjs_current = NULL;
+	obj = findjsobjects_lookup(fjs, current);
 
-		fjs->fjs_addr = addr;
+	if (obj == NULL) {
+		obj = findjsobjects_arena_alloc(&fjs->fjs_arena,
+		    sizeof (findjsobjects_obj_t));
+		bcopy(current, obj, sizeof (*obj));
+		obj->fjso_props = NULL;
+		obj->fjso_last = NULL;
 
-		for (i = 0; i < len; i++) {
-			jsobj_propvalue_addr(&value, elts[i]);
-			findjsobjects_references_add(fjs, &value, NULL, i);
+		for (prop = current->fjso_props; prop != NULL;
+		    prop = prop->fjsp_next) {
+			findjsobjects_prop_append(&fjs->fjs_arena, obj,
+			    prop->fjsp_id, prop->fjsp_desc);
 		}
 
-		mdb_free(elts, len * sizeof (uintptr_t));
+		findjsobjects_shape_add(fjs, obj);
+		obj->fjso_next = fjs->fjs_objects;
+		fjs->fjs_objects = obj;
+		fjs->fjs_stats.fjss_uniques++;
+		return (obj);
 	}
-}
-
-static void
-findjsobjects_referent(findjsobjects_state_t *fjs, uintptr_t addr)
-{
-	findjsobjects_referent_t search, *referent;
 
-	search.fjsr_addr = addr;
+	findjsobjects_instance_add(fjs, &obj->fjso_instances,
+	    current->fjso_instances.fjsi_addr);
+	obj->fjso_ninstances++;
+	obj->fjso_bytes += current->fjso_bytes;
 
-	if (avl_find(&fjs->fjs_referents, &search, NULL) != NULL) {
-		assert(fjs->fjs_marking);
-		mdb_warn("%p is already marked; ignoring\n", addr);
-		return;
-	}
+	return (obj);
+}
 
-	referent = mdb_zalloc(sizeof (findjsobjects_referent_t), UM_SLEEP);
-	referent->fjsr_addr = addr;
+/*
+ * Like findjsobjects_insert(), but for functions, which are grouped by their
+ * SharedFunctionInfo.  "func" is usually the scratch function.
+ */
+static findjsobjects_func_t *
+findjsobjects_func_insert(findjsobjects_state_t *fjs,
+    findjsobjects_func_t *func)
+{
+	findjsobjects_func_t *ofunc;
+	avl_index_t where;
 
-	avl_add(&fjs->fjs_referents, referent);
+	ofunc = avl_find(&fjs->fjs_funcinfo, func, &where);
 
-	if (fjs->fjs_tail != NULL) {
-		fjs->fjs_tail->fjsr_next = referent;
-	} else {
-		fjs->fjs_head = referent;
+	if (ofunc == NULL) {
+		ofunc = findjsobjects_arena_alloc(&fjs->fjs_arena,
+		    sizeof (findjsobjects_func_t));
+		bcopy(func, ofunc, sizeof (*ofunc));
+		avl_insert(&fjs->fjs_funcinfo, ofunc, where);
+		ofunc->fjsf_next = fjs->fjs_funcs;
+		fjs->fjs_funcs = ofunc;
+		fjs->fjs_stats.fjss_funcs_unique++;
+		return (ofunc);
 	}
 
-	fjs->fjs_tail = referent;
+	findjsobjects_instance_add(fjs, &ofunc->fjsf_instances,
+	    func->fjsf_instances.fjsi_addr);
+	ofunc->fjsf_ninstances++;
 
-	if (fjs->fjs_marking)
-		mdb_printf("findjsobjects: marked %p\n", addr);
+	return (ofunc);
 }
 
 static void
-findjsobjects_references(findjsobjects_state_t *fjs)
+findjsobjects_jsfunc(findjsobjects_state_t *fjs, uintptr_t addr)
 {
-	findjsobjects_reference_t *reference;
-	findjsobjects_referent_t *referent;
-	avl_tree_t *referents = &fjs->fjs_referents;
+	findjsobjects_func_t *func;
+	uintptr_t funcinfo, script, name;
+	int err;
+	char *bufp;
+	size_t len;
+
+	/*
+	 * This may be somewhat expensive to do for all JSFunctions, but in most
+	 * core files, there aren't that many.  We could defer some of this work
+	 * until the user tries to print the function ::jsfunctions, but this
+	 * step is useful to do early to filter out garbage data.
+	 */
+
+	v8_silent++;
+	if (read_heap_ptr(&funcinfo, addr, V8_OFF_JSFUNCTION_SHARED) != 0 ||
+	    read_heap_ptr(&script, funcinfo,
+	    V8_OFF_SHAREDFUNCTIONINFO_SCRIPT) != 0 ||
+	    read_heap_ptr(&name, script, V8_OFF_SCRIPT_NAME) != 0) {
+		fjs->fjs_stats.fjss_funcs_skipped++;
+		v8_silent--;
+		return;
+	}
+
+	func = &fjs->fjs_scratchfunc;
+	bzero(func, sizeof (*func));
+	func->fjsf_ninstances = 1;
+	func->fjsf_instances.fjsi_addr = addr;
+	func->fjsf_shared = funcinfo;
+
+	bufp = func->fjsf_funcname;
+	len = sizeof (func->fjsf_funcname);
+	err = jsfunc_name(funcinfo, &bufp, &len);
+
+	bufp = func->fjsf_scriptname;
+	len = sizeof (func->fjsf_scriptname);
+	err |= jsstr_print(name, JSSTR_NUDE, &bufp, &len);
+
+	v8_silent--;
+	if (err != 0) {
+		fjs->fjs_stats.fjss_funcs_skipped++;
+		return;
+	}
+
+	fjs->fjs_stats.fjss_funcs++;
+	(void) findjsobjects_func_insert(fjs, func);
+}
+
+/*
+ * Like read_heap_ptr(), but satisfy the read from the current window if we
+ * can.
+ */
+static int
+findjsobjects_read_ptr(findjsobjects_state_t *fjs, uintptr_t *valp,
+    uintptr_t addr, ssize_t off)
+{
+	uintptr_t raw = addr + off;
+
+	if (raw >= fjs->fjs_wbase &&
+	    raw + sizeof (uintptr_t) <= fjs->fjs_wbase + fjs->fjs_wlen) {
+		bcopy(fjs->fjs_wdata + (raw - fjs->fjs_wbase), valp,
+		    sizeof (*valp));
+		return (0);
+	}
+
+	return (read_heap_ptr(valp, addr, off));
+}
+
+static findjsobjects_mapmemo_t *
+findjsobjects_mapmemo_slot(findjsobjects_mapmemo_t *memo, size_t nentries,
+    uintptr_t map)
+{
+	size_t i = findjsobjects_mix(0, map) & (nentries - 1);
+
+	while (memo[i].fjsm_map != 0 && memo[i].fjsm_map != map)
+		i = (i + 1) & (nentries - 1);
+
+	return (&memo[i]);
+}
+
+static void
+findjsobjects_mapmemo_insert(findjsobjects_state_t *fjs, uintptr_t map,
+    findjsobjects_obj_t *obj)
+{
+	findjsobjects_mapmemo_t *memo, *slot;
+	size_t i, nentries;
+
+	if (fjs->fjs_mapmemoused >= fjs->fjs_nmapmemo / 2) {
+		nentries = fjs->fjs_nmapmemo == 0 ?
+		    FJS_MAPMEMO_NENTRIES : fjs->fjs_nmapmemo * 2;
+		memo = mdb_zalloc(nentries * sizeof (findjsobjects_mapmemo_t),
+		    UM_SLEEP);
+
+		for (i = 0; i < fjs->fjs_nmapmemo; i++) {
+			if (fjs->fjs_mapmemo[i].fjsm_map == 0)
+				continue;
+
+			*findjsobjects_mapmemo_slot(memo, nentries,
+			    fjs->fjs_mapmemo[i].fjsm_map) = fjs->fjs_mapmemo[i];
+		}
+
+		if (fjs->fjs_mapmemo != NULL)
+			mdb_free(fjs->fjs_mapmemo, fjs->fjs_nmapmemo *
+			    sizeof (findjsobjects_mapmemo_t));
+
+		fjs->fjs_mapmemo = memo;
+		fjs->fjs_nmapmemo = nentries;
+	}
+
+	slot = findjsobjects_mapmemo_slot(fjs->fjs_mapmemo,
+	    fjs->fjs_nmapmemo, map);
+
+	if (slot->fjsm_map == 0)
+		fjs->fjs_mapmemoused++;
+
+	slot->fjsm_map = map;
+	slot->fjsm_obj = obj;
+}
+
+static void
+findjsobjects_mapmemo_fini(findjsobjects_state_t *fjs)
+{
+	if (fjs->fjs_mapmemo != NULL)
+		mdb_free(fjs->fjs_mapmemo,
+		    fjs->fjs_nmapmemo * sizeof (findjsobjects_mapmemo_t));
+
+	fjs->fjs_mapmemo = NULL;
+	fjs->fjs_nmapmemo = 0;
+	fjs->fjs_mapmemoused = 0;
+}
+
+/*
+ * If the object at "addr" has a Map whose shape we've already recorded, and
+ * its header shows that it has the same fast-mode properties as the object
+ * for which we recorded it, add it as another instance of that shape and
+ * return B_TRUE.  Otherwise, the caller must enumerate its properties.
+ */
+static boolean_t
+findjsobjects_mapmemo_lookup(findjsobjects_state_t *fjs, uintptr_t addr,
+    uintptr_t map, uint8_t type, size_t size)
+{
+	findjsobjects_mapmemo_t *slot;
 	findjsobjects_obj_t *obj;
-	void *cookie = NULL;
-	uintptr_t addr;
+	uintptr_t ptr;
+	size_t len;
+	uint8_t t;
+
+	if (fjs->fjs_nmapmemo == 0)
+		return (B_FALSE);
+
+	slot = findjsobjects_mapmemo_slot(fjs->fjs_mapmemo,
+	    fjs->fjs_nmapmemo, map);
+
+	if ((obj = slot->fjsm_obj) == NULL)
+		return (B_FALSE);
+
+	/*
+	 * The properties must be in a FixedArray, as they were for the object
+	 * that we recorded.  Any numerically-named properties (in "elements")
+	 * are per-object, so we only take the fast path when there are none.
+	 */
+	if (findjsobjects_read_ptr(fjs, &ptr, addr,
+	    V8_OFF_JSOBJECT_PROPERTIES) != 0 ||
+	    read_typebyte(&t, ptr) != 0 || t != V8_TYPE_FIXEDARRAY)
+		return (B_FALSE);
+
+	if (V8_ELEMENTS_KIND_SHIFT != -1 && type != V8_TYPE_JSTYPEDARRAY &&
+	    (findjsobjects_read_ptr(fjs, &ptr, addr,
+	    V8_OFF_JSOBJECT_ELEMENTS) != 0 ||
+	    read_heap_smi(&len, ptr, V8_OFF_FIXEDARRAY_LENGTH) != 0 ||
+	    len != 0))
+		return (B_FALSE);
+
+	findjsobjects_instance_add(fjs, &obj->fjso_instances, addr);
+	obj->fjso_ninstances++;
+	obj->fjso_bytes += size;
+	fjs->fjs_stats.fjss_mapmemo_hits++;
+
+	return (B_TRUE);
+}
+
+/*
+ * Returns the size of the FixedArray or FixedDoubleArray at "addr" that holds
+ * an object's out-of-object properties or its elements, or 0 if it's empty
+ * (like the empty FixedArray shared by objects with no such properties or
+ * elements) or isn't one of these.
+ */
+static size_t
+obj_store_size(uintptr_t addr)
+{
+	uintptr_t len;
+	uint8_t type;
+
+	if (!V8_IS_HEAPOBJECT(addr) || read_typebyte(&type, addr) != 0 ||
+	    (type != V8_TYPE_FIXEDARRAY && type != V8_TYPE_FIXEDDOUBLEARRAY) ||
+	    read_heap_smi(&len, addr, V8_OFF_FIXEDARRAY_LENGTH) != 0 ||
+	    len == 0)
+		return (0);
+
+	return (V8_OFF_FIXEDARRAY_DATA + len * (type == V8_TYPE_FIXEDARRAY ?
+	    sizeof (uintptr_t) : sizeof (double)));
+}
+
+/*
+ * Returns in *sizep the shallow size of the heap object at "addr", whose type
+ * is "type".  For JSObjects, JSArrays, typed arrays and ArrayBuffers, that's
+ * the instance size recorded in the map, plus the sizes of the FixedArrays (or
+ * FixedDoubleArrays) holding the object's out-of-object properties and its
+ * elements.  For typed arrays, the number of bytes of the ArrayBuffer's data
+ * that the array covers is included, and also returned in *externalp.  Other
+ * objects count only their own size.  This is the size reported by
+ * ::findjsobjects -s bytes, ::jslargest, ::jsretained and ::jsheapsnapshot.
+ *
+ * During a heap scan, "fjs" is the scan's state and "map" is the object's map.
+ * The object is then read from the scan's window where possible, and instance
+ * sizes are cached by map, since most objects share their map with many
+ * others.  Otherwise, "fjs" may be NULL and "map" may be 0.
+ */
+static int
+obj_shallow_size(findjsobjects_state_t *fjs, uintptr_t addr, uintptr_t map,
+    uint8_t type, size_t *sizep, size_t *externalp)
+{
+	ssize_t offs[2];
+	uint_t slot, i;
+	uintptr_t ptr, len;
+	size_t size;
+	uint8_t isize;
+
+	*externalp = 0;
+
+	if (type != V8_TYPE_JSOBJECT && type != V8_TYPE_JSARRAY &&
+	    type != V8_TYPE_JSTYPEDARRAY && type != V8_TYPE_JSARRAYBUFFER)
+		return (obj_size(addr, type, sizep, UM_SLEEP));
+
+	if (map == 0 && read_heap_ptr(&map, addr, V8_OFF_HEAPOBJECT_MAP) != 0)
+		return (-1);
+
+	slot = (map >> V8_PointerSizeLog2) % FJS_NISIZES;
+
+	if (fjs != NULL && fjs->fjs_isizemaps[slot] == map) {
+		size = fjs->fjs_isizes[slot];
+	} else if (read_heap_byte(&isize, map, V8_OFF_MAP_INSTANCE_SIZE) == 0) {
+		size = (size_t)isize << V8_PointerSizeLog2;
+
+		if (fjs != NULL) {
+			fjs->fjs_isizemaps[slot] = map;
+			fjs->fjs_isizes[slot] = size;
+		}
+	} else {
+		return (-1);
+	}
+
+	offs[0] = V8_OFF_JSOBJECT_PROPERTIES;
+	offs[1] = V8_OFF_JSOBJECT_ELEMENTS;
+
+	for (i = 0; i < 2; i++) {
+		if ((fjs != NULL ? findjsobjects_read_ptr(fjs, &ptr, addr,
+		    offs[i]) : read_heap_ptr(&ptr, addr, offs[i])) == 0)
+			size += obj_store_size(ptr);
+	}
+
+	if (type == V8_TYPE_JSTYPEDARRAY &&
+	    V8_OFF_JSARRAYBUFFERVIEW_BYTE_LENGTH != -1 &&
+	    read_heap_smi(&len, addr,
+	    V8_OFF_JSARRAYBUFFERVIEW_BYTE_LENGTH) == 0) {
+		*externalp = len;
+		size += len;
+	}
+
+	*sizep = size;
+	return (0);
+}
+
+/*
+ * Account for a found object of the given type and shallow size in the
+ * per-type totals.
+ */
+static void
+findjsobjects_account(findjsobjects_state_t *fjs, uint8_t type, size_t size,
+    size_t external)
+{
+	findjsobjects_stats_t *stats = &fjs->fjs_stats;
+
+	if (type == V8_TYPE_JSARRAY) {
+		stats->fjss_arraybytes += size;
+	} else if (type == V8_TYPE_JSTYPEDARRAY) {
+		stats->fjss_typedbytes += size;
+		stats->fjss_externalbytes += external;
+	} else {
+		stats->fjss_objbytes += size;
+	}
+}
+
+/*
+ * Process a candidate object at "addr" whose map ("map") indicates the given
+ * instance type.  If the scan was started by findjsobjects_visit(), the object
+ * is just passed to the visitor.
+ */
+static void
+findjsobjects_candidate(findjsobjects_state_t *fjs, uintptr_t addr,
+    uintptr_t map, uint8_t type)
+{
+	findjsobjects_stats_t *stats = &fjs->fjs_stats;
+	int jsobject = V8_TYPE_JSOBJECT, jsarray = V8_TYPE_JSARRAY;
+	int jstypedarray = V8_TYPE_JSTYPEDARRAY;
+	int jsarraybuffer = V8_TYPE_JSARRAYBUFFER;
+	int jsfunction = V8_TYPE_JSFUNCTION;
+	findjsobjects_obj_t *current, *obj;
+	boolean_t memoize;
+	size_t size, external;
+
+	if (fjs->fjs_visit != NULL) {
+		fjs->fjs_visit(fjs->fjs_visitarg, addr, map, type);
+		return;
+	}
+
+	if (type == jsfunction) {
+		findjsobjects_jsfunc(fjs, addr);
+		return;
+	}
+
+	if (type != jsobject && type != jsarray && type != jstypedarray &&
+	    type != jsarraybuffer)
+		return;
 
-	fjs->fjs_referred = B_FALSE;
+	stats->fjss_jsobjs++;
 
 	v8_silent++;
 
+	if (obj_shallow_size(fjs, addr, map, type, &size, &external) != 0)
+		size = 0;
+
+	if (type != jsarray &&
+	    findjsobjects_mapmemo_lookup(fjs, addr, map, type, size)) {
+		v8_silent--;
+		findjsobjects_account(fjs, type, size, external);
+		stats->fjss_objects++;
+		return;
+	}
+
+	v8_silent--;
+
+	fjs->fjs_current = findjsobjects_alloc(fjs, addr);
+	fjs->fjs_current->fjso_bytes = size;
+
+	if (type != jsarray) {
+		if (jsobj_properties(addr,
+		    findjsobjects_prop, fjs,
+		    &fjs->fjs_current->fjso_propinfo) != 0) {
+			fjs->fjs_current = NULL;
+			return;
+		}
+
+		if ((fjs->fjs_current->fjso_propinfo &
+		    (JPI_MAYBE_GARBAGE)) != 0) {
+			stats->fjss_garbage++;
+			fjs->fjs_current->fjso_malformed = B_TRUE;
+		}
+
+		findjsobjects_constructor(fjs->fjs_current);
+		stats->fjss_objects++;
+	} else {
+		uintptr_t ptr;
+		size_t *nprops = &fjs->fjs_current->fjso_nprops;
+		ssize_t len = V8_OFF_JSARRAY_LENGTH;
+		ssize_t elems = V8_OFF_JSOBJECT_ELEMENTS;
+		ssize_t flen = V8_OFF_FIXEDARRAY_LENGTH;
+		uintptr_t nelems;
+		uint8_t t;
+
+		if (read_heap_smi(nprops, addr, len) != 0 ||
+		    read_heap_ptr(&ptr, addr, elems) != 0 ||
+		    !V8_IS_HEAPOBJECT(ptr) ||
+		    read_typebyte(&t, ptr) != 0 ||
+		    t != V8_TYPE_FIXEDARRAY ||
+		    read_heap_smi(&nelems, ptr, flen) != 0 ||
+		    nelems < *nprops) {
+			fjs->fjs_current = NULL;
+			return;
+		}
+
+		strcpy(fjs->fjs_current->fjso_constructor, "Array");
+		stats->fjss_arrays++;
+	}
+
+	/*
+	 * Now determine if we already have an object matching our
+	 * properties.  If we don't, we'll add our new object; if we
+	 * do we'll merely enqueue our instance.
+	 */
+	current = fjs->fjs_current;
+	memoize = type != jsarray && !current->fjso_malformed &&
+	    (current->fjso_propinfo & (JPI_NUMERIC | JPI_DICT |
+	    JPI_MAYBE_GARBAGE | JPI_UNDEFPROPNAME)) == 0;
+	obj = findjsobjects_insert(fjs);
+	findjsobjects_account(fjs, type, size, external);
+
+	if (memoize)
+		findjsobjects_mapmemo_insert(fjs, map, obj);
+}
+
+/*
+ * Given a block of "nwords" (at most FJS_BLOCKWORDS) pointer-sized words,
+ * return a bitmap of those words that are tagged as heap object pointers.
+ * Where SSE2 is available we test several words at once; only the low 32 bits
+ * of each word contain tag bits, so on 64-bit targets the high half of each
+ * word is masked to compare equal.
+ */
+static uint64_t
+findjsobjects_block_filter(const uintptr_t *words, size_t nwords)
+{
+	uintptr_t tagmask = V8_HeapObjectTagMask, tag = V8_HeapObjectTag;
+	uint64_t bits = 0;
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	const size_t nper = sizeof (__m128i) / sizeof (uintptr_t);
+	const uint32_t wmask = (1U << sizeof (uintptr_t)) - 1;
+	__m128i vmask, vtag, v;
+	uint32_t m;
+	size_t j;
+
+	if (sizeof (uintptr_t) == sizeof (uint64_t)) {
+		vmask = _mm_set_epi32(0, (int)tagmask, 0, (int)tagmask);
+		vtag = _mm_set_epi32(0, (int)tag, 0, (int)tag);
+	} else {
+		vmask = _mm_set1_epi32((int)tagmask);
+		vtag = _mm_set1_epi32((int)tag);
+	}
+
+	for (; i + nper <= nwords; i += nper) {
+		v = _mm_loadu_si128((const __m128i *)&words[i]);
+		v = _mm_cmpeq_epi32(_mm_and_si128(v, vmask), vtag);
+		m = (uint32_t)_mm_movemask_epi8(v);
+
+		for (j = 0; j < nper; j++) {
+			if (((m >> (j * sizeof (uintptr_t))) & wmask) == wmask)
+				bits |= 1ULL << (i + j);
+		}
+	}
+#endif
+
+	for (; i < nwords; i++) {
+		if ((words[i] & tagmask) == tag)
+			bits |= 1ULL << i;
+	}
+
+	return (bits);
+}
+
+/*
+ * Determine whether "map" is a meta-map -- the map of all maps, which is its
+ * own map.  There is one per heap, so we remember the few we've seen (and
+ * recently rejected non-meta-maps) to avoid reading them more than once.
+ */
+static boolean_t
+findjsobjects_metamap(findjsobjects_state_t *fjs, uintptr_t map)
+{
+	uintptr_t mapmap;
+	uint8_t type;
+	uint_t i, slot;
+
+	for (i = 0; i < fjs->fjs_nmetamaps; i++) {
+		if (fjs->fjs_metamaps[i] == map)
+			return (B_TRUE);
+	}
+
+	slot = (map >> V8_PointerSizeLog2) % FJS_NNOTMETAMAPS;
+
+	if (fjs->fjs_notmetamaps[slot] == map)
+		return (B_FALSE);
+
+	if (read_heap_ptr(&mapmap, map, V8_OFF_HEAPOBJECT_MAP) != 0 ||
+	    mapmap != map || read_typebyte(&type, map) != 0 ||
+	    type != V8_TYPE_MAP) {
+		fjs->fjs_notmetamaps[slot] = map;
+		return (B_FALSE);
+	}
+
+	if (fjs->fjs_nmetamaps < FJS_MAXMETAMAPS)
+		fjs->fjs_metamaps[fjs->fjs_nmetamaps++] = map;
+
+	return (B_TRUE);
+}
+
+static void
+findjsobjects_progress(findjsobjects_state_t *fjs, hrtime_t now)
+{
+	uint64_t secs = (now - fjs->fjs_progstart) / NANOSEC;
+	uint64_t bytes = fjs->fjs_nscanned - fjs->fjs_progbytes;
+	uint64_t objs = fjs->fjs_stats.fjss_jsobjs - fjs->fjs_progobjs;
+	uint64_t left = fjs->fjs_nbytes - fjs->fjs_nscanned;
+	uint64_t rate;
+
+	if (secs == 0 || (rate = bytes / secs) == 0 || fjs->fjs_nbytes == 0)
+		return;
+
+	mdb_warn("findjsobjects: scanned %llu of %llu MB (%llu%%), "
+	    "%llu objects/s, about %llu s remaining\n",
+	    fjs->fjs_nscanned / (1024 * 1024), fjs->fjs_nbytes / (1024 * 1024),
+	    fjs->fjs_nscanned * 100 / fjs->fjs_nbytes, objs / secs,
+	    left / rate);
+}
+
+/*
+ * Called periodically during an incremental scan.  Reports progress, and
+ * returns B_TRUE if the scan should stop here, either because the user has
+ * interrupted it or because its time budget has been exhausted.
+ */
+static boolean_t
+findjsobjects_checkpoint(findjsobjects_state_t *fjs)
+{
+	hrtime_t now = gethrtime();
+	sigset_t pending;
+
+	if (sigpending(&pending) == 0 && sigismember(&pending, SIGINT)) {
+		fjs->fjs_interrupted = B_TRUE;
+		return (B_TRUE);
+	}
+
+	if (fjs->fjs_deadline != 0 && now >= fjs->fjs_deadline)
+		return (B_TRUE);
+
+	if (now - fjs->fjs_proglast >= FJS_PROGRESS_INTERVAL) {
+		findjsobjects_progress(fjs, now);
+		fjs->fjs_proglast = now;
+	}
+
+	return (B_FALSE);
+}
+
+/*
+ * Examine the words in the first "scansize" bytes of the current window.  V8
+ * heap objects are pointer-aligned and begin with a pointer to their map, so
+ * we walk the window a block of words at a time, filter the block for words
+ * that look like map pointers, and examine only the objects that those words
+ * would begin.  The rest of the window (the overlap) is not scanned, but is
+ * available for reading maps and object headers.  Returns the number of bytes
+ * examined, which is less than "scansize" only if an incremental scan stopped
+ * at a checkpoint.
+ */
+static size_t
+findjsobjects_window(findjsobjects_state_t *fjs, size_t scansize)
+{
+	findjsobjects_stats_t *stats = &fjs->fjs_stats;
+	uint8_t type;
+	caddr_t range = fjs->fjs_wdata;
+	const uintptr_t *words = (const uintptr_t *)range;
+	size_t nwords = scansize / sizeof (uintptr_t), w, i, n, counted = 0;
+	uintptr_t base = fjs->fjs_wbase, size = fjs->fjs_wlen;
+	uintptr_t addr, mapaddr, mapmap, typeaddr;
+	boolean_t metamaps = V8_TYPE_MAP != -1;
+	uint64_t bits;
+	int ctype;
+
+	for (w = 0; w < nwords; w += n) {
+		if (fjs->fjs_incremental &&
+		    fjs->fjs_unchecked + (w - counted) >= FJS_CHECKWORDS) {
+			fjs->fjs_nscanned += (w - counted) * sizeof (uintptr_t);
+			fjs->fjs_unchecked = 0;
+			counted = w;
+
+			if (findjsobjects_checkpoint(fjs))
+				return (w * sizeof (uintptr_t));
+		}
+
+		n = MIN(FJS_BLOCKWORDS, nwords - w);
+		stats->fjss_words += n;
+		bits = findjsobjects_block_filter(&words[w], n);
+
+		for (; bits != 0; bits &= bits - 1) {
+			i = w + __builtin_ctzll(bits);
+			mapaddr = words[i];
+			addr = base + i * sizeof (uintptr_t) -
+			    V8_OFF_HEAPOBJECT_MAP;
+			stats->fjss_candidates++;
+
+			/*
+			 * If the map lies within our buffer, we can cheaply
+			 * check that it is in fact a map (that is, that its
+			 * own map is a meta-map) before going any further.
+			 */
+			if (metamaps && V8_OFF_HEAP(mapaddr) >= base &&
+			    V8_OFF_HEAP(mapaddr) + sizeof (uintptr_t) <=
+			    base + size) {
+				mapmap = *((uintptr_t *)((uintptr_t)range +
+				    (V8_OFF_HEAP(mapaddr) - base)));
+
+				if (!V8_IS_HEAPOBJECT(mapmap) ||
+				    !findjsobjects_metamap(fjs, mapmap)) {
+					stats->fjss_notmaps++;
+					continue;
+				}
+			}
+
+			typeaddr = mapaddr + V8_OFF_MAP_INSTANCE_ATTRIBUTES;
+			stats->fjss_typereads++;
+
+			if (typeaddr >= base && typeaddr < base + size) {
+				stats->fjss_cached++;
+
+				type = *((uint8_t *)((uintptr_t)range +
+				    (typeaddr - base)));
+			} else if (v8_typecache_lookup(mapaddr,
+			    &ctype) == 0) {
+				if (ctype == V8_TYPECACHE_NOTMAP) {
+					stats->fjss_notmaps++;
+					continue;
+				}
+
+				type = (uint8_t)ctype;
+			} else {
+				/*
+				 * This is the first time we've seen this map.
+				 * Check that it's really a map and cache its
+				 * type (or the fact that it's not a map).
+				 */
+				if (metamaps && (read_heap_ptr(&mapmap,
+				    mapaddr, V8_OFF_HEAPOBJECT_MAP) != 0 ||
+				    !V8_IS_HEAPOBJECT(mapmap) ||
+				    !findjsobjects_metamap(fjs, mapmap))) {
+					v8_typecache_insert(mapaddr,
+					    V8_TYPECACHE_NOTMAP);
+					stats->fjss_notmaps++;
+					continue;
+				}
+
+				if (mdbv8_vread(&type, sizeof (uint8_t),
+				    typeaddr) == -1) {
+					v8_typecache_insert(mapaddr,
+					    V8_TYPECACHE_NOTMAP);
+					continue;
+				}
+
+				v8_typecache_insert(mapaddr, type);
+			}
+
+			findjsobjects_candidate(fjs, addr, mapaddr, type);
+		}
+	}
+
+	fjs->fjs_nscanned += scansize - counted * sizeof (uintptr_t);
+	fjs->fjs_unchecked += nwords - counted;
+
+	return (scansize);
+}
+
+/*
+ * Scan the range [addr, addr + size) for JavaScript objects.  Rather than
+ * reading the whole range at once (which could be gigabytes), we read it
+ * through a window of fjs_window bytes, plus FJS_WINDOW_OVERLAP bytes beyond
+ * the end of the window so that objects straddling the end of the window can
+ * still be decoded from the buffer.  If a window can't be read, we try again
+ * without the overlap and then with successively smaller windows, down to
+ * FJS_WINDOW_MIN bytes, skipping only the parts that can't be read at all.
+ * Unreadable memory tends to come in runs, so the next window starts at the
+ * reduced size, and the window grows back (doubling with each successful
+ * read) only once we're reading memory again.  Returns the number of bytes
+ * scanned, which is less than "size" only if an incremental scan stopped at a
+ * checkpoint.
+ */
+static size_t
+findjsobjects_range(findjsobjects_state_t *fjs, uintptr_t addr, uintptr_t size)
+{
+	findjsobjects_stats_t *stats = &fjs->fjs_stats;
+	hrtime_t start = gethrvtime();
+	size_t bufsz = MIN(size, fjs->fjs_window + FJS_WINDOW_OVERLAP);
+	size_t window = fjs->fjs_window;
+	caddr_t buf = NULL;
+	size_t off = 0, scansize, len, done;
+	const void *mapped;
+
+	while (off < size) {
+		if (fjs->fjs_incremental &&
+		    fjs->fjs_unchecked >= FJS_CHECKWORDS) {
+			fjs->fjs_unchecked = 0;
+
+			if (findjsobjects_checkpoint(fjs))
+				break;
+		}
+
+		scansize = MIN(window, size - off);
+		len = MIN(scansize + FJS_WINDOW_OVERLAP, size - off);
+		stats->fjss_windows++;
+
+		/*
+		 * If the target's memory is mapped into our address space, we
+		 * can scan it in place.
+		 */
+		if ((mapped = mdbv8_vmap(len, addr + off)) != NULL) {
+			fjs->fjs_wbase = addr + off;
+			fjs->fjs_wlen = len;
+			fjs->fjs_wdata = (caddr_t)mapped;
+			done = findjsobjects_window(fjs, scansize);
+			off += done;
+
+			if (done < scansize)
+				break;
+
+			continue;
+		}
+
+		if (buf == NULL)
+			buf = mdb_alloc(bufsz, UM_SLEEP);
+
+		while (mdbv8_vread(buf, len, addr + off) == -1) {
+			stats->fjss_windows++;
+
+			if (len > scansize) {
+				len = scansize;
+			} else if (scansize > FJS_WINDOW_MIN) {
+				scansize = MAX(FJS_WINDOW_MIN, (scansize / 2) &
+				    ~(sizeof (uintptr_t) - 1));
+				len = scansize;
+				window = scansize;
+			} else {
+				len = 0;
+				break;
+			}
+		}
+
+		if (len == 0) {
+			stats->fjss_unreadable += scansize;
+			fjs->fjs_nscanned += scansize;
+			fjs->fjs_unchecked += scansize / sizeof (uintptr_t);
+			off += scansize;
+			continue;
+		}
+
+		if (window < fjs->fjs_window)
+			window = MIN(window * 2, fjs->fjs_window);
+
+		fjs->fjs_wbase = addr + off;
+		fjs->fjs_wlen = len;
+		fjs->fjs_wdata = buf;
+		done = findjsobjects_window(fjs, scansize);
+		off += done;
+
+		if (done < scansize)
+			break;
+	}
+
+	fjs->fjs_wlen = 0;
+	if (buf != NULL)
+		mdb_free(buf, bufsz);
+	stats->fjss_scantime += gethrvtime() - start;
+
+	return (off);
+}
+
+static int
+findjsobjects_chunk_add(findjsobjects_state_t *fjs, uintptr_t addr,
+    size_t size)
+{
+	findjsobjects_chunk_t *chunks;
+	size_t nalloc, chunksz;
+
+	fjs->fjs_nbytes += size;
+
+	while (size != 0) {
+		chunksz = size;
+
+		if (fjs->fjs_chunksize != 0 && chunksz > fjs->fjs_chunksize)
+			chunksz = fjs->fjs_chunksize;
+
+		if (fjs->fjs_nchunks == fjs->fjs_chunksalloc) {
+			nalloc = fjs->fjs_chunksalloc == 0 ? 64 :
+			    fjs->fjs_chunksalloc * 2;
+			chunks = mdb_zalloc(nalloc *
+			    sizeof (findjsobjects_chunk_t), UM_SLEEP);
+
+			if (fjs->fjs_chunks != NULL) {
+				bcopy(fjs->fjs_chunks, chunks,
+				    fjs->fjs_nchunks *
+				    sizeof (findjsobjects_chunk_t));
+				mdb_free(fjs->fjs_chunks, fjs->fjs_chunksalloc *
+				    sizeof (findjsobjects_chunk_t));
+			}
+
+			fjs->fjs_chunks = chunks;
+			fjs->fjs_chunksalloc = nalloc;
+		}
+
+		fjs->fjs_chunks[fjs->fjs_nchunks].fjsc_addr = addr;
+		fjs->fjs_chunks[fjs->fjs_nchunks].fjsc_size = chunksz;
+		fjs->fjs_nchunks++;
+
+		addr += chunksz;
+		size -= chunksz;
+	}
+
+	return (0);
+}
+
+static int
+findjsobjects_mapping(findjsobjects_state_t *fjs, const prmap_t *pmp,
+    const char *name)
+{
+	if (name != NULL && !(fjs->fjs_brk && (pmp->pr_mflags & MA_BREAK)))
+		return (0);
+
+	if (fjs->fjs_addr != 0 && (fjs->fjs_addr < pmp->pr_vaddr ||
+	    fjs->fjs_addr >= pmp->pr_vaddr + pmp->pr_size))
+		return (0);
+
+	return (findjsobjects_chunk_add(fjs, pmp->pr_vaddr, pmp->pr_size));
+}
+
+/*
+ * Scan the chunks [first, first + nchunks) in the calling process.
+ */
+static void
+findjsobjects_scan_chunks(findjsobjects_state_t *fjs, size_t first,
+    size_t nchunks)
+{
+	findjsobjects_chunk_t *chunk;
+	uint64_t hits = v8_typecache_hits, misses = v8_typecache_misses;
+	size_t i;
+
+	for (i = first; i < first + nchunks; i++) {
+		chunk = &fjs->fjs_chunks[i];
+		(void) findjsobjects_range(fjs, chunk->fjsc_addr,
+		    chunk->fjsc_size);
+	}
+
+	fjs->fjs_stats.fjss_typecache_hits += v8_typecache_hits - hits;
+	fjs->fjs_stats.fjss_typecache_misses += v8_typecache_misses - misses;
+}
+
+/*
+ * Scan serially from the cursor until we reach the end of the last chunk or
+ * stop at a checkpoint.  Returns B_TRUE if we stopped early.
+ */
+static boolean_t
+findjsobjects_scan_resume(findjsobjects_state_t *fjs)
+{
+	findjsobjects_chunk_t *chunk;
+	uint64_t hits = v8_typecache_hits, misses = v8_typecache_misses;
+	boolean_t stopped = B_FALSE;
+	size_t size, done;
+
+	fjs->fjs_incremental = B_TRUE;
+	fjs->fjs_unchecked = 0;
+
+	while (fjs->fjs_cursor_chunk < fjs->fjs_nchunks) {
+		chunk = &fjs->fjs_chunks[fjs->fjs_cursor_chunk];
+		size = chunk->fjsc_size - fjs->fjs_cursor_off;
+		done = findjsobjects_range(fjs,
+		    chunk->fjsc_addr + fjs->fjs_cursor_off, size);
+
+		if (done < size) {
+			fjs->fjs_cursor_off += done;
+			stopped = B_TRUE;
+			break;
+		}
+
+		fjs->fjs_cursor_chunk++;
+		fjs->fjs_cursor_off = 0;
+	}
+
+	fjs->fjs_incremental = B_FALSE;
+	fjs->fjs_stats.fjss_typecache_hits += v8_typecache_hits - hits;
+	fjs->fjs_stats.fjss_typecache_misses += v8_typecache_misses - misses;
+
+	return (stopped);
+}
+
+/*
+ * Write the addresses of a list of instances in the order in which they were
+ * found.  findjsobjects_instance_add() inserts each instance after the first,
+ * so after the first, the list is in the reverse of that order.  Merging the
+ * addresses in the order found builds the same list that a serial scan would
+ * have built.
+ */
+static void
+findjsobjects_worker_write_instances(FILE *fp, findjsobjects_instance_t *head,
+    int ninstances)
+{
+	findjsobjects_instance_t *inst;
+	uintptr_t *addrs;
+	int i = 0;
+
+	(void) fwrite(&head->fjsi_addr, sizeof (head->fjsi_addr), 1, fp);
+
+	if (ninstances <= 1)
+		return;
+
+	addrs = mdb_alloc((ninstances - 1) * sizeof (uintptr_t), UM_SLEEP);
+
+	for (inst = head->fjsi_next; inst != NULL && i < ninstances - 1;
+	    inst = inst->fjsi_next)
+		addrs[i++] = inst->fjsi_addr;
+
+	while (i-- > 0)
+		(void) fwrite(&addrs[i], sizeof (addrs[i]), 1, fp);
+
+	mdb_free(addrs, (ninstances - 1) * sizeof (uintptr_t));
+}
+
+/*
+ * Scan the whole heap serially, passing each candidate object to "visit" (with
+ * "arg") rather than recording it as ::findjsobjects does.  This serves
+ * commands like ::jsstrdups and ::jslargest, which look at every object once
+ * and keep their own results, using "fjs" only for the scan itself.  Returns
+ * 0 if the whole heap was scanned, and -1 if the scan couldn't be started or
+ * was interrupted, in which case the caller should discard its results.
+ *
+ * As with a serial ::findjsobjects scan, SIGINT is blocked while we scan.  If
+ * we're interrupted, the signal is delivered (aborting the dcmd) once the scan
+ * has stopped, so callers must free anything left over from an interrupted
+ * run when they're next invoked.
+ */
+static int
+findjsobjects_visit(findjsobjects_state_t *fjs, findjsobjects_visit_f *visit,
+    void *arg)
+{
+	struct ps_prochandle *Pr;
+	sigset_t intr, omask;
+	boolean_t stopped = B_TRUE;
+
+	if (mdb_get_xdata("pshandle", &Pr, sizeof (Pr)) == -1) {
+		mdb_warn("couldn't read pshandle xdata");
+		return (-1);
+	}
+
+	fjs->fjs_visit = visit;
+	fjs->fjs_visitarg = arg;
+	fjs->fjs_window = FJS_WINDOWSIZE;
+
+	(void) sigemptyset(&intr);
+	(void) sigaddset(&intr, SIGINT);
+	(void) sigprocmask(SIG_BLOCK, &intr, &omask);
+
+	v8_silent++;
+
+	if (Pmapping_iter(Pr, (proc_map_f *)findjsobjects_mapping, fjs) == 0) {
+		fjs->fjs_progstart = fjs->fjs_proglast = gethrtime();
+		v8_typecache_hold();
+		stopped = findjsobjects_scan_resume(fjs);
+		v8_typecache_rele();
+	}
+
+	v8_silent--;
+
+	if (fjs->fjs_chunks != NULL) {
+		mdb_free(fjs->fjs_chunks,
+		    fjs->fjs_chunksalloc * sizeof (findjsobjects_chunk_t));
+		fjs->fjs_chunks = NULL;
+		fjs->fjs_chunksalloc = 0;
+		fjs->fjs_nchunks = 0;
+	}
+
+	(void) sigprocmask(SIG_SETMASK, &omask, NULL);
+	return (stopped ? -1 : 0);
+}
+
+/*
+ * Serialize the objects and functions found by a worker.  Object and function
+ * records are written as the in-memory structure (whose pointers are ignored
+ * by the reader, which runs from the same image), followed by the property
+ * names and then the instance addresses.  Like the instances of each, objects
+ * and functions are written in the order in which they were found (the
+ * reverse of the order of their lists), so that the merged results are in
+ * the same order as those of a serial scan.
+ */
+static int
+findjsobjects_worker_write(findjsobjects_state_t *fjs,
+    findjsobjects_worker_t *fjw)
+{
+	FILE *fp = fjw->fjsw_results;
+	findjsobjects_wheader_t hdr;
+	findjsobjects_obj_t *obj, **objs;
+	findjsobjects_func_t *func, **funcs;
+	findjsobjects_prop_t *prop;
+	uint32_t len, i;
+
+	bzero(&hdr, sizeof (hdr));
+	hdr.fjsh_magic = FJS_WORKER_MAGIC;
+	hdr.fjsh_stats = fjs->fjs_stats;
+	hdr.fjsh_nbytes = fjw->fjsw_nbytes;
+	hdr.fjsh_elapsed = fjw->fjsw_elapsed;
+
+	for (obj = fjs->fjs_objects; obj != NULL; obj = obj->fjso_next)
+		hdr.fjsh_nobjs++;
+
+	for (func = fjs->fjs_funcs; func != NULL; func = func->fjsf_next)
+		hdr.fjsh_nfuncs++;
+
+	(void) fwrite(&hdr, sizeof (hdr), 1, fp);
+
+	objs = mdb_alloc(hdr.fjsh_nobjs * sizeof (void *), UM_SLEEP | UM_GC);
+	funcs = mdb_alloc(hdr.fjsh_nfuncs * sizeof (void *), UM_SLEEP | UM_GC);
+
+	for (obj = fjs->fjs_objects, i = hdr.fjsh_nobjs; obj != NULL;
+	    obj = obj->fjso_next)
+		objs[--i] = obj;
+
+	for (func = fjs->fjs_funcs, i = hdr.fjsh_nfuncs; func != NULL;
+	    func = func->fjsf_next)
+		funcs[--i] = func;
+
+	for (i = 0; i < hdr.fjsh_nobjs; i++) {
+		obj = objs[i];
+		(void) fwrite(obj, sizeof (*obj), 1, fp);
+
+		for (len = 0, prop = obj->fjso_props; prop != NULL;
+		    prop = prop->fjsp_next)
+			len++;
+
+		(void) fwrite(&len, sizeof (len), 1, fp);
+
+		for (prop = obj->fjso_props; prop != NULL;
+		    prop = prop->fjsp_next) {
+			len = strlen(prop->fjsp_desc);
+			(void) fwrite(&len, sizeof (len), 1, fp);
+			(void) fwrite(prop->fjsp_desc, len, 1, fp);
+		}
+
+		findjsobjects_worker_write_instances(fp, &obj->fjso_instances,
+		    obj->fjso_ninstances);
+	}
+
+	for (i = 0; i < hdr.fjsh_nfuncs; i++) {
+		func = funcs[i];
+		(void) fwrite(func, sizeof (*func), 1, fp);
+		findjsobjects_worker_write_instances(fp, &func->fjsf_instances,
+		    func->fjsf_ninstances);
+	}
+
+	if (fflush(fp) != 0 || ferror(fp))
+		return (-1);
+
+	return (0);
+}
+
+/*
+ * The body of a worker process.  This never returns: the worker is a copy of
+ * the entire debugger, and must not find its way back into the debugger's
+ * command loop.
+ */
+static void
+findjsobjects_worker(findjsobjects_state_t *fjs, findjsobjects_worker_t *fjw)
+{
+	hrtime_t start = gethrtime();
+	size_t i;
+
+	(void) signal(SIGINT, SIG_DFL);
+	(void) signal(SIGQUIT, SIG_DFL);
+	(void) signal(SIGPIPE, SIG_DFL);
+
+	for (i = fjw->fjsw_first; i < fjw->fjsw_first + fjw->fjsw_nchunks; i++)
+		fjw->fjsw_nbytes += fjs->fjs_chunks[i].fjsc_size;
+
+	findjsobjects_scan_chunks(fjs, fjw->fjsw_first, fjw->fjsw_nchunks);
+	fjw->fjsw_elapsed = gethrtime() - start;
+
+	_exit(findjsobjects_worker_write(fjs, fjw) == 0 ? 0 : 1);
+}
+
+static int
+findjsobjects_merge_addr(FILE *fp, uintptr_t *addrp)
+{
+	return (fread(addrp, sizeof (*addrp), 1, fp) == 1 ? 0 : -1);
+}
+
+static int
+findjsobjects_merge_obj(findjsobjects_state_t *fjs, FILE *fp)
+{
+	findjsobjects_obj_t *obj;
+	uint32_t nprops, len, i;
+	int ninstances;
+	uintptr_t addr;
+	char *desc;
+
+	obj = findjsobjects_alloc(fjs, 0);
+
+	if (fread(obj, sizeof (*obj), 1, fp) != 1 ||
+	    fread(&nprops, sizeof (nprops), 1, fp) != 1)
+		return (-1);
+
+	ninstances = obj->fjso_ninstances;
+	obj->fjso_props = NULL;
+	obj->fjso_last = NULL;
+	obj->fjso_next = NULL;
+	obj->fjso_hnext = NULL;
+	obj->fjso_instances.fjsi_next = NULL;
+	obj->fjso_ninstances = 1;
+	bzero(&obj->fjso_node, sizeof (obj->fjso_node));
+
+	for (i = 0; i < nprops; i++) {
+		if (fread(&len, sizeof (len), 1, fp) != 1 ||
+		    len > FJS_MAXDESC)
+			return (-1);
+
+		desc = findjsobjects_arena_alloc(&fjs->fjs_scratch, len + 1);
+
+		if (fread(desc, 1, len, fp) != len)
+			return (-1);
+
+		findjsobjects_prop_add(fjs, obj, desc);
+	}
+
+	if (ninstances < 1 ||
+	    findjsobjects_merge_addr(fp, &obj->fjso_instances.fjsi_addr) != 0)
+		return (-1);
+
+	fjs->fjs_current = obj;
+	obj = findjsobjects_insert(fjs);
+
+	while (--ninstances > 0) {
+		if (findjsobjects_merge_addr(fp, &addr) != 0)
+			return (-1);
+
+		findjsobjects_instance_add(fjs, &obj->fjso_instances, addr);
+		obj->fjso_ninstances++;
+	}
+
+	return (0);
+}
+
+static int
+findjsobjects_merge_func(findjsobjects_state_t *fjs, FILE *fp)
+{
+	findjsobjects_func_t *func;
+	int ninstances;
+	uintptr_t addr;
+
+	func = &fjs->fjs_scratchfunc;
+
+	if (fread(func, sizeof (*func), 1, fp) != 1 ||
+	    (ninstances = func->fjsf_ninstances) < 1 ||
+	    findjsobjects_merge_addr(fp,
+	    &func->fjsf_instances.fjsi_addr) != 0)
+		return (-1);
+
+	func->fjsf_instances.fjsi_next = NULL;
+	func->fjsf_ninstances = 1;
+	func->fjsf_next = NULL;
+	bzero(&func->fjsf_node, sizeof (func->fjsf_node));
+
+	func = findjsobjects_func_insert(fjs, func);
+
+	while (--ninstances > 0) {
+		if (findjsobjects_merge_addr(fp, &addr) != 0)
+			return (-1);
+
+		findjsobjects_instance_add(fjs, &func->fjsf_instances, addr);
+		func->fjsf_ninstances++;
+	}
+
+	return (0);
+}
+
+/*
+ * Merge the results of a worker into our state.  Workers are always merged in
+ * order, so the result (including which instance of each object is chosen as
+ * the representative) does not depend on the order in which workers finish.
+ */
+static int
+findjsobjects_merge(findjsobjects_state_t *fjs, findjsobjects_worker_t *fjw)
+{
+	findjsobjects_stats_t *stats = &fjs->fjs_stats, *wstats;
+	findjsobjects_wheader_t hdr;
+	FILE *fp = fjw->fjsw_results;
+	uint32_t i;
+
+	rewind(fp);
+
+	if (fread(&hdr, sizeof (hdr), 1, fp) != 1 ||
+	    hdr.fjsh_magic != FJS_WORKER_MAGIC) {
+		mdb_warn("findjsobjects: worker %d: bad results header\n",
+		    (int)(fjw - fjs->fjs_workers));
+		return (-1);
+	}
+
+	for (i = 0; i < hdr.fjsh_nobjs; i++) {
+		if (findjsobjects_merge_obj(fjs, fp) != 0)
+			goto err;
+	}
+
+	for (i = 0; i < hdr.fjsh_nfuncs; i++) {
+		if (findjsobjects_merge_func(fjs, fp) != 0)
+			goto err;
+	}
+
+	/*
+	 * The unique counts are maintained as we merge; everything else is
+	 * simply summed.
+	 */
+	wstats = &hdr.fjsh_stats;
+	stats->fjss_words += wstats->fjss_words;
+	stats->fjss_cached += wstats->fjss_cached;
+	stats->fjss_typereads += wstats->fjss_typereads;
+	stats->fjss_jsobjs += wstats->fjss_jsobjs;
+	stats->fjss_objects += wstats->fjss_objects;
+	stats->fjss_garbage += wstats->fjss_garbage;
+	stats->fjss_arrays += wstats->fjss_arrays;
+	stats->fjss_funcs += wstats->fjss_funcs;
+	stats->fjss_funcs_skipped += wstats->fjss_funcs_skipped;
+	stats->fjss_notmaps += wstats->fjss_notmaps;
+	stats->fjss_candidates += wstats->fjss_candidates;
+	stats->fjss_scantime += wstats->fjss_scantime;
+	stats->fjss_typecache_hits += wstats->fjss_typecache_hits;
+	stats->fjss_typecache_misses += wstats->fjss_typecache_misses;
+	stats->fjss_collisions += wstats->fjss_collisions;
+	stats->fjss_mapmemo_hits += wstats->fjss_mapmemo_hits;
+	stats->fjss_windows += wstats->fjss_windows;
+	stats->fjss_unreadable += wstats->fjss_unreadable;
+	stats->fjss_objbytes += wstats->fjss_objbytes;
+	stats->fjss_arraybytes += wstats->fjss_arraybytes;
+	stats->fjss_typedbytes += wstats->fjss_typedbytes;
+	stats->fjss_externalbytes += wstats->fjss_externalbytes;
+
+	fjw->fjsw_nbytes = hdr.fjsh_nbytes;
+	fjw->fjsw_elapsed = hdr.fjsh_elapsed;
+	fjw->fjsw_jsobjs = wstats->fjss_jsobjs;
+
+	return (0);
+
+err:
+	mdb_warn("findjsobjects: worker %d: truncated results\n",
+	    (int)(fjw - fjs->fjs_workers));
+	return (-1);
+}
+
+/*
+ * Kill any workers that are still running, and discard all of their results.
+ */
+static void
+findjsobjects_workers_kill(findjsobjects_state_t *fjs)
+{
+	findjsobjects_worker_t *fjw;
+	uint_t w;
+
+	for (w = 0; w < fjs->fjs_nworkers; w++) {
+		fjw = &fjs->fjs_workers[w];
+
+		if (fjw->fjsw_pid != -1) {
+			(void) kill(fjw->fjsw_pid, SIGKILL);
+
+			while (waitpid(fjw->fjsw_pid, NULL, 0) == -1 &&
+			    errno == EINTR)
+				continue;
+
+			fjw->fjsw_pid = -1;
+		}
+
+		if (fjw->fjsw_results != NULL) {
+			(void) fclose(fjw->fjsw_results);
+			fjw->fjsw_results = NULL;
+		}
+	}
+}
+
+/*
+ * Scan all chunks using fjs_nworkers worker processes.  The debugger's module
+ * API is not safe for use by multiple threads, so rather than threads we fork
+ * copies of the debugger, each of which scans a contiguous run of chunks and
+ * writes what it found to a temporary file.  If a worker can't be created or
+ * fails, its chunks are scanned in this process instead.
+ */
+static int
+findjsobjects_scan_parallel(findjsobjects_state_t *fjs)
+{
+	findjsobjects_worker_t *fjw;
+	uint64_t target, sofar = 0;
+	size_t i, next = 0;
+	uint_t w, nrunning, nworkers = fjs->fjs_nworkers;
+	int status, rv = 0;
+	sigset_t pending;
+	pid_t pid;
+
+	fjs->fjs_workers = mdb_zalloc(nworkers *
+	    sizeof (findjsobjects_worker_t), UM_SLEEP | UM_GC);
+
+	/*
+	 * Carve the chunks into runs of roughly equal size.
+	 */
+	for (w = 0; w < nworkers; w++) {
+		fjw = &fjs->fjs_workers[w];
+		fjw->fjsw_first = next;
+		target = (fjs->fjs_nbytes * (w + 1)) / nworkers;
+
+		while (next < fjs->fjs_nchunks &&
+		    (sofar < target || w == nworkers - 1)) {
+			sofar += fjs->fjs_chunks[next++].fjsc_size;
+			fjw->fjsw_nchunks++;
+		}
+	}
+
+	for (w = 0; w < nworkers; w++) {
+		fjw = &fjs->fjs_workers[w];
+		fjw->fjsw_pid = -1;
+
+		if (fjw->fjsw_nchunks == 0)
+			continue;
+
+		if ((fjw->fjsw_results = tmpfile()) == NULL) {
+			mdb_warn("findjsobjects: failed to create results "
+			    "file for worker %d", w);
+			fjw->fjsw_failed = B_TRUE;
+			continue;
+		}
+
+		if ((pid = fork()) == 0)
+			findjsobjects_worker(fjs, fjw);
+
+		if (pid == -1) {
+			mdb_warn("findjsobjects: failed to create "
+			    "worker %d", w);
+			fjw->fjsw_failed = B_TRUE;
+			continue;
+		}
+
+		fjw->fjsw_pid = pid;
+	}
+
+	/*
+	 * SIGINT is blocked (by our caller), so we poll for the workers to
+	 * exit, checking for a pending SIGINT as we go.  If there is one, we
+	 * kill the workers and discard their results before returning; the
+	 * signal is delivered once our caller restores the signal mask.
+	 */
+	for (nrunning = 0, w = 0; w < nworkers; w++) {
+		if (fjs->fjs_workers[w].fjsw_pid != -1)
+			nrunning++;
+	}
+
+	while (nrunning > 0) {
+		if (sigpending(&pending) == 0 &&
+		    sigismember(&pending, SIGINT)) {
+			findjsobjects_workers_kill(fjs);
+			fjs->fjs_interrupted = B_TRUE;
+			return (-1);
+		}
+
+		for (w = 0; w < nworkers; w++) {
+			fjw = &fjs->fjs_workers[w];
+
+			if (fjw->fjsw_pid == -1)
+				continue;
+
+			if ((pid = waitpid(fjw->fjsw_pid, &status,
+			    WNOHANG)) == 0 || (pid == -1 && errno == EINTR))
+				continue;
+
+			if (pid == -1 || !WIFEXITED(status) ||
+			    WEXITSTATUS(status) != 0) {
+				mdb_warn("findjsobjects: worker %d failed\n",
+				    w);
+				fjw->fjsw_failed = B_TRUE;
+			}
+
+			fjw->fjsw_pid = -1;
+			nrunning--;
+		}
+
+		if (nrunning > 0)
+			(void) poll(NULL, 0, FJS_WAIT_INTERVAL);
+	}
+
+	for (w = 0; w < nworkers; w++) {
+		fjw = &fjs->fjs_workers[w];
+
+		if (fjw->fjsw_nchunks == 0)
+			continue;
+
+		if (!fjw->fjsw_failed) {
+			if (findjsobjects_merge(fjs, fjw) != 0)
+				rv = -1;
+		} else {
+			hrtime_t start = gethrtime();
+			int jsobjs = fjs->fjs_stats.fjss_jsobjs;
+
+			mdb_warn("findjsobjects: scanning worker %d's memory "
+			    "serially\n", w);
+
+			for (i = fjw->fjsw_first;
+			    i < fjw->fjsw_first + fjw->fjsw_nchunks; i++) {
+				fjw->fjsw_nbytes +=
+				    fjs->fjs_chunks[i].fjsc_size;
+			}
+
+			findjsobjects_scan_chunks(fjs, fjw->fjsw_first,
+			    fjw->fjsw_nchunks);
+			fjw->fjsw_elapsed = gethrtime() - start;
+			fjw->fjsw_jsobjs = fjs->fjs_stats.fjss_jsobjs - jsobjs;
+		}
+
+		if (fjw->fjsw_results != NULL) {
+			(void) fclose(fjw->fjsw_results);
+			fjw->fjsw_results = NULL;
+		}
+	}
+
+	return (rv);
+}
+
+static void
+findjsobjects_revindex_fini(findjsobjects_revindex_t *fjsri)
+{
+	size_t ntargets = fjsri->fjsri_built ?
+	    fjsri->fjsri_ntargets : fjsri->fjsri_nalloc;
+	size_t nedges = fjsri->fjsri_built ?
+	    fjsri->fjsri_nedges : fjsri->fjsri_nalloc;
+
+	if (fjsri->fjsri_targets != NULL)
+		mdb_free(fjsri->fjsri_targets, ntargets * sizeof (uintptr_t));
+
+	if (fjsri->fjsri_offsets != NULL) {
+		mdb_free(fjsri->fjsri_offsets,
+		    (fjsri->fjsri_ntargets + 1) * sizeof (size_t));
+	}
+
+	if (fjsri->fjsri_referrers != NULL)
+		mdb_free(fjsri->fjsri_referrers, nedges * sizeof (uintptr_t));
+
+	if (fjsri->fjsri_labels != NULL)
+		mdb_free(fjsri->fjsri_labels, nedges * sizeof (uint64_t));
+
+	bzero(fjsri, sizeof (*fjsri));
+}
+
+static void *
+findjsobjects_revindex_grow(void *old, size_t oldn, size_t newn, size_t size)
+{
+	void *new = mdb_alloc(newn * size, UM_SLEEP);
+
+	if (old != NULL) {
+		bcopy(old, new, oldn * size);
+		mdb_free(old, oldn * size);
+	}
+
+	return (new);
+}
+
+/*
+ * Record a reference to "target" from the object at fjs_addr while building
+ * the reverse reference index.
+ */
+static void
+findjsobjects_revindex_add(findjsobjects_state_t *fjs, uintptr_t target,
+    const char *desc, size_t index)
+{
+	findjsobjects_revindex_t *fjsri = &fjs->fjs_revindex;
+	size_t n = fjsri->fjsri_nedges, nalloc;
+
+	if (!V8_IS_HEAPOBJECT(target))
+		return;
+
+	if (n == fjsri->fjsri_nalloc) {
+		nalloc = n == 0 ? 64 * 1024 : n * 2;
+		fjsri->fjsri_targets = findjsobjects_revindex_grow(
+		    fjsri->fjsri_targets, n, nalloc, sizeof (uintptr_t));
+		fjsri->fjsri_referrers = findjsobjects_revindex_grow(
+		    fjsri->fjsri_referrers, n, nalloc, sizeof (uintptr_t));
+		fjsri->fjsri_labels = findjsobjects_revindex_grow(
+		    fjsri->fjsri_labels, n, nalloc, sizeof (uint64_t));
+		fjsri->fjsri_nalloc = nalloc;
+	}
+
+	fjsri->fjsri_targets[n] = target;
+	fjsri->fjsri_referrers[n] = fjs->fjs_addr;
+	fjsri->fjsri_labels[n] = desc != NULL ?
+	    findjsobjects_intern(fjs, desc)->fjsn_id :
+	    (uint64_t)index | FJS_LABEL_ELEMENT;
+	fjsri->fjsri_nedges++;
+}
+
+static int
+findjsobjects_cmp_addr(const void *l, const void *r)
+{
+	uintptr_t lhs = *((const uintptr_t *)l);
+	uintptr_t rhs = *((const uintptr_t *)r);
+
+	return (lhs < rhs ? -1 : lhs > rhs ? 1 : 0);
+}
+
+/*
+ * Returns the index in fjsri_targets of "addr", or -1 if there are no known
+ * references to it.
+ */
+static ssize_t
+findjsobjects_revindex_find(findjsobjects_revindex_t *fjsri, uintptr_t addr)
+{
+	uintptr_t *found;
+
+	if ((found = bsearch(&addr, fjsri->fjsri_targets,
+	    fjsri->fjsri_ntargets, sizeof (uintptr_t),
+	    findjsobjects_cmp_addr)) == NULL)
+		return (-1);
+
+	return (found - fjsri->fjsri_targets);
+}
+
+static void findjsobjects_references_walk(findjsobjects_state_t *);
+
+/*
+ * Build the reverse reference index with one walk over all of the objects
+ * we found.
+ */
+static void
+findjsobjects_revindex_build(findjsobjects_state_t *fjs)
+{
+	findjsobjects_revindex_t *fjsri = &fjs->fjs_revindex;
+	uintptr_t *edgetargets, *edgereferrers, *sorted;
+	uint64_t *edgelabels;
+	size_t *next;
+	size_t i, j, n, nalloc, t;
+
+	findjsobjects_revindex_fini(fjsri);
+
+	fjs->fjs_indexing = B_TRUE;
+	findjsobjects_references_walk(fjs);
+	fjs->fjs_indexing = B_FALSE;
+
+	n = fjsri->fjsri_nedges;
+	nalloc = fjsri->fjsri_nalloc;
+	edgetargets = fjsri->fjsri_targets;
+	edgereferrers = fjsri->fjsri_referrers;
+	edgelabels = fjsri->fjsri_labels;
+
+	fjsri->fjsri_targets = NULL;
+	fjsri->fjsri_referrers = NULL;
+	fjsri->fjsri_labels = NULL;
+	fjsri->fjsri_nalloc = 0;
+	fjsri->fjsri_built = B_TRUE;
+	fjsri->fjsri_offsets = mdb_zalloc(sizeof (size_t), UM_SLEEP);
+
+	if (n == 0)
+		return;
+
+	/*
+	 * Sort and deduplicate the targets.
+	 */
+	sorted = mdb_alloc(n * sizeof (uintptr_t), UM_SLEEP);
+	bcopy(edgetargets, sorted, n * sizeof (uintptr_t));
+	qsort(sorted, n, sizeof (uintptr_t), findjsobjects_cmp_addr);
+
+	for (i = 0, t = 0; i < n; i++) {
+		if (t == 0 || sorted[t - 1] != sorted[i])
+			sorted[t++] = sorted[i];
+	}
+
+	fjsri->fjsri_targets = mdb_alloc(t * sizeof (uintptr_t), UM_SLEEP);
+	bcopy(sorted, fjsri->fjsri_targets, t * sizeof (uintptr_t));
+	fjsri->fjsri_ntargets = t;
+	mdb_free(sorted, n * sizeof (uintptr_t));
+
+	/*
+	 * Count the references to each target, and then distribute the
+	 * references into place, preserving the order in which they were
+	 * found.  We reuse "edgetargets" to store the index of each edge's
+	 * target.
+	 */
+	mdb_free(fjsri->fjsri_offsets, sizeof (size_t));
+	fjsri->fjsri_offsets = mdb_zalloc((t + 1) * sizeof (size_t), UM_SLEEP);
+
+	for (i = 0; i < n; i++) {
+		edgetargets[i] = findjsobjects_revindex_find(fjsri,
+		    edgetargets[i]);
+		fjsri->fjsri_offsets[edgetargets[i] + 1]++;
+	}
+
+	for (i = 0; i < t; i++)
+		fjsri->fjsri_offsets[i + 1] += fjsri->fjsri_offsets[i];
+
+	next = mdb_alloc(t * sizeof (size_t), UM_SLEEP);
+	bcopy(fjsri->fjsri_offsets, next, t * sizeof (size_t));
+	fjsri->fjsri_referrers = mdb_alloc(n * sizeof (uintptr_t), UM_SLEEP);
+	fjsri->fjsri_labels = mdb_alloc(n * sizeof (uint64_t), UM_SLEEP);
+
+	for (i = 0; i < n; i++) {
+		j = next[edgetargets[i]]++;
+		fjsri->fjsri_referrers[j] = edgereferrers[i];
+		fjsri->fjsri_labels[j] = edgelabels[i];
+	}
+
+	mdb_free(next, t * sizeof (size_t));
+	mdb_free(edgetargets, nalloc * sizeof (uintptr_t));
+	mdb_free(edgereferrers, nalloc * sizeof (uintptr_t));
+	mdb_free(edgelabels, nalloc * sizeof (uint64_t));
+
+	if (fjs->fjs_verbose) {
+		mdb_printf("findjsobjects: reverse index: %llu references to "
+		    "%llu objects (%llu KB)\n", (uint64_t)n,
+		    (uint64_t)t, (uint64_t)
+		    ((t * (sizeof (uintptr_t) + sizeof (size_t)) +
+		    n * (sizeof (uintptr_t) + sizeof (uint64_t))) / 1024));
+	}
+}
+
+static void
+findjsobjects_references_add(findjsobjects_state_t *fjs, v8propvalue_t *valp,
+    const char *desc, size_t index)
+{
+	assert(valp != NULL);
+
+	findjsobjects_referent_t search, *referent;
+	findjsobjects_reference_t *reference;
+
+	/*
+	 * Searching for unboxed floating-point values is not supported.
+	 */
+	if (valp->v8v_isboxeddouble) {
+		return;
+	}
+
+	if (fjs->fjs_indexing) {
+		findjsobjects_revindex_add(fjs, valp->v8v_u.v8vu_addr,
+		    desc, index);
+		return;
+	}
+
+	search.fjsr_addr = valp->v8v_u.v8vu_addr;
+
+	if ((referent = avl_find(&fjs->fjs_referents, &search, NULL)) == NULL)
+		return;
+
+	reference = mdb_zalloc(sizeof (*reference), UM_SLEEP | UM_GC);
+	reference->fjsrf_addr = fjs->fjs_addr;
+
+	if (desc != NULL) {
+		reference->fjsrf_desc =
+		    mdb_alloc(strlen(desc) + 1, UM_SLEEP | UM_GC);
+		(void) strcpy(reference->fjsrf_desc, desc);
+	} else {
+		reference->fjsrf_index = index;
+	}
+
+	if (referent->fjsr_head == NULL) {
+		referent->fjsr_head = reference;
+	} else {
+		referent->fjsr_tail->fjsrf_next = reference;
+	}
+
+	referent->fjsr_tail = reference;
+}
+
+static int
+findjsobjects_references_prop(const char *desc, v8propvalue_t *val, void *arg)
+{
+	/*
+	 * jsobj_properties will still call us if the layout of the object it's
+	 * inspecting cannot be understood, but with val == NULL. In this case,
+	 * there's no point in adding a reference though.
+	 */
+	if (val != NULL)
+		findjsobjects_references_add(arg, val, desc, -1);
+
+	return (0);
+}
+
+static void
+findjsobjects_references_array(findjsobjects_state_t *fjs,
+    findjsobjects_obj_t *obj)
+{
+	findjsobjects_instance_t *inst = findjsobjects_obj_instances(fjs, obj);
+	uintptr_t *elts;
+	size_t i, len;
+	v8propvalue_t value;
+
+	for (; inst != NULL; inst = inst->fjsi_next) {
+		uintptr_t addr = inst->fjsi_addr, ptr;
+
+		if (read_heap_ptr(&ptr, addr, V8_OFF_JSOBJECT_ELEMENTS) != 0 ||
+		    read_heap_array(ptr, &elts, &len, UM_SLEEP) != 0)
+			continue;
+
+		fjs->fjs_addr = addr;
+
+		for (i = 0; i < len; i++) {
+			jsobj_propvalue_addr(&value, elts[i]);
+			findjsobjects_references_add(fjs, &value, NULL, i);
+		}
+
+		mdb_free(elts, len * sizeof (uintptr_t));
+	}
+}
+
+static void
+findjsobjects_referent(findjsobjects_state_t *fjs, uintptr_t addr)
+{
+	findjsobjects_referent_t search, *referent;
+
+	search.fjsr_addr = addr;
+
+	if (avl_find(&fjs->fjs_referents, &search, NULL) != NULL) {
+		assert(fjs->fjs_marking);
+		mdb_warn("%p is already marked; ignoring\n", addr);
+		return;
+	}
+
+	referent = mdb_zalloc(sizeof (findjsobjects_referent_t), UM_SLEEP);
+	referent->fjsr_addr = addr;
+
+	avl_add(&fjs->fjs_referents, referent);
+
+	if (fjs->fjs_tail != NULL) {
+		fjs->fjs_tail->fjsr_next = referent;
+	} else {
+		fjs->fjs_head = referent;
+	}
+
+	fjs->fjs_tail = referent;
+
+	if (fjs->fjs_marking)
+		mdb_printf("findjsobjects: marked %p\n", addr);
+}
+
+/*
+ * Walk the properties and elements of all of the objects that we found,
+ * calling findjsobjects_references_add() for each value.
+ */
+static void
+findjsobjects_references_walk(findjsobjects_state_t *fjs)
+{
+	findjsobjects_obj_t *obj;
+
+	v8_silent++;
+
+	for (obj = fjs->fjs_objects; obj != NULL; obj = obj->fjso_next) {
+		findjsobjects_instance_t *inst;
+
+		if (obj->fjso_nprops != 0 && obj->fjso_props == NULL) {
+			findjsobjects_references_array(fjs, obj);
+			continue;
+		}
+
+		for (inst = findjsobjects_obj_instances(fjs, obj);
+		    inst != NULL; inst = inst->fjsi_next) {
+			fjs->fjs_addr = inst->fjsi_addr;
+
+			(void) jsobj_properties(inst->fjsi_addr,
+			    findjsobjects_references_prop, fjs, NULL);
+		}
+	}
+
+	v8_silent--;
+	fjs->fjs_addr = 0;
+}
+
+/*
+ * Report the references to "addr", which is at index "t" in fjsri_targets (or
+ * -1 if there are none), recorded in the reverse reference index.  As when we
+ * walk the objects, if our output is being piped, we emit only the address of
+ * the referring object for each reference.
+ */
+static void
+findjsobjects_revindex_print(findjsobjects_state_t *fjs, uintptr_t addr,
+    ssize_t t, boolean_t pipe)
+{
+	findjsobjects_revindex_t *fjsri = &fjs->fjs_revindex;
+	uintptr_t referrer;
+	size_t i;
+	uint64_t label;
+
+	if (t == -1) {
+		if (!pipe) {
+			mdb_printf("%p is not referred to by a "
+			    "known object.\n", addr);
+		}
+
+		return;
+	}
+
+	for (i = fjsri->fjsri_offsets[t]; i < fjsri->fjsri_offsets[t + 1];
+	    i++) {
+		referrer = fjsri->fjsri_referrers[i];
+		label = fjsri->fjsri_labels[i];
+
+		if (pipe) {
+			mdb_printf("%p\n", referrer);
+			continue;
+		}
+
+		mdb_printf("%p referred to by %p", addr, referrer);
+
+		if ((label & FJS_LABEL_ELEMENT) != 0) {
+			mdb_printf("[%llu]\n", label & ~FJS_LABEL_ELEMENT);
+		} else {
+			mdb_printf(".%s\n", fjs->fjs_nametab[label]->fjsn_str);
+		}
+	}
+}
+
+typedef struct findjsobjects_query {
+	uintptr_t fjsq_addr;		/* address queried */
+	size_t fjsq_ndx;		/* position in the query */
+} findjsobjects_query_t;
+
+static int
+findjsobjects_query_cmp(const void *l, const void *r)
+{
+	const findjsobjects_query_t *lhs = l;
+	const findjsobjects_query_t *rhs = r;
+
+	if (lhs->fjsq_addr != rhs->fjsq_addr)
+		return (lhs->fjsq_addr < rhs->fjsq_addr ? -1 : 1);
+
+	return (lhs->fjsq_ndx < rhs->fjsq_ndx ? -1 :
+	    lhs->fjsq_ndx > rhs->fjsq_ndx ? 1 : 0);
+}
+
+/*
+ * Report the references to each of "naddrs" addresses from the reverse
+ * reference index, in the order given.  We look the addresses up in sorted
+ * order, so that each search need only consider the targets above the
+ * previous one's, and so that repeated addresses are found once.
+ */
+static void
+findjsobjects_revindex_query(findjsobjects_state_t *fjs,
+    const uintptr_t *addrs, size_t naddrs, boolean_t pipe)
+{
+	findjsobjects_revindex_t *fjsri = &fjs->fjs_revindex;
+	findjsobjects_query_t *queries;
+	ssize_t *found, t = -1;
+	size_t i, lo = 0;
+	uintptr_t *match;
+
+	if (naddrs == 0)
+		return;
+
+	queries = mdb_alloc(naddrs * sizeof (findjsobjects_query_t),
+	    UM_SLEEP | UM_GC);
+	found = mdb_alloc(naddrs * sizeof (ssize_t), UM_SLEEP | UM_GC);
+
+	for (i = 0; i < naddrs; i++) {
+		queries[i].fjsq_addr = addrs[i];
+		queries[i].fjsq_ndx = i;
+	}
+
+	qsort(queries, naddrs, sizeof (findjsobjects_query_t),
+	    findjsobjects_query_cmp);
+
+	for (i = 0; i < naddrs; i++) {
+		if (i == 0 ||
+		    queries[i].fjsq_addr != queries[i - 1].fjsq_addr) {
+			match = bsearch(&queries[i].fjsq_addr,
+			    fjsri->fjsri_targets + lo,
+			    fjsri->fjsri_ntargets - lo, sizeof (uintptr_t),
+			    findjsobjects_cmp_addr);
+			t = match == NULL ? -1 : match - fjsri->fjsri_targets;
+
+			if (t != -1)
+				lo = t + 1;
+		}
+
+		found[queries[i].fjsq_ndx] = t;
+	}
+
+	for (i = 0; i < naddrs; i++)
+		findjsobjects_revindex_print(fjs, addrs[i], found[i], pipe);
+}
+
+static void
+findjsobjects_references(findjsobjects_state_t *fjs, boolean_t pipe)
+{
+	findjsobjects_reference_t *reference;
+	findjsobjects_referent_t *referent;
+	avl_tree_t *referents = &fjs->fjs_referents;
+	void *cookie = NULL;
+	uintptr_t addr;
+
+	/*
+	 * If we've built the reverse reference index, we can answer from
+	 * that.  Otherwise, traverse over all objects and arrays, looking for
+	 * references to our designated referent(s).
+	 */
+	if (!fjs->fjs_revindex.fjsri_built)
+		findjsobjects_references_walk(fjs);
+
+	/*
+	 * Now go over our referent(s), reporting any references that we have
+	 * accumulated.
+	 */
+	for (referent = fjs->fjs_head; referent != NULL;
+	    referent = referent->fjsr_next) {
+		addr = referent->fjsr_addr;
+
+		if (fjs->fjs_revindex.fjsri_built) {
+			findjsobjects_revindex_print(fjs, addr,
+			    findjsobjects_revindex_find(&fjs->fjs_revindex,
+			    addr), pipe);
+			continue;
+		}
+
+		if ((reference = referent->fjsr_head) == NULL) {
+			if (pipe)
+				continue;
+
+			mdb_printf("%p is not referred to by a "
+			    "known object.\n", addr);
+			continue;
+		}
+
+		for (; reference != NULL; reference = reference->fjsrf_next) {
+			if (pipe) {
+				mdb_printf("%p\n", reference->fjsrf_addr);
+				continue;
+			}
+
+			mdb_printf("%p referred to by %p",
+			    addr, reference->fjsrf_addr);
+
+			if (reference->fjsrf_desc == NULL) {
+				mdb_printf("[%d]\n", reference->fjsrf_index);
+			} else {
+				mdb_printf(".%s\n", reference->fjsrf_desc);
+			}
+		}
+	}
+
+	/*
+	 * Finally, destroy our referent nodes.
+	 */
+	while ((referent = avl_destroy_nodes(referents, &cookie)) != NULL)
+		mdb_free(referent, sizeof (findjsobjects_referent_t));
+
+	fjs->fjs_head = NULL;
+	fjs->fjs_tail = NULL;
+}
+
+static void
+findjsobjects_retained_fini(findjsobjects_retained_t *fjsrt)
+{
+	size_t n = fjsrt->fjsrt_nnodes, nlabels = fjsrt->fjsrt_nlabels;
+
+	if (fjsrt->fjsrt_addrs != NULL)
+		mdb_free(fjsrt->fjsrt_addrs, n * sizeof (uintptr_t));
+
+	if (fjsrt->fjsrt_shallow != NULL)
+		mdb_free(fjsrt->fjsrt_shallow, n * sizeof (uint32_t));
+
+	if (fjsrt->fjsrt_retained != NULL)
+		mdb_free(fjsrt->fjsrt_retained, n * sizeof (uint64_t));
+
+	if (fjsrt->fjsrt_idom != NULL)
+		mdb_free(fjsrt->fjsrt_idom, n * sizeof (uint32_t));
+
+	if (fjsrt->fjsrt_labels != NULL)
+		mdb_free(fjsrt->fjsrt_labels, n * sizeof (uint32_t));
+
+	if (fjsrt->fjsrt_lcount != NULL)
+		mdb_free(fjsrt->fjsrt_lcount, nlabels * sizeof (uint64_t));
+
+	if (fjsrt->fjsrt_lshallow != NULL)
+		mdb_free(fjsrt->fjsrt_lshallow, nlabels * sizeof (uint64_t));
+
+	if (fjsrt->fjsrt_lretained != NULL)
+		mdb_free(fjsrt->fjsrt_lretained, nlabels * sizeof (uint64_t));
+
+	bzero(fjsrt, sizeof (*fjsrt));
+}
+
+/*
+ * Returns the node index of "addr", or FJS_DOM_NONE if it's not in the graph.
+ */
+static uint32_t
+findjsobjects_retained_find(findjsobjects_retained_t *fjsrt, uintptr_t addr)
+{
+	uintptr_t *found;
+
+	if ((found = bsearch(&addr, fjsrt->fjsrt_addrs, fjsrt->fjsrt_nnodes,
+	    sizeof (uintptr_t), findjsobjects_cmp_addr)) == NULL)
+		return (FJS_DOM_NONE);
+
+	return ((uint32_t)(found - fjsrt->fjsrt_addrs));
+}
+
+/*
+ * Returns the label for an object without a constructor: its V8 type.
+ */
+static uint32_t
+findjsobjects_retained_label(findjsobjects_state_t *fjs, uint8_t type,
+    boolean_t known)
+{
+	char buf[80];
+	const char *name = known ?
+	    enum_lookup_str(v8_types, type, NULL) : "unknown";
+
+	if (name == NULL)
+		name = V8_TYPE_STRING(type) ? "String" : "unknown";
+
+	(void) snprintf(buf, sizeof (buf), "(%s)", name);
+	return (findjsobjects_intern(fjs, buf)->fjsn_id);
+}
+
+static void
+findjsobjects_dom_fini(findjsobjects_dom_t *dom)
+{
+	size_t n = dom->fjsd_nnodes, e = dom->fjsd_nedges;
+	size_t nvert = n + 1;
+	uint32_t **vertarrays[] = {
+		&dom->fjsd_vertex, &dom->fjsd_parent, &dom->fjsd_semi,
+		&dom->fjsd_idom, &dom->fjsd_ancestor, &dom->fjsd_label,
+		&dom->fjsd_bucket, &dom->fjsd_bnext, &dom->fjsd_stack
+	};
+	int i;
+
+	if (dom->fjsd_dfnum != NULL)
+		mdb_free(dom->fjsd_dfnum, n * sizeof (uint32_t));
+
+	if (dom->fjsd_ptarget != NULL)
+		mdb_free(dom->fjsd_ptarget, n * sizeof (uint32_t));
+
+	if (dom->fjsd_fwdoff != NULL)
+		mdb_free(dom->fjsd_fwdoff, (n + 1) * sizeof (uint32_t));
+
+	if (dom->fjsd_fwd != NULL)
+		mdb_free(dom->fjsd_fwd, e * sizeof (uint32_t));
+
+	if (dom->fjsd_referrer != NULL)
+		mdb_free(dom->fjsd_referrer, e * sizeof (uint32_t));
+
+	for (i = 0; i < sizeof (vertarrays) / sizeof (vertarrays[0]); i++) {
+		if (*vertarrays[i] != NULL)
+			mdb_free(*vertarrays[i], nvert * sizeof (uint32_t));
+	}
+
+	bzero(dom, sizeof (*dom));
+}
+
+static int
+findjsobjects_dom_init(findjsobjects_dom_t *dom, uint32_t nnodes,
+    uint32_t nedges)
+{
+	size_t n = nnodes, e = nedges;
+	size_t nvert = n + 1;
+	uint32_t **vertarrays[] = {
+		&dom->fjsd_vertex, &dom->fjsd_parent, &dom->fjsd_semi,
+		&dom->fjsd_idom, &dom->fjsd_ancestor, &dom->fjsd_label,
+		&dom->fjsd_bucket, &dom->fjsd_bnext, &dom->fjsd_stack
+	};
+	int i, failed = 0;
+
+	bzero(dom, sizeof (*dom));
+	dom->fjsd_nnodes = nnodes;
+	dom->fjsd_nedges = nedges;
+
+	dom->fjsd_dfnum = mdb_alloc(n * sizeof (uint32_t), UM_NOSLEEP);
+	dom->fjsd_ptarget = mdb_alloc(n * sizeof (uint32_t), UM_NOSLEEP);
+	dom->fjsd_fwdoff = mdb_zalloc((n + 1) * sizeof (uint32_t), UM_NOSLEEP);
+	dom->fjsd_fwd = mdb_alloc(e * sizeof (uint32_t), UM_NOSLEEP);
+	dom->fjsd_referrer = mdb_alloc(e * sizeof (uint32_t), UM_NOSLEEP);
+
+	failed = dom->fjsd_dfnum == NULL || dom->fjsd_ptarget == NULL ||
+	    dom->fjsd_fwdoff == NULL || (e != 0 &&
+	    (dom->fjsd_fwd == NULL || dom->fjsd_referrer == NULL));
+
+	for (i = 0; i < sizeof (vertarrays) / sizeof (vertarrays[0]); i++) {
+		*vertarrays[i] = mdb_alloc(nvert * sizeof (uint32_t),
+		    UM_NOSLEEP);
+
+		if (*vertarrays[i] == NULL)
+			failed = 1;
+	}
+
+	if (failed) {
+		findjsobjects_dom_fini(dom);
+		return (-1);
+	}
+
+	return (0);
+}
+
+/*
+ * Number the vertices reachable from node "s", which becomes a child of the
+ * synthetic root, in depth-first order.  While numbering, fjsd_ancestor holds
+ * the index of the next edge to follow from each vertex on the stack.
+ */
+static void
+findjsobjects_dom_dfs(findjsobjects_dom_t *dom, uint32_t s)
+{
+	uint32_t *cursor = dom->fjsd_ancestor;
+	uint32_t d, u, v, w, depth = 0;
+
+	d = dom->fjsd_n++;
+	dom->fjsd_dfnum[s] = d;
+	dom->fjsd_vertex[d] = s;
+	dom->fjsd_parent[d] = 0;
+	cursor[d] = dom->fjsd_fwdoff[s];
+	dom->fjsd_stack[depth++] = d;
+
+	while (depth > 0) {
+		d = dom->fjsd_stack[depth - 1];
+		v = dom->fjsd_vertex[d];
+
+		if (cursor[d] == dom->fjsd_fwdoff[v + 1]) {
+			depth--;
+			continue;
+		}
+
+		w = dom->fjsd_fwd[cursor[d]++];
+
+		if (dom->fjsd_dfnum[w] != FJS_DOM_NONE)
+			continue;
+
+		u = dom->fjsd_n++;
+		dom->fjsd_dfnum[w] = u;
+		dom->fjsd_vertex[u] = w;
+		dom->fjsd_parent[u] = d;
+		cursor[u] = dom->fjsd_fwdoff[w];
+		dom->fjsd_stack[depth++] = u;
+	}
+}
+
+/*
+ * Returns the vertex with the least semidominator on the path in the linked
+ * forest from "v" up to (but excluding) the root of its tree, compressing the
+ * path as we go.
+ */
+static uint32_t
+findjsobjects_dom_eval(findjsobjects_dom_t *dom, uint32_t v)
+{
+	uint32_t *ancestor = dom->fjsd_ancestor, *label = dom->fjsd_label;
+	uint32_t *semi = dom->fjsd_semi;
+	uint32_t x, a;
+	size_t k = 0;
+
+	if (ancestor[v] == FJS_DOM_NONE)
+		return (v);
+
+	for (x = v; ancestor[ancestor[x]] != FJS_DOM_NONE; x = ancestor[x])
+		dom->fjsd_stack[k++] = x;
+
+	while (k > 0) {
+		x = dom->fjsd_stack[--k];
+		a = ancestor[x];
+
+		if (semi[label[a]] < semi[label[x]])
+			label[x] = label[a];
+
+		ancestor[x] = ancestor[a];
+	}
+
+	return (label[v]);
+}
+
+/*
+ * Compute the immediate dominator of every vertex with the Lengauer-Tarjan
+ * algorithm (in its simple form, with path compression).  The predecessors of
+ * each vertex come straight from the reverse reference index.
+ */
+static void
+findjsobjects_dom_compute(findjsobjects_dom_t *dom,
+    findjsobjects_revindex_t *fjsri)
+{
+	uint32_t *semi = dom->fjsd_semi, *idom = dom->fjsd_idom;
+	uint32_t *bucket = dom->fjsd_bucket, *bnext = dom->fjsd_bnext;
+	uint32_t n = dom->fjsd_n, p, t, u, v, w;
+	size_t j;
+
+	for (v = 0; v < n; v++) {
+		semi[v] = v;
+		dom->fjsd_label[v] = v;
+		dom->fjsd_ancestor[v] = FJS_DOM_NONE;
+		bucket[v] = FJS_DOM_NONE;
+		idom[v] = 0;
+	}
+
+	for (w = n - 1; w > 0; w--) {
+		p = dom->fjsd_parent[w];
+
+		/*
+		 * The synthetic root, vertex 0, precedes everything, so the
+		 * root's children need not look at their other predecessors.
+		 */
+		if (p == 0) {
+			semi[w] = 0;
+		} else if ((t = dom->fjsd_ptarget[dom->fjsd_vertex[w]]) !=
+		    FJS_DOM_NONE) {
+			for (j = fjsri->fjsri_offsets[t];
+			    j < fjsri->fjsri_offsets[t + 1]; j++) {
+				u = findjsobjects_dom_eval(dom,
+				    dom->fjsd_dfnum[dom->fjsd_referrer[j]]);
+
+				if (semi[u] < semi[w])
+					semi[w] = semi[u];
+			}
+		}
+
+		bnext[w] = bucket[semi[w]];
+		bucket[semi[w]] = w;
+		dom->fjsd_ancestor[w] = p;
+
+		for (v = bucket[p]; v != FJS_DOM_NONE; v = bnext[v]) {
+			u = findjsobjects_dom_eval(dom, v);
+			idom[v] = semi[u] < semi[v] ? u : p;
+		}
+
+		bucket[p] = FJS_DOM_NONE;
+	}
+
+	for (w = 1; w < n; w++) {
+		if (idom[w] != semi[w])
+			idom[w] = idom[idom[w]];
+	}
+}
+
+/*
+ * Walk the dominator tree from the synthetic root, accumulating the per-label
+ * totals.  An object's retained size is added to its label's total only if
+ * none of its dominators has the same label.  We reuse fjsd_bucket and
+ * fjsd_bnext (which the dominator computation no longer needs) for the lists
+ * of each vertex's children, and fjsd_label for the next child to visit.
+ */
+static void
+findjsobjects_dom_labels(findjsobjects_dom_t *dom,
+    findjsobjects_retained_t *fjsrt, uint32_t *active)
+{
+	uint32_t *first = dom->fjsd_bucket, *sibling = dom->fjsd_bnext;
+	uint32_t *next = dom->fjsd_label;
+	uint32_t n = dom->fjsd_n, d, l, w, x, depth = 0;
+
+	for (w = 0; w < n; w++)
+		first[w] = FJS_DOM_NONE;
+
+	for (w = n - 1; w > 0; w--) {
+		sibling[w] = first[dom->fjsd_idom[w]];
+		first[dom->fjsd_idom[w]] = w;
+	}
+
+	next[0] = first[0];
+	dom->fjsd_stack[depth++] = 0;
+
+	while (depth > 0) {
+		d = dom->fjsd_stack[depth - 1];
+
+		if ((w = next[d]) == FJS_DOM_NONE) {
+			if (d != 0)
+				active[fjsrt->fjsrt_labels[
+				    dom->fjsd_vertex[d]]]--;
+			depth--;
+			continue;
+		}
+
+		next[d] = sibling[w];
+		x = dom->fjsd_vertex[w];
+		l = fjsrt->fjsrt_labels[x];
+
+		fjsrt->fjsrt_lcount[l]++;
+		fjsrt->fjsrt_lshallow[l] += fjsrt->fjsrt_shallow[x];
+
+		if (active[l]++ == 0)
+			fjsrt->fjsrt_lretained[l] += fjsrt->fjsrt_retained[x];
+
+		next[w] = first[w];
+		dom->fjsd_stack[depth++] = w;
+	}
+}
+
+/*
+ * Build the dominator tree of the graph described by the reverse reference
+ * index and compute retained sizes.  If "budget" is non-zero, it's the number
+ * of megabytes that we're allowed to use for the computation.
+ */
+static int
+findjsobjects_retained_build(findjsobjects_state_t *fjs, size_t budget)
+{
+	findjsobjects_revindex_t *fjsri = &fjs->fjs_revindex;
+	findjsobjects_retained_t *fjsrt = &fjs->fjs_retained;
+	findjsobjects_dom_t dom;
+	findjsobjects_obj_t *obj;
+	findjsobjects_func_t *func;
+	findjsobjects_instance_t *inst;
+	uintptr_t *addrs;
+	uint32_t *active;
+	size_t i, j, n, nnodes, nedges, nlabels;
+	uint64_t need;
+	uint32_t t, x, l;
+	hrtime_t start = gethrtime();
+
+	findjsobjects_retained_fini(fjsrt);
+
+	/*
+	 * The nodes of the graph are the objects and functions that we found,
+	 * plus everything that they refer to.
+	 */
+	for (n = fjsri->fjsri_ntargets, obj = fjs->fjs_objects; obj != NULL;
+	    obj = obj->fjso_next) {
+		for (inst = findjsobjects_obj_instances(fjs, obj);
+		    inst != NULL; inst = inst->fjsi_next)
+			n++;
+	}
+
+	for (func = fjs->fjs_funcs; func != NULL; func = func->fjsf_next) {
+		for (inst = findjsobjects_func_instances(fjs, func);
+		    inst != NULL; inst = inst->fjsi_next)
+			n++;
+	}
+
+	if ((addrs = mdb_alloc(n * sizeof (uintptr_t), UM_NOSLEEP)) == NULL) {
+		mdb_warn("not enough memory to compute retained sizes\n");
+		return (-1);
+	}
+
+	i = fjsri->fjsri_ntargets;
+	bcopy(fjsri->fjsri_targets, addrs, i * sizeof (uintptr_t));
+
+	for (obj = fjs->fjs_objects; obj != NULL; obj = obj->fjso_next) {
+		for (inst = findjsobjects_obj_instances(fjs, obj);
+		    inst != NULL; inst = inst->fjsi_next)
+			addrs[i++] = inst->fjsi_addr;
+	}
+
+	for (func = fjs->fjs_funcs; func != NULL; func = func->fjsf_next) {
+		for (inst = findjsobjects_func_instances(fjs, func);
+		    inst != NULL; inst = inst->fjsi_next)
+			addrs[i++] = inst->fjsi_addr;
+	}
+
+	qsort(addrs, n, sizeof (uintptr_t), findjsobjects_cmp_addr);
+
+	for (i = 0, nnodes = 0; i < n; i++) {
+		if (nnodes == 0 || addrs[nnodes - 1] != addrs[i])
+			addrs[nnodes++] = addrs[i];
+	}
+
+	nedges = fjsri->fjsri_nedges;
+
+	if (nnodes >= FJS_DOM_NONE - 1 || nedges >= FJS_DOM_NONE) {
+		mdb_warn("too many objects (%llu) or references (%llu) to "
+		    "compute retained sizes\n", (uint64_t)nnodes,
+		    (uint64_t)nedges);
+		mdb_free(addrs, n * sizeof (uintptr_t));
+		return (-1);
+	}
+
+	/*
+	 * We need 28 bytes per node for the results, and 48 bytes per node and
+	 * 8 bytes per reference while computing them.
+	 */
+	need = (uint64_t)nnodes * (28 + 48) + (uint64_t)nedges * 8;
+
+	if (budget != 0 && need > (uint64_t)budget * 1024 * 1024) {
+		mdb_warn("computing retained sizes of %llu objects with %llu "
+		    "references needs about %llu MB, but only %llu MB are "
+		    "allowed\n", (uint64_t)nnodes, (uint64_t)nedges,
+		    need / (1024 * 1024) + 1, (uint64_t)budget);
+		mdb_free(addrs, n * sizeof (uintptr_t));
+		return (-1);
+	}
+
+	fjsrt->fjsrt_nnodes = (uint32_t)nnodes;
+	fjsrt->fjsrt_addrs = mdb_alloc(nnodes * sizeof (uintptr_t),
+	    UM_NOSLEEP);
+	fjsrt->fjsrt_shallow = mdb_alloc(nnodes * sizeof (uint32_t),
+	    UM_NOSLEEP);
+	fjsrt->fjsrt_retained = mdb_alloc(nnodes * sizeof (uint64_t),
+	    UM_NOSLEEP);
+	fjsrt->fjsrt_idom = mdb_alloc(nnodes * sizeof (uint32_t), UM_NOSLEEP);
+	fjsrt->fjsrt_labels = mdb_alloc(nnodes * sizeof (uint32_t),
+	    UM_NOSLEEP);
+
+	if (fjsrt->fjsrt_addrs != NULL)
+		bcopy(addrs, fjsrt->fjsrt_addrs, nnodes * sizeof (uintptr_t));
+
+	mdb_free(addrs, n * sizeof (uintptr_t));
+
+	if (fjsrt->fjsrt_addrs == NULL || fjsrt->fjsrt_shallow == NULL ||
+	    fjsrt->fjsrt_retained == NULL || fjsrt->fjsrt_idom == NULL ||
+	    fjsrt->fjsrt_labels == NULL ||
+	    findjsobjects_dom_init(&dom, nnodes, nedges) != 0) {
+		mdb_warn("not enough memory to compute retained sizes\n");
+		findjsobjects_retained_fini(fjsrt);
+		return (-1);
+	}
+
+	/*
+	 * Label each object with its constructor, or failing that, its type,
+	 * and determine its shallow size.
+	 */
+	for (x = 0; x < nnodes; x++)
+		fjsrt->fjsrt_labels[x] = FJS_DOM_NONE;
+
+	for (obj = fjs->fjs_objects; obj != NULL; obj = obj->fjso_next) {
+		if (obj->fjso_constructor[0] == '\0')
+			continue;
+
+		l = findjsobjects_intern(fjs, obj->fjso_constructor)->fjsn_id;
+
+		for (inst = findjsobjects_obj_instances(fjs, obj);
+		    inst != NULL; inst = inst->fjsi_next) {
+			x = findjsobjects_retained_find(fjsrt, inst->fjsi_addr);
+			fjsrt->fjsrt_labels[x] = l;
+		}
+	}
+
+	v8_silent++;
+
+	for (x = 0; x < nnodes; x++) {
+		boolean_t known;
+		size_t size, external;
+		uint8_t type;
+
+		known = read_typebyte(&type, fjsrt->fjsrt_addrs[x]) == 0 &&
+		    obj_shallow_size(fjs, fjsrt->fjsrt_addrs[x], 0, type,
+		    &size, &external) == 0;
+
+		if (!known)
+			size = 0;
+
+		fjsrt->fjsrt_shallow[x] = (uint32_t)MIN(size, FJS_DOM_NONE);
+		fjsrt->fjsrt_total += fjsrt->fjsrt_shallow[x];
+
+		if (fjsrt->fjsrt_labels[x] == FJS_DOM_NONE) {
+			fjsrt->fjsrt_labels[x] =
+			    findjsobjects_retained_label(fjs, type, known);
+		}
+	}
+
+	v8_silent--;
+
+	/*
+	 * Find the node of each reference's referrer, match the nodes with
+	 * their entries in the reverse index, and from that, build the
+	 * forward edges.  We use fjsd_dfnum to keep track of where the next
+	 * edge from each node goes.
+	 */
+	for (j = 0; j < nedges; j++) {
+		x = findjsobjects_retained_find(fjsrt,
+		    fjsri->fjsri_referrers[j]);
+		assert(x != FJS_DOM_NONE);
+		dom.fjsd_referrer[j] = x;
+		dom.fjsd_fwdoff[x + 1]++;
+	}
+
+	for (x = 0; x < nnodes; x++)
+		dom.fjsd_fwdoff[x + 1] += dom.fjsd_fwdoff[x];
+
+	bcopy(dom.fjsd_fwdoff, dom.fjsd_dfnum, nnodes * sizeof (uint32_t));
+
+	for (x = 0, t = 0; x < nnodes; x++) {
+		while (t < fjsri->fjsri_ntargets &&
+		    fjsri->fjsri_targets[t] < fjsrt->fjsrt_addrs[x])
+			t++;
+
+		if (t == fjsri->fjsri_ntargets ||
+		    fjsri->fjsri_targets[t] != fjsrt->fjsrt_addrs[x]) {
+			dom.fjsd_ptarget[x] = FJS_DOM_NONE;
+			continue;
+		}
+
+		dom.fjsd_ptarget[x] = t;
+
+		for (j = fjsri->fjsri_offsets[t];
+		    j < fjsri->fjsri_offsets[t + 1]; j++) {
+			uint32_t r = dom.fjsd_referrer[j];
+			dom.fjsd_fwd[dom.fjsd_dfnum[r]++] = x;
+		}
+	}
+
+	/*
+	 * Number the vertices, starting from the objects with no known
+	 * referrers and then from whatever is left (which can only be
+	 * reached through cycles).
+	 */
+	for (x = 0; x < nnodes; x++)
+		dom.fjsd_dfnum[x] = FJS_DOM_NONE;
+
+	dom.fjsd_vertex[0] = nnodes;
+	dom.fjsd_parent[0] = 0;
+	dom.fjsd_n = 1;
+
+	for (i = 0; i < 2; i++) {
+		for (x = 0; x < nnodes; x++) {
+			if (dom.fjsd_dfnum[x] != FJS_DOM_NONE ||
+			    (i == 0 && dom.fjsd_ptarget[x] != FJS_DOM_NONE))
+				continue;
+
+			findjsobjects_dom_dfs(&dom, x);
+			fjsrt->fjsrt_nroots++;
+		}
+	}
+
+	assert(dom.fjsd_n == nnodes + 1);
+	findjsobjects_dom_compute(&dom, fjsri);
+
+	/*
+	 * Vertices are dominated only by vertices that precede them in
+	 * depth-first order, so we can accumulate retained sizes in a single
+	 * pass in reverse order.
+	 */
+	for (x = 0; x < nnodes; x++)
+		fjsrt->fjsrt_retained[x] = fjsrt->fjsrt_shallow[x];
+
+	for (t = dom.fjsd_n - 1; t > 0; t--) {
+		uint32_t d = dom.fjsd_idom[t];
+
+		x = dom.fjsd_vertex[t];
+
+		if (d == 0) {
+			fjsrt->fjsrt_idom[x] = FJS_DOM_NONE;
+			continue;
+		}
+
+		fjsrt->fjsrt_idom[x] = dom.fjsd_vertex[d];
+		fjsrt->fjsrt_retained[dom.fjsd_vertex[d]] +=
+		    fjsrt->fjsrt_retained[x];
+	}
+
+	nlabels = fjs->fjs_nnames;
+	fjsrt->fjsrt_nlabels = (uint32_t)nlabels;
+	fjsrt->fjsrt_lcount = mdb_zalloc(nlabels * sizeof (uint64_t),
+	    UM_NOSLEEP);
+	fjsrt->fjsrt_lshallow = mdb_zalloc(nlabels * sizeof (uint64_t),
+	    UM_NOSLEEP);
+	fjsrt->fjsrt_lretained = mdb_zalloc(nlabels * sizeof (uint64_t),
+	    UM_NOSLEEP);
+	active = mdb_zalloc(nlabels * sizeof (uint32_t), UM_NOSLEEP);
+
+	if (fjsrt->fjsrt_lcount == NULL || fjsrt->fjsrt_lshallow == NULL ||
+	    fjsrt->fjsrt_lretained == NULL || active == NULL) {
+		mdb_warn("not enough memory to compute retained sizes\n");
+
+		if (active != NULL)
+			mdb_free(active, nlabels * sizeof (uint32_t));
+
+		findjsobjects_dom_fini(&dom);
+		findjsobjects_retained_fini(fjsrt);
+		return (-1);
+	}
+
+	findjsobjects_dom_labels(&dom, fjsrt, active);
+	mdb_free(active, nlabels * sizeof (uint32_t));
+	findjsobjects_dom_fini(&dom);
+	fjsrt->fjsrt_built = B_TRUE;
+
+	if (fjs->fjs_verbose) {
+		mdb_printf("findjsobjects: dominator tree: %llu objects, "
+		    "%llu references, %u roots, %llu bytes in %llu ms "
+		    "(%llu KB)\n", (uint64_t)nnodes, (uint64_t)nedges,
+		    fjsrt->fjsrt_nroots, fjsrt->fjsrt_total,
+		    (uint64_t)((gethrtime() - start) / (NANOSEC / 1000)),
+		    need / 1024);
+	}
+
+	return (0);
+}
+
+/*
+ * Insert "idx" into "top", an array of at most "max" indexes kept in
+ * descending order of keys[idx], if it belongs there.
+ */
+static void
+findjsobjects_topn(uint32_t *top, size_t *ntopp, size_t max,
+    const uint64_t *keys, uint32_t idx)
+{
+	size_t i = *ntopp;
+
+	if (i == max) {
+		if (keys[idx] <= keys[top[max - 1]])
+			return;
+
+		i--;
+	} else {
+		(*ntopp)++;
+	}
+
+	for (; i > 0 && keys[top[i - 1]] < keys[idx]; i--)
+		top[i] = top[i - 1];
+
+	top[i] = idx;
+}
+
+/*
+ * Returns the object of which "addr" is an instance, if any.  If the results
+ * were loaded from an index, we search its table of instance addresses rather
+ * than the instances themselves, so that we needn't read them all in.
+ */
+static findjsobjects_obj_t *
+findjsobjects_instance(findjsobjects_state_t *fjs, uintptr_t addr)
+{
+	const findjsobjects_iaddr_t *iaddr;
+	findjsobjects_obj_t *obj;
+	findjsobjects_instance_t *inst;
+	uint64_t lo, hi, mid;
+
+	if (fjs->fjs_index != NULL) {
+		for (lo = 0, hi = fjs->fjs_niaddrs; lo < hi; ) {
+			mid = lo + (hi - lo) / 2;
+			iaddr = &fjs->fjs_iaddrs[mid];
+
+			if (iaddr->fjsia_addr == addr) {
+				return (iaddr->fjsia_obj < fjs->fjs_nishapes ?
+				    fjs->fjs_ishapes[iaddr->fjsia_obj] : NULL);
+			}
+
+			if (iaddr->fjsia_addr < addr)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+
+		return (NULL);
+	}
+
+	for (obj = fjs->fjs_objects; obj != NULL; obj = obj->fjso_next) {
+		for (inst = &obj->fjso_instances; inst != NULL;
+		    inst = inst->fjsi_next) {
+			if (inst->fjsi_addr == addr)
+				return (obj);
+		}
+	}
+
+	return (NULL);
+}
+
+/*ARGSUSED*/
+static void
+findjsobjects_match_all(findjsobjects_obj_t *obj, const char *ignored)
+{
+	mdb_printf("%p\n", obj->fjso_instances.fjsi_addr);
+}
+
+static void
+findjsobjects_match_propname(findjsobjects_obj_t *obj, const char *propname)
+{
+	findjsobjects_prop_t *prop;
+
+	for (prop = obj->fjso_props; prop != NULL; prop = prop->fjsp_next) {
+		if (strcmp(prop->fjsp_desc, propname) == 0) {
+			mdb_printf("%p\n", obj->fjso_instances.fjsi_addr);
+			return;
+		}
+	}
+}
+
+static void
+findjsobjects_match_constructor(findjsobjects_obj_t *obj,
+    const char *constructor)
+{
+	if (strcmp(constructor, obj->fjso_constructor) == 0)
+		mdb_printf("%p\n", obj->fjso_instances.fjsi_addr);
+}
+
+static void
+findjsobjects_match_kind(findjsobjects_obj_t *obj, const char *propkind)
+{
+	jspropinfo_t p = obj->fjso_propinfo;
+
+	if (((p & JPI_NUMERIC) != 0 && strstr(propkind, "numeric") != NULL) ||
+	    ((p & JPI_DICT) != 0 && strstr(propkind, "dict") != NULL) ||
+	    ((p & JPI_INOBJECT) != 0 && strstr(propkind, "inobject") != NULL) ||
+	    ((p & JPI_PROPS) != 0 && strstr(propkind, "props") != NULL) ||
+	    ((p & JPI_HASTRANSITIONS) != 0 &&
+	    strstr(propkind, "transitions") != NULL) ||
+	    ((p & JPI_HASCONTENT) != 0 &&
+	    strstr(propkind, "content") != NULL) ||
+	    ((p & JPI_SKIPPED) != 0 && strstr(propkind, "skipped") != NULL) ||
+	    ((p & JPI_UNDEFPROPNAME) != 0 &&
+	    strstr(propkind, "undefpropname") != NULL) ||
+	    ((p & JPI_BADPROPS) != 0 && strstr(propkind, "badprop") != NULL) ||
+	    ((p & JPI_BADLAYOUT) != 0 &&
+	    strstr(propkind, "badlayout") != NULL)) {
+		mdb_printf("%p\n", obj->fjso_instances.fjsi_addr);
+	}
+}
+
+static int
+findjsobjects_match(findjsobjects_state_t *fjs, uintptr_t addr,
+    uint_t flags, void (*func)(findjsobjects_obj_t *, const char *),
+    const char *match)
+{
+	findjsobjects_obj_t *obj;
+
+	if (!(flags & DCMD_ADDRSPEC)) {
+		for (obj = fjs->fjs_objects; obj != NULL;
+		    obj = obj->fjso_next) {
+			if (obj->fjso_malformed && !fjs->fjs_allobjs)
+				continue;
+
+			func(obj, match);
+		}
+
+		return (DCMD_OK);
+	}
+
+	/*
+	 * First, look for the specified address among the representative
+	 * objects.
+	 */
+	for (obj = fjs->fjs_objects; obj != NULL; obj = obj->fjso_next) {
+		if (obj->fjso_instances.fjsi_addr == addr) {
+			func(obj, match);
+			return (DCMD_OK);
+		}
+	}
+
+	/*
+	 * We didn't find it among the representative objects; look for it
+	 * among all instances.
+	 */
+	if ((obj = findjsobjects_instance(fjs, addr)) != NULL) {
+		func(obj, match);
+		return (DCMD_OK);
+	}
+
+	mdb_warn("%p does not correspond to a known object\n", addr);
+	return (DCMD_ERR);
+}
+
+static void
+findjsobjects_print(findjsobjects_obj_t *obj, boolean_t bytes)
+{
+	int col = 19 + (sizeof (uintptr_t) * 2) + strlen("..."), len;
+	uintptr_t addr = obj->fjso_instances.fjsi_addr;
+	findjsobjects_prop_t *prop;
+
+	mdb_printf("%?p %8d %8d ",
+	    addr, obj->fjso_ninstances, obj->fjso_nprops);
+
+	if (bytes) {
+		mdb_printf("%12llu ", obj->fjso_bytes);
+		col += 13;
+	}
+
+	if (obj->fjso_constructor[0] != '\0') {
+		mdb_printf("%s%s", obj->fjso_constructor,
+		    obj->fjso_props != NULL ? ": " : "");
+		col += strlen(obj->fjso_constructor) + 2;
+	}
+
+	for (prop = obj->fjso_props; prop != NULL; prop = prop->fjsp_next) {
+		if (col + (len = strlen(prop->fjsp_desc) + 2) < 80) {
+			mdb_printf("%s%s", prop->fjsp_desc,
+			    prop->fjsp_next != NULL ? ", " : "");
+			col += len;
+		} else {
+			mdb_printf("...");
+			break;
+		}
+	}
+
+	mdb_printf("\n", col);
+}
+
+static void
+dcmd_findjsobjects_help(void)
+{
+	mdb_printf("%s\n\n",
+"Finds all JavaScript objects in the V8 heap via brute force iteration over\n"
+"all mapped anonymous memory.  (This can take up to several minutes on large\n"
+"dumps.)  The output consists of representative objects, the number of\n"
+"instances of that object and the number of properties on the object --\n"
+"followed by the constructor and first few properties of the objects.  Once\n"
+"run, subsequent calls to ::findjsobjects use cached data.  If provided an\n"
+"address (and in the absence of -r, described below), ::findjsobjects treats\n"
+"the address as that of a representative object, and lists all instances of\n"
+"that object (that is, all objects that have a matching property signature).\n"
+"\n"
+"With -R, ::findjsobjects builds an index of all references between objects\n"
+"(which takes about as long as a single -r query) and uses it to answer this\n"
+"and all later -r and -R queries without walking the heap again.  -R works\n"
+"for any object, not just the representative objects and their instances,\n"
+"and when given a pipeline of addresses, -R looks them up all at once.\n"
+"When the output of -r or -R is piped, only the referring object of each\n"
+"reference is emitted.\n"
+"\n"
+"On core files, the initial heap scan can be spread across several worker\n"
+"processes with -P.  The results, including the order in which instances\n"
+"are listed, are the same as those of a serial scan.  If a parallel scan is\n"
+"interrupted with ^C, the workers are stopped and their results discarded.\n"
+"\n"
+"The scan also totals the shallow size of each object: the instance size\n"
+"recorded in its map, plus the sizes of its out-of-object property and\n"
+"elements arrays and, for typed arrays, of the part of the ArrayBuffer that\n"
+"the array covers.  With -s bytes, objects are listed in order of the total\n"
+"shallow size of their instances, which is shown in a BYTES column, and -v\n"
+"reports the totals for each V8 type.\n"
+"\n"
+"The results of the heap scan can be saved to an index file with -S, and a\n"
+"later session on the same target can load that index with -L instead of\n"
+"scanning the heap again.  Loading reads only the index's list of objects;\n"
+"the instances of each object are read from the file when a command first\n"
+"needs them.\n"
+"\n"
+"A serial heap scan that is interrupted with ^C, or that exceeds the time\n"
+"budget given with -T, stops where it is.  The objects found so far can be\n"
+"examined as usual (with a warning that the results are partial), and the\n"
+"next ::findjsobjects resumes the scan where it left off.  Progress is\n"
+"reported periodically during long scans.");
+
+	mdb_dec_indent(2);
+	mdb_printf("%<b>OPTIONS%</b>\n");
+	mdb_inc_indent(2);
+
+	mdb_printf("%s\n",
+"  -b       Include the heap denoted by the brk(2) (normally excluded)\n"
+"  -c cons  Display representative objects with the specified constructor\n"
+"  -p prop  Display representative objects that have the specified property\n"
+"  -l       List all objects that match the representative object\n"
+"  -L file  Load the results of a previous heap scan from an index file\n"
+"  -m       Mark specified object for later reference determination via -r\n"
+"  -P num   Scan the heap using num worker processes (core files only)\n"
+"  -r       Find references to the specified and/or marked object(s)\n"
+"  -R       Like -r, but build (once) and use the reverse reference index\n"
+"  -s sort  List objects by \"count\" of instances (default) or \"bytes\"\n"
+"  -S file  Save the results of the heap scan to an index file\n"
+"  -T secs  Stop scanning the heap after secs seconds (serial scans only)\n"
+"  -v       Provide verbose statistics\n"
+"  -w size  Read memory in windows of size bytes (default 4MB)\n");
+}
+
+/*
+ * Saved findjsobjects indexes
+ *
+ * The results of a heap scan can be saved to an index file (with -S) and
+ * loaded by a later session (with -L) so that the scan need not be repeated.
+ * The file consists of a header followed by fixed-size object and function
+ * records, an array of instance addresses (grouped by object or function), a
+ * table of the objects' instance addresses sorted by address, an array of
+ * property name references and finally a string table, all at offsets
+ * recorded in the header.
+ *
+ * The file is mapped read-only to be loaded, and stays mapped until the
+ * results are discarded.  Loading builds only the object and function
+ * records; their instances are read from the mapping when a query first needs
+ * them, and an address is looked up by binary search of the sorted table.
+ *
+ * An index is only valid for the process image from which it was created.
+ * This is identified by a key consisting of the process ID and start time, the
+ * number and total size of its mappings, the V8 version, and the GNU build-id
+ * of the executable (if it has one).
+ */
+#define	FJS_INDEX_MAGIC		"MDBV8FJX"
+#define	FJS_INDEX_VERSION	4
+#define	FJS_BUILDID_MAX		32
+
+#ifndef NT_GNU_BUILD_ID
+#define	NT_GNU_BUILD_ID		3
+#endif
+
+#ifdef _LP64
+#define	FJS_ELF(t)	Elf64_##t
+#else
+#define	FJS_ELF(t)	Elf32_##t
+#endif
+
+typedef struct findjsobjects_key {
+	uint64_t fjsk_pid;
+	int64_t fjsk_start_sec;
+	int64_t fjsk_start_nsec;
+	uint64_t fjsk_nmappings;
+	uint64_t fjsk_mapsize;
+	uint32_t fjsk_v8version[4];
+	uint32_t fjsk_buildidlen;
+	uint8_t fjsk_buildid[FJS_BUILDID_MAX];
+} findjsobjects_key_t;
+
+typedef struct findjsobjects_ihdr {
+	char fjsx_magic[8];
+	uint32_t fjsx_version;
+	uint32_t fjsx_ptrsize;
+	uint32_t fjsx_statsize;
+	uint32_t fjsx_pad;
+	findjsobjects_key_t fjsx_key;
+	findjsobjects_stats_t fjsx_stats;
+	uint64_t fjsx_nbytes;
+	uint64_t fjsx_nobjs;
+	uint64_t fjsx_nfuncs;
+	uint64_t fjsx_ninsts;
+	uint64_t fjsx_naddrs;
+	uint64_t fjsx_nproprefs;
+	uint64_t fjsx_strtabsz;
+	uint64_t fjsx_objs_off;
+	uint64_t fjsx_funcs_off;
+	uint64_t fjsx_insts_off;
+	uint64_t fjsx_addrs_off;
+	uint64_t fjsx_proprefs_off;
+	uint64_t fjsx_strtab_off;
+} findjsobjects_ihdr_t;
+
+typedef struct findjsobjects_iobj {
+	uint64_t fjsio_first;		/* index of first instance */
+	uint64_t fjsio_ninsts;		/* number of instances */
+	uint64_t fjsio_nprops;		/* fjso_nprops */
+	uint64_t fjsio_firstprop;	/* index of first property reference */
+	uint64_t fjsio_bytes;		/* fjso_bytes */
+	uint32_t fjsio_nproprefs;	/* number of property references */
+	uint32_t fjsio_propinfo;	/* fjso_propinfo */
+	uint32_t fjsio_malformed;	/* fjso_malformed */
+	uint32_t fjsio_constructor;	/* string table offset */
+} findjsobjects_iobj_t;
+
+typedef struct findjsobjects_ifunc {
+	uint64_t fjsif_shared;		/* fjsf_shared */
+	uint64_t fjsif_first;		/* index of first instance */
+	uint64_t fjsif_ninsts;		/* number of instances */
+	uint32_t fjsif_funcname;	/* string table offset */
+	uint32_t fjsif_scriptname;	/* string table offset */
+	uint32_t fjsif_location;	/* string table offset */
+	uint32_t fjsif_pad;
+} findjsobjects_ifunc_t;
+
+/*
+ * String table used while writing an index.  Strings are deduplicated with a
+ * simple open-addressing hash table.  Offsets are 32 bits wide; once a string
+ * doesn't fit, fjst_full is set, nothing more is added, and the table's user
+ * must fail.
+ */
+typedef struct findjsobjects_strtab {
+	uint32_t *fjst_slots;		/* offsets + 1 (0 means empty) */
+	size_t fjst_nslots;
+	size_t fjst_nstrs;
+	char *fjst_buf;
+	size_t fjst_bufsz;
+	size_t fjst_buflen;
+	boolean_t fjst_full;		/* a string didn't fit */
+} findjsobjects_strtab_t;
+
+static void
+findjsobjects_strtab_fini(findjsobjects_strtab_t *fjst)
+{
+	if (fjst->fjst_slots != NULL)
+		mdb_free(fjst->fjst_slots,
+		    fjst->fjst_nslots * sizeof (uint32_t));
+
+	if (fjst->fjst_buf != NULL)
+		mdb_free(fjst->fjst_buf, fjst->fjst_bufsz);
+
+	bzero(fjst, sizeof (*fjst));
+}
+
+static void
+findjsobjects_strtab_rehash(findjsobjects_strtab_t *fjst, size_t nslots)
+{
+	uint32_t *slots = mdb_zalloc(nslots * sizeof (uint32_t), UM_SLEEP);
+	size_t i, j;
+
+	for (i = 0; i < fjst->fjst_nslots; i++) {
+		if (fjst->fjst_slots[i] == 0)
+			continue;
+
+		j = findjsobjects_strhash(fjst->fjst_buf +
+		    fjst->fjst_slots[i] - 1) & (nslots - 1);
+
+		while (slots[j] != 0)
+			j = (j + 1) & (nslots - 1);
+
+		slots[j] = fjst->fjst_slots[i];
+	}
+
+	if (fjst->fjst_slots != NULL)
+		mdb_free(fjst->fjst_slots,
+		    fjst->fjst_nslots * sizeof (uint32_t));
+
+	fjst->fjst_slots = slots;
+	fjst->fjst_nslots = nslots;
+}
+
+/*
+ * Appends "len" bytes to the string table, without looking for an existing
+ * copy, and returns their offset.  If they don't fit, fjst_full is set and 0
+ * is returned.
+ */
+static uint32_t
+findjsobjects_strtab_append(findjsobjects_strtab_t *fjst, const void *data,
+    size_t len)
+{
+	uint32_t off = fjst->fjst_buflen;
+	size_t bufsz;
+	char *buf;
+
+	/*
+	 * The hash table stores offsets plus one, so the last offset must be
+	 * below UINT32_MAX.
+	 */
+	if (fjst->fjst_full || len > UINT32_MAX - fjst->fjst_buflen) {
+		fjst->fjst_full = B_TRUE;
+		return (0);
+	}
+
+	if (fjst->fjst_buflen + len > fjst->fjst_bufsz) {
+		bufsz = fjst->fjst_bufsz == 0 ? 64 * 1024 : fjst->fjst_bufsz;
+
+		while (fjst->fjst_buflen + len > bufsz)
+			bufsz *= 2;
+
+		buf = mdb_alloc(bufsz, UM_SLEEP);
+
+		if (fjst->fjst_buf != NULL) {
+			bcopy(fjst->fjst_buf, buf, fjst->fjst_buflen);
+			mdb_free(fjst->fjst_buf, fjst->fjst_bufsz);
+		}
+
+		fjst->fjst_buf = buf;
+		fjst->fjst_bufsz = bufsz;
+	}
+
+	bcopy(data, fjst->fjst_buf + fjst->fjst_buflen, len);
+	fjst->fjst_buflen += len;
+
+	return (off);
+}
+
+/*
+ * Returns the string table offset of "str", adding it if necessary.
+ */
+static uint32_t
+findjsobjects_strtab_add(findjsobjects_strtab_t *fjst, const char *str)
+{
+	size_t len = strlen(str) + 1, i;
+	uint32_t off;
+
+	if (fjst->fjst_nstrs >= fjst->fjst_nslots / 2) {
+		findjsobjects_strtab_rehash(fjst, fjst->fjst_nslots == 0 ?
+		    1024 : fjst->fjst_nslots * 2);
+	}
+
+	i = findjsobjects_strhash(str) & (fjst->fjst_nslots - 1);
+
+	while (fjst->fjst_slots[i] != 0) {
+		if (strcmp(fjst->fjst_buf + fjst->fjst_slots[i] - 1, str) == 0)
+			return (fjst->fjst_slots[i] - 1);
+
+		i = (i + 1) & (fjst->fjst_nslots - 1);
+	}
+
+	off = findjsobjects_strtab_append(fjst, str, len);
+
+	if (fjst->fjst_full)
+		return (0);
+
+	fjst->fjst_slots[i] = off + 1;
+	fjst->fjst_nstrs++;
+
+	return (fjst->fjst_slots[i] - 1);
+}
+
+/*
+ * Find the GNU build-id of the executable from its ELF notes, which we read
+ * from the text mapping of the target.
+ */
+static void
+findjsobjects_buildid(struct ps_prochandle *Pr, findjsobjects_key_t *keyp)
+{
+	const prmap_t *pmp;
+	FJS_ELF(Ehdr) ehdr;
+	FJS_ELF(Phdr) phdr;
+	FJS_ELF(Nhdr) nhdr;
+	uintptr_t addr, end;
+	size_t namesz, descsz;
+	char name[4];
+	int i;
+
+	if ((pmp = Pname_to_map(Pr, PR_OBJ_EXEC)) == NULL ||
+	    pmp->pr_offset != 0 ||
+	    mdb_vread(&ehdr, sizeof (ehdr), pmp->pr_vaddr) == -1 ||
+	    memcmp(ehdr.e_ident, ELFMAG, SELFMAG) != 0 ||
+	    ehdr.e_phentsize != sizeof (phdr))
+		return;
+
+	for (i = 0; i < ehdr.e_phnum; i++) {
+		if (mdb_vread(&phdr, sizeof (phdr), pmp->pr_vaddr +
+		    ehdr.e_phoff + i * sizeof (phdr)) == -1)
+			return;
+
+		if (phdr.p_type != PT_NOTE ||
+		    phdr.p_offset + phdr.p_filesz > pmp->pr_size)
+			continue;
+
+		addr = pmp->pr_vaddr + phdr.p_offset;
+		end = addr + phdr.p_filesz;
+
+		while (addr + sizeof (nhdr) <= end) {
+			if (mdb_vread(&nhdr, sizeof (nhdr), addr) == -1)
+				return;
+
+			namesz = (nhdr.n_namesz + 3) & ~3;
+			descsz = (nhdr.n_descsz + 3) & ~3;
+			addr += sizeof (nhdr);
+
+			if (nhdr.n_type == NT_GNU_BUILD_ID &&
+			    nhdr.n_namesz == sizeof (name) &&
+			    nhdr.n_descsz <= FJS_BUILDID_MAX &&
+			    mdb_vread(name, sizeof (name), addr) != -1 &&
+			    strcmp(name, "GNU") == 0 &&
+			    mdb_vread(keyp->fjsk_buildid, nhdr.n_descsz,
+			    addr + namesz) != -1) {
+				keyp->fjsk_buildidlen = nhdr.n_descsz;
+				return;
+			}
+
+			addr += namesz + descsz;
+		}
+	}
+}
+
+/*ARGSUSED*/
+static int
+findjsobjects_key_mapping(findjsobjects_key_t *keyp, const prmap_t *pmp,
+    const char *name)
+{
+	keyp->fjsk_nmappings++;
+	keyp->fjsk_mapsize += pmp->pr_size;
+	return (0);
+}
+
+static int
+findjsobjects_key(findjsobjects_key_t *keyp)
+{
+	struct ps_prochandle *Pr;
+	const psinfo_t *psp;
+
+	bzero(keyp, sizeof (*keyp));
+
+	if (mdb_get_xdata("pshandle", &Pr, sizeof (Pr)) == -1) {
+		mdb_warn("couldn't read pshandle xdata");
+		return (-1);
+	}
+
+	if ((psp = Ppsinfo(Pr)) != NULL) {
+		keyp->fjsk_pid = psp->pr_pid;
+		keyp->fjsk_start_sec = psp->pr_start.tv_sec;
+		keyp->fjsk_start_nsec = psp->pr_start.tv_nsec;
+	}
+
+	(void) Pmapping_iter(Pr, (proc_map_f *)findjsobjects_key_mapping, keyp);
+
+	keyp->fjsk_v8version[0] = v8_major;
+	keyp->fjsk_v8version[1] = v8_minor;
+	keyp->fjsk_v8version[2] = v8_build;
+	keyp->fjsk_v8version[3] = v8_patch;
+
+	findjsobjects_buildid(Pr, keyp);
+
+	return (0);
+}
+
+static int
+findjsobjects_iaddr_cmp(const void *l, const void *r)
+{
+	const findjsobjects_iaddr_t *lhs = l, *rhs = r;
+
+	if (lhs->fjsia_addr < rhs->fjsia_addr)
+		return (-1);
+
+	return (lhs->fjsia_addr > rhs->fjsia_addr);
+}
+
+static int
+findjsobjects_save(findjsobjects_state_t *fjs, const char *path)
+{
+	findjsobjects_strtab_t strtab;
+	findjsobjects_ihdr_t hdr;
+	findjsobjects_iobj_t iobj;
+	findjsobjects_ifunc_t ifunc;
+	findjsobjects_obj_t *obj;
+	findjsobjects_func_t *func;
+	findjsobjects_prop_t *prop;
+	findjsobjects_instance_t *inst;
+	findjsobjects_iaddr_t *iaddrs;
+	uint64_t ninsts = 0, nproprefs = 0, addr, i, n;
+	uint32_t ref;
+	FILE *fp;
+
+	bzero(&hdr, sizeof (hdr));
+	bzero(&strtab, sizeof (strtab));
+
+	if (findjsobjects_key(&hdr.fjsx_key) != 0)
+		return (-1);
+
+	if ((fp = fopen(path, "w")) == NULL) {
+		mdb_warn("failed to open \"%s\"", path);
+		return (-1);
+	}
+
+	bcopy(FJS_INDEX_MAGIC, hdr.fjsx_magic, sizeof (hdr.fjsx_magic));
+	hdr.fjsx_version = FJS_INDEX_VERSION;
+	hdr.fjsx_ptrsize = sizeof (uintptr_t);
+	hdr.fjsx_statsize = sizeof (findjsobjects_stats_t);
+	hdr.fjsx_stats = fjs->fjs_stats;
+	hdr.fjsx_nbytes = fjs->fjs_nbytes;
+
+	/*
+	 * Write the object and function records (which requires building the
+	 * string table as we go), then the instances and property references,
+	 * and finally the string table and the header.
+	 */
+	(void) fwrite(&hdr, sizeof (hdr), 1, fp);
+	hdr.fjsx_objs_off = sizeof (hdr);
+
+	for (obj = fjs->fjs_objects; obj != NULL; obj = obj->fjso_next) {
+		bzero(&iobj, sizeof (iobj));
+		iobj.fjsio_first = ninsts;
+		iobj.fjsio_ninsts = obj->fjso_ninstances;
+		iobj.fjsio_nprops = obj->fjso_nprops;
+		iobj.fjsio_firstprop = nproprefs;
+		iobj.fjsio_bytes = obj->fjso_bytes;
+		iobj.fjsio_propinfo = obj->fjso_propinfo;
+		iobj.fjsio_malformed = obj->fjso_malformed;
+		iobj.fjsio_constructor =
+		    findjsobjects_strtab_add(&strtab, obj->fjso_constructor);
+
+		for (prop = obj->fjso_props; prop != NULL;
+		    prop = prop->fjsp_next) {
+			(void) findjsobjects_strtab_add(&strtab,
+			    prop->fjsp_desc);
+			iobj.fjsio_nproprefs++;
+		}
+
+		ninsts += iobj.fjsio_ninsts;
+		nproprefs += iobj.fjsio_nproprefs;
+		hdr.fjsx_nobjs++;
+		(void) fwrite(&iobj, sizeof (iobj), 1, fp);
+	}
+
+	hdr.fjsx_funcs_off = hdr.fjsx_objs_off +
+	    hdr.fjsx_nobjs * sizeof (iobj);
+	hdr.fjsx_naddrs = ninsts;
+
+	for (func = fjs->fjs_funcs; func != NULL; func = func->fjsf_next) {
+		bzero(&ifunc, sizeof (ifunc));
+		ifunc.fjsif_shared = func->fjsf_shared;
+		ifunc.fjsif_first = ninsts;
+		ifunc.fjsif_ninsts = func->fjsf_ninstances;
+		ifunc.fjsif_funcname =
+		    findjsobjects_strtab_add(&strtab, func->fjsf_funcname);
+		ifunc.fjsif_scriptname =
+		    findjsobjects_strtab_add(&strtab, func->fjsf_scriptname);
+		ifunc.fjsif_location =
+		    findjsobjects_strtab_add(&strtab, func->fjsf_location);
+
+		ninsts += ifunc.fjsif_ninsts;
+		hdr.fjsx_nfuncs++;
+		(void) fwrite(&ifunc, sizeof (ifunc), 1, fp);
+	}
+
+	hdr.fjsx_insts_off = hdr.fjsx_funcs_off +
+	    hdr.fjsx_nfuncs * sizeof (ifunc);
+	hdr.fjsx_ninsts = ninsts;
+
+	for (obj = fjs->fjs_objects; obj != NULL; obj = obj->fjso_next) {
+		for (inst = findjsobjects_obj_instances(fjs, obj);
+		    inst != NULL; inst = inst->fjsi_next) {
+			addr = inst->fjsi_addr;
+			(void) fwrite(&addr, sizeof (addr), 1, fp);
+		}
+	}
+
+	for (func = fjs->fjs_funcs; func != NULL; func = func->fjsf_next) {
+		for (inst = findjsobjects_func_instances(fjs, func);
+		    inst != NULL; inst = inst->fjsi_next) {
+			addr = inst->fjsi_addr;
+			(void) fwrite(&addr, sizeof (addr), 1, fp);
+		}
+	}
+
+	/*
+	 * The table of the objects' instance addresses, sorted by address,
+	 * lets a loaded index find an instance's object without reading in all
+	 * of the instances.
+	 */
+	hdr.fjsx_addrs_off = hdr.fjsx_insts_off + ninsts * sizeof (addr);
+	iaddrs = mdb_alloc(MAX(hdr.fjsx_naddrs, 1) * sizeof (*iaddrs),
+	    UM_SLEEP);
+
+	for (i = 0, n = 0, obj = fjs->fjs_objects; obj != NULL;
+	    obj = obj->fjso_next, i++) {
+		for (inst = &obj->fjso_instances; inst != NULL &&
+		    n < hdr.fjsx_naddrs; inst = inst->fjsi_next, n++) {
+			iaddrs[n].fjsia_addr = inst->fjsi_addr;
+			iaddrs[n].fjsia_obj = i;
+		}
+	}
+
+	qsort(iaddrs, n, sizeof (*iaddrs), findjsobjects_iaddr_cmp);
+	(void) fwrite(iaddrs, sizeof (*iaddrs), n, fp);
+	mdb_free(iaddrs, MAX(hdr.fjsx_naddrs, 1) * sizeof (*iaddrs));
+
+	hdr.fjsx_proprefs_off = hdr.fjsx_addrs_off +
+	    hdr.fjsx_naddrs * sizeof (findjsobjects_iaddr_t);
+	hdr.fjsx_nproprefs = nproprefs;
+
+	for (obj = fjs->fjs_objects; obj != NULL; obj = obj->fjso_next) {
+		for (prop = obj->fjso_props; prop != NULL;
+		    prop = prop->fjsp_next) {
+			ref = findjsobjects_strtab_add(&strtab,
+			    prop->fjsp_desc);
+			(void) fwrite(&ref, sizeof (ref), 1, fp);
+		}
+	}
+
+	hdr.fjsx_strtab_off = hdr.fjsx_proprefs_off +
+	    nproprefs * sizeof (ref);
+	hdr.fjsx_strtabsz = strtab.fjst_buflen;
+
+	if (strtab.fjst_full) {
+		mdb_warn("too many distinct strings for an index\n");
+		findjsobjects_strtab_fini(&strtab);
+		(void) fclose(fp);
+		(void) unlink(path);
+		return (-1);
+	}
+
+	if (strtab.fjst_buflen != 0)
+		(void) fwrite(strtab.fjst_buf, strtab.fjst_buflen, 1, fp);
+
+	findjsobjects_strtab_fini(&strtab);
+
+	if (fseek(fp, 0, SEEK_SET) != 0 ||
+	    fwrite(&hdr, sizeof (hdr), 1, fp) != 1 ||
+	    fflush(fp) != 0 || ferror(fp)) {
+		mdb_warn("failed to write \"%s\"", path);
+		(void) fclose(fp);
+		(void) unlink(path);
+		return (-1);
+	}
+
+	(void) fclose(fp);
+	return (0);
+}
+
+/*
+ * Returns the string at offset "off" in the string table of an index, or NULL
+ * if the offset is invalid.  (The load code has ensured that the string table
+ * is NUL-terminated.)
+ */
+static const char *
+findjsobjects_index_str(const findjsobjects_ihdr_t *hdr, const char *base,
+    uint64_t off)
+{
+	if (off >= hdr->fjsx_strtabsz)
+		return (NULL);
+
+	return (base + hdr->fjsx_strtab_off + off);
+}
+
+static boolean_t
+findjsobjects_index_range(uint64_t off, uint64_t count, size_t size,
+    uint64_t filesz)
+{
+	return (off <= filesz && count <= (filesz - off) / size);
+}
+
+static int
+findjsobjects_index_read(findjsobjects_state_t *fjs,
+    const findjsobjects_ihdr_t *hdr, const char *base)
+{
+	const findjsobjects_iobj_t *iobjs = (const findjsobjects_iobj_t *)
+	    (base + hdr->fjsx_objs_off);
+	const findjsobjects_ifunc_t *ifuncs = (const findjsobjects_ifunc_t *)
+	    (base + hdr->fjsx_funcs_off);
+	const uint64_t *insts = (const uint64_t *)(base + hdr->fjsx_insts_off);
+	const uint32_t *proprefs = (const uint32_t *)
+	    (base + hdr->fjsx_proprefs_off);
+	findjsobjects_obj_t *obj;
+	findjsobjects_func_t *func;
+	const char *str;
+	uint64_t i, j;
+
+	fjs->fjs_nishapes = hdr->fjsx_nobjs;
+	fjs->fjs_ishapes = mdb_zalloc(MAX(hdr->fjsx_nobjs, 1) *
+	    sizeof (findjsobjects_obj_t *), UM_SLEEP);
+
+	/*
+	 * Objects were saved in sorted order.  Each one we insert goes onto
+	 * the front of the list, so we load them in reverse to preserve that
+	 * order.
+	 */
+	for (i = hdr->fjsx_nobjs; i-- > 0; ) {
+		const findjsobjects_iobj_t *iobj = &iobjs[i];
+
+		if (iobj->fjsio_ninsts == 0 || iobj->fjsio_ninsts > INT_MAX ||
+		    iobj->fjsio_first > hdr->fjsx_ninsts ||
+		    iobj->fjsio_ninsts > hdr->fjsx_ninsts -
+		    iobj->fjsio_first ||
+		    iobj->fjsio_firstprop > hdr->fjsx_nproprefs ||
+		    iobj->fjsio_nproprefs > hdr->fjsx_nproprefs -
+		    iobj->fjsio_firstprop ||
+		    (str = findjsobjects_index_str(hdr, base,
+		    iobj->fjsio_constructor)) == NULL)
+			return (-1);
+
+		obj = findjsobjects_alloc(fjs, insts[iobj->fjsio_first]);
+		obj->fjso_nprops = iobj->fjsio_nprops;
+		obj->fjso_bytes = iobj->fjsio_bytes;
+		obj->fjso_propinfo = iobj->fjsio_propinfo;
+		obj->fjso_malformed = iobj->fjsio_malformed != 0;
+		(void) strlcpy(obj->fjso_constructor, str,
+		    sizeof (obj->fjso_constructor));
+
+		for (j = 0; j < iobj->fjsio_nproprefs; j++) {
+			if ((str = findjsobjects_index_str(hdr, base,
+			    proprefs[iobj->fjsio_firstprop + j])) == NULL)
+				return (-1);
+
+			findjsobjects_prop_add(fjs, obj, str);
+		}
+
+		if (findjsobjects_lookup(fjs, obj) != NULL)
+			return (-1);
+
+		fjs->fjs_current = obj;
+		obj = findjsobjects_insert(fjs);
+		fjs->fjs_ishapes[i] = obj;
+
+		/*
+		 * Instances are stored with the representative first.  The
+		 * rest stay in the index until they're needed.
+		 */
+		obj->fjso_ninstances = iobj->fjsio_ninsts;
+		obj->fjso_pending = &insts[iobj->fjsio_first + 1];
+		obj->fjso_npending = iobj->fjsio_ninsts - 1;
+	}
+
+	/*
+	 * Functions are added to the front of the list, so we load them in
+	 * reverse to preserve their order.
+	 */
+	for (i = hdr->fjsx_nfuncs; i-- > 0; ) {
+		const findjsobjects_ifunc_t *ifunc = &ifuncs[i];
+		const char *funcname, *scriptname, *location;
+
+		if (ifunc->fjsif_ninsts == 0 || ifunc->fjsif_ninsts > INT_MAX ||
+		    ifunc->fjsif_first > hdr->fjsx_ninsts ||
+		    ifunc->fjsif_ninsts > hdr->fjsx_ninsts -
+		    ifunc->fjsif_first ||
+		    (funcname = findjsobjects_index_str(hdr, base,
+		    ifunc->fjsif_funcname)) == NULL ||
+		    (scriptname = findjsobjects_index_str(hdr, base,
+		    ifunc->fjsif_scriptname)) == NULL ||
+		    (location = findjsobjects_index_str(hdr, base,
+		    ifunc->fjsif_location)) == NULL)
+			return (-1);
+
+		func = &fjs->fjs_scratchfunc;
+		bzero(func, sizeof (*func));
+		func->fjsf_shared = ifunc->fjsif_shared;
+		func->fjsf_instances.fjsi_addr = insts[ifunc->fjsif_first];
+		func->fjsf_ninstances = 1;
+		(void) strlcpy(func->fjsf_funcname, funcname,
+		    sizeof (func->fjsf_funcname));
+		(void) strlcpy(func->fjsf_scriptname, scriptname,
+		    sizeof (func->fjsf_scriptname));
+		(void) strlcpy(func->fjsf_location, location,
+		    sizeof (func->fjsf_location));
+
+		if (avl_find(&fjs->fjs_funcinfo, func, NULL) != NULL)
+			return (-1);
+
+		func = findjsobjects_func_insert(fjs, func);
+		func->fjsf_ninstances = ifunc->fjsif_ninsts;
+		func->fjsf_pending = &insts[ifunc->fjsif_first + 1];
+		func->fjsf_npending = ifunc->fjsif_ninsts - 1;
+	}
+
+	fjs->fjs_iaddrs = (const findjsobjects_iaddr_t *)
+	    (base + hdr->fjsx_addrs_off);
+	fjs->fjs_niaddrs = hdr->fjsx_naddrs;
+
+	return (0);
+}
+
+/*
+ * Discard everything we've found, leaving the state as it was before the heap
+ * was scanned (or an index loaded).
+ */
+static void
+findjsobjects_discard(findjsobjects_state_t *fjs)
+{
+	void *cookie = NULL;
+
+	/*
+	 * The objects, functions, and their instances all live in the arenas,
+	 * so we need only empty the trees and release the arenas.
+	 */
+	while (avl_destroy_nodes(&fjs->fjs_tree, &cookie) != NULL)
+		continue;
+
+	cookie = NULL;
+
+	while (avl_destroy_nodes(&fjs->fjs_funcinfo, &cookie) != NULL)
+		continue;
+
+	if (fjs->fjs_names != NULL)
+		mdb_free(fjs->fjs_names,
+		    fjs->fjs_nnamebuckets * sizeof (void *));
+
+	if (fjs->fjs_shapes != NULL)
+		mdb_free(fjs->fjs_shapes,
+		    fjs->fjs_nshapebuckets * sizeof (void *));
+
+	if (fjs->fjs_nametab != NULL)
+		mdb_free(fjs->fjs_nametab,
+		    fjs->fjs_nametabsz * sizeof (void *));
+
+	if (fjs->fjs_ishapes != NULL)
+		mdb_free(fjs->fjs_ishapes,
+		    MAX(fjs->fjs_nishapes, 1) * sizeof (findjsobjects_obj_t *));
+
+	if (fjs->fjs_index != NULL)
+		(void) munmap(fjs->fjs_index, fjs->fjs_indexsz);
+
+	fjs->fjs_index = NULL;
+	fjs->fjs_indexsz = 0;
+	fjs->fjs_iaddrs = NULL;
+	fjs->fjs_niaddrs = 0;
+	fjs->fjs_ishapes = NULL;
+	fjs->fjs_nishapes = 0;
+
+	findjsobjects_revindex_fini(&fjs->fjs_revindex);
+	findjsobjects_retained_fini(&fjs->fjs_retained);
+	fjs->fjs_ctxvalid = B_FALSE;
+	fjs->fjs_nametab = NULL;
+	fjs->fjs_nametabsz = 0;
+	fjs->fjs_names = NULL;
+	fjs->fjs_nnamebuckets = 0;
+	fjs->fjs_nnames = 0;
+	fjs->fjs_shapes = NULL;
+	fjs->fjs_nshapebuckets = 0;
+	fjs->fjs_nshapes = 0;
+
+	findjsobjects_mapmemo_fini(fjs);
+	findjsobjects_arena_release(&fjs->fjs_arena);
+	findjsobjects_arena_release(&fjs->fjs_scratch);
+	fjs->fjs_current = NULL;
+	fjs->fjs_objects = NULL;
+	fjs->fjs_funcs = NULL;
+	fjs->fjs_scanning = B_FALSE;
+	fjs->fjs_aborted = B_FALSE;
+	fjs->fjs_cursor_chunk = 0;
+	fjs->fjs_cursor_off = 0;
+	fjs->fjs_nscanned = 0;
+	bzero(&fjs->fjs_stats, sizeof (fjs->fjs_stats));
+}
+
+static int
+findjsobjects_load(findjsobjects_state_t *fjs, const char *path)
+{
+	findjsobjects_ihdr_t hdr;
+	findjsobjects_key_t key;
+	struct stat st;
+	uint64_t filesz;
+	char *base;
+	int fd, rv = -1;
+
+	if (findjsobjects_key(&key) != 0)
+		return (-1);
+
+	if ((fd = open(path, O_RDONLY)) == -1) {
+		mdb_warn("failed to open \"%s\"", path);
+		return (-1);
+	}
+
+	if (fstat(fd, &st) != 0) {
+		mdb_warn("failed to stat \"%s\"", path);
+		(void) close(fd);
+		return (-1);
+	}
+
+	filesz = st.st_size;
+
+	if (filesz < sizeof (hdr)) {
+		mdb_warn("\"%s\" is not a findjsobjects index\n", path);
+		(void) close(fd);
+		return (-1);
+	}
+
+	base = mmap(NULL, filesz, PROT_READ, MAP_PRIVATE, fd, 0);
+	(void) close(fd);
+
+	if (base == MAP_FAILED) {
+		mdb_warn("failed to map \"%s\"", path);
+		return (-1);
+	}
+
+	bcopy(base, &hdr, sizeof (hdr));
+
+	if (bcmp(hdr.fjsx_magic, FJS_INDEX_MAGIC,
+	    sizeof (hdr.fjsx_magic)) != 0) {
+		mdb_warn("\"%s\" is not a findjsobjects index\n", path);
+		goto out;
+	}
+
+	if (hdr.fjsx_version != FJS_INDEX_VERSION ||
+	    hdr.fjsx_ptrsize != sizeof (uintptr_t) ||
+	    hdr.fjsx_statsize != sizeof (findjsobjects_stats_t)) {
+		mdb_warn("\"%s\" was written by an incompatible version "
+		    "of mdb_v8\n", path);
+		goto out;
+	}
+
+	if (bcmp(&hdr.fjsx_key, &key, sizeof (key)) != 0) {
+		mdb_warn("\"%s\" was not created from this target\n", path);
+		goto out;
+	}
+
+	if (!findjsobjects_index_range(hdr.fjsx_objs_off, hdr.fjsx_nobjs,
+	    sizeof (findjsobjects_iobj_t), filesz) ||
+	    !findjsobjects_index_range(hdr.fjsx_funcs_off, hdr.fjsx_nfuncs,
+	    sizeof (findjsobjects_ifunc_t), filesz) ||
+	    !findjsobjects_index_range(hdr.fjsx_insts_off, hdr.fjsx_ninsts,
+	    sizeof (uint64_t), filesz) ||
+	    !findjsobjects_index_range(hdr.fjsx_addrs_off, hdr.fjsx_naddrs,
+	    sizeof (findjsobjects_iaddr_t), filesz) ||
+	    hdr.fjsx_naddrs > hdr.fjsx_ninsts ||
+	    !findjsobjects_index_range(hdr.fjsx_proprefs_off,
+	    hdr.fjsx_nproprefs, sizeof (uint32_t), filesz) ||
+	    !findjsobjects_index_range(hdr.fjsx_strtab_off,
+	    hdr.fjsx_strtabsz, 1, filesz) ||
+	    hdr.fjsx_objs_off % sizeof (uint64_t) != 0 ||
+	    hdr.fjsx_funcs_off % sizeof (uint64_t) != 0 ||
+	    hdr.fjsx_insts_off % sizeof (uint64_t) != 0 ||
+	    hdr.fjsx_addrs_off % sizeof (uint64_t) != 0 ||
+	    hdr.fjsx_proprefs_off % sizeof (uint32_t) != 0 ||
+	    (hdr.fjsx_strtabsz != 0 &&
+	    base[hdr.fjsx_strtab_off + hdr.fjsx_strtabsz - 1] != '\0')) {
+		mdb_warn("\"%s\" is corrupt\n", path);
+		goto out;
+	}
+
+	/*
+	 * The index stays mapped for as long as we're using its results (see
+	 * findjsobjects_discard()).
+	 */
+	fjs->fjs_index = base;
+	fjs->fjs_indexsz = filesz;
+
+	if (findjsobjects_index_read(fjs, &hdr, base) != 0) {
+		mdb_warn("\"%s\" is corrupt\n", path);
+		findjsobjects_discard(fjs);
+		return (-1);
+	}
+
+	findjsobjects_tree_build(fjs);
+	fjs->fjs_stats = hdr.fjsx_stats;
+	fjs->fjs_nbytes = hdr.fjsx_nbytes;
+	fjs->fjs_nscanned = hdr.fjsx_nbytes;
+	return (0);
+
+out:
+	(void) munmap(base, filesz);
+	return (rv);
+}
+
+static findjsobjects_state_t findjsobjects_state;
+
+/*
+ * Scan the target's memory for objects and functions, or continue a serial
+ * scan that previously stopped early.  On return, the objects found so far
+ * are sorted and in the tree; fjs_scanning remains set if the scan is still
+ * incomplete.
+ */
+static int
+findjsobjects_scan(findjsobjects_state_t *fjs)
+{
+	struct ps_prochandle *Pr;
+	findjsobjects_obj_t **sorted, *obj;
+	sigset_t intr, omask;
+	boolean_t stopped = B_FALSE;
+	void *cookie = NULL;
+	hrtime_t now;
+	int nobjs;
+	uint_t i;
+
+	if (mdb_get_xdata("pshandle", &Pr, sizeof (Pr)) == -1) {
+		mdb_warn("couldn't read pshandle xdata");
+		return (-1);
+	}
+
+	if (fjs->fjs_nworkers > 1 && fjs->fjs_scanning) {
+		mdb_warn("findjsobjects: resuming a serial scan; "
+		    "ignoring -P\n");
+		fjs->fjs_nworkers = 1;
+	}
+
+	if (fjs->fjs_nworkers > 1 && Pstate(Pr) != PS_DEAD) {
+		mdb_warn("findjsobjects: parallel scans are only "
+		    "supported on core files; scanning serially\n");
+		fjs->fjs_nworkers = 1;
+	}
+
+	if (fjs->fjs_nworkers > 1 && fjs->fjs_budget != 0) {
+		mdb_warn("findjsobjects: time budgets are only supported "
+		    "for serial scans; scanning serially\n");
+		fjs->fjs_nworkers = 1;
+	}
+
+	if (fjs->fjs_window == 0)
+		fjs->fjs_window = FJS_WINDOWSIZE;
+
+	v8_silent++;
+
+	if (!fjs->fjs_scanning) {
+		fjs->fjs_chunksize = fjs->fjs_nworkers > 1 ? FJS_CHUNKSIZE : 0;
+		fjs->fjs_nchunks = 0;
+		fjs->fjs_nbytes = 0;
+		fjs->fjs_nscanned = 0;
+		fjs->fjs_cursor_chunk = 0;
+		fjs->fjs_cursor_off = 0;
+
+		if (Pmapping_iter(Pr,
+		    (proc_map_f *)findjsobjects_mapping, fjs) != 0) {
+			v8_silent--;
+			return (-1);
+		}
+	} else {
+		/*
+		 * We're picking up where we left off.  The tree will be
+		 * rebuilt (and the objects sorted again) once we stop.
+		 */
+		while (avl_destroy_nodes(&fjs->fjs_tree, &cookie) != NULL)
+			continue;
+
+		findjsobjects_revindex_fini(&fjs->fjs_revindex);
+		findjsobjects_retained_fini(&fjs->fjs_retained);
+		fjs->fjs_ctxvalid = B_FALSE;
+	}
+
+	v8_typecache_hold();
+
+	fjs->fjs_interrupted = B_FALSE;
+	(void) sigemptyset(&intr);
+	(void) sigaddset(&intr, SIGINT);
+	(void) sigprocmask(SIG_BLOCK, &intr, &omask);
+
+	if (fjs->fjs_nworkers > 1) {
+		fjs->fjs_aborted = B_TRUE;
+
+		if (findjsobjects_scan_parallel(fjs) != 0) {
+			v8_typecache_rele();
+			v8_silent--;
+
+			if (fjs->fjs_interrupted) {
+				mdb_warn("findjsobjects: interrupted; "
+				    "stopped all workers\n");
+			}
+
+			(void) sigprocmask(SIG_SETMASK, &omask, NULL);
+			return (-1);
+		}
+
+		fjs->fjs_aborted = B_FALSE;
+		fjs->fjs_nscanned = fjs->fjs_nbytes;
+	} else {
+		now = gethrtime();
+		fjs->fjs_scanning = B_TRUE;
+		fjs->fjs_deadline = fjs->fjs_budget == 0 ? 0 :
+		    now + (hrtime_t)fjs->fjs_budget * NANOSEC;
+		fjs->fjs_progstart = fjs->fjs_proglast = now;
+		fjs->fjs_progbytes = fjs->fjs_nscanned;
+		fjs->fjs_progobjs = fjs->fjs_stats.fjss_jsobjs;
+
+		stopped = findjsobjects_scan_resume(fjs);
+		fjs->fjs_scanning = stopped;
+	}
+
+	v8_typecache_rele();
+
+	if (!stopped)
+		findjsobjects_mapmemo_fini(fjs);
+
+	findjsobjects_tree_build(fjs);
+
+	if ((nobjs = avl_numnodes(&fjs->fjs_tree)) != 0) {
+		/*
+		 * We have the objects -- now sort them.
+		 */
+		sorted = mdb_alloc(nobjs * sizeof (void *),
+		    UM_SLEEP | UM_GC);
+
+		for (obj = fjs->fjs_objects, i = 0; obj != NULL;
+		    obj = obj->fjso_next, i++) {
+			sorted[i] = obj;
+		}
+
+		qsort(sorted, avl_numnodes(&fjs->fjs_tree),
+		    sizeof (void *), findjsobjects_cmp_ninstances);
+
+		for (i = 1, fjs->fjs_objects = sorted[0];
+		    i < nobjs; i++)
+			sorted[i - 1]->fjso_next = sorted[i];
+
+		sorted[nobjs - 1]->fjso_next = NULL;
+	}
+
+	v8_silent--;
+	fjs->fjs_finished = !fjs->fjs_scanning;
+
+	if (stopped) {
+		mdb_warn("findjsobjects: %s after scanning %llu of %llu MB; "
+		    "results are partial (run ::findjsobjects again to "
+		    "resume)\n", fjs->fjs_interrupted ? "interrupted" :
+		    "time budget exhausted",
+		    fjs->fjs_nscanned / (1024 * 1024),
+		    fjs->fjs_nbytes / (1024 * 1024));
+	}
+
+	/*
+	 * If we were interrupted, restoring the signal mask delivers the
+	 * pending SIGINT, which aborts this dcmd.  Everything is consistent by
+	 * now, so that's safe.
+	 */
+	(void) sigprocmask(SIG_SETMASK, &omask, NULL);
+
+	return (0);
+}
+
+/*
+ * Warn the user that the results of the heap scan are incomplete.
+ */
+static void
+findjsobjects_partial(findjsobjects_state_t *fjs)
+{
+	if (fjs->fjs_scanning) {
+		mdb_warn("warning: findjsobjects heap scan is incomplete "
+		    "(%llu of %llu MB scanned); results are partial\n",
+		    fjs->fjs_nscanned / (1024 * 1024),
+		    fjs->fjs_nbytes / (1024 * 1024));
+	}
+}
+
+static int
+findjsobjects_run(findjsobjects_state_t *fjs)
+{
+	findjsobjects_stats_t *stats = &fjs->fjs_stats;
+
+	if (!fjs->fjs_initialized) {
+		avl_create(&fjs->fjs_tree,
+		    (int(*)(const void *, const void *))findjsobjects_cmp,
+		    sizeof (findjsobjects_obj_t),
+		    offsetof(findjsobjects_obj_t, fjso_node));
+
+		avl_create(&fjs->fjs_referents,
+		    (int(*)(const void *, const void *))
+		    findjsobjects_cmp_referents,
+		    sizeof (findjsobjects_referent_t),
+		    offsetof(findjsobjects_referent_t, fjsr_node));
+
+		avl_create(&fjs->fjs_funcinfo,
+		    (int(*)(const void *, const void*))
+		    findjsobjects_cmp_funcinfo,
+		    sizeof (findjsobjects_func_t),
+		    offsetof(findjsobjects_func_t, fjsf_node));
+
+		fjs->fjs_initialized = B_TRUE;
+	}
+
+	/*
+	 * If a parallel scan was interrupted, whatever it left behind is
+	 * incomplete and can't be resumed, so we start over.
+	 */
+	if (fjs->fjs_aborted)
+		findjsobjects_discard(fjs);
+
+	if (avl_is_empty(&fjs->fjs_tree) || fjs->fjs_scanning) {
+		hrtime_t start = gethrtime();
+		uint_t i;
+
+		fjs->fjs_workers = NULL;
+
+		if (fjs->fjs_loadpath != NULL) {
+			if (findjsobjects_load(fjs, fjs->fjs_loadpath) != 0)
+				return (-1);
+		} else if (findjsobjects_scan(fjs) != 0) {
+			return (-1);
+		}
+
+		fjs->fjs_finished = !fjs->fjs_scanning;
+
+		if (fjs->fjs_verbose) {
+			const char *f = "findjsobjects: %30s => %d\n";
+			const char *f64 = "findjsobjects: %30s => %llu\n";
+			int elapsed = (int)((gethrtime() - start) / NANOSEC);
+
+			if (fjs->fjs_loadpath != NULL) {
+				mdb_printf("findjsobjects: %30s => %s\n",
+				    "loaded from index", fjs->fjs_loadpath);
+			}
+
+			mdb_printf(f, "elapsed time (seconds)", elapsed);
+			mdb_printf(f64, "words scanned", stats->fjss_words);
+			mdb_printf(f64, "candidate map words",
+			    stats->fjss_candidates);
+			mdb_printf(f, "rejected non-maps", stats->fjss_notmaps);
+			mdb_printf(f, "type reads", stats->fjss_typereads);
+			mdb_printf(f, "cached reads", stats->fjss_cached);
+			mdb_printf(f64, "map type cache hits",
+			    stats->fjss_typecache_hits);
+			mdb_printf(f64, "map type cache misses",
+			    stats->fjss_typecache_misses);
+			mdb_printf(f, "JavaScript objects", stats->fjss_jsobjs);
+			mdb_printf(f, "processed objects", stats->fjss_objects);
+			mdb_printf(f, "possible garbage", stats->fjss_garbage);
+			mdb_printf(f, "processed arrays", stats->fjss_arrays);
+			mdb_printf(f, "unique objects", stats->fjss_uniques);
+			mdb_printf(f64, "JSObject shallow bytes",
+			    stats->fjss_objbytes);
+			mdb_printf(f64, "JSArray shallow bytes",
+			    stats->fjss_arraybytes);
+			mdb_printf(f64, "JSTypedArray shallow bytes",
+			    stats->fjss_typedbytes);
+			mdb_printf(f64, "JSTypedArray data bytes",
+			    stats->fjss_externalbytes);
+			mdb_printf(f, "interned property names",
+			    (int)fjs->fjs_nnames);
+			mdb_printf(f64, "shape fingerprint collisions",
+			    stats->fjss_collisions);
+			mdb_printf(f64, "objects matched by map",
+			    stats->fjss_mapmemo_hits);
+			mdb_printf(f, "functions found", stats->fjss_funcs);
+			mdb_printf(f, "unique functions",
+			    stats->fjss_funcs_unique);
+			mdb_printf(f, "functions skipped",
+			    stats->fjss_funcs_skipped);
+			mdb_printf(f, "memory scanned (MB)",
+			    (int)(fjs->fjs_nscanned / (1024 * 1024)));
+			mdb_printf(f64, "window reads", stats->fjss_windows);
+			mdb_printf(f64, "unreadable bytes skipped",
+			    stats->fjss_unreadable);
+			mdb_printf(f64, "scan CPU time (ms)",
+			    (uint64_t)(stats->fjss_scantime /
+			    (NANOSEC / 1000)));
+			mdb_printf(f64, "scan CPU per GB scanned (ms)",
+			    fjs->fjs_nbytes == 0 ? 0 : (uint64_t)
+			    (stats->fjss_scantime / (NANOSEC / 1000) *
+			    (1024 * 1024 * 1024) / fjs->fjs_nbytes));
+			mdb_printf(f64, "bookkeeping bytes allocated",
+			    (uint64_t)(fjs->fjs_arena.fjsa_total +
+			    fjs->fjs_scratch.fjsa_total));
+			mdb_printf(f64, "bookkeeping bytes mapped",
+			    (uint64_t)(fjs->fjs_arena.fjsa_mapped +
+			    fjs->fjs_scratch.fjsa_mapped));
+			mdb_printf(f64, "bookkeeping peak bytes",
+			    (uint64_t)(fjs->fjs_arena.fjsa_peak +
+			    fjs->fjs_scratch.fjsa_peak));
+
+			for (i = 0; fjs->fjs_workers != NULL &&
+			    i < fjs->fjs_nworkers; i++) {
+				findjsobjects_worker_t *fjw =
+				    &fjs->fjs_workers[i];
+				uint64_t ms = fjw->fjsw_elapsed /
+				    (NANOSEC / 1000);
+				uint64_t mb = fjw->fjsw_nbytes / (1024 * 1024);
+
+				mdb_printf("findjsobjects: %23s %-6d => "
+				    "%llu MB in %llu ms (%llu MB/s), "
+				    "%d objects%s\n", "worker", i, mb, ms,
+				    ms == 0 ? 0 : mb * 1000 / ms,
+				    fjw->fjsw_jsobjs,
+				    fjw->fjsw_failed ? " (scanned serially)" :
+				    "");
+			}
+		}
+	}
+
+	return (0);
+}
+
+static int
+dcmd_findjsobjects(uintptr_t addr,
+    uint_t flags, int argc, const mdb_arg_t *argv)
+{
+	findjsobjects_state_t *fjs = &findjsobjects_state;
+	findjsobjects_obj_t *obj;
+	boolean_t references = B_FALSE, listlike = B_FALSE;
+	boolean_t revindex = B_FALSE;
+	const char *propname = NULL;
+	const char *constructor = NULL;
+	const char *propkind = NULL;
+	const char *loadpath = NULL, *savepath = NULL, *sortby = NULL;
+	uintptr_t nworkers = 1, budget = 0, window = FJS_WINDOWSIZE;
+	findjsobjects_obj_t **sorted;
+	boolean_t bybytes = B_FALSE;
+	size_t nobjs, i;
+	int rv;
+
+	fjs->fjs_verbose = B_FALSE;
+	fjs->fjs_brk = B_FALSE;
+	fjs->fjs_marking = B_FALSE;
+	fjs->fjs_allobjs = B_FALSE;
+
+	if (mdb_getopts(argc, argv,
+	    'a', MDB_OPT_SETBITS, B_TRUE, &fjs->fjs_allobjs,
+	    'b', MDB_OPT_SETBITS, B_TRUE, &fjs->fjs_brk,
+	    'c', MDB_OPT_STR, &constructor,
+	    'k', MDB_OPT_STR, &propkind,
+	    'l', MDB_OPT_SETBITS, B_TRUE, &listlike,
+	    'L', MDB_OPT_STR, &loadpath,
+	    'm', MDB_OPT_SETBITS, B_TRUE, &fjs->fjs_marking,
+	    'p', MDB_OPT_STR, &propname,
+	    'P', MDB_OPT_UINTPTR, &nworkers,
+	    'r', MDB_OPT_SETBITS, B_TRUE, &references,
+	    'R', MDB_OPT_SETBITS, B_TRUE, &revindex,
+	    's', MDB_OPT_STR, &sortby,
+	    'S', MDB_OPT_STR, &savepath,
+	    'T', MDB_OPT_UINTPTR, &budget,
+	    'v', MDB_OPT_SETBITS, B_TRUE, &fjs->fjs_verbose,
+	    'w', MDB_OPT_UINTPTR, &window,
+	    NULL) != argc)
+		return (DCMD_USAGE);
+
+	if (sortby != NULL) {
+		if (strcmp(sortby, "bytes") == 0) {
+			bybytes = B_TRUE;
+		} else if (strcmp(sortby, "count") != 0) {
+			mdb_warn("objects can only be sorted by \"count\" or "
+			    "\"bytes\"\n");
+			return (DCMD_ERR);
+		}
+	}
+
+	if (window < FJS_WINDOW_MIN) {
+		mdb_warn("window size must be at least %d bytes\n",
+		    FJS_WINDOW_MIN);
+		return (DCMD_ERR);
+	}
+
+	fjs->fjs_window = window & ~(sizeof (uintptr_t) - 1);
+
+	if (nworkers < 1 || nworkers > FJS_MAXWORKERS) {
+		mdb_warn("number of workers must be between 1 and %d\n",
+		    FJS_MAXWORKERS);
+		return (DCMD_ERR);
+	}
+
+	fjs->fjs_nworkers = (uint_t)nworkers;
+	fjs->fjs_budget = budget;
+
+	if (loadpath != NULL && fjs->fjs_initialized &&
+	    (!avl_is_empty(&fjs->fjs_tree) || fjs->fjs_scanning)) {
+		mdb_warn("cannot load an index after the heap has already "
+		    "been scanned\n");
+		return (DCMD_ERR);
+	}
+
+	fjs->fjs_loadpath = loadpath;
+	rv = findjsobjects_run(fjs);
+	fjs->fjs_loadpath = NULL;
+	fjs->fjs_budget = 0;
+
+	if (rv != 0)
+		return (DCMD_ERR);
+
+	if (savepath != NULL && !fjs->fjs_finished) {
+		mdb_warn("cannot save an index until the heap scan is "
+		    "complete\n");
+		return (DCMD_ERR);
+	}
+
+	if (savepath != NULL && findjsobjects_save(fjs, savepath) != 0)
+		return (DCMD_ERR);
+
+	findjsobjects_partial(fjs);
+
+	if (revindex) {
+		if (!fjs->fjs_revindex.fjsri_built)
+			findjsobjects_revindex_build(fjs);
+
+		references = B_TRUE;
+	}
+
+	if (listlike && !(flags & DCMD_ADDRSPEC)) {
+		if (propname != NULL || constructor != NULL ||
+		    propkind != NULL) {
+			char opt = propname != NULL ? 'p' :
+			    propkind != NULL ? 'k' :'c';
+
+			mdb_warn("cannot specify -l with -%c; instead, pipe "
+			    "output of ::findjsobjects -%c to "
+			    "::findjsobjects -l\n", opt, opt);
+			return (DCMD_ERR);
+		}
+
+		return (findjsobjects_match(fjs, addr, flags,
+		    findjsobjects_match_all, NULL));
+	}
+
+	if (propname != NULL) {
+		if (constructor != NULL || propkind != NULL) {
+			mdb_warn("cannot specify both a property name "
+			    "and a %s\n", constructor != NULL ?
+			    "constructor" : "property kind");
+			return (DCMD_ERR);
+		}
+
+		return (findjsobjects_match(fjs, addr, flags,
+		    findjsobjects_match_propname, propname));
+	}
+
+	if (constructor != NULL) {
+		if (propkind != NULL) {
+			mdb_warn("cannot specify both a constructor name "
+			    "and a property kind\n");
+			return (DCMD_ERR);
+		}
+
+		return (findjsobjects_match(fjs, addr, flags,
+		    findjsobjects_match_constructor, constructor));
+	}
+
+	if (propkind != NULL) {
+		return (findjsobjects_match(fjs, addr, flags,
+		    findjsobjects_match_kind, propkind));
+	}
+
+	if (references && !(flags & DCMD_ADDRSPEC) &&
+	    avl_is_empty(&fjs->fjs_referents)) {
+		mdb_warn("must specify or mark an object to find references\n");
+		return (DCMD_ERR);
+	}
+
+	if (fjs->fjs_marking && !(flags & DCMD_ADDRSPEC)) {
+		mdb_warn("must specify an object to mark\n");
+		return (DCMD_ERR);
+	}
+
+	if (references && fjs->fjs_marking) {
+		mdb_warn("can't both mark an object and find its references\n");
+		return (DCMD_ERR);
+	}
+
+	if (flags & DCMD_ADDRSPEC) {
+		findjsobjects_instance_t *inst;
+
+		/*
+		 * If we've been passed an address, it's to either list like
+		 * objects (-l), mark an object (-m) or find references to the
+		 * specified/marked objects (-r).  (Note that the absence of
+		 * any of these options implies -l.)
+		 */
+		if (revindex && !listlike) {
+			/*
+			 * With the reverse reference index, we can find the
+			 * references to any object, not just those we found.
+			 * If we're given a pipeline of addresses, we take all
+			 * of them now and look them up together.
+			 */
+			mdb_pipe_t p;
+
+			if (flags & DCMD_PIPE) {
+				mdb_get_pipe(&p);
+			} else {
+				p.pipe_data = &addr;
+				p.pipe_len = 1;
+			}
+
+			findjsobjects_revindex_query(fjs, p.pipe_data,
+			    p.pipe_len, (flags & DCMD_PIPE_OUT) != 0);
+			return (DCMD_OK);
+		}
+
+		if ((obj = findjsobjects_instance(fjs, addr)) == NULL) {
+			mdb_warn("%p is not a valid object\n", addr);
+			return (DCMD_ERR);
+		}
+
+		if (!references && !fjs->fjs_marking) {
+			for (inst = findjsobjects_obj_instances(fjs, obj);
+			    inst != NULL; inst = inst->fjsi_next)
+				mdb_printf("%p\n", inst->fjsi_addr);
+
+			return (DCMD_OK);
+		}
+
+		if (!listlike) {
+			findjsobjects_referent(fjs, addr);
+		} else {
+			for (inst = findjsobjects_obj_instances(fjs, obj);
+			    inst != NULL; inst = inst->fjsi_next)
+				findjsobjects_referent(fjs, inst->fjsi_addr);
+		}
+	}
+
+	if (references)
+		findjsobjects_references(fjs, (flags & DCMD_PIPE_OUT) != 0);
+
+	if (references || fjs->fjs_marking)
+		return (DCMD_OK);
+
+	if (!bybytes) {
+		mdb_printf("%?s %8s %8s %s\n", "OBJECT",
+		    "#OBJECTS", "#PROPS", "CONSTRUCTOR: PROPS");
+
+		for (obj = fjs->fjs_objects; obj != NULL;
+		    obj = obj->fjso_next) {
+			if (obj->fjso_malformed && !fjs->fjs_allobjs)
+				continue;
+
+			findjsobjects_print(obj, B_FALSE);
+		}
+
+		return (DCMD_OK);
+	}
+
+	/*
+	 * The objects are kept sorted by their number of instances, so to
+	 * list them by size we sort a copy of the list.
+	 */
+	for (nobjs = 0, obj = fjs->fjs_objects; obj != NULL;
+	    obj = obj->fjso_next)
+		nobjs++;
+
+	sorted = mdb_alloc(MAX(nobjs, 1) * sizeof (void *), UM_SLEEP | UM_GC);
+
+	for (i = 0, obj = fjs->fjs_objects; obj != NULL; obj = obj->fjso_next)
+		sorted[i++] = obj;
+
+	qsort(sorted, nobjs, sizeof (void *), findjsobjects_cmp_bytes);
+
+	mdb_printf("%?s %8s %8s %12s %s\n", "OBJECT",
+	    "#OBJECTS", "#PROPS", "BYTES", "CONSTRUCTOR: PROPS");
+
+	for (i = 0; i < nobjs; i++) {
+		if (sorted[i]->fjso_malformed && !fjs->fjs_allobjs)
+			continue;
+
+		findjsobjects_print(sorted[i], B_TRUE);
+	}
+
+	return (DCMD_OK);
+}
+
+/*
+ * Read the byte length of the JSArrayBuffer at "addr", which V8 stores as a
+ * Number: a SMI, or a HeapNumber for very large buffers.
+ */
+static int
+jsarraybuffer_length(uintptr_t addr, uintptr_t *lenp)
+{
+	uintptr_t len;
+	uint8_t type;
+	double d;
+
+	if (V8_OFF_JSARRAYBUFFER_BYTE_LENGTH == -1 ||
+	    read_heap_ptr(&len, addr, V8_OFF_JSARRAYBUFFER_BYTE_LENGTH) != 0)
+		return (-1);
+
+	if (V8_IS_SMI(len)) {
+		*lenp = V8_SMI_VALUE(len);
+		return (0);
+	}
+
+	if (!V8_IS_HEAPOBJECT(len) || read_typebyte(&type, len) != 0 ||
+	    type != V8_TYPE_HEAPNUMBER ||
+	    read_heap_double(&d, len, V8_OFF_HEAPNUMBER_VALUE) != 0 || d < 0)
+		return (-1);
+
+	*lenp = (uintptr_t)d;
+	return (0);
+}
+
+/*
+ * Locate the data of the Node Buffer at "addr".  If "view" is set, the buffer
+ * is a typed array whose data is in the backing store of its ArrayBuffer;
+ * otherwise, it's an older Buffer whose data is referenced from its elements.
+ * Returns the address of the backing store in *storep and the offset of the
+ * buffer's data into it in *offsetp.  If "sizep" is non-NULL, the size of the
+ * whole backing store (or 0 if it can't be determined) is returned there.
+ */
+static int
+nodebuffer_data(uintptr_t addr, boolean_t view, uintptr_t *storep,
+    uintptr_t *offsetp, uintptr_t *sizep)
+{
+	uintptr_t elts, rawbuf, len;
+	uintptr_t arraybuffer_view_buffer;
+	uintptr_t arraybufferview_content_offset;
+
+	if (!view) {
+		/*
+		 * This works for Buffer and NativeBuffer instances in node <
+		 * 4.0 because they use elements slots to reference the backing
+		 * storage. If the constructor name is not "Buffer" or
+		 * "NativeBuffer" but "Uint8Array" and
+		 * V8_OFF_JSARRAYBUFFER_BACKINGSTORE == -1, it means we are in
+		 * the range of node versions >= 4.0 and <= 4.1 that ship
+		 * with V8 4.5.x. For these versions, it also works because
+		 * Buffer instances are actually typed arrays but their backing
+		 * storage is an ExternalUint8Arrayelements whose address is
+		 * stored in the first element's slot.
+		 */
+		if (read_heap_ptr(&elts, addr, V8_OFF_JSOBJECT_ELEMENTS) != 0)
+			return (-1);
+
+		if (obj_v8internal(elts, 0, &rawbuf) != 0)
+			return (-1);
+
+		*storep = rawbuf;
+		*offsetp = 0;
+
+		if (sizep != NULL && read_heap_smi(sizep, elts,
+		    V8_OFF_FIXEDARRAY_LENGTH) != 0)
+			*sizep = 0;
+
+		return (0);
+	}
+
+	/*
+	 * The buffer instance's constructor name is Uint8Array, and
+	 * V8_OFF_JSARRAYBUFFER_BACKINGSTORE != -1, which means that
+	 * we're dealing with a node version that ships with V8 4.6 or
+	 * later. For these versions, buffer instances store their data
+	 * as a typed array, but this time instead of having the backing
+	 * store as an ExternalUint8Array referenced from an element
+	 * slot, it can be found at two different locations:
+	 *
+	 * 1. As a FixedTypedArray casted as a FixedTypedArrayBase in an
+	 * element slot.
+	 *
+	 * 2. As the "backing_store" property of the corresponding
+	 * JSArrayBuffer.
+	 *
+	 * The second way to retrieve the backing store seems like
+	 * it will be less likely to change, and is thus the one we're
+	 * using.
+	 */
+	if (V8_OFF_JSARRAYBUFFER_BACKINGSTORE == -1 ||
+	    V8_OFF_JSARRAYBUFFERVIEW_BUFFER == -1 ||
+	    V8_OFF_JSARRAYBUFFERVIEW_CONTENT_OFFSET == -1)
+		return (-1);
+
+	if (read_heap_ptr(&arraybuffer_view_buffer, addr,
+	    V8_OFF_JSARRAYBUFFERVIEW_BUFFER) != 0)
+		return (-1);
+
+	if (read_heap_ptr(&rawbuf, arraybuffer_view_buffer,
+	    V8_OFF_JSARRAYBUFFER_BACKINGSTORE) != 0)
+		return (-1);
+
+	if (read_heap_smi(&arraybufferview_content_offset, addr,
+	    V8_OFF_JSARRAYBUFFERVIEW_CONTENT_OFFSET) != 0)
+		return (-1);
+
+	*storep = rawbuf;
+	*offsetp = arraybufferview_content_offset;
+
+	if (sizep == NULL)
+		return (0);
+
+	/*
+	 * If the ArrayBuffer's length isn't available, the view extends at
+	 * least as far as its own end.
+	 */
+	if (jsarraybuffer_length(arraybuffer_view_buffer, sizep) != 0) {
+		if (V8_OFF_JSARRAYBUFFERVIEW_BYTE_LENGTH == -1 ||
+		    read_heap_smi(&len, addr,
+		    V8_OFF_JSARRAYBUFFERVIEW_BYTE_LENGTH) != 0)
+			len = 0;
+
+		*sizep = len != 0 ? arraybufferview_content_offset + len : 0;
+	}
+
+	return (0);
+}
+
+/*
+ * Given a Node Buffer object, print out details about it.  With "-a", just
+ * print the address.
+ */
+/* ARGSUSED */
+static int
+dcmd_nodebuffer(uintptr_t addr, uint_t flags, int argc,
+    const mdb_arg_t *argv)
+{
+	boolean_t opt_f = B_FALSE;
+	char buf[80];
+	char *bufp = buf;
+	size_t len = sizeof (buf);
+	uintptr_t rawbuf, offset;
+	boolean_t view;
+
+	/*
+	 * The undocumented "-f" option allows users to override constructor
+	 * checks.
+	 */
+	if (mdb_getopts(argc, argv,
+	    'f', MDB_OPT_SETBITS, B_TRUE, &opt_f, NULL) != argc)
+		return (DCMD_USAGE);
+
+	if (!opt_f) {
+		if (obj_jsconstructor(addr, &bufp, &len, B_FALSE) != 0)
+			return (DCMD_ERR);
+
+		if (strcmp(buf, "Buffer") != 0 &&
+		    strcmp(buf, "NativeBuffer") != 0 &&
+		    strcmp(buf, "Uint8Array") != 0) {
+			mdb_warn("%p does not appear to be a buffer\n", addr);
+			return (DCMD_ERR);
+		}
+	}
+
+	view = strcmp(buf, "Buffer") != 0 &&
+	    strcmp(buf, "NativeBuffer") != 0 &&
+	    V8_OFF_JSARRAYBUFFER_BACKINGSTORE != -1;
+
+	if (nodebuffer_data(addr, view, &rawbuf, &offset, NULL) != 0)
+		return (DCMD_ERR);
+
+	mdb_printf("%p\n", rawbuf + offset);
+	return (DCMD_OK);
+}
+
+static int
+jsclosure_iter_var(v8scopeinfo_t *sip, v8scopeinfo_var_t *sivp, void *arg)
+{
+	v8context_t *ctxp = arg;
+	uintptr_t namep, valp;
+	size_t validx, bufsz;
+	char buf[1024];
+	char *bufp;
+	jsobj_print_t jsop;
+
+	bufp = buf;
+	bufsz = sizeof (buf);
+	(void) bsnprintf(&bufp, &bufsz, "    ");
+	namep = v8scopeinfo_var_name(sip, sivp);
+	if (jsstr_print(namep, JSSTR_QUOTED, &bufp, &bufsz) != 0) {
+		return (-1);
+	}
+
+	validx = v8scopeinfo_var_idx(sip, sivp);
+	if (v8context_var_value(ctxp, validx, &valp) != 0) {
+		return (-1);
+	}
+
+	(void) bsnprintf(&bufp, &bufsz, ": ");
+
+	bzero(&jsop, sizeof (jsop));
+	jsop.jsop_depth = 1;
+	jsop.jsop_bufp = &bufp;
+	jsop.jsop_lenp = &bufsz;
+	jsop.jsop_indent = 4;
+	jsop.jsop_printaddr = B_TRUE;
+	if (jsobj_print(valp, &jsop) != 0) {
+		return (-1);
+	}
+
+	mdb_printf("%s\n", buf);
+	return (0);
+}
+
+/* ARGSUSED */
+static int
+jsfunction_bound_arg(v8boundfunction_t *bfp, uint_t which, uintptr_t value,
+    void *unused)
+{
+	char buf[80];
+	size_t len = sizeof (buf);
+	char *bufp;
+
+	bufp = buf;
+	(void) obj_jstype(value, &bufp, &len, NULL);
+
+	mdb_printf("      arg%d  = %p (%s)\n", which, value, buf);
+	return (0);
+}
+
+/* ARGSUSED */
+static int
+dcmd_jsfunction(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+{
+	v8function_t *fp = NULL;
+	v8funcinfo_t *fip = NULL;
+	v8boundfunction_t *bfp = NULL;
+	mdbv8_strbuf_t *strb = NULL;
+	int memflags = UM_SLEEP | UM_GC;
+	int rv = DCMD_ERR;
+	char buf[80];
+	size_t len = sizeof (buf);
+	char *bufp;
+
+	/*
+	 * Bound functions are separate from other functions.  The regular
+	 * function APIs may not work on them, depending on the Node version.
+	 * Handle them first.
+	 * TODO the API here doesn't really allow you to distinguish between
+	 * something like memory allocation failure and bad input (e.g., not a
+	 * bound function).  It was written assuming you would know what type
+	 * you expected something to be, but this is one of the first cases
+	 * where we don't.
+	 */
+	if ((bfp = v8boundfunction_load(addr, memflags)) != NULL) {
+		uintptr_t thisp;
+
+		mdb_printf("bound function that wraps: %p\n",
+		    v8boundfunction_target(bfp));
+		thisp = v8boundfunction_this(bfp);
+		bufp = buf;
+		(void) obj_jstype(thisp, &bufp, &len, NULL);
+		mdb_printf("with \"this\" = %p (%s)\n", thisp, buf);
+		rv = v8boundfunction_iter_args(bfp, jsfunction_bound_arg, NULL);
+		v8boundfunction_free(bfp);
+		return (rv);
+	}
+
+	v8_warnings++;
+	if ((fp = v8function_load(addr, memflags)) == NULL ||
+	    (fip = v8function_funcinfo(fp, memflags)) == NULL ||
+	    (strb = mdbv8_strbuf_alloc(512, memflags)) == NULL) {
+		goto out;
+	}
+
+	mdbv8_strbuf_sprintf(strb, "function: ");
+
+	if (v8funcinfo_funcname(fip, strb, MSF_ASCIIONLY) != 0) {
+		goto out;
+	}
+
+	mdbv8_strbuf_sprintf(strb, "\ndefined at ");
+	(void) v8funcinfo_scriptpath(fip, strb, MSF_ASCIIONLY);
+	mdbv8_strbuf_sprintf(strb, " ");
+	(void) v8funcinfo_definition_location(fip, strb, MSF_ASCIIONLY);
+	mdb_printf("%s\n", mdbv8_strbuf_tocstr(strb));
+	rv = DCMD_OK;
+
+out:
+	v8funcinfo_free(fip);
+	v8function_free(fp);
+	mdbv8_strbuf_free(strb);
+	v8_warnings--;
+	return (rv);
+}
+
+static int
+jsarray_print_one(v8array_t *ap, unsigned int index, uintptr_t value,
+    void *uarg)
+{
+	boolean_t *opt_i = uarg;
+
+	if (*opt_i) {
+		mdb_printf("%d ", index);
+	}
+
+	mdb_printf("%p\n", value);
+	return (0);
+}
+
+/* ARGSUSED */
+static int
+dcmd_jsarray(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+{
+	v8array_t *ap;
+	int memflags = UM_SLEEP | UM_GC;
+	boolean_t opt_i = B_FALSE;
+	int rv;
+
+	if (mdb_getopts(argc, argv, 'i', MDB_OPT_SETBITS, B_TRUE, &opt_i,
+	    NULL) != argc) {
+		return (DCMD_USAGE);
+	}
+
+	if ((ap = v8array_load(addr, memflags)) == NULL) {
+		mdb_warn("%p: failed to load JSArray\n", addr);
+		return (DCMD_ERR);
+	}
+
+	rv = v8array_iter_elements(ap, jsarray_print_one, &opt_i);
+	v8array_free(ap);
+	return (rv == 0 ? DCMD_OK : DCMD_ERR);
+}
+
+/* ARGSUSED */
+static int
+dcmd_jsclosure(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+{
+	v8function_t *funcp;
+	v8context_t *ctxp;
+	v8scopeinfo_t *sip;
+	int memflags = UM_SLEEP | UM_GC;
+
+	if ((funcp = v8function_load(addr, memflags)) == NULL) {
+		mdb_warn("%p: failed to load JSFunction\n", addr);
+		return (DCMD_ERR);
+	}
+
+	if ((ctxp = v8function_context(funcp, memflags)) == NULL) {
+		mdb_warn("%p: failed to load Context for JSFunction\n", addr);
+		return (DCMD_ERR);
+	}
+
+	if ((sip = v8context_scopeinfo(ctxp, memflags)) == NULL) {
+		mdb_warn("%p: failed to load ScopeInfo\n", addr);
+		return (DCMD_ERR);
+	}
+
+	if (v8scopeinfo_iter_vars(sip, V8SV_CONTEXTLOCALS,
+	    jsclosure_iter_var, ctxp) != 0) {
+		mdb_warn("%p: failed to iterate closure variables\n", addr);
+		return (DCMD_ERR);
+	}
+
+	return (DCMD_OK);
+}
+
+
+/* ARGSUSED */
+static int
+dcmd_jsconstructor(uintptr_t addr, uint_t flags, int argc,
+    const mdb_arg_t *argv)
+{
+	boolean_t opt_v = B_FALSE;
+	char buf[80];
+	char *bufp;
+	size_t len = sizeof (buf);
+
+	if (mdb_getopts(argc, argv, 'v', MDB_OPT_SETBITS, B_TRUE, &opt_v,
+	    NULL) != argc)
+		return (DCMD_USAGE);
+
+	bufp = buf;
+	if (obj_jsconstructor(addr, &bufp, &len, opt_v))
+		return (DCMD_ERR);
+
+	mdb_printf("%s\n", buf);
+	return (DCMD_OK);
+}
+
+/* ARGSUSED */
+static int
+dcmd_jsframe(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+{
+	uintptr_t fptr, raddr;
+	boolean_t opt_i = B_FALSE;
+	jsframe_t jsf;
+	int rv;
+
+	bzero(&jsf, sizeof (jsf));
+	jsf.jsf_nlines = 5;
+
+	if (mdb_getopts(argc, argv,
+	    'a', MDB_OPT_SETBITS, B_TRUE, &jsf.jsf_showall,
+	    'v', MDB_OPT_SETBITS, B_TRUE, &jsf.jsf_verbose,
+	    'i', MDB_OPT_SETBITS, B_TRUE, &opt_i,
+	    'f', MDB_OPT_STR, &jsf.jsf_func,
+	    'n', MDB_OPT_UINTPTR, &jsf.jsf_nlines,
+	    'p', MDB_OPT_STR, &jsf.jsf_prop, NULL) != argc)
+		return (DCMD_USAGE);
+
+	/*
+	 * As with $C, we assume we are given a *pointer* to the frame pointer
+	 * for a frame, rather than the actual frame pointer for the frame of
+	 * interest. This is needed to show the instruction pointer, which is
+	 * actually stored with the next frame.  For debugging, this can be
+	 * overridden with the "-i" option (for "immediate").
+	 */
+	if (opt_i) {
+		rv = do_jsframe(addr, 0, &jsf);
+		if (rv == 0)
+			jsframe_print_skipped(&jsf);
+		return (rv);
+	}
+
+	if (mdb_vread(&raddr, sizeof (raddr),
+	    addr + sizeof (uintptr_t)) == -1) {
+		mdb_warn("failed to read return address from %p",
+		    addr + sizeof (uintptr_t));
+		return (DCMD_ERR);
+	}
+
+	if (mdb_vread(&fptr, sizeof (fptr), addr) == -1) {
+		mdb_warn("failed to read frame pointer from %p", addr);
+		return (DCMD_ERR);
+	}
+
+	if (fptr == 0)
+		return (DCMD_OK);
+
+	rv = do_jsframe(fptr, raddr, &jsf);
+	if (rv == 0)
+		jsframe_print_skipped(&jsf);
+	return (rv);
+}
+
+static void
+jsobj_print_propinfo(jspropinfo_t propinfo)
+{
+	if (propinfo == JPI_NONE)
+		return;
+
+	mdb_printf("property kind: ");
+	if ((propinfo & JPI_NUMERIC) != 0)
+		mdb_printf("numeric-named ");
+	if ((propinfo & JPI_DICT) != 0)
+		mdb_printf("dictionary ");
+	if ((propinfo & JPI_INOBJECT) != 0)
+		mdb_printf("in-object ");
+	if ((propinfo & JPI_PROPS) != 0)
+		mdb_printf("\"properties\" array ");
+	mdb_printf("\n");
+
+	if ((propinfo & (JPI_HASTRANSITIONS | JPI_HASCONTENT)) != 0) {
+		mdb_printf("fallbacks: ");
+		if ((propinfo & JPI_HASTRANSITIONS) != 0)
+			mdb_printf("transitions ");
+		if ((propinfo & JPI_HASCONTENT) != 0)
+			mdb_printf("content ");
+		mdb_printf("\n");
+	}
+
+	if ((propinfo & JPI_UNDEFPROPNAME) != 0)
+		mdb_printf(
+		    "some properties skipped due to undefined property name\n");
+	if ((propinfo & JPI_SKIPPED) != 0)
+		mdb_printf(
+		    "some properties skipped due to unexpected layout\n");
+	if ((propinfo & JPI_BADLAYOUT) != 0)
+		mdb_printf("object has unexpected layout\n");
+	if ((propinfo & JPI_BADPROPS) != 0)
+		mdb_printf("object has invalid-looking property values\n");
+}
+
+/* ARGSUSED */
+static int
+dcmd_jsprint(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+{
+	char *buf, *bufp;
+	size_t bufsz = 262144, len = bufsz;
+	jsobj_print_t jsop;
+	boolean_t opt_b = B_FALSE;
+	boolean_t opt_v = B_FALSE;
+	uint64_t strlen_override = 0;
+	int rv, i;
+
+	bzero(&jsop, sizeof (jsop));
+	jsop.jsop_depth = 2;
+	jsop.jsop_printaddr = B_FALSE;
+
+	i = mdb_getopts(argc, argv,
+	    'a', MDB_OPT_SETBITS, B_TRUE, &jsop.jsop_printaddr,
+	    'b', MDB_OPT_SETBITS, B_TRUE, &opt_b,
+	    'd', MDB_OPT_UINT64, &jsop.jsop_depth,
+	    'N', MDB_OPT_UINT64, &strlen_override,
+	    'v', MDB_OPT_SETBITS, B_TRUE, &opt_v, NULL);
+
+	jsop.jsop_maxstrlen = (int)strlen_override;
+
+	if (opt_b)
+		jsop.jsop_baseaddr = addr;
+
+	do {
+		if (i != argc) {
+			const mdb_arg_t *member = &argv[i++];
+
+			if (member->a_type != MDB_TYPE_STRING)
+				return (DCMD_USAGE);
+
+			jsop.jsop_member = member->a_un.a_str;
+		}
+
+		for (;;) {
+			if ((buf = bufp =
+			    mdb_zalloc(bufsz, UM_NOSLEEP)) == NULL)
+				return (DCMD_ERR);
+
+			jsop.jsop_bufp = &bufp;
+			jsop.jsop_lenp = &len;
+
+			rv = jsobj_print(addr, &jsop);
+
+			if (len > 0)
+				break;
+
+			mdb_free(buf, bufsz);
+			bufsz <<= 1;
+			len = bufsz;
+		}
+
+		if (jsop.jsop_member == NULL && rv != 0) {
+			if (!jsop.jsop_descended)
+				mdb_warn("%s\n", buf);
+
+			return (DCMD_ERR);
+		}
+
+		if (jsop.jsop_member && !jsop.jsop_found) {
+			if (jsop.jsop_baseaddr)
+				(void) mdb_printf("%p: ", jsop.jsop_baseaddr);
+
+			(void) mdb_printf("undefined%s",
+			    i < argc ? " " : "");
+		} else {
+			(void) mdb_printf("%s%s", buf, i < argc &&
+			    !isspace(buf[strlen(buf) - 1]) ? " " : "");
+		}
+
+		mdb_free(buf, bufsz);
+		jsop.jsop_found = B_FALSE;
+		jsop.jsop_baseaddr = 0;
+	} while (i < argc);
+
+	mdb_printf("\n");
+
+	if (opt_v)
+		jsobj_print_propinfo(jsop.jsop_propinfo);
+
+	return (DCMD_OK);
+}
+
+/* ARGSUSED */
+static int
+dcmd_jssource(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+{
+	const char *typename;
+	uintptr_t nlines = 5;
+	uintptr_t funcinfop, scriptp, funcnamep;
+	uintptr_t tokpos, endpos;
+	uint8_t type;
+	char buf[256];
+	char *bufp = buf;
+	size_t len = sizeof (buf);
+
+	if (mdb_getopts(argc, argv, 'n', MDB_OPT_UINTPTR, &nlines,
+	    NULL) != argc)
+		return (DCMD_USAGE);
+
+	if (!V8_IS_HEAPOBJECT(addr) || read_typebyte(&type, addr) != 0) {
+		mdb_warn("%p is not a heap object\n", addr);
+		return (DCMD_ERR);
+	}
+
+	typename = enum_lookup_str(v8_types, type, "");
+	if (strcmp(typename, "JSFunction") != 0) {
+		mdb_warn("%p is not a JSFunction\n", addr);
+		return (DCMD_ERR);
+	}
+
+	if (read_heap_ptr(&funcinfop, addr, V8_OFF_JSFUNCTION_SHARED) != 0 ||
+	    read_heap_ptr(&scriptp, funcinfop,
+	    V8_OFF_SHAREDFUNCTIONINFO_SCRIPT) != 0 ||
+	    read_heap_ptr(&funcnamep, scriptp, V8_OFF_SCRIPT_NAME) != 0) {
+		mdb_warn("%p: failed to find script for function\n", addr);
+		return (DCMD_ERR);
+	}
+
+	if (read_heap_maybesmi(&tokpos, funcinfop,
+	    V8_OFF_SHAREDFUNCTIONINFO_FUNCTION_TOKEN_POSITION) != 0 ||
+	    read_heap_maybesmi(&endpos, funcinfop,
+	    V8_OFF_SHAREDFUNCTIONINFO_END_POSITION) != 0) {
+		mdb_warn("%p: failed to find function's boundaries\n", addr);
+	}
+
+	if (jsstr_print(funcnamep, JSSTR_NUDE, &bufp, &len) == 0)
+		mdb_printf("file: %s\n", buf);
+
+	if (tokpos != endpos)
+		jsfunc_lines(scriptp, tokpos, endpos, nlines, "%5d ");
+	mdb_printf("\n");
+	return (DCMD_OK);
+}
+
+/*
+ * With -c, ::jsfunctions reports how many contexts the closures for each
+ * function keep alive, and how many bytes those contexts use.  Each closure
+ * refers to the context in which it was created, and each context to the
+ * context enclosing it, up to the native context, which is shared by
+ * everything and not counted.  Since closures for the same function (and for
+ * functions defined alongside each other) commonly share enclosing contexts,
+ * the contexts we've loaded are cached by address, and a function's walk up
+ * the chain stops at the first context already counted for that function.
+ */
+#define	JSFUNCTIONS_NCTXBUCKETS	4096
+#define	JSFUNCTIONS_MAXDEPTH	1024
+
+typedef struct jsfunctions_ctx {
+	uintptr_t jsfc_addr;			/* context address */
+	uintptr_t jsfc_prev;			/* enclosing context */
+	size_t jsfc_size;			/* size of the context */
+	boolean_t jsfc_end;			/* not counted; end of chain */
+	findjsobjects_func_t *jsfc_func;	/* last function counted for */
+	struct jsfunctions_ctx *jsfc_next;	/* next in hash bucket */
+} jsfunctions_ctx_t;
+
+typedef struct jsfunctions_ctxcache {
+	jsfunctions_ctx_t **jsfcc_buckets;	/* contexts by address */
+	size_t jsfcc_nbuckets;			/* number of buckets */
+	size_t jsfcc_nctxs;			/* number of contexts */
+	uintptr_t jsfcc_native;			/* see jsfunctions_ctx_slot() */
+} jsfunctions_ctxcache_t;
+
+/*ARGSUSED*/
+static int
+jsfunctions_ctx_slot(v8context_t *ctxp, const char *label, uintptr_t value,
+    void *arg)
+{
+	jsfunctions_ctxcache_t *cache = arg;
+
+	if (strcmp(label, "native context") == 0)
+		cache->jsfcc_native = value;
+
+	return (0);
+}
+
+static jsfunctions_ctx_t **
+jsfunctions_ctx_bucket(jsfunctions_ctx_t **buckets, size_t nbuckets,
+    uintptr_t addr)
+{
+	return (&buckets[findjsobjects_mix(0, addr) % nbuckets]);
+}
+
+/*
+ * Returns the cache entry for the context at "addr", loading the context if
+ * we haven't seen it before.  Addresses that aren't contexts are cached too,
+ * as the end of a chain.
+ */
+static jsfunctions_ctx_t *
+jsfunctions_ctx_lookup(jsfunctions_ctxcache_t *cache, uintptr_t addr)
+{
+	jsfunctions_ctx_t **bucket, **buckets, *ctx, *next;
+	v8context_t *ctxp;
+	uintptr_t nslots;
+	size_t nbuckets, i;
+
+	bucket = jsfunctions_ctx_bucket(cache->jsfcc_buckets,
+	    cache->jsfcc_nbuckets, addr);
+
+	for (ctx = *bucket; ctx != NULL; ctx = ctx->jsfc_next) {
+		if (ctx->jsfc_addr == addr)
+			return (ctx);
+	}
+
+	ctx = mdb_zalloc(sizeof (jsfunctions_ctx_t), UM_SLEEP | UM_GC);
+	ctx->jsfc_addr = addr;
+	ctx->jsfc_end = B_TRUE;
+
+	if ((ctxp = v8context_load(addr, UM_SLEEP)) != NULL &&
+	    read_heap_smi(&nslots, addr, V8_OFF_FIXEDARRAY_LENGTH) == 0) {
+		cache->jsfcc_native = 0;
+		(void) v8context_iter_static_slots(ctxp,
+		    jsfunctions_ctx_slot, cache);
+
+		if (cache->jsfcc_native != addr) {
+			ctx->jsfc_end = B_FALSE;
+			ctx->jsfc_prev = v8context_prev_context(ctxp);
+			ctx->jsfc_size = V8_OFF_FIXEDARRAY_DATA +
+			    nslots * sizeof (uintptr_t);
+		}
+	}
+
+	v8context_free(ctxp);
+	ctx->jsfc_next = *bucket;
+	*bucket = ctx;
+
+	if (++cache->jsfcc_nctxs > 2 * cache->jsfcc_nbuckets) {
+		nbuckets = cache->jsfcc_nbuckets * 4;
+		buckets = mdb_zalloc(nbuckets * sizeof (jsfunctions_ctx_t *),
+		    UM_SLEEP | UM_GC);
+
+		for (i = 0; i < cache->jsfcc_nbuckets; i++) {
+			for (ctx = cache->jsfcc_buckets[i]; ctx != NULL;
+			    ctx = next) {
+				next = ctx->jsfc_next;
+				bucket = jsfunctions_ctx_bucket(buckets,
+				    nbuckets, ctx->jsfc_addr);
+				ctx->jsfc_next = *bucket;
+				*bucket = ctx;
+			}
+		}
+
+		cache->jsfcc_buckets = buckets;
+		cache->jsfcc_nbuckets = nbuckets;
+		return (jsfunctions_ctx_lookup(cache, addr));
+	}
+
+	return (ctx);
+}
+
+/*
+ * Count the contexts kept alive by each function's closures, unless we've
+ * already done so since the last heap scan.
+ */
+static void
+jsfunctions_contexts(findjsobjects_state_t *fjs)
+{
+	jsfunctions_ctxcache_t cache;
+	findjsobjects_func_t *func;
+	findjsobjects_instance_t *inst;
+	jsfunctions_ctx_t *ctx;
+	uintptr_t addr;
+	int depth;
+
+	if (fjs->fjs_ctxvalid)
+		return;
+
+	bzero(&cache, sizeof (cache));
+	cache.jsfcc_nbuckets = JSFUNCTIONS_NCTXBUCKETS;
+	cache.jsfcc_buckets = mdb_zalloc(
+	    cache.jsfcc_nbuckets * sizeof (jsfunctions_ctx_t *),
+	    UM_SLEEP | UM_GC);
+
+	v8_silent++;
+
+	for (func = fjs->fjs_funcs; func != NULL; func = func->fjsf_next) {
+		func->fjsf_ncontexts = 0;
+		func->fjsf_ctxbytes = 0;
+
+		for (inst = findjsobjects_func_instances(fjs, func);
+		    inst != NULL; inst = inst->fjsi_next) {
+			if (read_heap_ptr(&addr, inst->fjsi_addr,
+			    V8_OFF_JSFUNCTION_CONTEXT) != 0)
+				continue;
+
+			for (depth = 0; V8_IS_HEAPOBJECT(addr) &&
+			    depth < JSFUNCTIONS_MAXDEPTH; depth++) {
+				ctx = jsfunctions_ctx_lookup(&cache, addr);
+
+				if (ctx->jsfc_end || ctx->jsfc_func == func)
+					break;
+
+				ctx->jsfc_func = func;
+				func->fjsf_ncontexts++;
+				func->fjsf_ctxbytes += ctx->jsfc_size;
+				addr = ctx->jsfc_prev;
+			}
+		}
+	}
+
+	v8_silent--;
+	fjs->fjs_ctxvalid = B_TRUE;
+}
+
+static int
+jsfunctions_cmp_ctxbytes(const void *l, const void *r)
+{
+	findjsobjects_func_t *lhs = *((findjsobjects_func_t **)l);
+	findjsobjects_func_t *rhs = *((findjsobjects_func_t **)r);
+
+	if (lhs->fjsf_ctxbytes != rhs->fjsf_ctxbytes)
+		return (lhs->fjsf_ctxbytes < rhs->fjsf_ctxbytes ? -1 : 1);
+
+	if (lhs->fjsf_ninstances != rhs->fjsf_ninstances)
+		return (lhs->fjsf_ninstances < rhs->fjsf_ninstances ? -1 : 1);
+
+	return (0);
+}
+
+/* ARGSUSED */
+static int
+dcmd_jsfunctions(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+{
+	findjsobjects_state_t *fjs = &findjsobjects_state;
+	findjsobjects_func_t *func, **funcs;
+	uintptr_t funcinfo;
+	boolean_t showrange = B_FALSE;
+	boolean_t listlike = B_FALSE;
+	boolean_t contexts = B_FALSE;
+	const char *name = NULL, *filename = NULL;
+	uintptr_t instr = 0;
+	size_t nfuncs = 0, i;
+
+	if (mdb_getopts(argc, argv,
+	    'c', MDB_OPT_SETBITS, B_TRUE, &contexts,
+	    'l', MDB_OPT_SETBITS, B_TRUE, &listlike,
+	    'x', MDB_OPT_UINTPTR, &instr,
+	    'X', MDB_OPT_SETBITS, B_TRUE, &showrange,
+	    'n', MDB_OPT_STR, &name,
+	    's', MDB_OPT_STR, &filename,
+	    NULL) != argc)
+		return (DCMD_USAGE);
+
+	if (findjsobjects_run(fjs) != 0)
+		return (DCMD_ERR);
+
+	if (listlike && !(flags & DCMD_ADDRSPEC) &&
+	    (name != NULL || filename != NULL || instr != 0)) {
+		mdb_warn("cannot specify -l with -n, -f, or -x\n");
+		return (DCMD_ERR);
+	}
+
+	if (contexts && (listlike || showrange || (flags & DCMD_ADDRSPEC))) {
+		mdb_warn("cannot specify -c with -l, -X, or ADDR\n");
+		return (DCMD_ERR);
+	}
+
+	findjsobjects_partial(fjs);
+
+	if (flags & DCMD_ADDRSPEC) {
+		listlike = B_TRUE;
+	}
+
+	for (func = fjs->fjs_funcs; func != NULL; func = func->fjsf_next)
+		nfuncs++;
+
+	funcs = mdb_alloc(MAX(nfuncs, 1) * sizeof (findjsobjects_func_t *),
+	    UM_SLEEP | UM_GC);
+
+	for (func = fjs->fjs_funcs, i = 0; func != NULL;
+	    func = func->fjsf_next)
+		funcs[i++] = func;
+
+	if (contexts) {
+		/*
+		 * List the functions whose closures keep the most context
+		 * memory alive last, as ::findjsobjects does with objects.
+		 */
+		jsfunctions_contexts(fjs);
+		qsort(funcs, nfuncs, sizeof (findjsobjects_func_t *),
+		    jsfunctions_cmp_ctxbytes);
+		mdb_printf("%?s %8s %8s %10s %-40s %s\n", "FUNC", "#FUNCS",
+		    "#CTXS", "CTXBYTES", "NAME", "FROM");
+	} else if (!showrange && !listlike) {
+		mdb_printf("%?s %8s %-40s %s\n", "FUNC", "#FUNCS", "NAME",
+		    "FROM");
+	} else if (!listlike) {
+		mdb_printf("%?s %8s %?s %?s %-40s %s\n", "FUNC", "#FUNCS",
+		    "START", "END", "NAME", "FROM");
+	}
+
+	for (i = 0; i < nfuncs; i++) {
+		uintptr_t code, ilen;
+
+		func = funcs[i];
+
+		if (listlike && (flags & DCMD_ADDRSPEC) != 0) {
+			findjsobjects_instance_t *inst;
+
+			if (addr != func->fjsf_instances.fjsi_addr) {
+				continue;
+			}
+
+			for (inst = findjsobjects_func_instances(fjs, func);
+			    inst != NULL; inst = inst->fjsi_next) {
+				mdb_printf("%?p\n", inst->fjsi_addr);
+			}
+
+			continue;
+		}
+
+		funcinfo = func->fjsf_shared;
+
+		if (func->fjsf_location[0] == '\0') {
+			uintptr_t tokpos, script, lends;
+			ptrdiff_t tokposoff =
+			    V8_OFF_SHAREDFUNCTIONINFO_FUNCTION_TOKEN_POSITION;
+
+			/*
+			 * We don't want to actually decode the token position
+			 * as an SMI here, so we re-encode it when we pass it to
+			 * jsfunc_lineno() below.
+			 */
+			if (read_heap_maybesmi(&tokpos, funcinfo,
+			    tokposoff) != 0 ||
+			    read_heap_ptr(&script, funcinfo,
+			    V8_OFF_SHAREDFUNCTIONINFO_SCRIPT) != 0 ||
+			    read_heap_ptr(&lends, script,
+			    V8_OFF_SCRIPT_LINE_ENDS) != 0 ||
+			    jsfunc_lineno(lends, V8_VALUE_SMI(tokpos),
+			    func->fjsf_location,
+			    sizeof (func->fjsf_location), NULL) != 0) {
+				func->fjsf_location[0] = '\0';
+			}
+		}
+
+		if (name != NULL && strstr(func->fjsf_funcname, name) == NULL)
+			continue;
+
+		if (filename != NULL &&
+		    strstr(func->fjsf_scriptname, filename) == NULL)
+			continue;
+
+		code = 0;
+		ilen = 0;
+		if ((showrange || instr != 0) &&
+		    (read_heap_ptr(&code, funcinfo,
+		    V8_OFF_SHAREDFUNCTIONINFO_CODE) != 0 ||
+		    read_heap_ptr(&ilen, code,
+		    V8_OFF_CODE_INSTRUCTION_SIZE) != 0)) {
+			code = 0;
+			ilen = 0;
+		}
+
+		if ((instr != 0 && ilen != 0) &&
+		    (instr < code + V8_OFF_CODE_INSTRUCTION_START ||
+		    instr >= code + V8_OFF_CODE_INSTRUCTION_START + ilen))
+			continue;
+
+		if (listlike) {
+			mdb_printf("%?p\n", func->fjsf_instances.fjsi_addr);
+		} else if (contexts) {
+			mdb_printf("%?p %8d %8llu %10llu %-40s %s %s\n",
+			    func->fjsf_instances.fjsi_addr,
+			    func->fjsf_ninstances, func->fjsf_ncontexts,
+			    func->fjsf_ctxbytes, func->fjsf_funcname,
+			    func->fjsf_scriptname, func->fjsf_location);
+		} else if (!showrange) {
+			mdb_printf("%?p %8d %-40s %s %s\n",
+			    func->fjsf_instances.fjsi_addr,
+			    func->fjsf_ninstances, func->fjsf_funcname,
+			    func->fjsf_scriptname, func->fjsf_location);
+		} else {
+			uintptr_t code, ilen;
+
+			if (read_heap_ptr(&code, funcinfo,
+			    V8_OFF_SHAREDFUNCTIONINFO_CODE) != 0 ||
+			    read_heap_ptr(&ilen, code,
+			    V8_OFF_CODE_INSTRUCTION_SIZE) != 0) {
+				mdb_printf("%?p %8d %?s %?s %-40s %s %s\n",
+				    func->fjsf_instances.fjsi_addr,
+				    func->fjsf_ninstances, "?", "?",
+				    func->fjsf_funcname, func->fjsf_scriptname,
+				    func->fjsf_location);
+			} else {
+				mdb_printf("%?p %8d %?p %?p %-40s %s %s\n",
+				    func->fjsf_instances.fjsi_addr,
+				    func->fjsf_ninstances,
+				    code + V8_OFF_CODE_INSTRUCTION_START,
+				    code + V8_OFF_CODE_INSTRUCTION_START + ilen,
+				    func->fjsf_funcname, func->fjsf_scriptname,
+				    func->fjsf_location);
+			}
+		}
+	}
+
+	return (DCMD_OK);
+}
+
+static void
+dcmd_jsfunctions_help(void)
+{
+	mdb_printf("%s\n\n",
+"Lists JavaScript functions, optionally filtered by a substring of the\n"
+"function name or script filename or by the instruction address.  This uses\n"
+"the cache created by ::findjsobjects.  If ::findjsobjects has not already\n"
+"been run, this command runs it automatically without printing the output.\n"
+"This can take anywhere from a second to several minutes, depending on the\n"
+"size of the core dump.\n"
+"\n"
+"It's important to keep in mind that each time you create a function in\n"
+"JavaScript (even from a function definition that has already been used),\n"
+"the VM must create a new object to represent it.  For example, if your\n"
+"program has a function A that returns a closure B, the VM will create new\n"
+"instances of the closure function (B) each time the surrounding function (A)\n"
+"is called.  To show this, the output of this command consists of one line \n"
+"per function definition that appears in the JavaScript source, and the\n"
+"\"#FUNCS\" column shows how many different functions were created by VM from\n"
+"this definition.\n"
+"\n"
+"Each closure keeps alive the context in which it was created (holding the\n"
+"variables of the enclosing function that it may refer to), and that\n"
+"context keeps alive the contexts enclosing it.  With -c, the output also\n"
+"shows how many distinct contexts the closures for each function keep alive\n"
+"(\"#CTXS\"), not counting the native context that everything shares, and\n"
+"their total size (\"CTXBYTES\"), and functions are listed in order of the\n"
+"latter.  Contexts shared by several closures are counted once for each\n"
+"function.  This is useful for finding closures that leak.");
+
+	mdb_dec_indent(2);
+	mdb_printf("%<b>OPTIONS%</b>\n");
+	mdb_inc_indent(2);
+
+	mdb_printf("%s\n",
+"  -c       Show the contexts kept alive by each function's closures\n"
+"  -l       List only closures (without other columns).  With ADDR, list\n"
+"           closures for the representative function ADDR.\n"
+"  -n func  List functions whose name contains this substring\n"
+"  -s file  List functions that were defined in a file whose name contains\n"
+"           this substring.\n"
+"  -x instr List functions whose compiled instructions include this address\n"
+"  -X       Show where the function's instructions are stored in memory\n");
+}
+
+static void
+jsretained_print(findjsobjects_state_t *fjs, uint32_t x)
+{
+	findjsobjects_retained_t *fjsrt = &fjs->fjs_retained;
+
+	mdb_printf("%?p %10llu %12llu %s\n", fjsrt->fjsrt_addrs[x],
+	    (uint64_t)fjsrt->fjsrt_shallow[x], fjsrt->fjsrt_retained[x],
+	    fjs->fjs_nametab[fjsrt->fjsrt_labels[x]]->fjsn_str);
+}
+
+/* ARGSUSED */
+static int
+dcmd_jsretained(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+{
+	findjsobjects_state_t *fjs = &findjsobjects_state;
+	findjsobjects_retained_t *fjsrt = &fjs->fjs_retained;
+	boolean_t bycons = B_FALSE, verbose = B_FALSE;
+	uintptr_t count = FJS_RETAINED_NDEFAULT, budget = 0;
+	uint32_t *top, x, l;
+	size_t ntop = 0, i;
+
+	if (mdb_getopts(argc, argv,
+	    'c', MDB_OPT_SETBITS, B_TRUE, &bycons,
+	    'M', MDB_OPT_UINTPTR, &budget,
+	    'n', MDB_OPT_UINTPTR, &count,
+	    'v', MDB_OPT_SETBITS, B_TRUE, &verbose,
+	    NULL) != argc)
+		return (DCMD_USAGE);
+
+	if (count == 0) {
+		mdb_warn("count must be at least 1\n");
+		return (DCMD_ERR);
+	}
+
+	if (bycons && (flags & DCMD_ADDRSPEC)) {
+		mdb_warn("cannot specify an object with -c\n");
+		return (DCMD_ERR);
+	}
+
+	fjs->fjs_verbose = verbose;
+
+	if (findjsobjects_run(fjs) != 0)
+		return (DCMD_ERR);
+
+	findjsobjects_partial(fjs);
+
+	if (!fjs->fjs_revindex.fjsri_built)
+		findjsobjects_revindex_build(fjs);
+
+	if (!fjsrt->fjsrt_built &&
+	    findjsobjects_retained_build(fjs, budget) != 0)
+		return (DCMD_ERR);
+
+	if (flags & DCMD_ADDRSPEC) {
+		if ((x = findjsobjects_retained_find(fjsrt, addr)) ==
+		    FJS_DOM_NONE) {
+			mdb_warn("%p is not a known object\n", addr);
+			return (DCMD_ERR);
+		}
+
+		if (flags & DCMD_PIPE_OUT) {
+			mdb_printf("%p\n", addr);
+			return (DCMD_OK);
+		}
+
+		if (DCMD_HDRSPEC(flags)) {
+			mdb_printf("%?s %10s %12s %s\n", "OBJECT", "SHALLOW",
+			    "RETAINED", "CONSTRUCTOR");
+		}
+
+		jsretained_print(fjs, x);
+		return (DCMD_OK);
+	}
+
+	top = mdb_alloc(count * sizeof (uint32_t), UM_SLEEP | UM_GC);
+
+	if (bycons) {
+		for (l = 0; l < fjsrt->fjsrt_nlabels; l++) {
+			if (fjsrt->fjsrt_lcount[l] != 0) {
+				findjsobjects_topn(top, &ntop, count,
+				    fjsrt->fjsrt_lretained, l);
+			}
+		}
+
+		mdb_printf("%10s %12s %12s %s\n", "#OBJECTS", "SHALLOW",
+		    "RETAINED", "CONSTRUCTOR");
+
+		for (i = 0; i < ntop; i++) {
+			l = top[i];
+			mdb_printf("%10llu %12llu %12llu %s\n",
+			    fjsrt->fjsrt_lcount[l], fjsrt->fjsrt_lshallow[l],
+			    fjsrt->fjsrt_lretained[l],
+			    fjs->fjs_nametab[l]->fjsn_str);
+		}
+
+		return (DCMD_OK);
+	}
+
+	for (x = 0; x < fjsrt->fjsrt_nnodes; x++)
+		findjsobjects_topn(top, &ntop, count, fjsrt->fjsrt_retained, x);
+
+	if (!(flags & DCMD_PIPE_OUT)) {
+		mdb_printf("%?s %10s %12s %s\n", "OBJECT", "SHALLOW",
+		    "RETAINED", "CONSTRUCTOR");
+	}
+
+	for (i = 0; i < ntop; i++) {
+		if (flags & DCMD_PIPE_OUT) {
+			mdb_printf("%p\n", fjsrt->fjsrt_addrs[top[i]]);
+			continue;
+		}
+
+		jsretained_print(fjs, top[i]);
+	}
+
+	return (DCMD_OK);
+}
+
+static void
+dcmd_jsretained_help(void)
+{
+	mdb_printf("%s\n\n",
+"Reports how much memory JavaScript objects keep alive.  This uses the\n"
+"objects found by ::findjsobjects (running it first if needed) and the\n"
+"reverse reference index built by ::findjsobjects -R to compute the\n"
+"dominator tree of the heap.  The retained size of an object is the total\n"
+"size of the objects that can only be reached through it (including\n"
+"itself): the memory that would be freed if it were.  The shallow size of\n"
+"an object is as for \"::findjsobjects -s bytes\": its own size plus that\n"
+"of its out-of-object property and elements arrays and, for typed arrays,\n"
+"the part of the ArrayBuffer's data that the array covers.\n"
+"\n"
+"The references between objects are only those found in the properties\n"
+"and elements of the objects that ::findjsobjects found, and the VM's own\n"
+"roots are not known, so the roots of the graph are taken to be the objects\n"
+"that no known object refers to.  Objects without a constructor are\n"
+"grouped by V8 type, in parentheses.\n"
+"\n"
+"With no options, lists the objects with the largest retained sizes.  With\n"
+"ADDR, reports the sizes of that object.  The results are computed once and\n"
+"kept until the ::findjsobjects results are discarded.");
+
+	mdb_dec_indent(2);
+	mdb_printf("%<b>OPTIONS%</b>\n");
+	mdb_inc_indent(2);
+
+	mdb_printf("%s\n",
+"  -c       Summarize by constructor.  The retained size of a constructor\n"
+"           counts each of its instances that is not retained by another\n"
+"           instance of the same constructor.\n"
+"  -M mb    Fail rather than use more than this many megabytes to compute\n"
+"           the dominator tree\n"
+"  -n count List this many objects or constructors (default: 20)\n"
+"  -v       Report statistics about the scan and the dominator tree\n");
+}
+
+/*
+ * ::jspath searches the reverse reference index breadth-first, starting from
+ * the given object and following references backwards until it reaches a
+ * root: a value in a JavaScript stack frame (the function, its receiver and
+ * arguments, and the variables of the closures it can see), a property of a
+ * global object, or a slot of a native context.  An object that no known
+ * object refers to also ends a path.  To find the k shortest paths, each
+ * object may be expanded as part of up to k different paths, and no path may
+ * pass through the same object twice.
+ */
+#define	JSPATH_MAXFRAMES	1024
+#define	JSPATH_MAXDEPTH		1024
+#define	JSPATH_MAXNATIVE	16
+#define	JSPATH_MAXK		255
+#define	JSPATH_MAXENTRIES	(16 * 1024 * 1024)
+
+typedef struct jspath_root {
+	uintptr_t jspr_addr;
+	size_t jspr_order;
+	char jspr_desc[64];
+} jspath_root_t;
+
+typedef struct jspath {
+	jspath_root_t *jsp_roots;
+	size_t jsp_nroots;
+	size_t jsp_nalloc;
+	const char *jsp_what;		/* description of slots being added */
+	uintptr_t jsp_native[JSPATH_MAXNATIVE];
+	size_t jsp_nnative;
+	uintptr_t jsp_slot_native;	/* native context or global object */
+	uintptr_t jsp_slot_ext;		/* extension */
+	boolean_t jsp_slot_isnative;
+	uint_t jsp_nframes;		/* frames walked */
+	uint_t jsp_njsframes;		/* JavaScript frames found */
+} jspath_t;
+
+typedef struct jspath_entry {
+	uintptr_t jspe_addr;
+	uint32_t jspe_parent;
+	uint64_t jspe_label;
+} jspath_entry_t;
+
+static void
+jspath_root_add(jspath_t *jsp, uintptr_t addr, const char *desc)
+{
+	jspath_root_t *roots;
+	size_t nalloc;
+
+	if (!V8_IS_HEAPOBJECT(addr))
+		return;
+
+	if (jsp->jsp_nroots == jsp->jsp_nalloc) {
+		nalloc = jsp->jsp_nalloc == 0 ? 1024 : jsp->jsp_nalloc * 2;
+		roots = mdb_alloc(nalloc * sizeof (jspath_root_t),
+		    UM_SLEEP | UM_GC);
+
+		if (jsp->jsp_roots != NULL) {
+			bcopy(jsp->jsp_roots, roots,
+			    jsp->jsp_nroots * sizeof (jspath_root_t));
+		}
+
+		jsp->jsp_roots = roots;
+		jsp->jsp_nalloc = nalloc;
+	}
+
+	roots = &jsp->jsp_roots[jsp->jsp_nroots];
+	roots->jspr_addr = addr;
+	roots->jspr_order = jsp->jsp_nroots++;
+	(void) strlcpy(roots->jspr_desc, desc, sizeof (roots->jspr_desc));
+}
+
+static int
+jspath_cmp_root(const void *l, const void *r)
+{
+	const jspath_root_t *lhs = l, *rhs = r;
+
+	if (lhs->jspr_addr != rhs->jspr_addr)
+		return (lhs->jspr_addr < rhs->jspr_addr ? -1 : 1);
+
+	return (lhs->jspr_order < rhs->jspr_order ? -1 :
+	    lhs->jspr_order > rhs->jspr_order ? 1 : 0);
+}
+
+static jspath_root_t *
+jspath_root_find(jspath_t *jsp, uintptr_t addr)
+{
+	jspath_root_t search;
+
+	search.jspr_addr = addr;
+
+	return (bsearch(&search, jsp->jsp_roots, jsp->jsp_nroots,
+	    sizeof (jspath_root_t), findjsobjects_cmp_addr));
+}
+
+/*ARGSUSED*/
+static int
+jspath_static_slot(v8context_t *ctxp, const char *label, uintptr_t value,
+    void *arg)
+{
+	jspath_t *jsp = arg;
+
+	if (strcmp(label, "native context") == 0) {
+		jsp->jsp_slot_native = value;
+		jsp->jsp_slot_isnative = B_TRUE;
+	} else if (strcmp(label, "global object") == 0) {
+		jsp->jsp_slot_native = value;
+		jsp->jsp_slot_isnative = B_FALSE;
+	} else if (strcmp(label, "extension") == 0) {
+		jsp->jsp_slot_ext = value;
+	}
+
+	return (0);
+}
+
+/*ARGSUSED*/
+static int
+jspath_dynamic_slot(v8context_t *ctxp, uint_t idx, uintptr_t value, void *arg)
+{
+	jspath_t *jsp = arg;
+
+	jspath_root_add(jsp, value, jsp->jsp_what);
+	return (0);
+}
+
+/*
+ * The properties of a global object are stored in property cells; if "addr"
+ * is one, return the value it holds.
+ */
+static uintptr_t
+jspath_cell_value(uintptr_t addr)
+{
+	const char *name;
+	uintptr_t value;
+	ssize_t off;
+	uint8_t type;
+
+	if (!V8_IS_HEAPOBJECT(addr) || read_typebyte(&type, addr) != 0 ||
+	    (name = enum_lookup_str(v8_types, type, NULL)) == NULL ||
+	    strstr(name, "Cell") == NULL ||
+	    heap_offset(name, "value", &off) != 0 ||
+	    read_heap_ptr(&value, addr, off) != 0)
+		return (addr);
+
+	return (value);
+}
+
+static int
+jspath_global_prop(const char *desc, v8propvalue_t *val, void *arg)
+{
+	char buf[64];
+
+	if (val == NULL || val->v8v_isboxeddouble)
+		return (0);
+
+	(void) snprintf(buf, sizeof (buf), "global.%s", desc);
+	jspath_root_add(arg, jspath_cell_value(val->v8v_u.v8vu_addr), buf);
+	return (0);
+}
+
+/*
+ * Add the slots of a native context (or, for older versions of V8, the
+ * properties of a global object) to the roots, if we haven't already.
+ */
+static void
+jspath_native(jspath_t *jsp, uintptr_t addr, boolean_t isnative)
+{
+	v8context_t *ctxp;
+	uintptr_t global = addr;
+	size_t i;
+
+	if (!V8_IS_HEAPOBJECT(addr))
+		return;
+
+	for (i = 0; i < jsp->jsp_nnative; i++) {
+		if (jsp->jsp_native[i] == addr)
+			return;
+	}
+
+	if (jsp->jsp_nnative == JSPATH_MAXNATIVE)
+		return;
+
+	jsp->jsp_native[jsp->jsp_nnative++] = addr;
+
+	if (isnative) {
+		if ((ctxp = v8context_load(addr, UM_SLEEP | UM_GC)) == NULL)
+			return;
+
+		jsp->jsp_what = "native context";
+		jsp->jsp_slot_ext = 0;
+		(void) v8context_iter_static_slots(ctxp,
+		    jspath_static_slot, jsp);
+		(void) v8context_iter_dynamic_slots(ctxp,
+		    jspath_dynamic_slot, jsp);
+
+		/*
+		 * The extension slot of a native context holds the global
+		 * object.
+		 */
+		global = jsp->jsp_slot_ext;
+	}
+
+	jspath_root_add(jsp, global, "global");
+	(void) jsobj_properties(global, jspath_global_prop, jsp, NULL);
+}
+
+/*
+ * Walk the chain of contexts starting at "addr", adding the variables that
+ * they hold to the roots (if "what" is non-NULL) and the native context at
+ * the end of the chain.
+ */
+static void
+jspath_context(jspath_t *jsp, uintptr_t addr, const char *what)
+{
+	v8context_t *ctxp;
+	uintptr_t native = 0;
+	boolean_t isnative = B_FALSE;
+	int depth;
+
+	for (depth = 0; V8_IS_HEAPOBJECT(addr) && depth < JSPATH_MAXDEPTH;
+	    depth++) {
+		if ((ctxp = v8context_load(addr, UM_SLEEP | UM_GC)) == NULL)
+			break;
+
+		jsp->jsp_slot_native = 0;
+		(void) v8context_iter_static_slots(ctxp,
+		    jspath_static_slot, jsp);
+		native = jsp->jsp_slot_native;
+		isnative = jsp->jsp_slot_isnative;
+
+		if (what != NULL) {
+			jsp->jsp_what = what;
+			(void) v8context_iter_dynamic_slots(ctxp,
+			    jspath_dynamic_slot, jsp);
+		}
+
+		if (native == addr)
+			break;
+
+		addr = v8context_prev_context(ctxp);
+	}
+
+	jspath_native(jsp, native, isnative);
+}
+
+/*
+ * Add the values in the frame at "fptr" (whose return address is "raddr") to
+ * the roots, if it's a JavaScript frame.  The frame is decoded as ::jsstack
+ * decodes it.
+ */
+static void
+jspath_frame(jspath_t *jsp, uintptr_t fptr, uintptr_t raddr)
+{
+	uintptr_t funcp, funcinfop, nargs, argp, ii;
+	const char *ftypename;
+	v8function_t *fp;
+	v8context_t *ctxp;
+	char what[32];				/* "frame N" */
+	char buf[sizeof (what) + 32];		/* what, plus " argN" etc. */
+	uint8_t type;
+
+	if (jsframe_classify(fptr, raddr, &ftypename) != JSFRAME_JS ||
+	    jsframe_function(fptr, &funcp) != 0 ||
+	    !V8_IS_HEAPOBJECT(funcp) ||
+	    read_typebyte(&type, funcp) != 0 ||
+	    type != V8_TYPE_JSFUNCTION)
+		return;
+
+	(void) snprintf(what, sizeof (what), "frame %u", jsp->jsp_njsframes++);
+	(void) snprintf(buf, sizeof (buf), "%s function", what);
+	jspath_root_add(jsp, funcp, buf);
+
+	if (read_heap_ptr(&funcinfop, funcp, V8_OFF_JSFUNCTION_SHARED) == 0 &&
+	    read_heap_maybesmi(&nargs, funcinfop,
+	    V8_OFF_SHAREDFUNCTIONINFO_LENGTH) == 0) {
+		if (jsframe_arg(fptr, nargs, 0, &argp) == 0) {
+			(void) snprintf(buf, sizeof (buf), "%s this", what);
+			jspath_root_add(jsp, argp, buf);
+		}
+
+		for (ii = 0; ii < nargs; ii++) {
+			if (jsframe_arg(fptr, nargs, ii + 1, &argp) != 0)
+				continue;
+
+			(void) snprintf(buf, sizeof (buf),
+			    "%s arg%" PRIuPTR, what, ii + 1);
+			jspath_root_add(jsp, argp, buf);
+		}
+	}
+
+	(void) snprintf(buf, sizeof (buf), "%s closure", what);
+
+	if ((fp = v8function_load(funcp, UM_SLEEP | UM_GC)) != NULL &&
+	    (ctxp = v8function_context(fp, UM_SLEEP | UM_GC)) != NULL)
+		jspath_context(jsp, v8context_addr(ctxp), buf);
+}
+
+/*
+ * Callback for the "jsframe" walker.  As with $C and ::jsframe, "addr" points
+ * to the frame pointer of the frame of interest, and the return address into
+ * that frame is stored just after it.
+ */
+/* ARGSUSED */
+static int
+jspath_frames_cb(uintptr_t addr, const void *ignored, void *arg)
+{
+	jspath_t *jsp = arg;
+	uintptr_t fptr, raddr;
+
+	if (++jsp->jsp_nframes > JSPATH_MAXFRAMES)
+		return (WALK_DONE);
+
+	if (mdb_vread(&raddr, sizeof (raddr),
+	    addr + sizeof (uintptr_t)) == -1 ||
+	    mdb_vread(&fptr, sizeof (fptr), addr) == -1)
+		return (WALK_DONE);
+
+	if (fptr != 0)
+		jspath_frame(jsp, fptr, raddr);
+
+	return (WALK_NEXT);
+}
+
+/*
+ * Add the values in each JavaScript stack frame to the roots.  Like ::jsstack,
+ * we examine the top frame ourselves and then use the "jsframe" walker for
+ * the rest of the stack.
+ */
+static void
+jspath_frames(jspath_t *jsp)
+{
+	uintptr_t fptr, raddr;
+
+	if (load_current_context(&fptr, &raddr) != 0)
+		return;
+
+	jspath_frame(jsp, fptr, raddr);
+	(void) mdb_pwalk("jsframe", jspath_frames_cb, jsp, fptr);
+}
+
+/*
+ * Collect the roots: the values in stack frames, and the native contexts and
+ * global objects reachable from those frames and from the functions that
+ * ::findjsobjects found.
+ */
+static void
+jspath_roots(findjsobjects_state_t *fjs, jspath_t *jsp)
+{
+	findjsobjects_func_t *func;
+	v8function_t *fp;
+	v8context_t *ctxp;
+	size_t i, n;
+
+	v8_silent++;
+	jspath_frames(jsp);
+
+	for (func = fjs->fjs_funcs; func != NULL; func = func->fjsf_next) {
+		if ((fp = v8function_load(func->fjsf_instances.fjsi_addr,
+		    UM_SLEEP | UM_GC)) != NULL &&
+		    (ctxp = v8function_context(fp, UM_SLEEP | UM_GC)) != NULL)
+			jspath_context(jsp, v8context_addr(ctxp), NULL);
+	}
+
+	v8_silent--;
+
+	/*
+	 * Sort the roots by address, keeping only the first description
+	 * found for each.
+	 */
+	qsort(jsp->jsp_roots, jsp->jsp_nroots, sizeof (jspath_root_t),
+	    jspath_cmp_root);
+
+	for (i = 0, n = 0; i < jsp->jsp_nroots; i++) {
+		if (n == 0 || jsp->jsp_roots[n - 1].jspr_addr !=
+		    jsp->jsp_roots[i].jspr_addr)
+			jsp->jsp_roots[n++] = jsp->jsp_roots[i];
+	}
+
+	jsp->jsp_nroots = n;
+}
+
+static boolean_t
+jspath_onpath(jspath_entry_t *entries, uint32_t idx, uintptr_t addr)
+{
+	for (; idx != FJS_DOM_NONE; idx = entries[idx].jspe_parent) {
+		if (entries[idx].jspe_addr == addr)
+			return (B_TRUE);
+	}
+
+	return (B_FALSE);
+}
+
+static void
+jspath_print(findjsobjects_state_t *fjs, jspath_entry_t *entries,
+    uint32_t idx, jspath_root_t *root, uint_t pathno, boolean_t pipe)
+{
+	jspath_entry_t *entry = &entries[idx], *parent;
+
+	if (pipe) {
+		mdb_printf("%p\n", entry->jspe_addr);
+		return;
+	}
+
+	mdb_printf("path %d:\n", pathno);
+	mdb_printf("    %p (%s)\n", entry->jspe_addr,
+	    root != NULL ? root->jspr_desc : "no known referrers");
+
+	for (; entry->jspe_parent != FJS_DOM_NONE; entry = parent) {
+		parent = &entries[entry->jspe_parent];
+
+		if ((entry->jspe_label & FJS_LABEL_ELEMENT) != 0) {
+			mdb_printf("    %p[%llu] => %p\n", entry->jspe_addr,
+			    entry->jspe_label & ~FJS_LABEL_ELEMENT,
+			    parent->jspe_addr);
+		} else {
+			mdb_printf("    %p.%s => %p\n", entry->jspe_addr,
+			    fjs->fjs_nametab[entry->jspe_label]->fjsn_str,
+			    parent->jspe_addr);
+		}
+	}
+}
+
+static int
+jspath_search(findjsobjects_state_t *fjs, jspath_t *jsp, uintptr_t addr,
+    uint_t k, boolean_t pipe)
+{
+	findjsobjects_revindex_t *fjsri = &fjs->fjs_revindex;
+	jspath_entry_t *entries, *grown;
+	jspath_root_t *root;
+	uint8_t *visits;
+	uint32_t head = 0, tail = 0, nalloc = 1024;
+	uint_t found = 0;
+	boolean_t truncated = B_FALSE;
+	uintptr_t cur;
+	ssize_t t;
+	size_t j;
+
+	visits = mdb_zalloc(MAX(fjsri->fjsri_ntargets, 1), UM_SLEEP | UM_GC);
+	entries = mdb_alloc(nalloc * sizeof (jspath_entry_t), UM_SLEEP | UM_GC);
+	entries[tail].jspe_addr = addr;
+	entries[tail].jspe_parent = FJS_DOM_NONE;
+	entries[tail++].jspe_label = 0;
+
+	while (head < tail && found < k) {
+		cur = entries[head].jspe_addr;
+		root = jspath_root_find(jsp, cur);
+		t = findjsobjects_revindex_find(fjsri, cur);
+
+		if (root != NULL || t == -1) {
+			jspath_print(fjs, entries, head++, root, ++found, pipe);
+			continue;
+		}
+
+		if (visits[t] >= k) {
+			head++;
+			continue;
+		}
+
+		visits[t]++;
+
+		for (j = fjsri->fjsri_offsets[t];
+		    j < fjsri->fjsri_offsets[t + 1]; j++) {
+			if (jspath_onpath(entries, head,
+			    fjsri->fjsri_referrers[j]))
+				continue;
+
+			if (tail == JSPATH_MAXENTRIES) {
+				truncated = B_TRUE;
+				break;
+			}
+
+			if (tail == nalloc) {
+				nalloc *= 2;
+				grown = mdb_alloc(nalloc *
+				    sizeof (jspath_entry_t), UM_SLEEP | UM_GC);
+				bcopy(entries, grown,
+				    tail * sizeof (jspath_entry_t));
+				entries = grown;
+			}
+
+			entries[tail].jspe_addr = fjsri->fjsri_referrers[j];
+			entries[tail].jspe_parent = head;
+			entries[tail++].jspe_label = fjsri->fjsri_labels[j];
+		}
+
+		head++;
+	}
+
+	if (truncated && found < k) {
+		mdb_warn("search for paths to %p stopped after %d partial "
+		    "paths\n", addr, JSPATH_MAXENTRIES);
+	}
+
+	return (DCMD_OK);
+}
+
+/* ARGSUSED */
+static int
+dcmd_jspath(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+{
+	findjsobjects_state_t *fjs = &findjsobjects_state;
+	boolean_t verbose = B_FALSE;
+	uintptr_t k = 1;
+	jspath_t jsp;
+
+	if (mdb_getopts(argc, argv,
+	    'k', MDB_OPT_UINTPTR, &k,
+	    'v', MDB_OPT_SETBITS, B_TRUE, &verbose,
+	    NULL) != argc || !(flags & DCMD_ADDRSPEC))
+		return (DCMD_USAGE);
+
+	if (k < 1 || k > JSPATH_MAXK) {
+		mdb_warn("number of paths must be between 1 and %d\n",
+		    JSPATH_MAXK);
+		return (DCMD_ERR);
+	}
+
+	fjs->fjs_verbose = verbose;
+
+	if (findjsobjects_run(fjs) != 0)
+		return (DCMD_ERR);
+
+	findjsobjects_partial(fjs);
+
+	if (!fjs->fjs_revindex.fjsri_built)
+		findjsobjects_revindex_build(fjs);
+
+	bzero(&jsp, sizeof (jsp));
+	jspath_roots(fjs, &jsp);
+
+	if (verbose) {
+		mdb_printf("jspath: %llu roots in %d native contexts\n",
+		    (uint64_t)jsp.jsp_nroots, (int)jsp.jsp_nnative);
+	}
+
+	return (jspath_search(fjs, &jsp, addr, (uint_t)k,
+	    (flags & DCMD_PIPE_OUT) != 0));
+}
+
+static void
+dcmd_jspath_help(void)
+{
+	mdb_printf("%s\n\n",
+"Prints the shortest chain of references from a root to the object ADDR.\n"
+"This uses the objects found by ::findjsobjects (running it first if\n"
+"needed) and the reverse reference index built by ::findjsobjects -R, so\n"
+"after the first use, each search is fast.\n"
+"\n"
+"The roots are the values in JavaScript stack frames (the function, \"this\",\n"
+"the arguments, and the variables of the closures that the function can\n"
+"see), the slots of native contexts, and the properties of global objects.\n"
+"Only references from the properties and elements of objects found by\n"
+"::findjsobjects are followed, so a path may instead end at an object that\n"
+"no known object refers to (such as one referred to only by a closure).\n"
+"\n"
+"Each path is printed starting from its root, one reference per line, like\n"
+"the output of ::findjsobjects -r.  If the output is piped, only the\n"
+"address of each path's root is printed.");
+
+	mdb_dec_indent(2);
+	mdb_printf("%<b>OPTIONS%</b>\n");
+	mdb_inc_indent(2);
+
+	mdb_printf("%s\n",
+"  -k num   Print up to this many of the shortest distinct paths (default:\n"
+"           1)\n"
+"  -v       Report statistics about the scan and the roots\n");
+}
+
+/*
+ * ::jsheapdiff compares the shapes found by ::findjsobjects in two heaps,
+ * typically from cores of the same program taken some time apart.  Each heap
+ * is described by a summary file written with ::jsheapdiff -o: a header
+ * followed by a fixed-size record for each shape (its constructor, property
+ * count and property names, the number of instances and their total shallow
+ * size) and a string table, at offsets recorded in the header.  A shape's
+ * property names are stored together in the string table, each terminated by
+ * a NUL, so that (unlike any printable separator) the boundaries between
+ * names are unambiguous.  Unlike an index (see findjsobjects_save()), a
+ * summary records no addresses, so its size depends only on the number of
+ * distinct shapes, and it can be compared against a summary of any other
+ * process.  A summary of a heap in which no shapes were found has an empty
+ * string table.
+ */
+#define	FJS_SUMMARY_MAGIC	"MDBV8FJD"
+#define	FJS_SUMMARY_VERSION	2
+#define	JSHEAPDIFF_NDEFAULT	20
+
+typedef struct findjsobjects_shdr {
+	char fjsh_magic[8];
+	uint32_t fjsh_version;
+	uint32_t fjsh_pad;
+	uint64_t fjsh_pid;
+	uint64_t fjsh_nobjects;		/* total number of instances */
+	uint64_t fjsh_nbytes;		/* total shallow size of instances */
+	uint64_t fjsh_nshapes;
+	uint64_t fjsh_strtabsz;
+	uint64_t fjsh_shapes_off;
+	uint64_t fjsh_strtab_off;
+} findjsobjects_shdr_t;
+
+typedef struct findjsobjects_sshape {
+	uint64_t fjss_count;		/* number of instances */
+	uint64_t fjss_bytes;		/* total shallow size of instances */
+	uint64_t fjss_nprops;		/* fjso_nprops */
+	uint32_t fjss_constructor;	/* string table offset */
+	uint32_t fjss_props;		/* string table offset */
+	uint32_t fjss_propslen;		/* bytes of property names */
+	uint32_t fjss_pad;
+} findjsobjects_sshape_t;
+
+/*
+ * A shape being compared.  Index 0 of each array describes the heap before,
+ * and index 1 the heap after.
+ */
+typedef struct jsheapdiff_shape {
+	const char *jhs_constructor;
+	const char *jhs_props;		/* names, each NUL-terminated */
+	size_t jhs_propslen;		/* bytes in jhs_props */
+	uint64_t jhs_nprops;
+	uint64_t jhs_count[2];
+	uint64_t jhs_bytes[2];
+	uintptr_t jhs_addr;		/* representative, if known */
+} jsheapdiff_shape_t;
+
+/*
+ * Returns the property names of "obj" in a garbage-collected buffer, each
+ * terminated by a NUL, and their total length in *lenp.
+ */
+static char *
+jsheapdiff_props(findjsobjects_obj_t *obj, size_t *lenp)
+{
+	findjsobjects_prop_t *prop;
+	size_t len = 0, n;
+	char *buf;
+
+	for (prop = obj->fjso_props; prop != NULL; prop = prop->fjsp_next)
+		len += strlen(prop->fjsp_desc) + 1;
+
+	buf = mdb_zalloc(len + 1, UM_SLEEP | UM_GC);
+	*lenp = len;
+
+	for (len = 0, prop = obj->fjso_props; prop != NULL;
+	    prop = prop->fjsp_next) {
+		n = strlen(prop->fjsp_desc) + 1;
+		bcopy(prop->fjsp_desc, buf + len, n);
+		len += n;
+	}
+
+	return (buf);
+}
+
+/*
+ * Returns the property names of "shape" as a single garbage-collected string,
+ * separated by commas, for display.
+ */
+static char *
+jsheapdiff_props_fmt(const jsheapdiff_shape_t *shape)
+{
+	const char *name;
+	size_t len = shape->jhs_propslen * 2 + 1;
+	char *buf;
+
+	buf = mdb_zalloc(len, UM_SLEEP | UM_GC);
+
+	for (name = shape->jhs_props;
+	    name < shape->jhs_props + shape->jhs_propslen;
+	    name += strlen(name) + 1) {
+		if (name != shape->jhs_props)
+			(void) strlcat(buf, ", ", len);
+
+		(void) strlcat(buf, name, len);
+	}
+
+	return (buf);
+}
+
+/*
+ * Describes the shapes of the current heap, which must have been completely
+ * scanned, as garbage-collected shapes for side "side".
+ */
+static int
+jsheapdiff_current(findjsobjects_state_t *fjs, int side,
+    jsheapdiff_shape_t **shapesp, size_t *nshapesp, findjsobjects_shdr_t *hdr)
+{
+	findjsobjects_key_t key;
+	findjsobjects_obj_t *obj;
+	jsheapdiff_shape_t *shapes, *shape;
+	size_t n = 0;
+
+	if (findjsobjects_key(&key) != 0)
+		return (-1);
+
+	for (obj = fjs->fjs_objects; obj != NULL; obj = obj->fjso_next)
+		n++;
+
+	shapes = mdb_zalloc(MAX(n, 1) * sizeof (jsheapdiff_shape_t),
+	    UM_SLEEP | UM_GC);
+	bzero(hdr, sizeof (*hdr));
+	hdr->fjsh_pid = key.fjsk_pid;
+	hdr->fjsh_nshapes = n;
+
+	for (obj = fjs->fjs_objects, shape = shapes; obj != NULL;
+	    obj = obj->fjso_next, shape++) {
+		shape->jhs_constructor = obj->fjso_constructor;
+		shape->jhs_props = jsheapdiff_props(obj, &shape->jhs_propslen);
+		shape->jhs_nprops = obj->fjso_nprops;
+		shape->jhs_count[side] = obj->fjso_ninstances;
+		shape->jhs_bytes[side] = obj->fjso_bytes;
+		shape->jhs_addr = obj->fjso_instances.fjsi_addr;
+		hdr->fjsh_nobjects += shape->jhs_count[side];
+		hdr->fjsh_nbytes += shape->jhs_bytes[side];
+	}
+
+	*shapesp = shapes;
+	*nshapesp = n;
+	return (0);
+}
+
+static int
+jsheapdiff_save(findjsobjects_state_t *fjs, const char *path)
+{
+	findjsobjects_strtab_t strtab;
+	findjsobjects_shdr_t hdr;
+	findjsobjects_sshape_t *sshapes;
+	jsheapdiff_shape_t *shapes;
+	size_t n, i;
+	FILE *fp;
+	int rv = 0;
+
+	if (jsheapdiff_current(fjs, 0, &shapes, &n, &hdr) != 0)
+		return (-1);
+
+	bcopy(FJS_SUMMARY_MAGIC, hdr.fjsh_magic, sizeof (hdr.fjsh_magic));
+	hdr.fjsh_version = FJS_SUMMARY_VERSION;
+	hdr.fjsh_shapes_off = sizeof (hdr);
+
+	sshapes = mdb_zalloc(MAX(n, 1) * sizeof (findjsobjects_sshape_t),
+	    UM_SLEEP | UM_GC);
+	bzero(&strtab, sizeof (strtab));
+
+	for (i = 0; i < n; i++) {
+		sshapes[i].fjss_count = shapes[i].jhs_count[0];
+		sshapes[i].fjss_bytes = shapes[i].jhs_bytes[0];
+		sshapes[i].fjss_nprops = shapes[i].jhs_nprops;
+		sshapes[i].fjss_constructor = findjsobjects_strtab_add(&strtab,
+		    shapes[i].jhs_constructor);
+		sshapes[i].fjss_propslen = shapes[i].jhs_propslen;
+		sshapes[i].fjss_props = shapes[i].jhs_propslen == 0 ?
+		    findjsobjects_strtab_add(&strtab, "") :
+		    findjsobjects_strtab_append(&strtab, shapes[i].jhs_props,
+		    shapes[i].jhs_propslen);
+	}
+
+	hdr.fjsh_strtab_off = hdr.fjsh_shapes_off +
+	    n * sizeof (findjsobjects_sshape_t);
+	hdr.fjsh_strtabsz = strtab.fjst_buflen;
+
+	if (strtab.fjst_full) {
+		mdb_warn("too many distinct strings for a heap summary\n");
+		findjsobjects_strtab_fini(&strtab);
+		return (-1);
+	}
+
+	if ((fp = fopen(path, "w")) == NULL) {
+		mdb_warn("failed to open \"%s\"", path);
+		findjsobjects_strtab_fini(&strtab);
+		return (-1);
+	}
+
+	if (fwrite(&hdr, sizeof (hdr), 1, fp) != 1 ||
+	    (n != 0 && fwrite(sshapes, sizeof (findjsobjects_sshape_t), n,
+	    fp) != n) ||
+	    (strtab.fjst_buflen != 0 &&
+	    fwrite(strtab.fjst_buf, strtab.fjst_buflen, 1, fp) != 1) ||
+	    fflush(fp) != 0 || ferror(fp)) {
+		mdb_warn("failed to write \"%s\"", path);
+		(void) unlink(path);
+		rv = -1;
+	}
+
+	(void) fclose(fp);
+	findjsobjects_strtab_fini(&strtab);
+	return (rv);
+}
+
+/*
+ * Reads the summary at "path" as garbage-collected shapes for side "side".
+ * The file is unmapped before we return, so its string table is copied.
+ */
+static int
+jsheapdiff_load(const char *path, int side, jsheapdiff_shape_t **shapesp,
+    size_t *nshapesp, findjsobjects_shdr_t *hdr)
+{
+	const findjsobjects_sshape_t *sshapes;
+	jsheapdiff_shape_t *shapes;
+	struct stat st;
+	uint64_t filesz, i;
+	char *base, *strtab;
+	int fd, rv = -1;
+
+	if ((fd = open(path, O_RDONLY)) == -1) {
+		mdb_warn("failed to open \"%s\"", path);
+		return (-1);
+	}
+
+	if (fstat(fd, &st) != 0) {
+		mdb_warn("failed to stat \"%s\"", path);
+		(void) close(fd);
+		return (-1);
+	}
+
+	filesz = st.st_size;
+
+	if (filesz < sizeof (*hdr)) {
+		mdb_warn("\"%s\" is not a heap summary\n", path);
+		(void) close(fd);
+		return (-1);
+	}
+
+	base = mmap(NULL, filesz, PROT_READ, MAP_PRIVATE, fd, 0);
+	(void) close(fd);
+
+	if (base == MAP_FAILED) {
+		mdb_warn("failed to map \"%s\"", path);
+		return (-1);
+	}
+
+	bcopy(base, hdr, sizeof (*hdr));
+
+	if (bcmp(hdr->fjsh_magic, FJS_SUMMARY_MAGIC,
+	    sizeof (hdr->fjsh_magic)) != 0) {
+		mdb_warn("\"%s\" is not a heap summary\n", path);
+		goto out;
+	}
+
+	if (hdr->fjsh_version != FJS_SUMMARY_VERSION) {
+		mdb_warn("\"%s\" was written by an incompatible version "
+		    "of mdb_v8\n", path);
+		goto out;
+	}
+
+	if (!findjsobjects_index_range(hdr->fjsh_shapes_off,
+	    hdr->fjsh_nshapes, sizeof (findjsobjects_sshape_t), filesz) ||
+	    !findjsobjects_index_range(hdr->fjsh_strtab_off,
+	    hdr->fjsh_strtabsz, 1, filesz) ||
+	    hdr->fjsh_shapes_off % sizeof (uint64_t) != 0 ||
+	    (hdr->fjsh_strtabsz == 0 ? hdr->fjsh_nshapes != 0 :
+	    base[hdr->fjsh_strtab_off + hdr->fjsh_strtabsz - 1] != '\0')) {
+		mdb_warn("\"%s\" is corrupt\n", path);
+		goto out;
+	}
+
+	sshapes = (const findjsobjects_sshape_t *)
+	    (base + hdr->fjsh_shapes_off);
+
+	for (i = 0; i < hdr->fjsh_nshapes; i++) {
+		if (sshapes[i].fjss_constructor >= hdr->fjsh_strtabsz ||
+		    sshapes[i].fjss_props >= hdr->fjsh_strtabsz ||
+		    sshapes[i].fjss_propslen > hdr->fjsh_strtabsz -
+		    sshapes[i].fjss_props) {
+			mdb_warn("\"%s\" is corrupt\n", path);
+			goto out;
+		}
+	}
+
+	strtab = mdb_alloc(MAX(hdr->fjsh_strtabsz, 1), UM_SLEEP | UM_GC);
+	bcopy(base + hdr->fjsh_strtab_off, strtab, hdr->fjsh_strtabsz);
+	shapes = mdb_zalloc(MAX(hdr->fjsh_nshapes, 1) *
+	    sizeof (jsheapdiff_shape_t), UM_SLEEP | UM_GC);
+
+	for (i = 0; i < hdr->fjsh_nshapes; i++) {
+		shapes[i].jhs_constructor =
+		    strtab + sshapes[i].fjss_constructor;
+		shapes[i].jhs_props = strtab + sshapes[i].fjss_props;
+		shapes[i].jhs_propslen = sshapes[i].fjss_propslen;
+		shapes[i].jhs_nprops = sshapes[i].fjss_nprops;
+		shapes[i].jhs_count[side] = sshapes[i].fjss_count;
+		shapes[i].jhs_bytes[side] = sshapes[i].fjss_bytes;
+	}
+
+	*shapesp = shapes;
+	*nshapesp = hdr->fjsh_nshapes;
+	rv = 0;
+
+out:
+	(void) munmap(base, filesz);
+	return (rv);
+}
+
+static int
+jsheapdiff_cmp(const void *l, const void *r)
+{
+	const jsheapdiff_shape_t *lhs = l, *rhs = r;
+	int rv;
+
+	if ((rv = strcmp(lhs->jhs_constructor, rhs->jhs_constructor)) != 0)
+		return (rv);
+
+	if (lhs->jhs_nprops != rhs->jhs_nprops)
+		return (lhs->jhs_nprops < rhs->jhs_nprops ? -1 : 1);
+
+	if (lhs->jhs_propslen != rhs->jhs_propslen)
+		return (lhs->jhs_propslen < rhs->jhs_propslen ? -1 : 1);
+
+	return (memcmp(lhs->jhs_props, rhs->jhs_props, lhs->jhs_propslen));
+}
+
+/*
+ * Formats the change from "before" to "after" into "buf".
+ */
+static void
+jsheapdiff_delta(char *buf, size_t len, uint64_t before, uint64_t after)
+{
+	if (after >= before)
+		(void) mdb_snprintf(buf, len, "+%llu", after - before);
+	else
+		(void) mdb_snprintf(buf, len, "-%llu", before - after);
+}
+
+static void
+jsheapdiff_print(const jsheapdiff_shape_t *shape, boolean_t verbose)
+{
+	char dcount[32], dbytes[32], props[80];
+	char *names = jsheapdiff_props_fmt(shape);
+	int col = 9 + 1 + 9 + 1 + 12 + 1 + 12 + 1 + strlen("...");
+
+	jsheapdiff_delta(dcount, sizeof (dcount),
+	    shape->jhs_count[0], shape->jhs_count[1]);
+	jsheapdiff_delta(dbytes, sizeof (dbytes),
+	    shape->jhs_bytes[0], shape->jhs_bytes[1]);
+
+	mdb_printf("%9llu %9s %12llu %12s ", shape->jhs_count[1], dcount,
+	    shape->jhs_bytes[1], dbytes);
+
+	if (shape->jhs_constructor[0] != '\0') {
+		mdb_printf("%s%s", shape->jhs_constructor,
+		    names[0] != '\0' ? ": " : "");
+		col += strlen(shape->jhs_constructor) + 2;
+	}
+
+	if (verbose || col + strlen(names) < 80) {
+		mdb_printf("%s\n", names);
+		return;
+	}
+
+	(void) strlcpy(props, names,
+	    MIN(sizeof (props), MAX(80 - col, 0) + 1));
+	mdb_printf("%s...\n", props);
+}
+
+/* ARGSUSED */
+static int
+dcmd_jsheapdiff(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+{
+	findjsobjects_state_t *fjs = &findjsobjects_state;
+	findjsobjects_shdr_t hdrs[2];
+	jsheapdiff_shape_t *shapes[2], *all, *shape;
+	boolean_t bybytes = B_FALSE, verbose = B_FALSE;
+	const char *outpath = NULL;
+	uintptr_t count = JSHEAPDIFF_NDEFAULT;
+	size_t nshapes[2], nall, i, j, ntop = 0;
+	uint64_t *keys, before, after;
+	uint32_t *top;
+	int side;
+
+	i = mdb_getopts(argc, argv,
+	    'b', MDB_OPT_SETBITS, B_TRUE, &bybytes,
+	    'n', MDB_OPT_UINTPTR, &count,
+	    'o', MDB_OPT_STR, &outpath,
+	    'v', MDB_OPT_SETBITS, B_TRUE, &verbose,
+	    NULL);
+	argc -= i;
+	argv += i;
+
+	if (outpath != NULL ? argc != 0 : argc < 1 || argc > 2)
+		return (DCMD_USAGE);
+
+	for (i = 0; i < argc; i++) {
+		if (argv[i].a_type != MDB_TYPE_STRING)
+			return (DCMD_USAGE);
+	}
+
+	if (count == 0) {
+		mdb_warn("count must be at least 1\n");
+		return (DCMD_ERR);
+	}
+
+	/*
+	 * Only a summary of the current heap (written with -o, or compared
+	 * against when just one summary is given) requires a heap scan.
+	 */
+	if (argc < 2) {
+		fjs->fjs_verbose = B_FALSE;
+
+		if (findjsobjects_run(fjs) != 0)
+			return (DCMD_ERR);
+
+		if (!fjs->fjs_finished) {
+			mdb_warn("cannot summarize the heap until the heap "
+			    "scan is complete\n");
+			return (DCMD_ERR);
+		}
+	}
+
+	if (outpath != NULL) {
+		return (jsheapdiff_save(fjs, outpath) == 0 ?
+		    DCMD_OK : DCMD_ERR);
+	}
+
+	for (side = 0; side < 2; side++) {
+		if (side < argc ? jsheapdiff_load(argv[side].a_un.a_str, side,
+		    &shapes[side], &nshapes[side], &hdrs[side]) != 0 :
+		    jsheapdiff_current(fjs, side, &shapes[side],
+		    &nshapes[side], &hdrs[side]) != 0)
+			return (DCMD_ERR);
+	}
+
+	/*
+	 * Sort the shapes from both heaps together, and then coalesce those
+	 * that match.
+	 */
+	nall = nshapes[0] + nshapes[1];
+	all = mdb_alloc(MAX(nall, 1) * sizeof (jsheapdiff_shape_t),
+	    UM_SLEEP | UM_GC);
+	bcopy(shapes[0], all, nshapes[0] * sizeof (jsheapdiff_shape_t));
+	bcopy(shapes[1], all + nshapes[0],
+	    nshapes[1] * sizeof (jsheapdiff_shape_t));
+	qsort(all, nall, sizeof (jsheapdiff_shape_t), jsheapdiff_cmp);
+
+	for (i = 0, j = 0; i < nall; i++) {
+		if (j != 0 && jsheapdiff_cmp(&all[j - 1], &all[i]) == 0) {
+			shape = &all[j - 1];
+
+			for (side = 0; side < 2; side++) {
+				shape->jhs_count[side] +=
+				    all[i].jhs_count[side];
+				shape->jhs_bytes[side] +=
+				    all[i].jhs_bytes[side];
+			}
+
+			if (shape->jhs_addr == 0)
+				shape->jhs_addr = all[i].jhs_addr;
+
+			continue;
+		}
+
+		all[j++] = all[i];
+	}
+
+	nall = j;
+
+	/*
+	 * Now pick the shapes that grew the most.
+	 */
+	keys = mdb_zalloc(MAX(nall, 1) * sizeof (uint64_t), UM_SLEEP | UM_GC);
+	top = mdb_alloc(count * sizeof (uint32_t), UM_SLEEP | UM_GC);
+
+	for (i = 0; i < nall; i++) {
+		before = bybytes ? all[i].jhs_bytes[0] : all[i].jhs_count[0];
+		after = bybytes ? all[i].jhs_bytes[1] : all[i].jhs_count[1];
+
+		if (after <= before)
+			continue;
+
+		keys[i] = after - before;
+		findjsobjects_topn(top, &ntop, count, keys, (uint32_t)i);
+	}
+
+	if (flags & DCMD_PIPE_OUT) {
+		for (i = 0; i < ntop; i++) {
+			if (all[top[i]].jhs_addr != 0)
+				mdb_printf("%p\n", all[top[i]].jhs_addr);
+		}
+
+		return (DCMD_OK);
+	}
+
+	for (side = 0; side < 2; side++) {
+		mdb_printf("%-6s pid %llu: %llu objects, %llu bytes, "
+		    "%llu shapes\n", side == 0 ? "before" : "after",
+		    hdrs[side].fjsh_pid, hdrs[side].fjsh_nobjects,
+		    hdrs[side].fjsh_nbytes, hdrs[side].fjsh_nshapes);
+	}
+
+	mdb_printf("\n%9s %9s %12s %12s %s\n", "COUNT", "+COUNT", "BYTES",
+	    "+BYTES", "SHAPE");
+
+	for (i = 0; i < ntop; i++)
+		jsheapdiff_print(&all[top[i]], verbose);
+
+	return (DCMD_OK);
+}
+
+static void
+dcmd_jsheapdiff_help(void)
+{
+	mdb_printf("%s\n\n",
+"Compares the objects found by ::findjsobjects in two heaps, usually from\n"
+"cores of the same program taken some time apart, and lists the shapes\n"
+"(constructor and property names) whose instances grew the most.\n"
+"\n"
+"Each heap is described by a summary file, written with -o, that records\n"
+"for each shape the number of instances and their total shallow size (as\n"
+"listed by ::findjsobjects -s bytes).  A summary is typically much smaller\n"
+"than the heap it describes, and comparing two summaries does not require a\n"
+"target.  Given one summary, ::jsheapdiff compares it with the current\n"
+"heap, running ::findjsobjects first if needed; in that case, if the output\n"
+"is piped, a representative object of each shape is emitted, which can be\n"
+"piped to ::findjsobjects to list its instances.\n"
+"\n"
+"For each shape, the output includes the count and size after, the change\n"
+"from before, and the constructor and property names.");
+
+	mdb_dec_indent(2);
+	mdb_printf("%<b>OPTIONS%</b>\n");
+	mdb_inc_indent(2);
+
+	mdb_printf("%s\n",
+"  -b       Rank shapes by growth in bytes rather than in instances\n"
+"  -n count List this many shapes (default: 20)\n"
+"  -o file  Write a summary of the current heap to file\n"
+"  -v       Print the property names of each shape in full\n");
+}
+
+/*
+ * ::jsheapsnapshot writes the objects found by ::findjsobjects, and the
+ * references between them, as a heap snapshot in the JSON format read by the
+ * heap profiler in Chrome DevTools.  A snapshot consists of a "nodes" array,
+ * which describes each object with JSSNAP_NODE_NFIELDS numbers (including its
+ * number of outgoing edges), an "edges" array, which describes each node's
+ * edges in the same order with JSSNAP_EDGE_NFIELDS numbers, and a "strings"
+ * array holding every name, which the nodes and edges refer to by index.
+ *
+ * The snapshot is streamed rather than built in memory: each object's
+ * references are found with the same iterators that ::jsprint and ::jsclosure
+ * use and are written immediately to a temporary file of edges, and the
+ * object's node is written to the snapshot once they've been counted.  The
+ * strings and values that objects refer to are emitted as nodes of their own
+ * the first time they're seen, into a second temporary file that is appended
+ * to the nodes.  Both temporary files are then copied into the snapshot,
+ * followed by the strings, which are deduplicated with the string table used
+ * for saved indexes.  The total node and edge counts precede the arrays in
+ * the format, so we leave room for them and fill them in at the end.
+ *
+ * What we hold in memory is then proportional to the number of objects and
+ * distinct strings, not to the number of references between them.
+ */
+#define	JSSNAP_NODE_NFIELDS	6
+#define	JSSNAP_EDGE_NFIELDS	3
+#define	JSSNAP_MAXSTR		1024	/* bytes of a string's value kept */
+#define	JSSNAP_BUFSZ		(1024 * 1024)
+#define	JSSNAP_COUNTWIDTH	20
+
+/*
+ * Node and edge types, as indexes into the lists in the snapshot metadata.
+ */
+#define	JSSNAP_NODE_STRING	2
+#define	JSSNAP_NODE_OBJECT	3
+#define	JSSNAP_NODE_CLOSURE	5
+#define	JSSNAP_NODE_NUMBER	7
+
+#define	JSSNAP_EDGE_CONTEXT	0
+#define	JSSNAP_EDGE_ELEMENT	1
+#define	JSSNAP_EDGE_PROPERTY	2
+
+static const char *jssnap_meta =
+	"{\"snapshot\":{\"meta\":{"
+	"\"node_fields\":[\"type\",\"name\",\"id\",\"self_size\","
+	"\"edge_count\",\"trace_node_id\"],"
+	"\"node_types\":[[\"hidden\",\"array\",\"string\",\"object\","
+	"\"code\",\"closure\",\"regexp\",\"number\",\"native\",\"synthetic\","
+	"\"concatenated string\",\"sliced string\"],"
+	"\"string\",\"number\",\"number\",\"number\",\"number\"],"
+	"\"edge_fields\":[\"type\",\"name_or_index\",\"to_node\"],"
+	"\"edge_types\":[[\"context\",\"element\",\"property\",\"internal\","
+	"\"hidden\",\"shortcut\",\"weak\"],\"string_or_number\",\"node\"],"
+	"\"trace_function_info_fields\":[\"function_id\",\"name\","
+	"\"script_name\",\"script_id\",\"line\",\"column\"],"
+	"\"trace_node_fields\":[\"id\",\"function_info_index\",\"count\","
+	"\"size\",\"children\"],"
+	"\"sample_fields\":[\"timestamp_us\",\"last_assigned_id\"],"
+	"\"location_fields\":[\"object_index\",\"script_id\",\"line\","
+	"\"column\"]},\n";
+
+/*
+ * An object found by ::findjsobjects.  These are sorted by address, and an
+ * object's index in the array is its index in the nodes array.
+ */
+typedef struct jssnap_node {
+	uintptr_t jsn_addr;
+	uint32_t jsn_name;
+	uint8_t jsn_type;
+	boolean_t jsn_array;
+} jssnap_node_t;
+
+typedef struct jssnap {
+	findjsobjects_state_t *jss_fjs;
+	jssnap_node_t *jss_nodes;	/* objects, sorted by address */
+	size_t jss_nnodes;
+	uintptr_t *jss_leafaddrs;	/* hash of other nodes' addresses */
+	uint32_t *jss_leafidx;		/* and their node indexes */
+	size_t jss_nleafslots;
+	size_t jss_nleaves;
+	findjsobjects_strtab_t jss_strtab;
+	uint32_t *jss_stroffs;		/* string table offset of each string */
+	size_t jss_nstroffs;
+	FILE *jss_edges;		/* temporary file of edges */
+	FILE *jss_leaves;		/* temporary file of other nodes */
+	uint64_t jss_nedges;
+	uint32_t jss_nodeedges;		/* edges of the current node */
+	v8context_t *jss_ctx;		/* context of the current closure */
+	mdbv8_strbuf_t *jss_strb;
+	uint64_t jss_nbytes;		/* total self size of all nodes */
+} jssnap_t;
+
+static void
+jssnap_fini(jssnap_t *jss)
+{
+	if (jss->jss_leafaddrs != NULL) {
+		mdb_free(jss->jss_leafaddrs,
+		    jss->jss_nleafslots * sizeof (uintptr_t));
+		mdb_free(jss->jss_leafidx,
+		    jss->jss_nleafslots * sizeof (uint32_t));
+	}
+
+	if (jss->jss_stroffs != NULL) {
+		mdb_free(jss->jss_stroffs,
+		    jss->jss_nstroffs * sizeof (uint32_t));
+	}
+
+	if (jss->jss_edges != NULL)
+		(void) fclose(jss->jss_edges);
+
+	if (jss->jss_leaves != NULL)
+		(void) fclose(jss->jss_leaves);
+
+	findjsobjects_strtab_fini(&jss->jss_strtab);
+}
+
+static int
+jssnap_cmp_offset(const void *l, const void *r)
+{
+	uint32_t lhs = *((const uint32_t *)l);
+	uint32_t rhs = *((const uint32_t *)r);
+
+	return (lhs < rhs ? -1 : lhs > rhs ? 1 : 0);
+}
+
+/*
+ * Returns the index in the strings array of "str", which must already be
+ * escaped for JSON, adding it if necessary.  Strings are added to the string
+ * table in order, so their offsets are sorted.  If the string table is full,
+ * 0 is returned, and jssnap_write() fails once the heap has been walked.
+ */
+static uint32_t
+jssnap_str(jssnap_t *jss, const char *str)
+{
+	findjsobjects_strtab_t *fjst = &jss->jss_strtab;
+	size_t nstrs = fjst->fjst_nstrs, nalloc;
+	uint32_t off, *found;
+
+	off = findjsobjects_strtab_add(fjst, str);
+
+	if (fjst->fjst_full)
+		return (0);
+
+	if (fjst->fjst_nstrs == nstrs) {
+		found = bsearch(&off, jss->jss_stroffs, nstrs,
+		    sizeof (uint32_t), jssnap_cmp_offset);
+		assert(found != NULL);
+		return (found - jss->jss_stroffs);
+	}
+
+	if (nstrs == jss->jss_nstroffs) {
+		nalloc = nstrs == 0 ? 1024 : nstrs * 2;
+		jss->jss_stroffs = findjsobjects_revindex_grow(
+		    jss->jss_stroffs, nstrs, nalloc, sizeof (uint32_t));
+		jss->jss_nstroffs = nalloc;
+	}
+
+	jss->jss_stroffs[nstrs] = off;
+	return ((uint32_t)nstrs);
+}
+
+/*
+ * Like jssnap_str(), but escapes "str" first.
+ */
+static uint32_t
+jssnap_rawstr(jssnap_t *jss, const char *str)
+{
+	mdbv8_strbuf_rewind(jss->jss_strb);
+	mdbv8_strbuf_appends(jss->jss_strb, str, MSF_JSON);
+	return (jssnap_str(jss, mdbv8_strbuf_tocstr(jss->jss_strb)));
+}
+
+/*
+ * Returns the index in the strings array of the value of the JavaScript
+ * string at "addr", truncated to JSSNAP_MAXSTR bytes.
+ */
+static uint32_t
+jssnap_jsstr(jssnap_t *jss, uintptr_t addr)
+{
+	v8string_t *strp;
+
+	mdbv8_strbuf_rewind(jss->jss_strb);
+
+	if ((strp = v8string_load(addr, UM_SLEEP)) != NULL) {
+		(void) v8string_write(strp, jss->jss_strb, MSF_JSON,
+		    JSSTR_NONE);
+		v8string_free(strp);
+	}
+
+	return (jssnap_str(jss, mdbv8_strbuf_tocstr(jss->jss_strb)));
+}
+
+static void
+jssnap_leaf_rehash(jssnap_t *jss, size_t nslots)
+{
+	uintptr_t *addrs = mdb_zalloc(nslots * sizeof (uintptr_t), UM_SLEEP);
+	uint32_t *idx = mdb_alloc(nslots * sizeof (uint32_t), UM_SLEEP);
+	size_t i, j;
+
+	for (i = 0; i < jss->jss_nleafslots; i++) {
+		if (jss->jss_leafaddrs[i] == 0)
+			continue;
+
+		j = (jss->jss_leafaddrs[i] >> 3) & (nslots - 1);
+
+		while (addrs[j] != 0)
+			j = (j + 1) & (nslots - 1);
+
+		addrs[j] = jss->jss_leafaddrs[i];
+		idx[j] = jss->jss_leafidx[i];
+	}
+
+	if (jss->jss_leafaddrs != NULL) {
+		mdb_free(jss->jss_leafaddrs,
+		    jss->jss_nleafslots * sizeof (uintptr_t));
+		mdb_free(jss->jss_leafidx,
+		    jss->jss_nleafslots * sizeof (uint32_t));
+	}
+
+	jss->jss_leafaddrs = addrs;
+	jss->jss_leafidx = idx;
+	jss->jss_nleafslots = nslots;
+}
+
+/*
+ * Returns the node index of the string or number at "addr", writing a node
+ * for it if this is the first reference to it.  Returns -1 for any other
+ * kind of value.
+ */
+static int64_t
+jssnap_leaf(jssnap_t *jss, uintptr_t addr)
+{
+	uint32_t idx, name;
+	uint8_t type, ntype;
+	size_t i, size;
+
+	if (jss->jss_nleaves >= jss->jss_nleafslots / 2) {
+		jssnap_leaf_rehash(jss, jss->jss_nleafslots == 0 ?
+		    64 * 1024 : jss->jss_nleafslots * 2);
+	}
+
+	i = (addr >> 3) & (jss->jss_nleafslots - 1);
+
+	while (jss->jss_leafaddrs[i] != 0) {
+		if (jss->jss_leafaddrs[i] == addr)
+			return (jss->jss_leafidx[i]);
+
+		i = (i + 1) & (jss->jss_nleafslots - 1);
+	}
+
+	if (read_typebyte(&type, addr) != 0)
+		return (-1);
+
+	if (V8_TYPE_STRING(type)) {
+		ntype = JSSNAP_NODE_STRING;
+		name = jssnap_jsstr(jss, addr);
+	} else if (type == V8_TYPE_HEAPNUMBER ||
+	    type == V8_TYPE_MUTABLEHEAPNUMBER) {
+		ntype = JSSNAP_NODE_NUMBER;
+		name = jssnap_str(jss, "heap number");
+	} else {
+		return (-1);
+	}
+
+	if (obj_size(addr, type, &size, UM_SLEEP) != 0)
+		size = 0;
+
+	idx = jss->jss_nnodes + jss->jss_nleaves++;
+	jss->jss_leafaddrs[i] = addr;
+	jss->jss_leafidx[i] = idx;
+	jss->jss_nbytes += size;
+
+	(void) fprintf(jss->jss_leaves, ",\n%u,%u,%llu,%llu,0,0", ntype, name,
+	    (u_longlong_t)idx * 2 + 1, (u_longlong_t)size);
+
+	return (idx);
+}
+
+/*
+ * Write an edge of the given type from the current node to "value", if it
+ * refers to an object, string or number.
+ */
+static void
+jssnap_edge(jssnap_t *jss, uint_t type, uint32_t nameidx, uintptr_t value)
+{
+	jssnap_node_t *found, search;
+	int64_t idx;
+
+	if (!V8_IS_HEAPOBJECT(value))
+		return;
+
+	search.jsn_addr = value;
+
+	if ((found = bsearch(&search, jss->jss_nodes, jss->jss_nnodes,
+	    sizeof (jssnap_node_t), findjsobjects_cmp_addr)) != NULL) {
+		idx = found - jss->jss_nodes;
+	} else if ((idx = jssnap_leaf(jss, value)) == -1) {
+		return;
+	}
+
+	(void) fprintf(jss->jss_edges, "%s%u,%u,%llu",
+	    jss->jss_nedges == 0 ? "" : ",\n", type, nameidx,
+	    (u_longlong_t)idx * JSSNAP_NODE_NFIELDS);
+	jss->jss_nedges++;
+	jss->jss_nodeedges++;
+}
+
+static int
+jssnap_prop(const char *desc, v8propvalue_t *val, void *arg)
+{
+	jssnap_t *jss = arg;
+
+	if (val != NULL && !val->v8v_isboxeddouble) {
+		jssnap_edge(jss, JSSNAP_EDGE_PROPERTY, jssnap_rawstr(jss, desc),
+		    val->v8v_u.v8vu_addr);
+	}
+
+	return (0);
+}
+
+/* ARGSUSED */
+static int
+jssnap_element(v8array_t *ap, unsigned int index, uintptr_t value, void *arg)
+{
+	jssnap_edge(arg, JSSNAP_EDGE_ELEMENT, index, value);
+	return (0);
+}
+
+static int
+jssnap_closure_var(v8scopeinfo_t *sip, v8scopeinfo_var_t *sivp, void *arg)
+{
+	jssnap_t *jss = arg;
+	uintptr_t valp;
+
+	if (v8context_var_value(jss->jss_ctx, v8scopeinfo_var_idx(sip, sivp),
+	    &valp) == 0) {
+		jssnap_edge(jss, JSSNAP_EDGE_CONTEXT,
+		    jssnap_jsstr(jss, v8scopeinfo_var_name(sip, sivp)), valp);
+	}
+
+	return (0);
+}
+
+/*
+ * Write the edges of the object "node" to the temporary file of edges, and
+ * then the node itself to "fp".
+ */
+static void
+jssnap_object(jssnap_t *jss, jssnap_node_t *node, FILE *fp)
+{
+	uintptr_t addr = node->jsn_addr;
+	size_t idx = node - jss->jss_nodes, size, external;
+	v8function_t *funcp;
+	v8scopeinfo_t *sip;
+	v8array_t *ap;
+	uint8_t type;
+
+	jss->jss_nodeedges = 0;
+
+	if (node->jsn_type == JSSNAP_NODE_CLOSURE) {
+		if ((funcp = v8function_load(addr, UM_SLEEP)) != NULL &&
+		    (jss->jss_ctx = v8function_context(funcp,
+		    UM_SLEEP)) != NULL &&
+		    (sip = v8context_scopeinfo(jss->jss_ctx,
+		    UM_SLEEP)) != NULL) {
+			(void) v8scopeinfo_iter_vars(sip, V8SV_CONTEXTLOCALS,
+			    jssnap_closure_var, jss);
+			v8scopeinfo_free(sip);
+		}
+
+		v8context_free(jss->jss_ctx);
+		v8function_free(funcp);
+		jss->jss_ctx = NULL;
+	} else if (node->jsn_array) {
+		if ((ap = v8array_load(addr, UM_SLEEP)) != NULL) {
+			(void) v8array_iter_elements(ap, jssnap_element, jss);
+			v8array_free(ap);
+		}
+	} else {
+		(void) jsobj_properties(addr, jssnap_prop, jss, NULL);
+	}
+
+	if (read_typebyte(&type, addr) != 0 ||
+	    obj_shallow_size(NULL, addr, 0, type, &size, &external) != 0)
+		size = 0;
+
+	jss->jss_nbytes += size;
+
+	(void) fprintf(fp, "%s%u,%u,%llu,%llu,%u,0", idx == 0 ? "" : ",\n",
+	    node->jsn_type, node->jsn_name, (u_longlong_t)idx * 2 + 1,
+	    (u_longlong_t)size, jss->jss_nodeedges);
+}
+
+/*
+ * Copy the contents of the temporary file "src" to "dst".
+ */
+static int
+jssnap_copy(FILE *src, FILE *dst)
+{
+	char buf[8192];
+	size_t n;
+
+	if (fflush(src) != 0 || fseek(src, 0, SEEK_SET) != 0)
+		return (-1);
+
+	while ((n = fread(buf, 1, sizeof (buf), src)) != 0) {
+		if (fwrite(buf, 1, n, dst) != n)
+			return (-1);
+	}
+
+	return (ferror(src) ? -1 : 0);
+}
+
+static int
+jssnap_write(findjsobjects_state_t *fjs, const char *path, boolean_t verbose)
+{
+	jssnap_t jss;
+	jssnap_node_t *node;
+	findjsobjects_obj_t *obj;
+	findjsobjects_func_t *func;
+	findjsobjects_instance_t *inst;
+	long countoff;
+	size_t n = 0, i;
+	char *str, *end;
+	FILE *fp;
+	int rv = -1;
+
+	bzero(&jss, sizeof (jss));
+	jss.jss_fjs = fjs;
+
+	for (obj = fjs->fjs_objects; obj != NULL; obj = obj->fjso_next)
+		n += obj->fjso_ninstances;
+
+	for (func = fjs->fjs_funcs; func != NULL; func = func->fjsf_next)
+		n += func->fjsf_ninstances;
+
+	if (n >= INT32_MAX / JSSNAP_NODE_NFIELDS) {
+		mdb_warn("too many objects for a heap snapshot\n");
+		return (-1);
+	}
+
+	jss.jss_nodes = mdb_alloc(MAX(n, 1) * sizeof (jssnap_node_t),
+	    UM_SLEEP | UM_GC);
+	jss.jss_strb = mdbv8_strbuf_alloc(JSSNAP_MAXSTR, UM_SLEEP | UM_GC);
+
 	/*
-	 * First traverse over all objects and arrays, looking for references
-	 * to our designated referent(s).
+	 * The empty string comes first, for nodes and edges without a name.
 	 */
+	(void) jssnap_str(&jss, "");
+
 	for (obj = fjs->fjs_objects; obj != NULL; obj = obj->fjso_next) {
-		findjsobjects_instance_t *head = &obj->fjso_instances, *inst;
+		uint32_t name = jssnap_rawstr(&jss, obj->fjso_constructor[0] !=
+		    '\0' ? obj->fjso_constructor : "Object");
+		boolean_t array = obj->fjso_nprops != 0 &&
+		    obj->fjso_props == NULL;
+
+		for (inst = findjsobjects_obj_instances(fjs, obj);
+		    inst != NULL; inst = inst->fjsi_next, jss.jss_nnodes++) {
+			node = &jss.jss_nodes[jss.jss_nnodes];
+			node->jsn_addr = inst->fjsi_addr;
+			node->jsn_name = name;
+			node->jsn_type = JSSNAP_NODE_OBJECT;
+			node->jsn_array = array;
+		}
+	}
 
-		if (obj->fjso_nprops != 0 && obj->fjso_props == NULL) {
-			findjsobjects_references_array(fjs, obj);
-			continue;
+	for (func = fjs->fjs_funcs; func != NULL; func = func->fjsf_next) {
+		uint32_t name = jssnap_rawstr(&jss, func->fjsf_funcname);
+
+		for (inst = findjsobjects_func_instances(fjs, func);
+		    inst != NULL; inst = inst->fjsi_next, jss.jss_nnodes++) {
+			node = &jss.jss_nodes[jss.jss_nnodes];
+			node->jsn_addr = inst->fjsi_addr;
+			node->jsn_name = name;
+			node->jsn_type = JSSNAP_NODE_CLOSURE;
+			node->jsn_array = B_FALSE;
 		}
+	}
 
-		for (inst = head; inst != NULL; inst = inst->fjsi_next) {
-			fjs->fjs_addr = inst->fjsi_addr;
+	qsort(jss.jss_nodes, jss.jss_nnodes, sizeof (jssnap_node_t),
+	    findjsobjects_cmp_addr);
 
-			(void) jsobj_properties(inst->fjsi_addr,
-			    findjsobjects_references_prop, fjs, NULL);
-		}
+	if ((fp = fopen(path, "w")) == NULL) {
+		mdb_warn("failed to open \"%s\"", path);
+		jssnap_fini(&jss);
+		return (-1);
+	}
+
+	if ((jss.jss_edges = tmpfile()) == NULL ||
+	    (jss.jss_leaves = tmpfile()) == NULL) {
+		mdb_warn("failed to create temporary file");
+		goto out;
 	}
 
+	(void) setvbuf(fp, mdb_alloc(JSSNAP_BUFSZ, UM_SLEEP | UM_GC),
+	    _IOFBF, JSSNAP_BUFSZ);
+	(void) setvbuf(jss.jss_edges, mdb_alloc(JSSNAP_BUFSZ,
+	    UM_SLEEP | UM_GC), _IOFBF, JSSNAP_BUFSZ);
+	(void) setvbuf(jss.jss_leaves, mdb_alloc(JSSNAP_BUFSZ,
+	    UM_SLEEP | UM_GC), _IOFBF, JSSNAP_BUFSZ);
+
+	(void) fputs(jssnap_meta, fp);
+	(void) fputs("\"node_count\":", fp);
+	countoff = ftell(fp);
+	(void) fprintf(fp, "%*s,\"edge_count\":%*s,"
+	    "\"trace_function_count\":0},\n\"nodes\":[", JSSNAP_COUNTWIDTH, "",
+	    JSSNAP_COUNTWIDTH, "");
+
+	v8_silent++;
+
+	for (i = 0; i < jss.jss_nnodes; i++)
+		jssnap_object(&jss, &jss.jss_nodes[i], fp);
+
 	v8_silent--;
-	fjs->fjs_addr = NULL;
 
-	/*
-	 * Now go over our referent(s), reporting any references that we have
-	 * accumulated.
-	 */
-	for (referent = fjs->fjs_head; referent != NULL;
-	    referent = referent->fjsr_next) {
-		addr = referent->fjsr_addr;
+	if (jss.jss_strtab.fjst_full) {
+		mdb_warn("too many distinct strings for a heap snapshot\n");
+		(void) unlink(path);
+		goto out;
+	}
 
-		if ((reference = referent->fjsr_head) == NULL) {
-			mdb_printf("%p is not referred to by a "
-			    "known object.\n", addr);
-			continue;
+	if (jssnap_copy(jss.jss_leaves, fp) != 0)
+		goto err;
+
+	(void) fputs("],\n\"edges\":[", fp);
+
+	if (jssnap_copy(jss.jss_edges, fp) != 0)
+		goto err;
+
+	(void) fputs("],\n\"trace_function_infos\":[],\"trace_tree\":[],"
+	    "\"samples\":[],\"locations\":[],\n\"strings\":[", fp);
+
+	str = jss.jss_strtab.fjst_buf;
+	end = str + jss.jss_strtab.fjst_buflen;
+
+	for (i = 0; str < end; str += strlen(str) + 1, i++)
+		(void) fprintf(fp, "%s\"%s\"", i == 0 ? "" : ",\n", str);
+
+	(void) fputs("]}\n", fp);
+
+	if (countoff == -1 || fseek(fp, countoff, SEEK_SET) != 0 ||
+	    fprintf(fp, "%*llu,\"edge_count\":%*llu", JSSNAP_COUNTWIDTH,
+	    (u_longlong_t)(jss.jss_nnodes + jss.jss_nleaves), JSSNAP_COUNTWIDTH,
+	    (u_longlong_t)jss.jss_nedges) < 0 || fflush(fp) != 0 || ferror(fp))
+		goto err;
+
+	if (verbose) {
+		mdb_printf("wrote %llu nodes (%llu objects), %llu edges, "
+		    "%llu strings, %llu bytes of objects\n",
+		    (uint64_t)(jss.jss_nnodes + jss.jss_nleaves),
+		    (uint64_t)jss.jss_nnodes, jss.jss_nedges,
+		    (uint64_t)jss.jss_strtab.fjst_nstrs, jss.jss_nbytes);
+	}
+
+	rv = 0;
+	goto out;
+
+err:
+	mdb_warn("failed to write \"%s\"", path);
+	(void) unlink(path);
+
+out:
+	(void) fclose(fp);
+	jssnap_fini(&jss);
+	return (rv);
+}
+
+/* ARGSUSED */
+static int
+dcmd_jsheapsnapshot(uintptr_t addr, uint_t flags, int argc,
+    const mdb_arg_t *argv)
+{
+	findjsobjects_state_t *fjs = &findjsobjects_state;
+	boolean_t verbose = B_FALSE;
+	int i;
+
+	i = mdb_getopts(argc, argv,
+	    'v', MDB_OPT_SETBITS, B_TRUE, &verbose,
+	    NULL);
+
+	if (argc - i != 1 || argv[i].a_type != MDB_TYPE_STRING)
+		return (DCMD_USAGE);
+
+	fjs->fjs_verbose = verbose;
+
+	if (findjsobjects_run(fjs) != 0)
+		return (DCMD_ERR);
+
+	if (!fjs->fjs_finished) {
+		mdb_warn("cannot write a heap snapshot until the heap scan "
+		    "is complete\n");
+		return (DCMD_ERR);
+	}
+
+	return (jssnap_write(fjs, argv[i].a_un.a_str, verbose) == 0 ?
+	    DCMD_OK : DCMD_ERR);
+}
+
+static void
+dcmd_jsheapsnapshot_help(void)
+{
+	mdb_printf("%s\n\n",
+"Writes the objects found by ::findjsobjects (running it first if needed)\n"
+"and the references between them to FILE as a heap snapshot, which can be\n"
+"loaded into the Memory panel of Chrome DevTools.\n"
+"\n"
+"The snapshot includes each object, array and closure, the strings and\n"
+"numbers that they refer to, and their properties, elements and closure\n"
+"variables.  The sizes of objects include their out-of-object property and\n"
+"elements arrays, and strings are truncated to 1024 characters.  V8's own\n"
+"internal objects and roots are not included.\n"
+"\n"
+"The table of nodes (with the address of each) and the table of distinct\n"
+"strings stay in memory until the snapshot is complete; only the edges, and\n"
+"the records of nodes for strings and numbers, go through temporary files.\n"
+"So the memory used is proportional to the number of nodes plus the total\n"
+"size of the distinct strings, not to the number of references between\n"
+"them.  The string table is limited to 4 GB.");
+
+	mdb_dec_indent(2);
+	mdb_printf("%<b>OPTIONS%</b>\n");
+	mdb_inc_indent(2);
+
+	mdb_printf("%s\n",
+"  -v       Report statistics about the scan and the snapshot\n");
+}
+
+/*
+ * ::jsstrdups walks the heap (using the same machinery as ::findjsobjects, but
+ * with its own state, so that the results of ::findjsobjects are unaffected)
+ * looking for strings with the same contents.  Each string's contents are
+ * written through a small streaming buffer (see mdbv8_strbuf_setflush()) and
+ * hashed as they go by, so no string is ever copied in full, and ConsStrings
+ * are walked piece by piece (see v8string_write_pieces()) rather than being
+ * flattened.  Strings are grouped into values by the 64-bit hash of their
+ * contents (as UTF-8) and their length.  A string whose hash and length match
+ * those of a value is only counted with it once its contents have been
+ * compared with those of the value's first string.  For that, the first
+ * string's contents are collected into jsd_cmpbuf (and kept there, since the
+ * duplicates of a value are often found together), and the new string's
+ * contents are compared against them as they're streamed.
+ */
+#define	JSSTRDUPS_NDEFAULT	20
+#define	JSSTRDUPS_NBUCKETS	4096
+#define	JSSTRDUPS_BUFSZ		4096
+#define	JSSTRDUPS_VALUESZ	1024
+
+typedef struct jsstrdups_value {
+	uint64_t jsv_hash;			/* hash of contents */
+	size_t jsv_len;				/* length in characters */
+	uint64_t jsv_count;			/* number of strings */
+	uint64_t jsv_bytes;			/* total size of strings */
+	size_t jsv_maxsize;			/* size of largest string */
+	uintptr_t jsv_addr;			/* first string found */
+	struct jsstrdups_value *jsv_next;	/* next in hash bucket */
+} jsstrdups_value_t;
+
+typedef struct jsstrdups {
+	findjsobjects_state_t jsd_fjs;		/* heap scan state */
+	findjsobjects_arena_t jsd_arena;	/* jsstrdups_value_t's */
+	jsstrdups_value_t **jsd_buckets;	/* values by hash */
+	size_t jsd_nbuckets;			/* number of buckets */
+	uint64_t jsd_nvalues;			/* number of values */
+	mdbv8_strbuf_t *jsd_strb;		/* streaming buffer */
+	uint64_t jsd_hash;			/* hash of current string */
+	uint64_t jsd_nstrings;			/* strings hashed */
+	uint64_t jsd_nbytes;			/* total size of strings */
+	uint64_t jsd_nskipped;			/* strings not hashed */
+	enum {
+		JSSTRDUPS_HASH,			/* hash contents */
+		JSSTRDUPS_COLLECT,		/* copy into jsd_cmpbuf */
+		JSSTRDUPS_COMPARE		/* compare with jsd_cmpbuf */
+	} jsd_mode;				/* what flushing does */
+	uintptr_t jsd_cmpaddr;			/* string in jsd_cmpbuf */
+	char *jsd_cmpbuf;			/* contents of jsd_cmpaddr */
+	size_t jsd_cmpbufsz;			/* size of jsd_cmpbuf */
+	size_t jsd_cmplen;			/* bytes in jsd_cmpbuf */
+	size_t jsd_cmpoff;			/* bytes compared so far */
+	boolean_t jsd_cmpdiff;			/* contents differ */
+} jsstrdups_t;
+
+static jsstrdups_t jsstrdups_state;
+
+/*
+ * Free everything left over from a previous run, which may have been
+ * interrupted.
+ */
+static void
+jsstrdups_fini(jsstrdups_t *jsd)
+{
+	if (jsd->jsd_buckets != NULL) {
+		mdb_free(jsd->jsd_buckets,
+		    jsd->jsd_nbuckets * sizeof (jsstrdups_value_t *));
+	}
+
+	if (jsd->jsd_cmpbuf != NULL)
+		mdb_free(jsd->jsd_cmpbuf, jsd->jsd_cmpbufsz);
+
+	findjsobjects_arena_release(&jsd->jsd_arena);
+	mdbv8_strbuf_free(jsd->jsd_strb);
+	bzero(jsd, sizeof (*jsd));
+}
+
+static void
+jsstrdups_flush(void *arg, const char *buf, size_t len)
+{
+	jsstrdups_t *jsd = arg;
+	uint64_t hash = jsd->jsd_hash;
+	size_t i, bufsz;
+	char *newbuf;
+
+	switch (jsd->jsd_mode) {
+	case JSSTRDUPS_HASH:
+		for (i = 0; i < len; i++) {
+			hash ^= (uint8_t)buf[i];
+			hash *= 0x100000001b3ULL;
 		}
 
-		for (; reference != NULL; reference = reference->fjsrf_next) {
-			mdb_printf("%p referred to by %p",
-			    addr, reference->fjsrf_addr);
+		jsd->jsd_hash = hash;
+		break;
 
-			if (reference->fjsrf_desc == NULL) {
-				mdb_printf("[%d]\n", reference->fjsrf_index);
-			} else {
-				mdb_printf(".%s\n", reference->fjsrf_desc);
+	case JSSTRDUPS_COLLECT:
+		if (jsd->jsd_cmplen + len > jsd->jsd_cmpbufsz) {
+			bufsz = MAX(jsd->jsd_cmpbufsz, JSSTRDUPS_BUFSZ);
+
+			while (jsd->jsd_cmplen + len > bufsz)
+				bufsz *= 2;
+
+			newbuf = mdb_alloc(bufsz, UM_SLEEP);
+
+			if (jsd->jsd_cmpbuf != NULL) {
+				bcopy(jsd->jsd_cmpbuf, newbuf,
+				    jsd->jsd_cmplen);
+				mdb_free(jsd->jsd_cmpbuf, jsd->jsd_cmpbufsz);
 			}
+
+			jsd->jsd_cmpbuf = newbuf;
+			jsd->jsd_cmpbufsz = bufsz;
+		}
+
+		bcopy(buf, jsd->jsd_cmpbuf + jsd->jsd_cmplen, len);
+		jsd->jsd_cmplen += len;
+		break;
+
+	case JSSTRDUPS_COMPARE:
+		if (jsd->jsd_cmpdiff)
+			break;
+
+		if (len > jsd->jsd_cmplen - jsd->jsd_cmpoff ||
+		    bcmp(buf, jsd->jsd_cmpbuf + jsd->jsd_cmpoff, len) != 0) {
+			jsd->jsd_cmpdiff = B_TRUE;
+			break;
 		}
+
+		jsd->jsd_cmpoff += len;
+		break;
 	}
+}
 
-	/*
-	 * Finally, destroy our referent nodes.
-	 */
-	while ((referent = avl_destroy_nodes(referents, &cookie)) != NULL)
-		mdb_free(referent, sizeof (findjsobjects_referent_t));
+/*
+ * Stream the contents of the string at "addr" (as UTF-8) through jsd_strb, to
+ * be hashed, collected or compared according to jsd_mode.
+ */
+static int
+jsstrdups_write(jsstrdups_t *jsd, uintptr_t addr)
+{
+	v8string_t *strp;
+	int rv;
 
-	fjs->fjs_head = NULL;
-	fjs->fjs_tail = NULL;
+	if ((strp = v8string_load(addr, UM_SLEEP)) == NULL)
+		return (-1);
+
+	mdbv8_strbuf_rewind(jsd->jsd_strb);
+	rv = v8string_write_pieces(strp, jsd->jsd_strb, MSF_UTF8, JSSTR_NONE);
+	mdbv8_strbuf_flush(jsd->jsd_strb);
+	v8string_free(strp);
+
+	return (rv);
 }
 
-static findjsobjects_instance_t *
-findjsobjects_instance(findjsobjects_state_t *fjs, uintptr_t addr,
-    findjsobjects_instance_t **headp)
+/*
+ * Returns true if the string at "addr" has the same contents as the first
+ * string found with value "val".
+ */
+static boolean_t
+jsstrdups_same(jsstrdups_t *jsd, const jsstrdups_value_t *val, uintptr_t addr)
 {
-	findjsobjects_obj_t *obj;
+	boolean_t same;
 
-	for (obj = fjs->fjs_objects; obj != NULL; obj = obj->fjso_next) {
-		findjsobjects_instance_t *head = &obj->fjso_instances, *inst;
+	if (jsd->jsd_cmpaddr != val->jsv_addr) {
+		jsd->jsd_mode = JSSTRDUPS_COLLECT;
+		jsd->jsd_cmpaddr = 0;
+		jsd->jsd_cmplen = 0;
 
-		for (inst = head; inst != NULL; inst = inst->fjsi_next) {
-			if (inst->fjsi_addr == addr) {
-				*headp = head;
-				return (inst);
-			}
+		if (jsstrdups_write(jsd, val->jsv_addr) != 0) {
+			jsd->jsd_mode = JSSTRDUPS_HASH;
+			return (B_FALSE);
 		}
+
+		jsd->jsd_cmpaddr = val->jsv_addr;
 	}
 
-	return (NULL);
+	jsd->jsd_mode = JSSTRDUPS_COMPARE;
+	jsd->jsd_cmpoff = 0;
+	jsd->jsd_cmpdiff = B_FALSE;
+
+	same = jsstrdups_write(jsd, addr) == 0 && !jsd->jsd_cmpdiff &&
+	    jsd->jsd_cmpoff == jsd->jsd_cmplen;
+
+	jsd->jsd_mode = JSSTRDUPS_HASH;
+	return (same);
 }
 
-/*ARGSUSED*/
-static void
-findjsobjects_match_all(findjsobjects_obj_t *obj, const char *ignored)
+static jsstrdups_value_t **
+jsstrdups_bucket(jsstrdups_value_t **buckets, size_t nbuckets, uint64_t hash,
+    size_t len)
 {
-	mdb_printf("%p\n", obj->fjso_instances.fjsi_addr);
+	return (&buckets[findjsobjects_mix(hash, len) % nbuckets]);
 }
 
 static void
-findjsobjects_match_propname(findjsobjects_obj_t *obj, const char *propname)
+jsstrdups_rehash(jsstrdups_t *jsd)
 {
-	findjsobjects_prop_t *prop;
+	size_t nbuckets = jsd->jsd_nbuckets * 4, i;
+	jsstrdups_value_t **buckets, **bucket, *val, *next;
 
-	for (prop = obj->fjso_props; prop != NULL; prop = prop->fjsp_next) {
-		if (strcmp(prop->fjsp_desc, propname) == 0) {
-			mdb_printf("%p\n", obj->fjso_instances.fjsi_addr);
-			return;
+	buckets = mdb_zalloc(nbuckets * sizeof (jsstrdups_value_t *),
+	    UM_SLEEP);
+
+	for (i = 0; i < jsd->jsd_nbuckets; i++) {
+		for (val = jsd->jsd_buckets[i]; val != NULL; val = next) {
+			next = val->jsv_next;
+			bucket = jsstrdups_bucket(buckets, nbuckets,
+			    val->jsv_hash, val->jsv_len);
+			val->jsv_next = *bucket;
+			*bucket = val;
 		}
 	}
+
+	mdb_free(jsd->jsd_buckets,
+	    jsd->jsd_nbuckets * sizeof (jsstrdups_value_t *));
+	jsd->jsd_buckets = buckets;
+	jsd->jsd_nbuckets = nbuckets;
 }
 
+/*
+ * Hash the contents of the string at "addr" and record it with the other
+ * strings having the same value.
+ */
 static void
-findjsobjects_match_constructor(findjsobjects_obj_t *obj,
-    const char *constructor)
+jsstrdups_string(jsstrdups_t *jsd, uintptr_t addr, uint8_t type)
 {
-	if (strcmp(constructor, obj->fjso_constructor) == 0)
-		mdb_printf("%p\n", obj->fjso_instances.fjsi_addr);
+	jsstrdups_value_t *val, **bucket;
+	v8string_t *strp;
+	size_t size, len;
+
+	if (obj_size(addr, type, &size, UM_SLEEP) != 0 ||
+	    (strp = v8string_load(addr, UM_SLEEP)) == NULL) {
+		jsd->jsd_nskipped++;
+		return;
+	}
+
+	len = v8string_length(strp);
+	v8string_free(strp);
+	jsd->jsd_hash = 0xcbf29ce484222325ULL;
+
+	if (jsstrdups_write(jsd, addr) != 0) {
+		jsd->jsd_nskipped++;
+		return;
+	}
+
+	jsd->jsd_nstrings++;
+	jsd->jsd_nbytes += size;
+
+	bucket = jsstrdups_bucket(jsd->jsd_buckets, jsd->jsd_nbuckets,
+	    jsd->jsd_hash, len);
+
+	for (val = *bucket; val != NULL; val = val->jsv_next) {
+		if (val->jsv_hash == jsd->jsd_hash && val->jsv_len == len &&
+		    jsstrdups_same(jsd, val, addr))
+			break;
+	}
+
+	if (val == NULL) {
+		val = findjsobjects_arena_alloc(&jsd->jsd_arena,
+		    sizeof (jsstrdups_value_t));
+		val->jsv_hash = jsd->jsd_hash;
+		val->jsv_len = len;
+		val->jsv_addr = addr;
+		val->jsv_next = *bucket;
+		*bucket = val;
+
+		if (++jsd->jsd_nvalues > 2 * jsd->jsd_nbuckets)
+			jsstrdups_rehash(jsd);
+	}
+
+	val->jsv_count++;
+	val->jsv_bytes += size;
+	val->jsv_maxsize = MAX(val->jsv_maxsize, size);
+}
+
+/*
+ * The visitor for ::jsstrdups's heap scan.
+ */
+/* ARGSUSED */
+static void
+jsstrdups_visit(void *arg, uintptr_t addr, uintptr_t map, uint8_t type)
+{
+	jsstrdups_t *jsd = arg;
+
+	if (V8_TYPE_STRING(type)) {
+		jsd->jsd_fjs.fjs_stats.fjss_jsobjs++;
+		jsstrdups_string(jsd, addr, type);
+	}
+}
+
+/*
+ * Returns the number of bytes that would be saved if all of the strings with
+ * this value were replaced by a single copy (the largest of them).
+ */
+static uint64_t
+jsstrdups_saved(const jsstrdups_value_t *val)
+{
+	return (val->jsv_bytes - val->jsv_maxsize);
 }
 
 static void
-findjsobjects_match_kind(findjsobjects_obj_t *obj, const char *propkind)
+jsstrdups_print(const jsstrdups_value_t *val, boolean_t verbose)
 {
-	jspropinfo_t p = obj->fjso_propinfo;
+	char buf[JSSTRDUPS_VALUESZ];
+	mdbv8_strbuf_t strb;
+	v8string_t *strp;
+	int col = 2 * sizeof (uintptr_t) + 1 + 9 + 1 + 12 + 1 + 12 + 1;
 
-	if (((p & JPI_NUMERIC) != 0 && strstr(propkind, "numeric") != NULL) ||
-	    ((p & JPI_DICT) != 0 && strstr(propkind, "dict") != NULL) ||
-	    ((p & JPI_INOBJECT) != 0 && strstr(propkind, "inobject") != NULL) ||
-	    ((p & JPI_PROPS) != 0 && strstr(propkind, "props") != NULL) ||
-	    ((p & JPI_HASTRANSITIONS) != 0 &&
-	    strstr(propkind, "transitions") != NULL) ||
-	    ((p & JPI_HASCONTENT) != 0 &&
-	    strstr(propkind, "content") != NULL) ||
-	    ((p & JPI_SKIPPED) != 0 && strstr(propkind, "skipped") != NULL) ||
-	    ((p & JPI_UNDEFPROPNAME) != 0 &&
-	    strstr(propkind, "undefpropname") != NULL) ||
-	    ((p & JPI_BADPROPS) != 0 && strstr(propkind, "badprop") != NULL) ||
-	    ((p & JPI_BADLAYOUT) != 0 &&
-	    strstr(propkind, "badlayout") != NULL)) {
-		mdb_printf("%p\n", obj->fjso_instances.fjsi_addr);
+	mdbv8_strbuf_init(&strb, buf, verbose ? sizeof (buf) :
+	    MAX(80 - col, 16) + 1);
+
+	if ((strp = v8string_load(val->jsv_addr, UM_SLEEP)) == NULL) {
+		mdbv8_strbuf_sprintf(&strb, "<string (failed to load string)>");
+	} else {
+		mdbv8_strbuf_appendc(&strb, '"', MSF_JSON);
+		mdbv8_strbuf_reserve(&strb, 1);
+		(void) v8string_write_pieces(strp, &strb, MSF_JSON, JSSTR_NONE);
+		mdbv8_strbuf_reserve(&strb, -1);
+		mdbv8_strbuf_appendc(&strb, '"', MSF_JSON);
+		v8string_free(strp);
 	}
+
+	mdb_printf("%?p %9llu %12llu %12llu %s\n", val->jsv_addr,
+	    val->jsv_count, val->jsv_bytes, jsstrdups_saved(val),
+	    mdbv8_strbuf_tocstr(&strb));
 }
 
+/* ARGSUSED */
 static int
-findjsobjects_match(findjsobjects_state_t *fjs, uintptr_t addr,
-    uint_t flags, void (*func)(findjsobjects_obj_t *, const char *),
-    const char *match)
+dcmd_jsstrdups(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
 {
-	findjsobjects_obj_t *obj;
-
-	if (!(flags & DCMD_ADDRSPEC)) {
-		for (obj = fjs->fjs_objects; obj != NULL;
-		    obj = obj->fjso_next) {
-			if (obj->fjso_malformed && !fjs->fjs_allobjs)
-				continue;
+	jsstrdups_t *jsd = &jsstrdups_state;
+	jsstrdups_value_t *val, **vals;
+	boolean_t verbose = B_FALSE;
+	uintptr_t count = JSSTRDUPS_NDEFAULT;
+	uint64_t *keys, ndups = 0, wasted = 0;
+	size_t i, ntop = 0;
+	uint32_t *top;
 
-			func(obj, match);
-		}
+	if (mdb_getopts(argc, argv,
+	    'n', MDB_OPT_UINTPTR, &count,
+	    'v', MDB_OPT_SETBITS, B_TRUE, &verbose,
+	    NULL) != argc)
+		return (DCMD_USAGE);
 
-		return (DCMD_OK);
+	if (count == 0) {
+		mdb_warn("count must be at least 1\n");
+		return (DCMD_ERR);
 	}
 
-	/*
-	 * First, look for the specified address among the representative
-	 * objects.
-	 */
-	for (obj = fjs->fjs_objects; obj != NULL; obj = obj->fjso_next) {
-		if (obj->fjso_instances.fjsi_addr == addr) {
-			func(obj, match);
-			return (DCMD_OK);
-		}
+	jsstrdups_fini(jsd);
+	jsd->jsd_nbuckets = JSSTRDUPS_NBUCKETS;
+	jsd->jsd_buckets = mdb_zalloc(
+	    jsd->jsd_nbuckets * sizeof (jsstrdups_value_t *), UM_SLEEP);
+	jsd->jsd_strb = mdbv8_strbuf_alloc(JSSTRDUPS_BUFSZ, UM_SLEEP);
+	mdbv8_strbuf_setflush(jsd->jsd_strb, jsstrdups_flush, jsd);
+
+	if (findjsobjects_visit(&jsd->jsd_fjs, jsstrdups_visit, jsd) != 0) {
+		jsstrdups_fini(jsd);
+		return (DCMD_ERR);
 	}
 
 	/*
-	 * We didn't find it among the representative objects; iterate over
-	 * all objects.
+	 * Pick the values whose duplicates waste the most memory.
 	 */
-	for (obj = fjs->fjs_objects; obj != NULL; obj = obj->fjso_next) {
-		findjsobjects_instance_t *head = &obj->fjso_instances, *inst;
+	vals = mdb_alloc(MAX(jsd->jsd_nvalues, 1) *
+	    sizeof (jsstrdups_value_t *), UM_SLEEP | UM_GC);
+	keys = mdb_alloc(MAX(jsd->jsd_nvalues, 1) * sizeof (uint64_t),
+	    UM_SLEEP | UM_GC);
+	top = mdb_alloc(count * sizeof (uint32_t), UM_SLEEP | UM_GC);
+
+	for (i = 0; i < jsd->jsd_nbuckets; i++) {
+		for (val = jsd->jsd_buckets[i]; val != NULL;
+		    val = val->jsv_next) {
+			if (val->jsv_count < 2)
+				continue;
 
-		for (inst = head; inst != NULL; inst = inst->fjsi_next) {
-			if (inst->fjsi_addr == addr) {
-				func(obj, match);
-				return (DCMD_OK);
-			}
+			vals[ndups] = val;
+			keys[ndups] = jsstrdups_saved(val);
+			wasted += keys[ndups];
+			findjsobjects_topn(top, &ntop, count, keys,
+			    (uint32_t)ndups++);
 		}
 	}
 
-	mdb_warn("%p does not correspond to a known object\n", addr);
-	return (DCMD_ERR);
-}
-
-static void
-findjsobjects_print(findjsobjects_obj_t *obj)
-{
-	int col = 19 + (sizeof (uintptr_t) * 2) + strlen("..."), len;
-	uintptr_t addr = obj->fjso_instances.fjsi_addr;
-	findjsobjects_prop_t *prop;
+	if (flags & DCMD_PIPE_OUT) {
+		for (i = 0; i < ntop; i++)
+			mdb_printf("%p\n", vals[top[i]]->jsv_addr);
+	} else {
+		mdb_printf("%llu strings, %llu bytes; %llu distinct values, "
+		    "%llu duplicated, wasting %llu bytes\n", jsd->jsd_nstrings,
+		    jsd->jsd_nbytes, jsd->jsd_nvalues, ndups, wasted);
 
-	mdb_printf("%?p %8d %8d ",
-	    addr, obj->fjso_ninstances, obj->fjso_nprops);
+		if (jsd->jsd_nskipped != 0) {
+			mdb_printf("(%llu strings could not be read)\n",
+			    jsd->jsd_nskipped);
+		}
 
-	if (obj->fjso_constructor[0] != '\0') {
-		mdb_printf("%s%s", obj->fjso_constructor,
-		    obj->fjso_props != NULL ? ": " : "");
-		col += strlen(obj->fjso_constructor) + 2;
-	}
+		mdb_printf("\n%?s %9s %12s %12s %s\n", "ADDR", "COUNT",
+		    "BYTES", "SAVED", "VALUE");
 
-	for (prop = obj->fjso_props; prop != NULL; prop = prop->fjsp_next) {
-		if (col + (len = strlen(prop->fjsp_desc) + 2) < 80) {
-			mdb_printf("%s%s", prop->fjsp_desc,
-			    prop->fjsp_next != NULL ? ", " : "");
-			col += len;
-		} else {
-			mdb_printf("...");
-			break;
-		}
+		for (i = 0; i < ntop; i++)
+			jsstrdups_print(vals[top[i]], verbose);
 	}
 
-	mdb_printf("\n", col);
+	jsstrdups_fini(jsd);
+	return (DCMD_OK);
 }
 
 static void
-dcmd_findjsobjects_help(void)
+dcmd_jsstrdups_help(void)
 {
 	mdb_printf("%s\n\n",
-"Finds all JavaScript objects in the V8 heap via brute force iteration over\n"
-"all mapped anonymous memory.  (This can take up to several minutes on large\n"
-"dumps.)  The output consists of representative objects, the number of\n"
-"instances of that object and the number of properties on the object --\n"
-"followed by the constructor and first few properties of the objects.  Once\n"
-"run, subsequent calls to ::findjsobjects use cached data.  If provided an\n"
-"address (and in the absence of -r, described below), ::findjsobjects treats\n"
-"the address as that of a representative object, and lists all instances of\n"
-"that object (that is, all objects that have a matching property signature).");
+"Scans the heap for JavaScript strings with the same contents, and lists\n"
+"the values whose duplicates waste the most memory.  Programs that parse\n"
+"JSON or HTTP headers often keep many copies of the same strings alive.\n"
+"\n"
+"For each value, the output includes the address of one of the strings\n"
+"(which is emitted alone if the output is piped), the number of strings,\n"
+"their total size, the bytes that would be saved if they were interned\n"
+"(that is, all but the largest copy), and the value itself.  Sizes are of\n"
+"the strings' heap objects; for ConsStrings and SlicedStrings, which refer\n"
+"to other strings for their contents, that's just the header.\n"
+"\n"
+"Each string's contents are hashed as they're read, without making a copy,\n"
+"and ConsStrings are walked piece by piece rather than being flattened, so\n"
+"even very large strings can be compared.  Strings with the same length\n"
+"and the same 64-bit hash are then compared byte by byte, for which the\n"
+"contents of one string at a time are held in memory.  This scan is\n"
+"separate from that of ::findjsobjects, and like it can be interrupted\n"
+"with ^C.");
 
 	mdb_dec_indent(2);
 	mdb_printf("%<b>OPTIONS%</b>\n");
 	mdb_inc_indent(2);
 
 	mdb_printf("%s\n",
-"  -b       Include the heap denoted by the brk(2) (normally excluded)\n"
-"  -c cons  Display representative objects with the specified constructor\n"
-"  -p prop  Display representative objects that have the specified property\n"
-"  -l       List all objects that match the representative object\n"
-"  -m       Mark specified object for later reference determination via -r\n"
-"  -r       Find references to the specified and/or marked object(s)\n"
-"  -v       Provide verbose statistics\n");
+"  -n count List this many values (default: 20)\n"
+"  -v       Print values in full (up to 1024 bytes)\n");
 }
 
-static findjsobjects_state_t findjsobjects_state;
+/*
+ * ::jselements takes a census of the elements (the backing stores of
+ * numerically-named properties) of the objects and arrays found by
+ * ::findjsobjects.  Growing an array by pushing onto it leaves spare capacity
+ * that's never given back if the array later shrinks, arrays created with a
+ * length or written sparsely contain holes, and sparse enough arrays are
+ * stored as dictionaries instead.  For each object, we determine the
+ * capacity of its elements store, how much of it is in use (up to the length
+ * of an array, or the last element present for other objects), how many
+ * holes there are among the elements in use, and the number of bytes wasted
+ * by the unused capacity and the holes.
+ */
+#define	JSELEMENTS_NDEFAULT	20
+#define	JSELEMENTS_NBUCKETS	256
+#define	JSELEMENTS_CHUNK	4096
+#define	JSELEMENTS_NODDBALLS	8
+#define	JSELEMENTS_NKINDS	32
+
+typedef struct jselements_census {
+	uint64_t jsec_count;		/* number of objects */
+	uint64_t jsec_capacity;		/* total capacity (elements) */
+	uint64_t jsec_used;		/* total elements in use */
+	uint64_t jsec_holes;		/* total holes in use */
+	uint64_t jsec_wasted;		/* total bytes wasted */
+} jselements_census_t;
+
+typedef struct jselements_group {
+	const char *jseg_constructor;		/* constructor name */
+	const char *jseg_kind;			/* elements kind */
+	uintptr_t jseg_addr;			/* representative object */
+	jselements_census_t jseg_census;	/* totals */
+	struct jselements_group *jseg_next;	/* next in hash bucket */
+} jselements_group_t;
+
+typedef struct jselements_obj {
+	uintptr_t jseo_addr;			/* object */
+	const char *jseo_constructor;		/* constructor name */
+	const char *jseo_kind;			/* elements kind */
+	jselements_census_t jseo_census;	/* this object's elements */
+} jselements_obj_t;
+
+typedef struct jselements {
+	jselements_group_t *jse_buckets[JSELEMENTS_NBUCKETS];
+	size_t jse_ngroups;			/* number of groups */
+	jselements_obj_t *jse_top;		/* most wasteful objects */
+	size_t jse_ntop;			/* number of top objects */
+	size_t jse_maxtop;			/* size of jse_top */
+	jselements_census_t jse_total;		/* totals for all objects */
+	uintptr_t jse_hole;			/* the hole, once found */
+	uintptr_t jse_oddballs[JSELEMENTS_NODDBALLS];	/* not the hole */
+	uint_t jse_noddballs;			/* valid jse_oddballs */
+	char jse_kinds[JSELEMENTS_NKINDS][16];	/* names of other kinds */
+	uintptr_t *jse_chunk;			/* JSELEMENTS_CHUNK elements */
+} jselements_t;
 
-static int
-findjsobjects_run(findjsobjects_state_t *fjs)
+/*
+ * Returns true if "value" is the hole.  The hole is a singleton, so once
+ * we've found it we need only compare addresses; until then, we remember a
+ * few other oddballs (like undefined) so that we needn't examine them again.
+ */
+static boolean_t
+jselements_is_hole(jselements_t *jse, uintptr_t value)
 {
-	struct ps_prochandle *Pr;
-	findjsobjects_obj_t *obj;
-	findjsobjects_stats_t *stats = &fjs->fjs_stats;
+	uint8_t type;
+	uint_t i;
 
-	if (!fjs->fjs_initialized) {
-		avl_create(&fjs->fjs_tree,
-		    (int(*)(const void *, const void *))findjsobjects_cmp,
-		    sizeof (findjsobjects_obj_t),
-		    offsetof(findjsobjects_obj_t, fjso_node));
+	if (!V8_IS_HEAPOBJECT(value))
+		return (B_FALSE);
 
-		avl_create(&fjs->fjs_referents,
-		    (int(*)(const void *, const void *))
-		    findjsobjects_cmp_referents,
-		    sizeof (findjsobjects_referent_t),
-		    offsetof(findjsobjects_referent_t, fjsr_node));
+	if (jse->jse_hole != 0)
+		return (value == jse->jse_hole);
 
-		avl_create(&fjs->fjs_funcinfo,
-		    (int(*)(const void *, const void*))
-		    findjsobjects_cmp_funcinfo,
-		    sizeof (findjsobjects_func_t),
-		    offsetof(findjsobjects_func_t, fjsf_node));
+	for (i = 0; i < jse->jse_noddballs; i++) {
+		if (jse->jse_oddballs[i] == value)
+			return (B_FALSE);
+	}
 
-		fjs->fjs_initialized = B_TRUE;
+	if (read_typebyte(&type, value) != 0 || type != V8_TYPE_ODDBALL)
+		return (B_FALSE);
+
+	if (jsobj_is_hole(value)) {
+		jse->jse_hole = value;
+		return (B_TRUE);
 	}
 
-	if (avl_is_empty(&fjs->fjs_tree)) {
-		findjsobjects_obj_t **sorted;
-		int nobjs, i;
-		hrtime_t start = gethrtime();
+	if (jse->jse_noddballs < JSELEMENTS_NODDBALLS)
+		jse->jse_oddballs[jse->jse_noddballs++] = value;
 
-		if (mdb_get_xdata("pshandle", &Pr, sizeof (Pr)) == -1) {
-			mdb_warn("couldn't read pshandle xdata");
-			return (-1);
-		}
+	return (B_FALSE);
+}
 
-		v8_silent++;
+static const char *
+jselements_kind_name(jselements_t *jse, int kind)
+{
+	if (kind == -1 || kind >= JSELEMENTS_NKINDS)
+		return ("unknown");
 
-		if (Pmapping_iter(Pr,
-		    (proc_map_f *)findjsobjects_mapping, fjs) != 0) {
-			v8_silent--;
-			return (-1);
-		}
+	if (kind == V8_ELEMENTS_FAST_ELEMENTS)
+		return ("fast");
 
-		if ((nobjs = avl_numnodes(&fjs->fjs_tree)) != 0) {
-			/*
-			 * We have the objects -- now sort them.
-			 */
-			sorted = mdb_alloc(nobjs * sizeof (void *),
-			    UM_SLEEP | UM_GC);
+	if (kind == V8_ELEMENTS_FAST_HOLEY_ELEMENTS)
+		return ("holey");
 
-			for (obj = fjs->fjs_objects, i = 0; obj != NULL;
-			    obj = obj->fjso_next, i++) {
-				sorted[i] = obj;
-			}
+	if (kind == V8_ELEMENTS_DICTIONARY_ELEMENTS)
+		return ("dictionary");
 
-			qsort(sorted, avl_numnodes(&fjs->fjs_tree),
-			    sizeof (void *), findjsobjects_cmp_ninstances);
+	if (jse->jse_kinds[kind][0] == '\0') {
+		(void) mdb_snprintf(jse->jse_kinds[kind],
+		    sizeof (jse->jse_kinds[kind]), "kind %d", kind);
+	}
 
-			for (i = 1, fjs->fjs_objects = sorted[0];
-			    i < nobjs; i++)
-				sorted[i - 1]->fjso_next = sorted[i];
+	return (jse->jse_kinds[kind]);
+}
 
-			sorted[nobjs - 1]->fjso_next = NULL;
-		}
+/*
+ * Count the holes among the first "used" elements of the FixedArray at
+ * "elements", reading them a chunk at a time.  If "lastp" is non-NULL, the
+ * number of elements up to and including the last one that isn't a hole is
+ * returned there.
+ */
+static int
+jselements_holes(jselements_t *jse, uintptr_t elements, size_t used,
+    uint64_t *holesp, size_t *lastp)
+{
+	uintptr_t *buf = jse->jse_chunk;
+	size_t i, n, off;
 
-		fjs->fjs_finished = B_TRUE;
+	*holesp = 0;
 
-		v8_silent--;
+	if (lastp != NULL)
+		*lastp = 0;
 
-		if (fjs->fjs_verbose) {
-			const char *f = "findjsobjects: %30s => %d\n";
-			int elapsed = (int)((gethrtime() - start) / NANOSEC);
+	for (off = 0; off < used; off += n) {
+		n = MIN(used - off, JSELEMENTS_CHUNK);
 
-			mdb_printf(f, "elapsed time (seconds)", elapsed);
-			mdb_printf(f, "heap objects", stats->fjss_heapobjs);
-			mdb_printf(f, "type reads", stats->fjss_typereads);
-			mdb_printf(f, "cached reads", stats->fjss_cached);
-			mdb_printf(f, "JavaScript objects", stats->fjss_jsobjs);
-			mdb_printf(f, "processed objects", stats->fjss_objects);
-			mdb_printf(f, "possible garbage", stats->fjss_garbage);
-			mdb_printf(f, "processed arrays", stats->fjss_arrays);
-			mdb_printf(f, "unique objects", stats->fjss_uniques);
-			mdb_printf(f, "functions found", stats->fjss_funcs);
-			mdb_printf(f, "unique functions",
-			    stats->fjss_funcs_unique);
-			mdb_printf(f, "functions skipped",
-			    stats->fjss_funcs_skipped);
+		if (mdbv8_vread(buf, n * sizeof (uintptr_t), elements +
+		    V8_OFF_FIXEDARRAY_DATA + off * sizeof (uintptr_t)) == -1)
+			return (-1);
+
+		for (i = 0; i < n; i++) {
+			if (jselements_is_hole(jse, buf[i]))
+				(*holesp)++;
+			else if (lastp != NULL)
+				*lastp = off + i + 1;
 		}
 	}
 
 	return (0);
 }
 
+/*
+ * Take the census of the elements of the object at "addr".  Returns -1 if the
+ * object has no elements (or they can't be read).
+ */
 static int
-dcmd_findjsobjects(uintptr_t addr,
-    uint_t flags, int argc, const mdb_arg_t *argv)
-{
-	findjsobjects_state_t *fjs = &findjsobjects_state;
-	findjsobjects_obj_t *obj;
-	boolean_t references = B_FALSE, listlike = B_FALSE;
-	const char *propname = NULL;
-	const char *constructor = NULL;
-	const char *propkind = NULL;
+jselements_obj(jselements_t *jse, uintptr_t addr, jselements_census_t *census,
+    const char **kindp)
+{
+	uintptr_t elements, map, len, length, *dict;
+	size_t slotsz = sizeof (uintptr_t), used, nentries, i;
+	uint8_t type, etype, bit_field2;
+	boolean_t isarray;
+	int kind = -1;
+
+	bzero(census, sizeof (*census));
+
+	if (read_typebyte(&type, addr) != 0 ||
+	    (type != V8_TYPE_JSOBJECT && type != V8_TYPE_JSARRAY) ||
+	    read_heap_ptr(&elements, addr, V8_OFF_JSOBJECT_ELEMENTS) != 0 ||
+	    !V8_IS_HEAPOBJECT(elements) ||
+	    read_typebyte(&etype, elements) != 0 ||
+	    read_heap_smi(&len, elements, V8_OFF_FIXEDARRAY_LENGTH) != 0 ||
+	    len == 0)
+		return (-1);
 
-	fjs->fjs_verbose = B_FALSE;
-	fjs->fjs_brk = B_FALSE;
-	fjs->fjs_marking = B_FALSE;
-	fjs->fjs_allobjs = B_FALSE;
+	isarray = type == V8_TYPE_JSARRAY;
 
-	if (mdb_getopts(argc, argv,
-	    'a', MDB_OPT_SETBITS, B_TRUE, &fjs->fjs_allobjs,
-	    'b', MDB_OPT_SETBITS, B_TRUE, &fjs->fjs_brk,
-	    'c', MDB_OPT_STR, &constructor,
-	    'k', MDB_OPT_STR, &propkind,
-	    'l', MDB_OPT_SETBITS, B_TRUE, &listlike,
-	    'm', MDB_OPT_SETBITS, B_TRUE, &fjs->fjs_marking,
-	    'p', MDB_OPT_STR, &propname,
-	    'r', MDB_OPT_SETBITS, B_TRUE, &references,
-	    'v', MDB_OPT_SETBITS, B_TRUE, &fjs->fjs_verbose,
-	    NULL) != argc)
-		return (DCMD_USAGE);
+	if (V8_ELEMENTS_KIND_SHIFT != -1 &&
+	    read_heap_ptr(&map, addr, V8_OFF_HEAPOBJECT_MAP) == 0 &&
+	    read_heap_byte(&bit_field2, map, V8_OFF_MAP_BIT_FIELD2) == 0) {
+		kind = bit_field2 >> V8_ELEMENTS_KIND_SHIFT;
+		kind &= (1 << V8_ELEMENTS_KIND_BITCOUNT) - 1;
+	}
 
-	if (findjsobjects_run(fjs) != 0)
-		return (DCMD_ERR);
+	*kindp = jselements_kind_name(jse, kind);
+	census->jsec_count = 1;
 
-	if (!fjs->fjs_finished) {
-		mdb_warn("error: previous findjsobjects "
-		    "heap scan did not complete.\n");
-		return (DCMD_ERR);
-	}
+	if (etype != V8_TYPE_FIXEDARRAY) {
+		/*
+		 * This is a FixedDoubleArray.  Holes in these are NaNs with a
+		 * particular bit pattern that we don't know, so we don't count
+		 * them.
+		 */
+		if (etype != V8_TYPE_FIXEDDOUBLEARRAY)
+			return (-1);
 
-	if (listlike && !(flags & DCMD_ADDRSPEC)) {
-		if (propname != NULL || constructor != NULL ||
-		    propkind != NULL) {
-			char opt = propname != NULL ? 'p' :
-			    propkind != NULL ? 'k' :'c';
+		slotsz = sizeof (double);
+		used = len;
 
-			mdb_warn("cannot specify -l with -%c; instead, pipe "
-			    "output of ::findjsobjects -%c to "
-			    "::findjsobjects -l\n", opt, opt);
-			return (DCMD_ERR);
-		}
+		if (isarray && read_heap_smi(&length, addr,
+		    V8_OFF_JSARRAY_LENGTH) == 0)
+			used = MIN(length, len);
+	} else if (kind == V8_ELEMENTS_DICTIONARY_ELEMENTS) {
+		/*
+		 * The capacity of a dictionary is its number of entries, each
+		 * of which is in use if its key is a number rather than one of
+		 * the oddballs that mark empty and deleted entries.
+		 */
+		if (read_heap_array(elements, &dict, &len, UM_SLEEP) != 0)
+			return (-1);
 
-		return (findjsobjects_match(fjs, addr, flags,
-		    findjsobjects_match_all, NULL));
-	}
+		slotsz = V8_DICT_ENTRY_SIZE * sizeof (uintptr_t);
+		nentries = 0;
+		used = 0;
 
-	if (propname != NULL) {
-		if (constructor != NULL || propkind != NULL) {
-			mdb_warn("cannot specify both a property name "
-			    "and a %s\n", constructor != NULL ?
-			    "constructor" : "property kind");
-			return (DCMD_ERR);
+		for (i = V8_DICT_START_INDEX + V8_DICT_PREFIX_SIZE;
+		    i + V8_DICT_ENTRY_SIZE <= len; i += V8_DICT_ENTRY_SIZE) {
+			nentries++;
+
+			if (V8_IS_SMI(dict[i]) ||
+			    (read_typebyte(&etype, dict[i]) == 0 &&
+			    etype != V8_TYPE_ODDBALL))
+				used++;
 		}
 
-		return (findjsobjects_match(fjs, addr, flags,
-		    findjsobjects_match_propname, propname));
-	}
+		mdb_free(dict, len * sizeof (uintptr_t));
+		len = nentries;
+	} else if (isarray) {
+		if (read_heap_smi(&length, addr, V8_OFF_JSARRAY_LENGTH) != 0)
+			return (-1);
 
-	if (constructor != NULL) {
-		if (propkind != NULL) {
-			mdb_warn("cannot specify both a constructor name "
-			    "and a property kind\n");
-			return (DCMD_ERR);
-		}
+		used = MIN(length, len);
 
-		return (findjsobjects_match(fjs, addr, flags,
-		    findjsobjects_match_constructor, constructor));
-	}
+		if (kind != V8_ELEMENTS_FAST_ELEMENTS &&
+		    jselements_holes(jse, elements, used,
+		    &census->jsec_holes, NULL) != 0)
+			return (-1);
+	} else {
+		if (jselements_holes(jse, elements, len,
+		    &census->jsec_holes, &used) != 0)
+			return (-1);
 
-	if (propkind != NULL) {
-		return (findjsobjects_match(fjs, addr, flags,
-		    findjsobjects_match_kind, propkind));
+		census->jsec_holes -= len - used;
 	}
 
-	if (references && !(flags & DCMD_ADDRSPEC) &&
-	    avl_is_empty(&fjs->fjs_referents)) {
-		mdb_warn("must specify or mark an object to find references\n");
-		return (DCMD_ERR);
-	}
+	census->jsec_capacity = len;
+	census->jsec_used = used;
+	census->jsec_wasted = (len - used + census->jsec_holes) * slotsz;
 
-	if (fjs->fjs_marking && !(flags & DCMD_ADDRSPEC)) {
-		mdb_warn("must specify an object to mark\n");
-		return (DCMD_ERR);
-	}
+	return (0);
+}
 
-	if (references && fjs->fjs_marking) {
-		mdb_warn("can't both mark an object and find its references\n");
-		return (DCMD_ERR);
+static void
+jselements_add(jselements_census_t *total, const jselements_census_t *census)
+{
+	total->jsec_count += census->jsec_count;
+	total->jsec_capacity += census->jsec_capacity;
+	total->jsec_used += census->jsec_used;
+	total->jsec_holes += census->jsec_holes;
+	total->jsec_wasted += census->jsec_wasted;
+}
+
+static void
+jselements_group_add(jselements_t *jse, uintptr_t addr, const char *cons,
+    const char *kind, const jselements_census_t *census)
+{
+	jselements_group_t **bucket, *group;
+
+	bucket = &jse->jse_buckets[findjsobjects_mix(
+	    findjsobjects_strhash(cons), (uintptr_t)kind) %
+	    JSELEMENTS_NBUCKETS];
+
+	for (group = *bucket; group != NULL; group = group->jseg_next) {
+		if (group->jseg_kind == kind &&
+		    strcmp(group->jseg_constructor, cons) == 0)
+			break;
 	}
 
-	if (flags & DCMD_ADDRSPEC) {
-		findjsobjects_instance_t *inst, *head;
+	if (group == NULL) {
+		group = mdb_zalloc(sizeof (jselements_group_t),
+		    UM_SLEEP | UM_GC);
+		group->jseg_constructor = cons;
+		group->jseg_kind = kind;
+		group->jseg_addr = addr;
+		group->jseg_next = *bucket;
+		*bucket = group;
+		jse->jse_ngroups++;
+	}
 
-		/*
-		 * If we've been passed an address, it's to either list like
-		 * objects (-l), mark an object (-m) or find references to the
-		 * specified/marked objects (-r).  (Note that the absence of
-		 * any of these options implies -l.)
-		 */
-		inst = findjsobjects_instance(fjs, addr, &head);
+	jselements_add(&group->jseg_census, census);
+}
 
-		if (inst == NULL) {
-			mdb_warn("%p is not a valid object\n", addr);
-			return (DCMD_ERR);
-		}
+/*
+ * Insert an object into the list of the most wasteful objects, which is kept
+ * in descending order of bytes wasted, if it belongs there.
+ */
+static void
+jselements_top_add(jselements_t *jse, uintptr_t addr, const char *cons,
+    const char *kind, const jselements_census_t *census)
+{
+	jselements_obj_t *top = jse->jse_top;
+	size_t i = jse->jse_ntop;
 
-		if (!references && !fjs->fjs_marking) {
-			for (inst = head; inst != NULL; inst = inst->fjsi_next)
-				mdb_printf("%p\n", inst->fjsi_addr);
+	if (census->jsec_wasted == 0)
+		return;
 
-			return (DCMD_OK);
-		}
+	if (i == jse->jse_maxtop) {
+		if (census->jsec_wasted <= top[i - 1].jseo_census.jsec_wasted)
+			return;
 
-		if (!listlike) {
-			findjsobjects_referent(fjs, inst->fjsi_addr);
-		} else {
-			for (inst = head; inst != NULL; inst = inst->fjsi_next)
-				findjsobjects_referent(fjs, inst->fjsi_addr);
-		}
+		i--;
+	} else {
+		jse->jse_ntop++;
 	}
 
-	if (references)
-		findjsobjects_references(fjs);
-
-	if (references || fjs->fjs_marking)
-		return (DCMD_OK);
+	for (; i > 0 && top[i - 1].jseo_census.jsec_wasted <
+	    census->jsec_wasted; i--)
+		top[i] = top[i - 1];
 
-	mdb_printf("%?s %8s %8s %s\n", "OBJECT",
-	    "#OBJECTS", "#PROPS", "CONSTRUCTOR: PROPS");
+	top[i].jseo_addr = addr;
+	top[i].jseo_constructor = cons;
+	top[i].jseo_kind = kind;
+	top[i].jseo_census = *census;
+}
 
-	for (obj = fjs->fjs_objects; obj != NULL; obj = obj->fjso_next) {
-		if (obj->fjso_malformed && !fjs->fjs_allobjs)
-			continue;
+static int
+jselements_cmp_wasted(const void *l, const void *r)
+{
+	const jselements_group_t *lhs = *((const jselements_group_t **)l);
+	const jselements_group_t *rhs = *((const jselements_group_t **)r);
 
-		findjsobjects_print(obj);
+	if (lhs->jseg_census.jsec_wasted != rhs->jseg_census.jsec_wasted) {
+		return (lhs->jseg_census.jsec_wasted <
+		    rhs->jseg_census.jsec_wasted ? -1 : 1);
 	}
 
-	return (DCMD_OK);
+	return (strcmp(lhs->jseg_constructor, rhs->jseg_constructor));
+}
+
+static void
+jselements_print(uintptr_t addr, const jselements_census_t *census,
+    const char *kind, const char *cons)
+{
+	mdb_printf("%?p %8llu %10llu %10llu %8llu %12llu %-10s %s\n", addr,
+	    census->jsec_count, census->jsec_capacity, census->jsec_used,
+	    census->jsec_holes, census->jsec_wasted, kind,
+	    cons[0] != '\0' ? cons : "<unknown>");
 }
 
-/*
- * Given a Node Buffer object, print out details about it.  With "-a", just
- * print the address.
- */
 /* ARGSUSED */
 static int
-dcmd_nodebuffer(uintptr_t addr, uint_t flags, int argc,
-    const mdb_arg_t *argv)
+dcmd_jselements(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
 {
-	boolean_t opt_f = B_FALSE;
-	char buf[80];
-	char *bufp = buf;
-	size_t len = sizeof (buf);
-	uintptr_t elts, rawbuf;
-	uintptr_t arraybuffer_view_buffer;
-	uintptr_t arraybufferview_content_offset;
+	findjsobjects_state_t *fjs = &findjsobjects_state;
+	jselements_t *jse;
+	jselements_census_t census;
+	jselements_group_t **groups, *group;
+	findjsobjects_obj_t *obj;
+	findjsobjects_instance_t *inst;
+	uintptr_t count = JSELEMENTS_NDEFAULT;
+	const char *kind;
+	size_t i, j;
 
-	/*
-	 * The undocumented "-f" option allows users to override constructor
-	 * checks.
-	 */
 	if (mdb_getopts(argc, argv,
-	    'f', MDB_OPT_SETBITS, B_TRUE, &opt_f, NULL) != argc)
+	    'n', MDB_OPT_UINTPTR, &count,
+	    NULL) != argc)
 		return (DCMD_USAGE);
 
-	if (!opt_f) {
-		if (obj_jsconstructor(addr, &bufp, &len, B_FALSE) != 0)
-			return (DCMD_ERR);
-
-		if (strcmp(buf, "Buffer") != 0 &&
-		    strcmp(buf, "NativeBuffer") != 0 &&
-		    strcmp(buf, "Uint8Array") != 0) {
-			mdb_warn("%p does not appear to be a buffer\n", addr);
-			return (DCMD_ERR);
-		}
+	if (count == 0) {
+		mdb_warn("count must be at least 1\n");
+		return (DCMD_ERR);
 	}
 
-	if (strcmp(buf, "Buffer") == 0 ||
-	    strcmp(buf, "NativeBuffer") == 0 ||
-	    V8_OFF_JSARRAYBUFFER_BACKINGSTORE == -1) {
-		/*
-		 * This works for Buffer and NativeBuffer instances in node <
-		 * 4.0 because they use elements slots to reference the backing
-		 * storage. If the constructor name is not "Buffer" or
-		 * "NativeBuffer" but "Uint8Array" and
-		 * V8_OFF_JSARRAYBUFFER_BACKINGSTORE == -1, it means we are in
-		 * the range of node versions >= 4.0 and <= 4.1 that ship
-		 * with V8 4.5.x. For these versions, it also works because
-		 * Buffer instances are actually typed arrays but their backing
-		 * storage is an ExternalUint8Arrayelements whose address is
-		 * stored in the first element's slot.
-		 */
-		if (read_heap_ptr(&elts, addr, V8_OFF_JSOBJECT_ELEMENTS) != 0)
-			return (DCMD_ERR);
+	if (findjsobjects_run(fjs) != 0)
+		return (DCMD_ERR);
 
-		if (obj_v8internal(elts, 0, &rawbuf) != 0)
-			return (DCMD_ERR);
-	} else {
-		/*
-		 * The buffer instance's constructor name is Uint8Array, and
-		 * V8_OFF_JSARRAYBUFFER_BACKINGSTORE != -1, which means that
-		 * we're dealing with a node version that ships with V8 4.6 or
-		 * later. For these versions, buffer instances store their data
-		 * as a typed array, but this time instead of having the backing
-		 * store as an ExternalUint8Array referenced from an element
-		 * slot, it can be found at two different locations:
-		 *
-		 * 1. As a FixedTypedArray casted as a FixedTypedArrayBase in an
-		 * element slot.
-		 *
-		 * 2. As the "backing_store" property of the corresponding
-		 * JSArrayBuffer.
-		 *
-		 * The second way to retrieve the backing store seems like
-		 * it will be less likely to change, and is thus the one we're
-		 * using.
-		 */
-		if (V8_OFF_JSARRAYBUFFER_BACKINGSTORE == -1 ||
-		    V8_OFF_JSARRAYBUFFERVIEW_BUFFER == -1 ||
-		    V8_OFF_JSARRAYBUFFERVIEW_CONTENT_OFFSET == -1)
-			return (DCMD_ERR);
+	findjsobjects_partial(fjs);
 
-		if (read_heap_ptr(&arraybuffer_view_buffer, addr,
-		    V8_OFF_JSARRAYBUFFERVIEW_BUFFER) != 0)
-			return (DCMD_ERR);
+	jse = mdb_zalloc(sizeof (jselements_t), UM_SLEEP | UM_GC);
+	jse->jse_maxtop = count;
+	jse->jse_chunk = mdb_alloc(JSELEMENTS_CHUNK * sizeof (uintptr_t),
+	    UM_SLEEP | UM_GC);
+	jse->jse_top = mdb_zalloc(count * sizeof (jselements_obj_t),
+	    UM_SLEEP | UM_GC);
 
-		if (read_heap_ptr(&rawbuf, arraybuffer_view_buffer,
-		    V8_OFF_JSARRAYBUFFER_BACKINGSTORE) != 0)
-			return (DCMD_ERR);
+	v8_silent++;
 
-		if (read_heap_smi(&arraybufferview_content_offset, addr,
-		    V8_OFF_JSARRAYBUFFERVIEW_CONTENT_OFFSET) != 0)
-			return (DCMD_ERR);
+	for (obj = fjs->fjs_objects; obj != NULL; obj = obj->fjso_next) {
+		for (inst = findjsobjects_obj_instances(fjs, obj);
+		    inst != NULL; inst = inst->fjsi_next) {
+			if (jselements_obj(jse, inst->fjsi_addr, &census,
+			    &kind) != 0)
+				continue;
 
-		rawbuf += arraybufferview_content_offset;
+			jselements_add(&jse->jse_total, &census);
+			jselements_group_add(jse, inst->fjsi_addr,
+			    obj->fjso_constructor, kind, &census);
+			jselements_top_add(jse, inst->fjsi_addr,
+			    obj->fjso_constructor, kind, &census);
+		}
 	}
 
-	mdb_printf("%p\n", rawbuf);
-	return (DCMD_OK);
-}
+	v8_silent--;
 
-static int
-jsclosure_iter_var(v8scopeinfo_t *sip, v8scopeinfo_var_t *sivp, void *arg)
-{
-	v8context_t *ctxp = arg;
-	uintptr_t namep, valp;
-	size_t validx, bufsz;
-	char buf[1024];
-	char *bufp;
-	jsobj_print_t jsop;
+	if (flags & DCMD_PIPE_OUT) {
+		for (i = 0; i < jse->jse_ntop; i++)
+			mdb_printf("%p\n", jse->jse_top[i].jseo_addr);
 
-	bufp = buf;
-	bufsz = sizeof (buf);
-	(void) bsnprintf(&bufp, &bufsz, "    ");
-	namep = v8scopeinfo_var_name(sip, sivp);
-	if (jsstr_print(namep, JSSTR_QUOTED, &bufp, &bufsz) != 0) {
-		return (-1);
+		return (DCMD_OK);
 	}
 
-	validx = v8scopeinfo_var_idx(sip, sivp);
-	if (v8context_var_value(ctxp, validx, &valp) != 0) {
-		return (-1);
+	groups = mdb_alloc(MAX(jse->jse_ngroups, 1) *
+	    sizeof (jselements_group_t *), UM_SLEEP | UM_GC);
+
+	for (i = 0, j = 0; i < JSELEMENTS_NBUCKETS; i++) {
+		for (group = jse->jse_buckets[i]; group != NULL;
+		    group = group->jseg_next)
+			groups[j++] = group;
 	}
 
-	(void) bsnprintf(&bufp, &bufsz, ": ");
+	qsort(groups, jse->jse_ngroups, sizeof (jselements_group_t *),
+	    jselements_cmp_wasted);
 
-	bzero(&jsop, sizeof (jsop));
-	jsop.jsop_depth = 1;
-	jsop.jsop_bufp = &bufp;
-	jsop.jsop_lenp = &bufsz;
-	jsop.jsop_indent = 4;
-	jsop.jsop_printaddr = B_TRUE;
-	if (jsobj_print(valp, &jsop) != 0) {
-		return (-1);
+	mdb_printf("%?s %8s %10s %10s %8s %12s %-10s %s\n", "OBJECT",
+	    "#OBJECTS", "CAPACITY", "USED", "HOLES", "WASTED", "KIND",
+	    "CONSTRUCTOR");
+
+	for (i = 0; i < jse->jse_ngroups; i++) {
+		jselements_print(groups[i]->jseg_addr, &groups[i]->jseg_census,
+		    groups[i]->jseg_kind, groups[i]->jseg_constructor);
 	}
 
-	mdb_printf("%s\n", buf);
-	return (0);
+	mdb_printf("\n%llu objects with elements: capacity %llu, %llu used, "
+	    "%llu holes, %llu bytes wasted\n", jse->jse_total.jsec_count,
+	    jse->jse_total.jsec_capacity, jse->jse_total.jsec_used,
+	    jse->jse_total.jsec_holes, jse->jse_total.jsec_wasted);
+
+	if (jse->jse_ntop == 0)
+		return (DCMD_OK);
+
+	mdb_printf("\nmost wasteful objects:\n");
+	mdb_printf("%?s %8s %10s %10s %8s %12s %-10s %s\n", "OBJECT",
+	    "", "CAPACITY", "USED", "HOLES", "WASTED", "KIND",
+	    "CONSTRUCTOR");
+
+	for (i = 0; i < jse->jse_ntop; i++) {
+		jselements_print(jse->jse_top[i].jseo_addr,
+		    &jse->jse_top[i].jseo_census, jse->jse_top[i].jseo_kind,
+		    jse->jse_top[i].jseo_constructor);
+	}
+
+	return (DCMD_OK);
 }
 
-/* ARGSUSED */
-static int
-jsfunction_bound_arg(v8boundfunction_t *bfp, uint_t which, uintptr_t value,
-    void *unused)
+static void
+dcmd_jselements_help(void)
 {
-	char buf[80];
-	size_t len = sizeof (buf);
-	char *bufp;
+	mdb_printf("%s\n\n",
+"Takes a census of the elements (the storage for numerically-named\n"
+"properties) of the objects and arrays found by ::findjsobjects, running it\n"
+"first if needed, to show where memory is wasted by spare capacity and\n"
+"holes.\n"
+"\n"
+"Arrays that grow by push() get spare capacity that isn't given back when\n"
+"they shrink, arrays created with a length or written sparsely contain\n"
+"holes, and sparse enough arrays are stored as dictionaries.  For each\n"
+"object, CAPACITY is the number of elements that its store can hold, USED\n"
+"is the number in use (up to the length of an array, or the last element\n"
+"present for other objects), HOLES is the number of holes among those, and\n"
+"WASTED is the number of bytes taken by unused capacity and holes.  For\n"
+"dictionaries, capacity and use are counted in entries.  Holes in arrays of\n"
+"doubles are not counted.\n"
+"\n"
+"Objects are grouped by constructor and elements kind, in increasing order\n"
+"of bytes wasted, with a representative object for each group.  The most\n"
+"wasteful objects are then listed individually; if the output is piped,\n"
+"only their addresses are emitted.");
 
-	bufp = buf;
-	(void) obj_jstype(value, &bufp, &len, NULL);
+	mdb_dec_indent(2);
+	mdb_printf("%<b>OPTIONS%</b>\n");
+	mdb_inc_indent(2);
 
-	mdb_printf("      arg%d  = %p (%s)\n", which, value, buf);
-	return (0);
+	mdb_printf("%s\n",
+"  -n count List this many of the most wasteful objects (default: 20)\n");
 }
 
-/* ARGSUSED */
-static int
-dcmd_jsfunction(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+/*
+ * ::jsarraybuffers takes a census of the memory outside the V8 heap used by
+ * the backing stores of ArrayBuffers, typed arrays, and Node Buffers found by
+ * ::findjsobjects.  Typed arrays (including Buffers in newer versions of
+ * Node) are views of an ArrayBuffer, and many views may share the same
+ * ArrayBuffer (as Buffers allocated from Node's pool do), so each backing
+ * store is counted only once, for the first object found referring to it.
+ * Views are examined before ArrayBuffers so that stores are attributed to the
+ * more specific constructor.  An ArrayBuffer that has been detached (or
+ * neutered) has no backing store.
+ */
+#define	JSARRAYBUFFERS_NBUCKETS		4096
+#define	JSARRAYBUFFERS_NGROUPBUCKETS	256
+#define	JSARRAYBUFFERS_NSIZES		(sizeof (uintptr_t) * 8 + 1)
+
+typedef struct jsarraybuffers_census {
+	uint64_t jsac_nobjs;		/* objects referring to stores */
+	uint64_t jsac_nstores;		/* distinct backing stores */
+	uint64_t jsac_bytes;		/* bytes in those stores */
+} jsarraybuffers_census_t;
+
+typedef struct jsarraybuffers_store {
+	uintptr_t jsas_store;			/* backing store address */
+	struct jsarraybuffers_store *jsas_next;	/* next in hash bucket */
+} jsarraybuffers_store_t;
+
+typedef struct jsarraybuffers_group {
+	const char *jsag_constructor;		/* constructor name */
+	uintptr_t jsag_addr;			/* representative object */
+	jsarraybuffers_census_t jsag_census;	/* totals */
+	struct jsarraybuffers_group *jsag_next;	/* next in hash bucket */
+} jsarraybuffers_group_t;
+
+typedef struct jsarraybuffers {
+	jsarraybuffers_store_t *jsa_stores[JSARRAYBUFFERS_NBUCKETS];
+	jsarraybuffers_group_t *jsa_groups[JSARRAYBUFFERS_NGROUPBUCKETS];
+	size_t jsa_ngroups;			/* number of groups */
+	jsarraybuffers_census_t jsa_sizes[JSARRAYBUFFERS_NSIZES];
+	jsarraybuffers_census_t jsa_attached;	/* objects with a store */
+	jsarraybuffers_census_t jsa_detached;	/* objects without a store */
+	boolean_t jsa_pipe;			/* print addresses only */
+} jsarraybuffers_t;
+
+/*
+ * Returns the index of the size bucket for "size": bucket 0 holds empty
+ * stores, and bucket i holds stores of at least 2^(i-1) bytes and less than
+ * 2^i bytes.
+ */
+static uint_t
+jsarraybuffers_sizebucket(uintptr_t size)
 {
-	v8function_t *fp = NULL;
-	v8funcinfo_t *fip = NULL;
-	v8boundfunction_t *bfp = NULL;
-	mdbv8_strbuf_t *strb = NULL;
-	int memflags = UM_SLEEP | UM_GC;
-	int rv = DCMD_ERR;
-	char buf[80];
-	size_t len = sizeof (buf);
-	char *bufp;
+	uint_t i;
 
-	/*
-	 * Bound functions are separate from other functions.  The regular
-	 * function APIs may not work on them, depending on the Node version.
-	 * Handle them first.
-	 * TODO the API here doesn't really allow you to distinguish between
-	 * something like memory allocation failure and bad input (e.g., not a
-	 * bound function).  It was written assuming you would know what type
-	 * you expected something to be, but this is one of the first cases
-	 * where we don't.
-	 */
-	if ((bfp = v8boundfunction_load(addr, memflags)) != NULL) {
-		uintptr_t thisp;
+	for (i = 0; size != 0; i++)
+		size >>= 1;
 
-		mdb_printf("bound function that wraps: %p\n",
-		    v8boundfunction_target(bfp));
-		thisp = v8boundfunction_this(bfp);
-		bufp = buf;
-		(void) obj_jstype(thisp, &bufp, &len, NULL);
-		mdb_printf("with \"this\" = %p (%s)\n", thisp, buf);
-		rv = v8boundfunction_iter_args(bfp, jsfunction_bound_arg, NULL);
-		v8boundfunction_free(bfp);
-		return (rv);
-	}
+	return (i);
+}
 
-	v8_warnings++;
-	if ((fp = v8function_load(addr, memflags)) == NULL ||
-	    (fip = v8function_funcinfo(fp, memflags)) == NULL ||
-	    (strb = mdbv8_strbuf_alloc(512, memflags)) == NULL) {
-		goto out;
-	}
+/*
+ * Returns true if we've already seen the backing store at "store", recording
+ * it if not.
+ */
+static boolean_t
+jsarraybuffers_seen(jsarraybuffers_t *jsa, uintptr_t store)
+{
+	jsarraybuffers_store_t **bucket, *sp;
 
-	mdbv8_strbuf_sprintf(strb, "function: ");
+	bucket = &jsa->jsa_stores[findjsobjects_mix(0, store) %
+	    JSARRAYBUFFERS_NBUCKETS];
 
-	if (v8funcinfo_funcname(fip, strb, MSF_ASCIIONLY) != 0) {
-		goto out;
+	for (sp = *bucket; sp != NULL; sp = sp->jsas_next) {
+		if (sp->jsas_store == store)
+			return (B_TRUE);
 	}
 
-	mdbv8_strbuf_sprintf(strb, "\ndefined at ");
-	(void) v8funcinfo_scriptpath(fip, strb, MSF_ASCIIONLY);
-	mdbv8_strbuf_sprintf(strb, " ");
-	(void) v8funcinfo_definition_location(fip, strb, MSF_ASCIIONLY);
-	mdb_printf("%s\n", mdbv8_strbuf_tocstr(strb));
-	rv = DCMD_OK;
+	sp = mdb_alloc(sizeof (jsarraybuffers_store_t), UM_SLEEP | UM_GC);
+	sp->jsas_store = store;
+	sp->jsas_next = *bucket;
+	*bucket = sp;
 
-out:
-	v8funcinfo_free(fip);
-	v8function_free(fp);
-	mdbv8_strbuf_free(strb);
-	v8_warnings--;
-	return (rv);
+	return (B_FALSE);
 }
 
-static int
-jsarray_print_one(v8array_t *ap, unsigned int index, uintptr_t value,
-    void *uarg)
+static jsarraybuffers_group_t *
+jsarraybuffers_group(jsarraybuffers_t *jsa, uintptr_t addr, const char *cons)
 {
-	boolean_t *opt_i = uarg;
+	jsarraybuffers_group_t **bucket, *group;
 
-	if (*opt_i) {
-		mdb_printf("%d ", index);
+	bucket = &jsa->jsa_groups[findjsobjects_strhash(cons) %
+	    JSARRAYBUFFERS_NGROUPBUCKETS];
+
+	for (group = *bucket; group != NULL; group = group->jsag_next) {
+		if (strcmp(group->jsag_constructor, cons) == 0)
+			return (group);
 	}
 
-	mdb_printf("%p\n", value);
-	return (0);
+	group = mdb_zalloc(sizeof (jsarraybuffers_group_t), UM_SLEEP | UM_GC);
+	group->jsag_constructor = cons;
+	group->jsag_addr = addr;
+	group->jsag_next = *bucket;
+	*bucket = group;
+	jsa->jsa_ngroups++;
+
+	return (group);
 }
 
-/* ARGSUSED */
-static int
-dcmd_jsarray(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+/*
+ * Account for the object at "addr", whose backing store is at "store" (or
+ * NULL, if it has none) and is "size" bytes long.
+ */
+static void
+jsarraybuffers_add(jsarraybuffers_t *jsa, uintptr_t addr, const char *cons,
+    uintptr_t store, uintptr_t size)
 {
-	v8array_t *ap;
-	int memflags = UM_SLEEP | UM_GC;
-	boolean_t opt_i = B_FALSE;
-	int rv;
+	jsarraybuffers_group_t *group;
+	jsarraybuffers_census_t *state, *sizes;
 
-	if (mdb_getopts(argc, argv, 'i', MDB_OPT_SETBITS, B_TRUE, &opt_i,
-	    NULL) != argc) {
-		return (DCMD_USAGE);
-	}
+	group = jsarraybuffers_group(jsa, addr, cons);
+	group->jsag_census.jsac_nobjs++;
 
-	if ((ap = v8array_load(addr, memflags)) == NULL) {
-		mdb_warn("%p: failed to load JSArray\n", addr);
-		return (DCMD_ERR);
+	if (store == 0) {
+		jsa->jsa_detached.jsac_nobjs++;
+		return;
 	}
 
-	rv = v8array_iter_elements(ap, jsarray_print_one, &opt_i);
-	v8array_free(ap);
-	return (rv == 0 ? DCMD_OK : DCMD_ERR);
+	state = &jsa->jsa_attached;
+	state->jsac_nobjs++;
+
+	if (jsarraybuffers_seen(jsa, store))
+		return;
+
+	sizes = &jsa->jsa_sizes[jsarraybuffers_sizebucket(size)];
+	sizes->jsac_nobjs++;
+	sizes->jsac_nstores++;
+	sizes->jsac_bytes += size;
+
+	group->jsag_census.jsac_nstores++;
+	group->jsag_census.jsac_bytes += size;
+	state->jsac_nstores++;
+	state->jsac_bytes += size;
+
+	if (jsa->jsa_pipe)
+		mdb_printf("%p\n", addr);
 }
 
-/* ARGSUSED */
-static int
-dcmd_jsclosure(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+/*
+ * Examine the objects of one shape found by ::findjsobjects.  Views (typed
+ * arrays, including Buffers) are examined if "views" is set, and ArrayBuffers
+ * otherwise.  The Buffers of older versions of Node were plain JSObjects, but
+ * those versions predate JSArrayBuffer::backing_store, without which
+ * ::jsarraybuffers doesn't run at all.
+ */
+static void
+jsarraybuffers_obj(findjsobjects_state_t *fjs, jsarraybuffers_t *jsa,
+    findjsobjects_obj_t *obj, boolean_t views)
 {
-	v8function_t *funcp;
-	v8context_t *ctxp;
-	v8scopeinfo_t *sip;
-	int memflags = UM_SLEEP | UM_GC;
+	findjsobjects_instance_t *inst;
+	const char *cons = obj->fjso_constructor;
+	uintptr_t addr = obj->fjso_instances.fjsi_addr;
+	uintptr_t store, offset, size;
+	uint8_t type;
+
+	/*
+	 * All instances of a shape have the same type.
+	 */
+	if (read_typebyte(&type, addr) != 0)
+		return;
 
-	if ((funcp = v8function_load(addr, memflags)) == NULL) {
-		mdb_warn("%p: failed to load JSFunction\n", addr);
-		return (DCMD_ERR);
-	}
+	if (type != (views ? V8_TYPE_JSTYPEDARRAY : V8_TYPE_JSARRAYBUFFER))
+		return;
 
-	if ((ctxp = v8function_context(funcp, memflags)) == NULL) {
-		mdb_warn("%p: failed to load Context for JSFunction\n", addr);
-		return (DCMD_ERR);
-	}
+	for (inst = findjsobjects_obj_instances(fjs, obj);
+	    inst != NULL; inst = inst->fjsi_next) {
+		addr = inst->fjsi_addr;
 
-	if ((sip = v8context_scopeinfo(ctxp, memflags)) == NULL) {
-		mdb_warn("%p: failed to load ScopeInfo\n", addr);
-		return (DCMD_ERR);
+		if (!views) {
+			if (read_heap_ptr(&store, addr,
+			    V8_OFF_JSARRAYBUFFER_BACKINGSTORE) != 0)
+				continue;
+
+			if (jsarraybuffer_length(addr, &size) != 0)
+				size = 0;
+		} else if (nodebuffer_data(addr, B_TRUE, &store, &offset,
+		    &size) != 0) {
+			continue;
+		}
+
+		jsarraybuffers_add(jsa, addr, cons, store, size);
 	}
+}
 
-	if (v8scopeinfo_iter_vars(sip, V8SV_CONTEXTLOCALS,
-	    jsclosure_iter_var, ctxp) != 0) {
-		mdb_warn("%p: failed to iterate closure variables\n", addr);
-		return (DCMD_ERR);
+static int
+jsarraybuffers_cmp_bytes(const void *l, const void *r)
+{
+	const jsarraybuffers_group_t *lhs =
+	    *((const jsarraybuffers_group_t **)l);
+	const jsarraybuffers_group_t *rhs =
+	    *((const jsarraybuffers_group_t **)r);
+
+	if (lhs->jsag_census.jsac_bytes != rhs->jsag_census.jsac_bytes) {
+		return (lhs->jsag_census.jsac_bytes <
+		    rhs->jsag_census.jsac_bytes ? -1 : 1);
 	}
 
-	return (DCMD_OK);
+	return (strcmp(lhs->jsag_constructor, rhs->jsag_constructor));
 }
 
+static void
+jsarraybuffers_print(const char *label, const jsarraybuffers_census_t *census)
+{
+	mdb_printf("%-10s %8llu %8llu %14llu\n", label, census->jsac_nobjs,
+	    census->jsac_nstores, census->jsac_bytes);
+}
 
 /* ARGSUSED */
 static int
-dcmd_jsconstructor(uintptr_t addr, uint_t flags, int argc,
+dcmd_jsarraybuffers(uintptr_t addr, uint_t flags, int argc,
     const mdb_arg_t *argv)
 {
-	boolean_t opt_v = B_FALSE;
-	char buf[80];
-	char *bufp;
-	size_t len = sizeof (buf);
+	findjsobjects_state_t *fjs = &findjsobjects_state;
+	jsarraybuffers_t *jsa;
+	jsarraybuffers_group_t **groups, *group;
+	jsarraybuffers_census_t *census;
+	findjsobjects_obj_t *obj;
+	uintptr_t shared;
+	size_t i, j;
 
-	if (mdb_getopts(argc, argv, 'v', MDB_OPT_SETBITS, B_TRUE, &opt_v,
-	    NULL) != argc)
+	if (mdb_getopts(argc, argv, NULL) != argc)
 		return (DCMD_USAGE);
 
-	bufp = buf;
-	if (obj_jsconstructor(addr, &bufp, &len, opt_v))
+	if (V8_OFF_JSARRAYBUFFER_BACKINGSTORE == -1 ||
+	    V8_TYPE_JSARRAYBUFFER == -1) {
+		mdb_warn("ArrayBuffers are not supported for this version "
+		    "of V8\n");
 		return (DCMD_ERR);
+	}
 
-	mdb_printf("%s\n", buf);
-	return (DCMD_OK);
-}
+	if (findjsobjects_run(fjs) != 0)
+		return (DCMD_ERR);
 
-/* ARGSUSED */
-static int
-dcmd_jsframe(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
-{
-	uintptr_t fptr, raddr;
-	boolean_t opt_i = B_FALSE;
-	jsframe_t jsf;
-	int rv;
+	findjsobjects_partial(fjs);
 
-	bzero(&jsf, sizeof (jsf));
-	jsf.jsf_nlines = 5;
+	jsa = mdb_zalloc(sizeof (jsarraybuffers_t), UM_SLEEP | UM_GC);
+	jsa->jsa_pipe = (flags & DCMD_PIPE_OUT) != 0;
 
-	if (mdb_getopts(argc, argv,
-	    'a', MDB_OPT_SETBITS, B_TRUE, &jsf.jsf_showall,
-	    'v', MDB_OPT_SETBITS, B_TRUE, &jsf.jsf_verbose,
-	    'i', MDB_OPT_SETBITS, B_TRUE, &opt_i,
-	    'f', MDB_OPT_STR, &jsf.jsf_func,
-	    'n', MDB_OPT_UINTPTR, &jsf.jsf_nlines,
-	    'p', MDB_OPT_STR, &jsf.jsf_prop, NULL) != argc)
-		return (DCMD_USAGE);
+	v8_silent++;
 
-	/*
-	 * As with $C, we assume we are given a *pointer* to the frame pointer
-	 * for a frame, rather than the actual frame pointer for the frame of
-	 * interest. This is needed to show the instruction pointer, which is
-	 * actually stored with the next frame.  For debugging, this can be
-	 * overridden with the "-i" option (for "immediate").
-	 */
-	if (opt_i) {
-		rv = do_jsframe(addr, 0, &jsf);
-		if (rv == 0)
-			jsframe_print_skipped(&jsf);
-		return (rv);
+	for (obj = fjs->fjs_objects; obj != NULL; obj = obj->fjso_next)
+		jsarraybuffers_obj(fjs, jsa, obj, B_TRUE);
+
+	for (obj = fjs->fjs_objects; obj != NULL; obj = obj->fjso_next)
+		jsarraybuffers_obj(fjs, jsa, obj, B_FALSE);
+
+	v8_silent--;
+
+	if (jsa->jsa_pipe)
+		return (DCMD_OK);
+
+	groups = mdb_alloc(MAX(jsa->jsa_ngroups, 1) *
+	    sizeof (jsarraybuffers_group_t *), UM_SLEEP | UM_GC);
+
+	for (i = 0, j = 0; i < JSARRAYBUFFERS_NGROUPBUCKETS; i++) {
+		for (group = jsa->jsa_groups[i]; group != NULL;
+		    group = group->jsag_next)
+			groups[j++] = group;
 	}
 
-	if (mdb_vread(&raddr, sizeof (raddr),
-	    addr + sizeof (uintptr_t)) == -1) {
-		mdb_warn("failed to read return address from %p",
-		    addr + sizeof (uintptr_t));
-		return (DCMD_ERR);
+	qsort(groups, jsa->jsa_ngroups, sizeof (jsarraybuffers_group_t *),
+	    jsarraybuffers_cmp_bytes);
+
+	mdb_printf("%?s %8s %8s %14s %s\n", "OBJECT", "#OBJECTS", "#STORES",
+	    "BYTES", "CONSTRUCTOR");
+
+	for (i = 0; i < jsa->jsa_ngroups; i++) {
+		census = &groups[i]->jsag_census;
+		mdb_printf("%?p %8llu %8llu %14llu %s\n", groups[i]->jsag_addr,
+		    census->jsac_nobjs, census->jsac_nstores,
+		    census->jsac_bytes, groups[i]->jsag_constructor[0] != '\0' ?
+		    groups[i]->jsag_constructor : "<unknown>");
 	}
 
-	if (mdb_vread(&fptr, sizeof (fptr), addr) == -1) {
-		mdb_warn("failed to read frame pointer from %p", addr);
-		return (DCMD_ERR);
+	mdb_printf("\n%14s %14s %8s %14s\n", "MINSIZE", "MAXSIZE", "#STORES",
+	    "BYTES");
+
+	for (i = 0; i < JSARRAYBUFFERS_NSIZES; i++) {
+		census = &jsa->jsa_sizes[i];
+
+		if (census->jsac_nstores == 0)
+			continue;
+
+		mdb_printf("%14llu %14llu %8llu %14llu\n",
+		    i == 0 ? 0 : (uint64_t)1 << (i - 1),
+		    i == 0 ? 0 : ((uint64_t)1 << (i - 1)) * 2 - 1,
+		    census->jsac_nstores, census->jsac_bytes);
 	}
 
-	if (fptr == NULL)
-		return (DCMD_OK);
+	mdb_printf("\n%-10s %8s %8s %14s\n", "STATE", "#OBJECTS", "#STORES",
+	    "BYTES");
+	jsarraybuffers_print("attached", &jsa->jsa_attached);
+	jsarraybuffers_print("detached", &jsa->jsa_detached);
 
-	rv = do_jsframe(fptr, raddr, &jsf);
-	if (rv == 0)
-		jsframe_print_skipped(&jsf);
-	return (rv);
+	shared = jsa->jsa_attached.jsac_nobjs - jsa->jsa_attached.jsac_nstores;
+	mdb_printf("\n%llu objects refer to %llu backing stores "
+	    "(%llu references shared), %llu external bytes\n",
+	    jsa->jsa_attached.jsac_nobjs + jsa->jsa_detached.jsac_nobjs,
+	    jsa->jsa_attached.jsac_nstores, (uint64_t)shared,
+	    jsa->jsa_attached.jsac_bytes);
+
+	return (DCMD_OK);
 }
 
 static void
-jsobj_print_propinfo(jspropinfo_t propinfo)
+dcmd_jsarraybuffers_help(void)
 {
-	if (propinfo == JPI_NONE)
-		return;
+	mdb_printf("%s\n",
+"Takes a census of the memory outside the V8 heap used for the backing\n"
+"stores of the ArrayBuffers, typed arrays, and Node Buffers found by\n"
+"::findjsobjects, running it first if needed.  Backing stores are found as\n"
+"for ::nodebuffer.  Each store is counted once, no matter how many objects\n"
+"refer to it, and is attributed to the first object found that refers to it,\n"
+"preferring typed arrays and Buffers over ArrayBuffers.\n"
+"\n"
+"External bytes are reported by constructor, with a representative object\n"
+"for each, in increasing order of bytes; by size, in power-of-two ranges;\n"
+"and by whether objects' ArrayBuffers are attached, or have been detached\n"
+"(neutered) and no longer have a backing store.  Empty ArrayBuffers that\n"
+"never had a backing store are counted as detached.\n"
+"\n"
+"If the output is piped, the address of the first object found referring to\n"
+"each backing store is emitted instead.\n");
+}
 
-	mdb_printf("property kind: ");
-	if ((propinfo & JPI_NUMERIC) != 0)
-		mdb_printf("numeric-named ");
-	if ((propinfo & JPI_DICT) != 0)
-		mdb_printf("dictionary ");
-	if ((propinfo & JPI_INOBJECT) != 0)
-		mdb_printf("in-object ");
-	if ((propinfo & JPI_PROPS) != 0)
-		mdb_printf("\"properties\" array ");
-	mdb_printf("\n");
+/*
+ * ::jslargest walks the heap (like ::jsstrdups, with its own scan state) and
+ * reports the individual objects with the largest shallow sizes.  For
+ * JavaScript objects, that's as reported by "::findjsobjects -s bytes": the
+ * object itself, its out-of-object properties and its elements, and for typed
+ * arrays, the data they cover.  For strings, it's the string object,
+ * including the characters of sequential strings and the external contents of
+ * external strings.  Only the largest objects are kept, in a min-heap ordered
+ * by size, so the memory used depends only on the number requested.
+ */
+#define	JSLARGEST_NDEFAULT	50
+
+typedef struct jslargest_obj {
+	uintptr_t jslo_addr;			/* object */
+	size_t jslo_size;			/* shallow size */
+	uint8_t jslo_type;			/* V8 type */
+} jslargest_obj_t;
+
+typedef struct jslargest {
+	findjsobjects_state_t jsl_fjs;		/* heap scan state */
+	jslargest_obj_t *jsl_heap;		/* min-heap of largest */
+	size_t jsl_nheap;			/* entries in jsl_heap */
+	size_t jsl_maxheap;			/* capacity of jsl_heap */
+	uint64_t jsl_nobjs;			/* objects examined */
+	uint64_t jsl_nbytes;			/* total size of objects */
+	uint64_t jsl_nskipped;			/* objects not sized */
+} jslargest_t;
+
+static jslargest_t jslargest_state;
 
-	if ((propinfo & (JPI_HASTRANSITIONS | JPI_HASCONTENT)) != 0) {
-		mdb_printf("fallbacks: ");
-		if ((propinfo & JPI_HASTRANSITIONS) != 0)
-			mdb_printf("transitions ");
-		if ((propinfo & JPI_HASCONTENT) != 0)
-			mdb_printf("content ");
-		mdb_printf("\n");
+/*
+ * Free everything left over from a previous run, which may have been
+ * interrupted.
+ */
+static void
+jslargest_fini(jslargest_t *jsl)
+{
+	if (jsl->jsl_heap != NULL) {
+		mdb_free(jsl->jsl_heap,
+		    jsl->jsl_maxheap * sizeof (jslargest_obj_t));
 	}
 
-	if ((propinfo & JPI_UNDEFPROPNAME) != 0)
-		mdb_printf(
-		    "some properties skipped due to undefined property name\n");
-	if ((propinfo & JPI_SKIPPED) != 0)
-		mdb_printf(
-		    "some properties skipped due to unexpected layout\n");
-	if ((propinfo & JPI_BADLAYOUT) != 0)
-		mdb_printf("object has unexpected layout\n");
-	if ((propinfo & JPI_BADPROPS) != 0)
-		mdb_printf("object has invalid-looking property values\n");
+	bzero(jsl, sizeof (*jsl));
 }
 
-/* ARGSUSED */
-static int
-dcmd_jsprint(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+/*
+ * Add an object to the min-heap if it's among the largest seen so far.  The
+ * smallest of those is at the root, so most objects need only be compared
+ * against it.
+ */
+static void
+jslargest_insert(jslargest_t *jsl, uintptr_t addr, uint8_t type, size_t size)
 {
-	char *buf, *bufp;
-	size_t bufsz = 262144, len = bufsz;
-	jsobj_print_t jsop;
-	boolean_t opt_b = B_FALSE;
-	boolean_t opt_v = B_FALSE;
-	uint64_t strlen_override = 0;
-	int rv, i;
-
-	bzero(&jsop, sizeof (jsop));
-	jsop.jsop_depth = 2;
-	jsop.jsop_printaddr = B_FALSE;
-
-	i = mdb_getopts(argc, argv,
-	    'a', MDB_OPT_SETBITS, B_TRUE, &jsop.jsop_printaddr,
-	    'b', MDB_OPT_SETBITS, B_TRUE, &opt_b,
-	    'd', MDB_OPT_UINT64, &jsop.jsop_depth,
-	    'N', MDB_OPT_UINT64, &strlen_override,
-	    'v', MDB_OPT_SETBITS, B_TRUE, &opt_v, NULL);
+	jslargest_obj_t *heap = jsl->jsl_heap, obj;
+	size_t i, child, n;
 
-	jsop.jsop_maxstrlen = (int)strlen_override;
-
-	if (opt_b)
-		jsop.jsop_baseaddr = addr;
+	obj.jslo_addr = addr;
+	obj.jslo_size = size;
+	obj.jslo_type = type;
 
-	do {
-		if (i != argc) {
-			const mdb_arg_t *member = &argv[i++];
+	if (jsl->jsl_nheap < jsl->jsl_maxheap) {
+		for (i = jsl->jsl_nheap++; i > 0 &&
+		    heap[(i - 1) / 2].jslo_size > size; i = (i - 1) / 2)
+			heap[i] = heap[(i - 1) / 2];
 
-			if (member->a_type != MDB_TYPE_STRING)
-				return (DCMD_USAGE);
+		heap[i] = obj;
+		return;
+	}
 
-			jsop.jsop_member = member->a_un.a_str;
-		}
+	if (size <= heap[0].jslo_size)
+		return;
 
-		for (;;) {
-			if ((buf = bufp =
-			    mdb_zalloc(bufsz, UM_NOSLEEP)) == NULL)
-				return (DCMD_ERR);
+	n = jsl->jsl_nheap;
 
-			jsop.jsop_bufp = &bufp;
-			jsop.jsop_lenp = &len;
+	for (i = 0; (child = 2 * i + 1) < n; i = child) {
+		if (child + 1 < n &&
+		    heap[child + 1].jslo_size < heap[child].jslo_size)
+			child++;
 
-			rv = jsobj_print(addr, &jsop);
+		if (heap[child].jslo_size >= size)
+			break;
 
-			if (len > 0)
-				break;
+		heap[i] = heap[child];
+	}
 
-			mdb_free(buf, bufsz);
-			bufsz <<= 1;
-			len = bufsz;
-		}
+	heap[i] = obj;
+}
 
-		if (jsop.jsop_member == NULL && rv != 0) {
-			if (!jsop.jsop_descended)
-				mdb_warn("%s\n", buf);
+/*
+ * Returns the size of the string at "addr", including its external contents
+ * if it's an external string.
+ */
+static int
+jslargest_string_size(uintptr_t addr, uint8_t type, size_t *sizep)
+{
+	v8string_t *strp;
+	size_t length;
 
-			return (DCMD_ERR);
-		}
+	if (!V8_STRREP_EXT(type))
+		return (obj_size(addr, type, sizep, UM_SLEEP));
 
-		if (jsop.jsop_member && !jsop.jsop_found) {
-			if (jsop.jsop_baseaddr)
-				(void) mdb_printf("%p: ", jsop.jsop_baseaddr);
+	if (read_size(sizep, addr) != 0 ||
+	    (strp = v8string_load(addr, UM_SLEEP)) == NULL)
+		return (-1);
 
-			(void) mdb_printf("undefined%s",
-			    i < argc ? " " : "");
-		} else {
-			(void) mdb_printf("%s%s", buf, i < argc &&
-			    !isspace(buf[strlen(buf) - 1]) ? " " : "");
-		}
+	length = v8string_length(strp);
+	v8string_free(strp);
+	*sizep += V8_STRENC_ASCII(type) ? length : 2 * length;
 
-		mdb_free(buf, bufsz);
-		jsop.jsop_found = B_FALSE;
-		jsop.jsop_baseaddr = NULL;
-	} while (i < argc);
+	return (0);
+}
 
-	mdb_printf("\n");
+/*
+ * The visitor for ::jslargest's heap scan.
+ */
+static void
+jslargest_visit(void *arg, uintptr_t addr, uintptr_t map, uint8_t type)
+{
+	jslargest_t *jsl = arg;
+	size_t size, external;
 
-	if (opt_v)
-		jsobj_print_propinfo(jsop.jsop_propinfo);
+	if (type == V8_TYPE_JSOBJECT || type == V8_TYPE_JSARRAY ||
+	    type == V8_TYPE_JSTYPEDARRAY || type == V8_TYPE_JSARRAYBUFFER) {
+		if (obj_shallow_size(&jsl->jsl_fjs, addr, map, type, &size,
+		    &external) != 0)
+			size = 0;
+	} else if (!V8_TYPE_STRING(type)) {
+		return;
+	} else if (jslargest_string_size(addr, type, &size) != 0) {
+		jsl->jsl_nskipped++;
+		return;
+	}
 
-	return (DCMD_OK);
+	jsl->jsl_fjs.fjs_stats.fjss_jsobjs++;
+	jsl->jsl_nobjs++;
+	jsl->jsl_nbytes += size;
+	jslargest_insert(jsl, addr, type, size);
 }
 
-/* ARGSUSED */
 static int
-dcmd_jssource(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+jslargest_cmp_size(const void *l, const void *r)
 {
-	const char *typename;
-	uintptr_t nlines = 5;
-	uintptr_t funcinfop, scriptp, funcnamep;
-	uintptr_t tokpos, endpos;
-	uint8_t type;
-	char buf[256];
-	char *bufp = buf;
-	size_t len = sizeof (buf);
+	const jslargest_obj_t *lhs = l, *rhs = r;
 
-	if (mdb_getopts(argc, argv, 'n', MDB_OPT_UINTPTR, &nlines,
-	    NULL) != argc)
-		return (DCMD_USAGE);
-
-	if (!V8_IS_HEAPOBJECT(addr) || read_typebyte(&type, addr) != 0) {
-		mdb_warn("%p is not a heap object\n", addr);
-		return (DCMD_ERR);
-	}
+	if (lhs->jslo_size != rhs->jslo_size)
+		return (lhs->jslo_size > rhs->jslo_size ? -1 : 1);
 
-	typename = enum_lookup_str(v8_types, type, "");
-	if (strcmp(typename, "JSFunction") != 0) {
-		mdb_warn("%p is not a JSFunction\n", addr);
-		return (DCMD_ERR);
-	}
+	return (lhs->jslo_addr < rhs->jslo_addr ? -1 :
+	    lhs->jslo_addr > rhs->jslo_addr ? 1 : 0);
+}
 
-	if (read_heap_ptr(&funcinfop, addr, V8_OFF_JSFUNCTION_SHARED) != 0 ||
-	    read_heap_ptr(&scriptp, funcinfop,
-	    V8_OFF_SHAREDFUNCTIONINFO_SCRIPT) != 0 ||
-	    read_heap_ptr(&funcnamep, scriptp, V8_OFF_SCRIPT_NAME) != 0) {
-		mdb_warn("%p: failed to find script for function\n", addr);
-		return (DCMD_ERR);
-	}
+static void
+jslargest_print(const jslargest_obj_t *obj)
+{
+	char buf[80];
+	char *bufp = buf;
+	size_t len = sizeof (buf);
+	uint8_t type = obj->jslo_type;
 
-	if (read_heap_maybesmi(&tokpos, funcinfop,
-	    V8_OFF_SHAREDFUNCTIONINFO_FUNCTION_TOKEN_POSITION) != 0 ||
-	    read_heap_maybesmi(&endpos, funcinfop,
-	    V8_OFF_SHAREDFUNCTIONINFO_END_POSITION) != 0) {
-		mdb_warn("%p: failed to find function's boundaries\n", addr);
-	}
+	buf[0] = '\0';
 
-	if (jsstr_print(funcnamep, JSSTR_NUDE, &bufp, &len) == 0)
-		mdb_printf("file: %s\n", buf);
+	if (V8_TYPE_STRING(type)) {
+		(void) bsnprintf(&bufp, &len, "<string>");
+	} else if (obj_jsconstructor(obj->jslo_addr, &bufp, &len,
+	    B_FALSE) != 0 || buf[0] == '\0') {
+		(void) strlcpy(buf, "<unknown>", sizeof (buf));
+	}
 
-	if (tokpos != endpos)
-		jsfunc_lines(scriptp, tokpos, endpos, nlines, "%5d ");
-	mdb_printf("\n");
-	return (DCMD_OK);
+	mdb_printf("%?p %-24s %12llu %s\n", obj->jslo_addr,
+	    enum_lookup_str(v8_types, type, "<unknown>"),
+	    (uint64_t)obj->jslo_size, buf);
 }
 
 /* ARGSUSED */
 static int
-dcmd_jsfunctions(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+dcmd_jslargest(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
 {
-	findjsobjects_state_t *fjs = &findjsobjects_state;
-	findjsobjects_func_t *func;
-	uintptr_t funcinfo;
-	boolean_t showrange = B_FALSE;
-	boolean_t listlike = B_FALSE;
-	const char *name = NULL, *filename = NULL;
-	uintptr_t instr = 0;
+	jslargest_t *jsl = &jslargest_state;
+	uintptr_t count = JSLARGEST_NDEFAULT;
+	size_t i;
 
 	if (mdb_getopts(argc, argv,
-	    'l', MDB_OPT_SETBITS, B_TRUE, &listlike,
-	    'x', MDB_OPT_UINTPTR, &instr,
-	    'X', MDB_OPT_SETBITS, B_TRUE, &showrange,
-	    'n', MDB_OPT_STR, &name,
-	    's', MDB_OPT_STR, &filename,
+	    'n', MDB_OPT_UINTPTR, &count,
 	    NULL) != argc)
 		return (DCMD_USAGE);
 
-	if (findjsobjects_run(fjs) != 0)
-		return (DCMD_ERR);
-
-	if (listlike && !(flags & DCMD_ADDRSPEC) &&
-	    (name != NULL || filename != NULL || instr != 0)) {
-		mdb_warn("cannot specify -l with -n, -f, or -x\n");
-		return (DCMD_ERR);
-	}
-
-	if (!fjs->fjs_finished) {
-		mdb_warn("error: previous findjsobjects "
-		    "heap scan did not complete.\n");
+	if (count == 0) {
+		mdb_warn("count must be at least 1\n");
 		return (DCMD_ERR);
 	}
 
-	if (flags & DCMD_ADDRSPEC) {
-		listlike = B_TRUE;
-	}
+	jslargest_fini(jsl);
+	jsl->jsl_maxheap = count;
+	jsl->jsl_heap = mdb_alloc(count * sizeof (jslargest_obj_t), UM_SLEEP);
 
-	if (!showrange && !listlike) {
-		mdb_printf("%?s %8s %-40s %s\n", "FUNC", "#FUNCS", "NAME",
-		    "FROM");
-	} else if (!listlike) {
-		mdb_printf("%?s %8s %?s %?s %-40s %s\n", "FUNC", "#FUNCS",
-		    "START", "END", "NAME", "FROM");
+	if (findjsobjects_visit(&jsl->jsl_fjs, jslargest_visit, jsl) != 0) {
+		jslargest_fini(jsl);
+		return (DCMD_ERR);
 	}
 
-	for (func = fjs->fjs_funcs; func != NULL; func = func->fjsf_next) {
-		uintptr_t code, ilen;
-
-		if (listlike && (flags & DCMD_ADDRSPEC) != 0) {
-			findjsobjects_instance_t *inst;
-
-			if (addr != func->fjsf_instances.fjsi_addr) {
-				continue;
-			}
-
-			for (inst = &func->fjsf_instances;
-			    inst != NULL; inst = inst->fjsi_next) {
-				mdb_printf("%?p\n", inst->fjsi_addr);
-			}
-
-			continue;
-		}
+	qsort(jsl->jsl_heap, jsl->jsl_nheap, sizeof (jslargest_obj_t),
+	    jslargest_cmp_size);
 
-		funcinfo = func->fjsf_shared;
-
-		if (func->fjsf_location[0] == '\0') {
-			uintptr_t tokpos, script, lends;
-			ptrdiff_t tokposoff =
-			    V8_OFF_SHAREDFUNCTIONINFO_FUNCTION_TOKEN_POSITION;
+	if (flags & DCMD_PIPE_OUT) {
+		for (i = 0; i < jsl->jsl_nheap; i++)
+			mdb_printf("%p\n", jsl->jsl_heap[i].jslo_addr);
+	} else {
+		mdb_printf("%llu objects and strings, %llu bytes\n",
+		    jsl->jsl_nobjs, jsl->jsl_nbytes);
 
-			/*
-			 * We don't want to actually decode the token position
-			 * as an SMI here, so we re-encode it when we pass it to
-			 * jsfunc_lineno() below.
-			 */
-			if (read_heap_maybesmi(&tokpos, funcinfo,
-			    tokposoff) != 0 ||
-			    read_heap_ptr(&script, funcinfo,
-			    V8_OFF_SHAREDFUNCTIONINFO_SCRIPT) != 0 ||
-			    read_heap_ptr(&lends, script,
-			    V8_OFF_SCRIPT_LINE_ENDS) != 0 ||
-			    jsfunc_lineno(lends, V8_VALUE_SMI(tokpos),
-			    func->fjsf_location,
-			    sizeof (func->fjsf_location), NULL) != 0) {
-				func->fjsf_location[0] = '\0';
-			}
+		if (jsl->jsl_nskipped != 0) {
+			mdb_printf("(%llu strings could not be read)\n",
+			    jsl->jsl_nskipped);
 		}
 
-		if (name != NULL && strstr(func->fjsf_funcname, name) == NULL)
-			continue;
-
-		if (filename != NULL &&
-		    strstr(func->fjsf_scriptname, filename) == NULL)
-			continue;
-
-		code = 0;
-		ilen = 0;
-		if ((showrange || instr != 0) &&
-		    (read_heap_ptr(&code, funcinfo,
-		    V8_OFF_SHAREDFUNCTIONINFO_CODE) != 0 ||
-		    read_heap_ptr(&ilen, code,
-		    V8_OFF_CODE_INSTRUCTION_SIZE) != 0)) {
-			code = 0;
-			ilen = 0;
-		}
+		mdb_printf("\n%?s %-24s %12s %s\n", "ADDR", "TYPE", "BYTES",
+		    "CONSTRUCTOR");
 
-		if ((instr != 0 && ilen != 0) &&
-		    (instr < code + V8_OFF_CODE_INSTRUCTION_START ||
-		    instr >= code + V8_OFF_CODE_INSTRUCTION_START + ilen))
-			continue;
+		v8_silent++;
 
-		if (listlike) {
-			mdb_printf("%?p\n", func->fjsf_instances.fjsi_addr);
-		} else if (!showrange) {
-			mdb_printf("%?p %8d %-40s %s %s\n",
-			    func->fjsf_instances.fjsi_addr,
-			    func->fjsf_ninstances, func->fjsf_funcname,
-			    func->fjsf_scriptname, func->fjsf_location);
-		} else {
-			uintptr_t code, ilen;
+		for (i = 0; i < jsl->jsl_nheap; i++)
+			jslargest_print(&jsl->jsl_heap[i]);
 
-			if (read_heap_ptr(&code, funcinfo,
-			    V8_OFF_SHAREDFUNCTIONINFO_CODE) != 0 ||
-			    read_heap_ptr(&ilen, code,
-			    V8_OFF_CODE_INSTRUCTION_SIZE) != 0) {
-				mdb_printf("%?p %8d %?s %?s %-40s %s %s\n",
-				    func->fjsf_instances.fjsi_addr,
-				    func->fjsf_ninstances, "?", "?",
-				    func->fjsf_funcname, func->fjsf_scriptname,
-				    func->fjsf_location);
-			} else {
-				mdb_printf("%?p %8d %?p %?p %-40s %s %s\n",
-				    func->fjsf_instances.fjsi_addr,
-				    func->fjsf_ninstances,
-				    code + V8_OFF_CODE_INSTRUCTION_START,
-				    code + V8_OFF_CODE_INSTRUCTION_START + ilen,
-				    func->fjsf_funcname, func->fjsf_scriptname,
-				    func->fjsf_location);
-			}
-		}
+		v8_silent--;
 	}
 
+	jslargest_fini(jsl);
 	return (DCMD_OK);
 }
 
 static void
-dcmd_jsfunctions_help(void)
+dcmd_jslargest_help(void)
 {
 	mdb_printf("%s\n\n",
-"Lists JavaScript functions, optionally filtered by a substring of the\n"
-"function name or script filename or by the instruction address.  This uses\n"
-"the cache created by ::findjsobjects.  If ::findjsobjects has not already\n"
-"been run, this command runs it automatically without printing the output.\n"
-"This can take anywhere from a second to several minutes, depending on the\n"
-"size of the core dump.\n"
+"Scans the heap for the JavaScript objects and strings with the largest\n"
+"shallow sizes, and lists them in decreasing order of size with their V8\n"
+"type and constructor.  If the output is piped, only their addresses are\n"
+"emitted.\n"
 "\n"
-"It's important to keep in mind that each time you create a function in\n"
-"JavaScript (even from a function definition that has already been used),\n"
-"the VM must create a new object to represent it.  For example, if your\n"
-"program has a function A that returns a closure B, the VM will create new\n"
-"instances of the closure function (B) each time the surrounding function (A)\n"
-"is called.  To show this, the output of this command consists of one line \n"
-"per function definition that appears in the JavaScript source, and the\n"
-"\"#FUNCS\" column shows how many different functions were created by VM from\n"
-"this definition.");
+"The shallow size of an object is as for \"::findjsobjects -s bytes\": the\n"
+"object itself, plus its out-of-object properties and elements, and for\n"
+"typed arrays, the part of the ArrayBuffer's data that they cover.  For\n"
+"strings, it includes the characters of sequential strings and the external\n"
+"contents of external strings.  Only the largest objects seen so far are\n"
+"kept as the heap is walked, so the memory used depends only on the number\n"
+"requested.  This scan is separate from that of ::findjsobjects, and like\n"
+"it can be interrupted with ^C.");
 
 	mdb_dec_indent(2);
 	mdb_printf("%<b>OPTIONS%</b>\n");
 	mdb_inc_indent(2);
 
 	mdb_printf("%s\n",
-"  -l       List only closures (without other columns).  With ADDR, list\n"
-"           closures for the representative function ADDR.\n"
-"  -n func  List functions whose name contains this substring\n"
-"  -s file  List functions that were defined in a file whose name contains\n"
-"           this substring.\n"
-"  -x instr List functions whose compiled instructions include this address\n"
-"  -X       Show where the function's instructions are stored in memory\n");
+"  -n count List this many objects (default: 50)\n");
 }
 
 /* ARGSUSED */
@@ -6849,6 +15368,177 @@ dcmd_v8warnings(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
 	return (DCMD_OK);
 }
 
+/* ARGSUSED */
+static int
+dcmd_v8memcache(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+{
+	mdbv8_memstats_t stats;
+	boolean_t opt_f = B_FALSE, opt_z = B_FALSE;
+	uintptr_t mb = UINTPTR_MAX;
+	const char *f = "%-28s %llu\n";
+
+	if (mdb_getopts(argc, argv,
+	    'f', MDB_OPT_SETBITS, B_TRUE, &opt_f,
+	    'z', MDB_OPT_SETBITS, B_TRUE, &opt_z,
+	    'M', MDB_OPT_UINTPTR, &mb,
+	    NULL) != argc)
+		return (DCMD_USAGE);
+
+	if (mb != UINTPTR_MAX && mb > (SIZE_MAX >> 20)) {
+		mdb_warn("cache size too large: %llu MB\n", (uint64_t)mb);
+		return (DCMD_ERR);
+	}
+
+	if (mb != UINTPTR_MAX)
+		mdbv8_mem_setsize(mb * 1024 * 1024);
+
+	if (opt_f)
+		mdbv8_mem_flush();
+
+	if (opt_z)
+		mdbv8_mem_resetstats();
+
+	if (opt_f || opt_z || mb != UINTPTR_MAX)
+		return (DCMD_OK);
+
+	mdbv8_mem_stats(&stats);
+	mdb_printf("%-28s %s\n", "cache state",
+	    stats.mms_backmapped ? "unused (target is mapped)" :
+	    stats.mms_enabled ? "enabled" : stats.mms_maxpages == 0 ?
+	    "disabled" : "idle (live process)");
+	mdb_printf("%-28s %s\n", "memory source", stats.mms_backend);
+	mdb_printf(f, "page size (bytes)", (uint64_t)stats.mms_pagesize);
+	mdb_printf(f, "pages cached", (uint64_t)stats.mms_npages);
+	mdb_printf(f, "maximum pages cached", (uint64_t)stats.mms_maxpages);
+	mdb_printf(f, "reads", stats.mms_reads);
+	mdb_printf(f, "reads from cached pages", stats.mms_hits);
+	mdb_printf(f, "reads filling pages", stats.mms_misses);
+	mdb_printf(f, "reads bypassing cache", stats.mms_bypassed);
+	mdb_printf(f, "failed reads", stats.mms_failures);
+	mdb_printf(f, "target reads", stats.mms_vreads);
+	mdb_printf(f, "target bytes read", stats.mms_vbytes);
+	mdb_printf(f, "pages evicted", stats.mms_evictions);
+	mdb_printf(f, "reads from mapped memory", stats.mms_mapped);
+	mdb_printf(f, "reads known unreadable", stats.mms_unreadable);
+	mdb_printf(f, "unreadable ranges", (uint64_t)stats.mms_nunreadable);
+
+	if (stats.mms_hits + stats.mms_misses != 0) {
+		mdb_printf("%-28s %llu%%\n", "hit rate",
+		    stats.mms_hits * 100 / (stats.mms_hits + stats.mms_misses));
+	}
+
+	return (DCMD_OK);
+}
+
+static void
+dcmd_v8memcache_help(void)
+{
+	mdb_printf("%s\n\n",
+"Reports statistics about the cache of target memory pages used when reading\n"
+"V8 heap objects.  Most reads of object fields are satisfied from pages\n"
+"already in the cache rather than by separate reads from the target.  The\n"
+"cache is used throughout a session on a core file; for a live process,\n"
+"it's only used during a heap scan, since the process may run between\n"
+"commands.  Reads larger than a page, and reads from pages that can't be\n"
+"read in full, bypass the cache.  While the cache is in use, it also keeps\n"
+"track of ranges of target memory that can't be read (starting with the\n"
+"gaps between a core file's mappings), so that reads from them fail\n"
+"without consulting the target.");
+
+	mdb_dec_indent(2);
+	mdb_printf("%<b>OPTIONS%</b>\n");
+	mdb_inc_indent(2);
+
+	mdb_printf("%s\n",
+"  -f       Discard all cached pages\n"
+"  -M mb    Set the maximum size of the cache (0 disables it)\n"
+"  -z       Reset the statistics\n");
+}
+
+static int
+v8target_seg_count(uintptr_t addr, size_t size, uint_t flags, const char *name,
+    void *arg)
+{
+	uint64_t *counts = arg;
+
+	counts[0]++;
+	counts[1] += size;
+	return (0);
+}
+
+/* ARGSUSED */
+static int
+dcmd_v8target(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+{
+	boolean_t opt_r = B_FALSE;
+	mdbv8_elfcore_t *ecp;
+	mdbv8_memstats_t stats;
+	uint64_t counts[2] = { 0, 0 };
+	int i;
+
+	i = mdb_getopts(argc, argv,
+	    'r', MDB_OPT_SETBITS, B_TRUE, &opt_r, NULL);
+
+	if ((opt_r && i != argc) || argc - i > 1 ||
+	    (i < argc && argv[i].a_type != MDB_TYPE_STRING))
+		return (DCMD_USAGE);
+
+	if (opt_r || i < argc) {
+		ecp = NULL;
+		if (i < argc &&
+		    (ecp = mdbv8_elfcore_open(argv[i].a_un.a_str)) == NULL)
+			return (DCMD_ERR);
+
+		/*
+		 * Cached Map types (and cached pages) describe the old target.
+		 */
+		v8_typecache_flush();
+		mdbv8_mem_setbackend(ecp != NULL ?
+		    &mdbv8_elfcore_backend : NULL, ecp);
+		v8_target_core = ecp;
+		v8_unreadable_seed();
+		return (DCMD_OK);
+	}
+
+	mdbv8_mem_stats(&stats);
+
+	if (v8_target_core == NULL) {
+		mdb_printf("reading target memory from %s\n",
+		    stats.mms_backend);
+		return (DCMD_OK);
+	}
+
+	(void) mdbv8_elfcore_iter(v8_target_core, v8target_seg_count, counts);
+	mdb_printf("reading target memory from %s \"%s\" "
+	    "(%llu segments, %llu bytes)\n", stats.mms_backend,
+	    mdbv8_elfcore_path(v8_target_core), counts[0], counts[1]);
+
+	return (DCMD_OK);
+}
+
+static void
+dcmd_v8target_help(void)
+{
+	mdb_printf("%s\n\n",
+"Selects where heap objects are read from.  By default, they're read from\n"
+"the debugger's target.  Given the path to a Linux ELF core file, this\n"
+"command instead maps that file into the debugger's address space and reads\n"
+"heap objects directly from the mapping, including the parts of\n"
+"file-backed mappings that Linux leaves out of core files (which are mapped\n"
+"from the files named in the core file's NT_FILE note, where they can be\n"
+"found).  Heap scans like ::findjsobjects then scan the core file in place\n"
+"rather than copying it.  V8 metadata, symbols, and stacks still come from\n"
+"the debugger's target, which should be the same process.  With no\n"
+"arguments, reports where target memory is currently read from.");
+
+	mdb_dec_indent(2);
+	mdb_printf("%<b>OPTIONS%</b>\n");
+	mdb_inc_indent(2);
+
+	mdb_printf("%s\n",
+"  -r       Go back to reading from the debugger's target\n");
+}
+
 /*
  * "v8whatis" scours the memory just prior to the given address looking for
  * structure that indicates a V8 heap object.  This is a heuristic way to find
@@ -6857,7 +15547,7 @@ dcmd_v8warnings(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
 static int
 dcmd_v8whatis(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
 {
-	uintptr_t origaddr, curaddr, curvalue, ptrlowbits;
+	uintptr_t origaddr, curaddr = 0, curvalue, ptrlowbits;
 	size_t curoffset, maxoffset = 4096;
 	boolean_t contained, verbose = B_FALSE;
 	uint8_t typebyte;
@@ -6906,8 +15596,11 @@ dcmd_v8whatis(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
 
 	/*
 	 * At this point, we walk backwards from the address we're given looking
-	 * for something that looks like a V8 heap object.
+	 * for something that looks like a V8 heap object.  Many of the words we
+	 * look at won't be readable or won't point anywhere readable, so hold
+	 * the caches, which remember those failures, for the duration.
 	 */
+	v8_typecache_hold();
 	for (curoffset = 0; curoffset < maxoffset;
 	    curoffset += sizeof (uintptr_t)) {
 		curaddr = addr - curoffset;
@@ -6945,6 +15638,7 @@ dcmd_v8whatis(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
 
 		break;
 	}
+	v8_typecache_rele();
 
 	if (curoffset >= maxoffset) {
 		if (verbose) {
@@ -7027,7 +15721,7 @@ walk_jselement_init(mdb_walk_state_t *wsp)
 	int memflags = UM_GC | UM_SLEEP;
 	jselement_walk_data_t *jsew;
 
-	if ((addr = wsp->walk_addr) == NULL) {
+	if ((addr = wsp->walk_addr) == 0) {
 		mdb_warn("'jselement' does not support global walks\n");
 		return (WALK_ERR);
 	}
@@ -7093,7 +15787,7 @@ walk_jselement_fini(mdb_walk_state_t *wsp)
 static int
 walk_jsframes_init(mdb_walk_state_t *wsp)
 {
-	if (wsp->walk_addr != NULL)
+	if (wsp->walk_addr != 0)
 		return (WALK_NEXT);
 
 	if (load_current_context(&wsp->walk_addr, NULL) != 0)
@@ -7117,7 +15811,13 @@ walk_jsframes_step(mdb_walk_state_t *wsp)
 	if (mdb_vread(&next, sizeof (next), addr) == -1)
 		return (WALK_ERR);
 
-	if (next == NULL)
+	/*
+	 * Frames are always further up the stack than the frames they call.
+	 * Code built without frame pointers can leave anything in the frame
+	 * pointer register, so stop if the chain doesn't ascend, rather than
+	 * looping forever.
+	 */
+	if (next == 0 || next <= addr)
 		return (WALK_DONE);
 
 	wsp->walk_addr = next;
@@ -7170,7 +15870,7 @@ walk_jsprop_init(mdb_walk_state_t *wsp)
 	uintptr_t addr;
 	uint8_t type;
 
-	if ((addr = wsp->walk_addr) == NULL) {
+	if ((addr = wsp->walk_addr) == 0) {
 		mdb_warn("'jsprop' does not support global walks\n");
 		return (WALK_ERR);
 	}
@@ -7250,11 +15950,37 @@ static const mdb_dcmd_t v8_mdb_dcmds[] = {
 		dcmd_jssource },
 	{ "jsstack", "[-av] [-f function] [-p property] [-n numlines]",
 		"print a JavaScript stacktrace", dcmd_jsstack },
-	{ "findjsobjects", "?[-vb] [-r | -c cons | -p prop]", "find JavaScript "
-		"objects", dcmd_findjsobjects, dcmd_findjsobjects_help },
-	{ "jsfunctions", "?[-X] [-s file_filter] [-n name_filter] "
+	{ "findjsobjects", "?[-vb] [-P num] [-L file] [-S file] [-T secs] "
+		"[-w size] [-s sort] [-r | -R | -c cons | -p prop]",
+		"find JavaScript objects", dcmd_findjsobjects,
+		dcmd_findjsobjects_help },
+	{ "jsfunctions", "?[-cX] [-s file_filter] [-n name_filter] "
 	    "[-x instr_filter]", "list JavaScript functions",
 	    dcmd_jsfunctions, dcmd_jsfunctions_help },
+	{ "jsretained", "?[-cv] [-M mb] [-n count]",
+	    "report memory retained by JavaScript objects",
+	    dcmd_jsretained, dcmd_jsretained_help },
+	{ "jspath", ":[-v] [-k num]",
+	    "find the shortest paths from a root to a JavaScript object",
+	    dcmd_jspath, dcmd_jspath_help },
+	{ "jsheapdiff", "[-bv] [-n count] before [after] | -o file",
+	    "compare the shapes of objects in two JavaScript heaps",
+	    dcmd_jsheapdiff, dcmd_jsheapdiff_help },
+	{ "jsheapsnapshot", "[-v] file",
+	    "write a Chrome DevTools heap snapshot of JavaScript objects",
+	    dcmd_jsheapsnapshot, dcmd_jsheapsnapshot_help },
+	{ "jsarraybuffers", NULL,
+	    "report memory used by ArrayBuffer backing stores",
+	    dcmd_jsarraybuffers, dcmd_jsarraybuffers_help },
+	{ "jselements", "[-n count]",
+	    "report spare capacity and holes in JavaScript elements",
+	    dcmd_jselements, dcmd_jselements_help },
+	{ "jslargest", "[-n count]",
+	    "list the largest JavaScript objects and strings",
+	    dcmd_jslargest, dcmd_jslargest_help },
+	{ "jsstrdups", "[-v] [-n count]",
+	    "find JavaScript strings with duplicate contents",
+	    dcmd_jsstrdups, dcmd_jsstrdups_help },
 
 	/*
 	 * Commands to inspect V8-level state
@@ -7277,6 +16003,12 @@ static const mdb_dcmd_t v8_mdb_dcmds[] = {
 		dcmd_v8load, dcmd_v8load_help },
 	{ "v8frametypes", NULL, "list known V8 frame types",
 		dcmd_v8frametypes },
+	{ "v8memcache", "[-fz] [-M mb]",
+		"report statistics about the target memory cache",
+		dcmd_v8memcache, dcmd_v8memcache_help },
+	{ "v8target", "[-r] [corefile]",
+		"read heap objects from an ELF core file",
+		dcmd_v8target, dcmd_v8target_help },
 	{ "v8print", ":[class]", "print a V8 heap object",
 		dcmd_v8print, dcmd_v8print_help },
 	{ "v8str", ":[-v]", "print the contents of a V8 string",
@@ -7390,3 +16122,11 @@ _mdb_init(void)
 	enable_demangling();
 	return (&v8_mdb);
 }
+
+void
+_mdb_fini(void)
+{
+	mdbv8_mem_setbackend(NULL, NULL);
+	v8_target_core = NULL;
+	mdbv8_mem_flush();
+}
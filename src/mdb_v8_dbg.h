@@ -85,6 +85,8 @@
  * Basic types
  */
 
+typedef void (*mdbv8_strbuf_flush_f)(void *, const char *, size_t);
+
 typedef struct {
 	char	*ms_buf;	/* full buffer */
 	size_t	ms_bufsz;	/* full buffer size */
@@ -93,6 +95,8 @@ typedef struct {
 	size_t	ms_reservesz;	/* bytes reserved */
 	int	ms_flags;	/* buffer flags */
 	int	ms_memflags;	/* memory allocation flags */
+	mdbv8_strbuf_flush_f ms_flush;	/* consumer of full buffers */
+	void	*ms_flusharg;	/* argument for ms_flush */
 } mdbv8_strbuf_t;
 
 typedef struct v8fixedarray v8fixedarray_t;
@@ -110,6 +114,7 @@ typedef struct v8scopeinfo_var v8scopeinfo_var_t;
 typedef enum {
 	MSF_ASCIIONLY	= 0x1,			/* replace non-ASCII */
 	MSF_JSON	= MSF_ASCIIONLY | 0x2,	/* partial JSON string */
+	MSF_UTF8	= 0x4,			/* encode chars as UTF-8 */
 } mdbv8_strappend_flags_t;
 
 typedef enum {
@@ -140,6 +145,8 @@ mdbv8_strbuf_t *mdbv8_strbuf_alloc(size_t, int);
 void mdbv8_strbuf_free(mdbv8_strbuf_t *);
 void mdbv8_strbuf_init(mdbv8_strbuf_t *, char *, size_t);
 void mdbv8_strbuf_legacy_update(mdbv8_strbuf_t *, char **, size_t *);
+void mdbv8_strbuf_setflush(mdbv8_strbuf_t *, mdbv8_strbuf_flush_f, void *);
+void mdbv8_strbuf_flush(mdbv8_strbuf_t *);
 
 size_t mdbv8_strbuf_bufsz(mdbv8_strbuf_t *);
 size_t mdbv8_strbuf_bytesleft(mdbv8_strbuf_t *);
@@ -192,6 +199,8 @@ void v8string_free(v8string_t *);
 size_t v8string_length(v8string_t *);
 int v8string_write(v8string_t *, mdbv8_strbuf_t *,
     mdbv8_strappend_flags_t, v8string_flags_t);
+int v8string_write_pieces(v8string_t *, mdbv8_strbuf_t *,
+    mdbv8_strappend_flags_t, v8string_flags_t);
 
 
 /*
@@ -0,0 +1,577 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * Copyright (c) 2018, Joyent, Inc.
+ */
+
+/*
+ * mdb_v8_elfcore.c: a target memory backend for Linux ELF core files.
+ *
+ * Rather than reading the core file with a system call for each read, we map
+ * the whole file into our address space and build a table of the target's
+ * memory segments from its PT_LOAD program headers, sorted by address.  A read
+ * is then a binary search of that table, a bounds check, and a copy out of
+ * the mapping, and callers scanning large ranges can use the mapping directly
+ * through mdbv8_vmap().
+ *
+ * Linux omits from core files the contents of file-backed mappings that it
+ * expects to be able to find elsewhere (most notably, the text of the
+ * executable and its shared libraries).  Such segments have a p_filesz
+ * smaller than their p_memsz.  The core file's NT_FILE note records which
+ * file (and which offset in that file) backs each mapping, so where we can
+ * open that file, we map the missing parts of the segment from it.  Anything
+ * else missing from the core file can't be read.
+ */
+
+#include "mdb_v8_dbg.h"
+#include "mdb_v8_impl.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/elf.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef _LP64
+#define	ELFCORE(t)	Elf64_##t
+#define	ELFCORE_CLASS	ELFCLASS64
+#else
+#define	ELFCORE(t)	Elf32_##t
+#define	ELFCORE_CLASS	ELFCLASS32
+#endif
+
+/*
+ * The Linux note describing the files mapped by the process.
+ */
+#ifndef NT_FILE
+#define	NT_FILE		0x46494c45
+#endif
+
+typedef struct mdbv8_elfseg {
+	uintptr_t	es_vaddr;	/* target address of segment */
+	size_t		es_size;	/* bytes available */
+	const uint8_t	*es_data;	/* contents of segment */
+	const char	*es_name;	/* mapped file, if known */
+	uint_t		es_flags;	/* PF_R, PF_W, and PF_X */
+} mdbv8_elfseg_t;
+
+typedef struct mdbv8_elfmap {
+	void		*em_addr;	/* mapping of a backing file */
+	size_t		em_size;	/* size of mapping */
+} mdbv8_elfmap_t;
+
+struct mdbv8_elfcore {
+	char		*ec_path;	/* path to core file */
+	uint8_t		*ec_base;	/* mapping of the whole core file */
+	size_t		ec_size;	/* size of core file */
+	const ELFCORE(Phdr) *ec_phdrs;	/* program headers */
+	size_t		ec_phnum;	/* number of program headers */
+	mdbv8_elfseg_t	*ec_segs;	/* segments, sorted by address */
+	size_t		ec_nsegs;	/* number of segments */
+	size_t		ec_segsalloc;	/* number of segments allocated */
+	mdbv8_elfmap_t	*ec_maps;	/* backing files mapped */
+	size_t		ec_nmaps;	/* number of backing files mapped */
+	size_t		ec_mapsalloc;	/* number of mappings allocated */
+	const uintptr_t	*ec_files;	/* NT_FILE (start, end, pgoff) */
+	const char	**ec_filenames;	/* name of each NT_FILE entry */
+	size_t		ec_nfiles;	/* number of NT_FILE entries */
+	size_t		ec_filepgsz;	/* units of NT_FILE offsets */
+};
+
+/*
+ * Returns the segment containing "addr", if any.
+ */
+static const mdbv8_elfseg_t *
+elfcore_lookup(mdbv8_elfcore_t *ecp, uintptr_t addr)
+{
+	size_t lo = 0, hi = ecp->ec_nsegs, mid;
+	const mdbv8_elfseg_t *esp;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		esp = &ecp->ec_segs[mid];
+
+		if (addr < esp->es_vaddr)
+			hi = mid;
+		else if (addr - esp->es_vaddr >= esp->es_size)
+			lo = mid + 1;
+		else
+			return (esp);
+	}
+
+	return (NULL);
+}
+
+static ssize_t
+elfcore_vread(void *arg, void *buf, size_t nbytes, uintptr_t addr)
+{
+	mdbv8_elfcore_t *ecp = arg;
+	const mdbv8_elfseg_t *esp;
+	size_t done, off, n;
+
+	for (done = 0; done < nbytes; done += n) {
+		if ((esp = elfcore_lookup(ecp, addr + done)) == NULL)
+			return (-1);
+
+		off = addr + done - esp->es_vaddr;
+		n = MIN(nbytes - done, esp->es_size - off);
+		bcopy(esp->es_data + off, (uint8_t *)buf + done, n);
+	}
+
+	return (nbytes);
+}
+
+static const void *
+elfcore_vmap(void *arg, size_t nbytes, uintptr_t addr)
+{
+	const mdbv8_elfseg_t *esp;
+	size_t off;
+
+	if ((esp = elfcore_lookup(arg, addr)) == NULL)
+		return (NULL);
+
+	off = addr - esp->es_vaddr;
+	return (nbytes <= esp->es_size - off ? esp->es_data + off : NULL);
+}
+
+static void
+elfcore_fini(void *arg)
+{
+	mdbv8_elfcore_close(arg);
+}
+
+const mdbv8_membackend_t mdbv8_elfcore_backend = {
+	.mb_name = "ELF core file",
+	.mb_vread = elfcore_vread,
+	.mb_vmap = elfcore_vmap,
+	.mb_fini = elfcore_fini
+};
+
+static void
+elfcore_seg_add(mdbv8_elfcore_t *ecp, uintptr_t vaddr, size_t size,
+    const uint8_t *data, const char *name, uint_t flags)
+{
+	mdbv8_elfseg_t *segs;
+	size_t nalloc;
+
+	if (ecp->ec_nsegs == ecp->ec_segsalloc) {
+		nalloc = ecp->ec_segsalloc == 0 ? 64 : ecp->ec_segsalloc * 2;
+		segs = mdb_zalloc(nalloc * sizeof (mdbv8_elfseg_t), UM_SLEEP);
+
+		if (ecp->ec_segs != NULL) {
+			bcopy(ecp->ec_segs, segs,
+			    ecp->ec_nsegs * sizeof (mdbv8_elfseg_t));
+			mdb_free(ecp->ec_segs,
+			    ecp->ec_segsalloc * sizeof (mdbv8_elfseg_t));
+		}
+
+		ecp->ec_segs = segs;
+		ecp->ec_segsalloc = nalloc;
+	}
+
+	ecp->ec_segs[ecp->ec_nsegs].es_vaddr = vaddr;
+	ecp->ec_segs[ecp->ec_nsegs].es_size = size;
+	ecp->ec_segs[ecp->ec_nsegs].es_data = data;
+	ecp->ec_segs[ecp->ec_nsegs].es_name = name;
+	ecp->ec_segs[ecp->ec_nsegs].es_flags = flags;
+	ecp->ec_nsegs++;
+}
+
+/*
+ * Map "size" bytes at offset "off" of the file "path", returning a pointer to
+ * the data or NULL if the file can't be mapped or is too short.
+ */
+static const uint8_t *
+elfcore_map_file(mdbv8_elfcore_t *ecp, const char *path, off_t off,
+    size_t size)
+{
+	mdbv8_elfmap_t *maps;
+	struct stat st;
+	size_t nalloc, pgoff;
+	void *addr;
+	int fd;
+
+	pgoff = off % sysconf(_SC_PAGESIZE);
+
+	if ((fd = open(path, O_RDONLY)) == -1)
+		return (NULL);
+
+	if (fstat(fd, &st) != 0 || off + size > st.st_size ||
+	    (addr = mmap(NULL, size + pgoff, PROT_READ, MAP_PRIVATE, fd,
+	    off - pgoff)) == MAP_FAILED) {
+		(void) close(fd);
+		return (NULL);
+	}
+
+	(void) close(fd);
+
+	if (ecp->ec_nmaps == ecp->ec_mapsalloc) {
+		nalloc = ecp->ec_mapsalloc == 0 ? 16 : ecp->ec_mapsalloc * 2;
+		maps = mdb_zalloc(nalloc * sizeof (mdbv8_elfmap_t), UM_SLEEP);
+
+		if (ecp->ec_maps != NULL) {
+			bcopy(ecp->ec_maps, maps,
+			    ecp->ec_nmaps * sizeof (mdbv8_elfmap_t));
+			mdb_free(ecp->ec_maps,
+			    ecp->ec_mapsalloc * sizeof (mdbv8_elfmap_t));
+		}
+
+		ecp->ec_maps = maps;
+		ecp->ec_mapsalloc = nalloc;
+	}
+
+	ecp->ec_maps[ecp->ec_nmaps].em_addr = addr;
+	ecp->ec_maps[ecp->ec_nmaps].em_size = size + pgoff;
+	ecp->ec_nmaps++;
+
+	return ((const uint8_t *)addr + pgoff);
+}
+
+/*
+ * Decode the NT_FILE note at "desc", which looks like this:
+ *
+ *     count, page size,
+ *     count x (start address, end address, offset in pages),
+ *     count x NUL-terminated file name
+ *
+ * where each number is the size of a pointer in the target.
+ */
+static int
+elfcore_note_file(mdbv8_elfcore_t *ecp, const uint8_t *desc, size_t descsz)
+{
+	const uintptr_t *words = (const uintptr_t *)desc;
+	const char *name, *end = (const char *)desc + descsz;
+	size_t count, i;
+
+	if (descsz < 2 * sizeof (uintptr_t))
+		return (-1);
+
+	count = words[0];
+
+	if (count > descsz / (3 * sizeof (uintptr_t)) ||
+	    (2 + 3 * count) * sizeof (uintptr_t) > descsz)
+		return (-1);
+
+	ecp->ec_filenames = mdb_zalloc(
+	    MAX(count, 1) * sizeof (const char *), UM_SLEEP);
+	ecp->ec_nfiles = count;
+	ecp->ec_filepgsz = words[1];
+	ecp->ec_files = &words[2];
+
+	name = (const char *)&words[2 + 3 * count];
+
+	for (i = 0; i < count && name < end; i++) {
+		ecp->ec_filenames[i] = name;
+
+		while (name < end && *name != '\0')
+			name++;
+
+		if (name == end) {
+			ecp->ec_filenames[i] = NULL;
+			break;
+		}
+
+		name++;
+	}
+
+	return (0);
+}
+
+/*
+ * Returns the contents of the first note of type "type" written by the kernel
+ * (that is, with owner "CORE"), and stores its size in *sizep.
+ */
+static const uint8_t *
+elfcore_note_find(mdbv8_elfcore_t *ecp, uint_t type, size_t *sizep)
+{
+	const ELFCORE(Phdr) *php;
+	const ELFCORE(Nhdr) *nhp;
+	const uint8_t *p, *end;
+	size_t namesz, descsz, i;
+
+	for (i = 0; i < ecp->ec_phnum; i++) {
+		php = &ecp->ec_phdrs[i];
+
+		if (php->p_type != PT_NOTE || php->p_offset > ecp->ec_size ||
+		    php->p_filesz > ecp->ec_size - php->p_offset)
+			continue;
+
+		p = ecp->ec_base + php->p_offset;
+		end = p + php->p_filesz;
+
+		while (p + sizeof (*nhp) <= end) {
+			nhp = (const ELFCORE(Nhdr) *)p;
+			namesz = (nhp->n_namesz + 3) & ~3;
+			descsz = (nhp->n_descsz + 3) & ~3;
+			p += sizeof (*nhp);
+
+			if (namesz > end - p || descsz > end - p - namesz)
+				break;
+
+			if (nhp->n_type == type &&
+			    nhp->n_namesz == sizeof ("CORE") &&
+			    strcmp((const char *)p, "CORE") == 0) {
+				*sizep = nhp->n_descsz;
+				return (p + namesz);
+			}
+
+			p += namesz + descsz;
+		}
+	}
+
+	return (NULL);
+}
+
+/*
+ * Add segments for the parts of [vaddr, vaddr + size) that are backed by
+ * files named in the NT_FILE note, and return the name of the file backing
+ * "vaddr", if any.
+ */
+static const char *
+elfcore_backfill(mdbv8_elfcore_t *ecp, uintptr_t vaddr, size_t size,
+    boolean_t addsegs, uint_t flags)
+{
+	const uintptr_t *fp;
+	const char *name = NULL;
+	const uint8_t *data;
+	uintptr_t start, end;
+	size_t i;
+
+	for (i = 0; i < ecp->ec_nfiles; i++) {
+		fp = &ecp->ec_files[3 * i];
+
+		if (fp[0] <= vaddr && vaddr < fp[1])
+			name = ecp->ec_filenames[i];
+
+		start = MAX(fp[0], vaddr);
+		end = MIN(fp[1], vaddr + size);
+
+		if (!addsegs || start >= end || ecp->ec_filenames[i] == NULL)
+			continue;
+
+		if ((data = elfcore_map_file(ecp, ecp->ec_filenames[i],
+		    (off_t)fp[2] * ecp->ec_filepgsz + (start - fp[0]),
+		    end - start)) != NULL) {
+			elfcore_seg_add(ecp, start, end - start, data,
+			    ecp->ec_filenames[i], flags);
+		}
+	}
+
+	return (name);
+}
+
+static int
+elfcore_seg_compare(const void *l, const void *r)
+{
+	const mdbv8_elfseg_t *lp = l, *rp = r;
+
+	if (lp->es_vaddr < rp->es_vaddr)
+		return (-1);
+
+	return (lp->es_vaddr > rp->es_vaddr);
+}
+
+/*
+ * Open the Linux ELF core file at "path".  On failure, emits a warning and
+ * returns NULL.  The result should be released with mdbv8_elfcore_close(), or
+ * passed to mdbv8_mem_setbackend() with mdbv8_elfcore_backend, which will
+ * release it when the backend is changed.
+ */
+mdbv8_elfcore_t *
+mdbv8_elfcore_open(const char *path)
+{
+	mdbv8_elfcore_t *ecp;
+	const ELFCORE(Ehdr) *ehp;
+	const ELFCORE(Phdr) *php;
+	const uint8_t *desc;
+	struct stat st;
+	size_t avail, descsz;
+	void *base;
+	int fd, i;
+
+	if ((fd = open(path, O_RDONLY)) == -1) {
+		mdb_warn("failed to open \"%s\"", path);
+		return (NULL);
+	}
+
+	if (fstat(fd, &st) != 0) {
+		mdb_warn("failed to stat \"%s\"", path);
+		(void) close(fd);
+		return (NULL);
+	}
+
+	if (st.st_size < sizeof (ELFCORE(Ehdr))) {
+		mdb_warn("\"%s\" is not an ELF core file\n", path);
+		(void) close(fd);
+		return (NULL);
+	}
+
+	base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	(void) close(fd);
+
+	if (base == MAP_FAILED) {
+		mdb_warn("failed to map \"%s\"", path);
+		return (NULL);
+	}
+
+	ecp = mdb_zalloc(sizeof (*ecp), UM_SLEEP);
+	ecp->ec_path = mdb_alloc(strlen(path) + 1, UM_SLEEP);
+	(void) strcpy(ecp->ec_path, path);
+	ecp->ec_base = base;
+	ecp->ec_size = st.st_size;
+
+	ehp = (const ELFCORE(Ehdr) *)ecp->ec_base;
+
+	if (memcmp(ehp->e_ident, ELFMAG, SELFMAG) != 0 ||
+	    ehp->e_ident[EI_CLASS] != ELFCORE_CLASS ||
+	    ehp->e_type != ET_CORE ||
+	    ehp->e_phentsize != sizeof (ELFCORE(Phdr)) ||
+	    ehp->e_phoff > ecp->ec_size ||
+	    ehp->e_phnum > (ecp->ec_size - ehp->e_phoff) /
+	    sizeof (ELFCORE(Phdr))) {
+		mdb_warn("\"%s\" is not an ELF core file for this "
+		    "architecture\n", path);
+		mdbv8_elfcore_close(ecp);
+		return (NULL);
+	}
+
+	php = (const ELFCORE(Phdr) *)(ecp->ec_base + ehp->e_phoff);
+	ecp->ec_phdrs = php;
+	ecp->ec_phnum = ehp->e_phnum;
+
+	if ((desc = elfcore_note_find(ecp, NT_FILE, &descsz)) != NULL)
+		(void) elfcore_note_file(ecp, desc, descsz);
+
+	for (i = 0; i < ehp->e_phnum; i++) {
+		if (php[i].p_type != PT_LOAD || php[i].p_memsz == 0)
+			continue;
+
+		avail = 0;
+		if (php[i].p_offset < ecp->ec_size) {
+			avail = MIN(php[i].p_filesz,
+			    ecp->ec_size - php[i].p_offset);
+			avail = MIN(avail, php[i].p_memsz);
+		}
+
+		if (avail < php[i].p_memsz) {
+			(void) elfcore_backfill(ecp, php[i].p_vaddr + avail,
+			    php[i].p_memsz - avail, B_TRUE, php[i].p_flags);
+		}
+
+		if (avail != 0) {
+			elfcore_seg_add(ecp, php[i].p_vaddr, avail,
+			    ecp->ec_base + php[i].p_offset,
+			    elfcore_backfill(ecp, php[i].p_vaddr, 0, B_FALSE,
+			    0), php[i].p_flags);
+		}
+	}
+
+	qsort(ecp->ec_segs, ecp->ec_nsegs, sizeof (mdbv8_elfseg_t),
+	    elfcore_seg_compare);
+
+	return (ecp);
+}
+
+void
+mdbv8_elfcore_close(mdbv8_elfcore_t *ecp)
+{
+	size_t i;
+
+	if (ecp == NULL)
+		return;
+
+	for (i = 0; i < ecp->ec_nmaps; i++)
+		(void) munmap(ecp->ec_maps[i].em_addr, ecp->ec_maps[i].em_size);
+
+	if (ecp->ec_maps != NULL)
+		mdb_free(ecp->ec_maps,
+		    ecp->ec_mapsalloc * sizeof (mdbv8_elfmap_t));
+
+	if (ecp->ec_segs != NULL)
+		mdb_free(ecp->ec_segs,
+		    ecp->ec_segsalloc * sizeof (mdbv8_elfseg_t));
+
+	if (ecp->ec_filenames != NULL)
+		mdb_free(ecp->ec_filenames,
+		    MAX(ecp->ec_nfiles, 1) * sizeof (const char *));
+
+	(void) munmap(ecp->ec_base, ecp->ec_size);
+	mdb_free(ecp->ec_path, strlen(ecp->ec_path) + 1);
+	mdb_free(ecp, sizeof (*ecp));
+}
+
+const char *
+mdbv8_elfcore_path(mdbv8_elfcore_t *ecp)
+{
+	return (ecp->ec_path);
+}
+
+/*
+ * Invoke "func" for each readable segment of the core file, in address order,
+ * with its address, size, permissions (PF_R, PF_W, and PF_X), the name of the
+ * file it maps (or NULL), and "arg".  Iteration stops if "func" returns
+ * non-zero, and that value is returned.
+ */
+int
+mdbv8_elfcore_iter(mdbv8_elfcore_t *ecp,
+    int (*func)(uintptr_t, size_t, uint_t, const char *, void *), void *arg)
+{
+	const mdbv8_elfseg_t *esp;
+	size_t i;
+	int rv;
+
+	for (i = 0; i < ecp->ec_nsegs; i++) {
+		esp = &ecp->ec_segs[i];
+
+		if ((rv = func(esp->es_vaddr, esp->es_size, esp->es_flags,
+		    esp->es_name, arg)) != 0)
+			return (rv);
+	}
+
+	return (0);
+}
+
+/*
+ * Invoke "func" for each file mapping recorded in the core file's NT_FILE
+ * note, with the mapping's start and end addresses, the offset into the file
+ * that it maps (in bytes), the file's name, and "arg".  Iteration stops if
+ * "func" returns non-zero, and that value is returned.
+ */
+int
+mdbv8_elfcore_file_iter(mdbv8_elfcore_t *ecp,
+    int (*func)(uintptr_t, uintptr_t, uint64_t, const char *, void *),
+    void *arg)
+{
+	const uintptr_t *fp;
+	size_t i;
+	int rv;
+
+	for (i = 0; i < ecp->ec_nfiles; i++) {
+		fp = &ecp->ec_files[3 * i];
+
+		if (ecp->ec_filenames[i] == NULL)
+			continue;
+
+		if ((rv = func(fp[0], fp[1], (uint64_t)fp[2] *
+		    ecp->ec_filepgsz, ecp->ec_filenames[i], arg)) != 0)
+			return (rv);
+	}
+
+	return (0);
+}
+
+/*
+ * Returns the contents of the first note of type "type" (e.g., NT_PRSTATUS)
+ * and stores its size in *sizep, or returns NULL if there's no such note.
+ */
+const void *
+mdbv8_elfcore_note(mdbv8_elfcore_t *ecp, uint_t type, size_t *sizep)
+{
+	return (elfcore_note_find(ecp, type, sizep));
+}
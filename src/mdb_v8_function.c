@@ -174,11 +174,15 @@ static v8boundfunction_t *v8boundfunction_load_direct(uintptr_t, int);
 v8function_t *
 v8function_load(uintptr_t addr, int memflags)
 {
-	uint8_t type;
-	uintptr_t shared;
+	uintptr_t type, shared;
 	v8function_t *funcp;
+	heap_field_t fields[] = {
+		{ V8_OFF_HEAPOBJECT_MAP, HF_TYPE, &type },
+		{ V8_OFF_JSFUNCTION_SHARED, HF_PTR, &shared }
+	};
 
-	if (!V8_IS_HEAPOBJECT(addr) || read_typebyte(&type, addr) != 0) {
+	if (!V8_IS_HEAPOBJECT(addr) || read_heap_fields(addr, fields,
+	    sizeof (fields) / sizeof (fields[0])) != 0) {
 		v8_warn("%p: not a heap object\n", addr);
 		return (NULL);
 	}
@@ -188,11 +192,6 @@ v8function_load(uintptr_t addr, int memflags)
 		return (NULL);
 	}
 
-	if (read_heap_ptr(&shared, addr, V8_OFF_JSFUNCTION_SHARED) != 0) {
-		v8_warn("%p: no SharedFunctionInfo\n", addr);
-		return (NULL);
-	}
-
 	if ((funcp = mdb_zalloc(sizeof (*funcp), memflags)) == NULL) {
 		return (NULL);
 	}
@@ -296,17 +295,22 @@ v8funcinfo_load(uintptr_t funcinfo, int memflags)
 	v8funcinfo_t *fip;
 	uintptr_t script, name, inferred_name, code;
 	uintptr_t scriptpath, lineends, tokenpos;
-
-	if (read_heap_maybesmi(&tokenpos, funcinfo,
-	    V8_OFF_SHAREDFUNCTIONINFO_FUNCTION_TOKEN_POSITION) != 0 ||
-	    read_heap_ptr(&name, funcinfo,
-	    V8_OFF_SHAREDFUNCTIONINFO_NAME) != 0 ||
-	    read_heap_ptr(&script, funcinfo,
-	    V8_OFF_SHAREDFUNCTIONINFO_SCRIPT) != 0 ||
-	    read_heap_ptr(&scriptpath, script, V8_OFF_SCRIPT_NAME) != 0 ||
-	    read_heap_ptr(&lineends, script, V8_OFF_SCRIPT_LINE_ENDS) != 0 ||
-	    read_heap_ptr(&code, funcinfo,
-	    V8_OFF_SHAREDFUNCTIONINFO_CODE) != 0) {
+	heap_field_t fields[] = {
+		{ V8_OFF_SHAREDFUNCTIONINFO_FUNCTION_TOKEN_POSITION,
+		    HF_MAYBESMI, &tokenpos },
+		{ V8_OFF_SHAREDFUNCTIONINFO_NAME, HF_PTR, &name },
+		{ V8_OFF_SHAREDFUNCTIONINFO_SCRIPT, HF_PTR, &script },
+		{ V8_OFF_SHAREDFUNCTIONINFO_CODE, HF_PTR, &code }
+	};
+	heap_field_t scriptfields[] = {
+		{ V8_OFF_SCRIPT_NAME, HF_PTR, &scriptpath },
+		{ V8_OFF_SCRIPT_LINE_ENDS, HF_PTR, &lineends }
+	};
+
+	if (read_heap_fields(funcinfo, fields,
+	    sizeof (fields) / sizeof (fields[0])) != 0 ||
+	    read_heap_fields(script, scriptfields,
+	    sizeof (scriptfields) / sizeof (scriptfields[0])) != 0) {
 		return (NULL);
 	}
 
@@ -327,7 +331,7 @@ v8funcinfo_load(uintptr_t funcinfo, int memflags)
 	fip->v8fi_script = script;
 	fip->v8fi_scriptpath = scriptpath;
 	fip->v8fi_tokenpos = tokenpos;
-	fip->v8fi_line_endings = jsobj_is_undefined(lineends) ? NULL : lineends;
+	fip->v8fi_line_endings = jsobj_is_undefined(lineends) ? 0 : lineends;
 	fip->v8fi_code = code;
 	return (fip);
 }
@@ -379,7 +383,7 @@ v8funcinfo_funcname(v8funcinfo_t *fip, mdbv8_strbuf_t *strb,
 	 * If that failed or was empty, then we printed a generic name, but try
 	 * now to append the inferred name.
 	 */
-	if (fip->v8fi_inferred_name != NULL) {
+	if (fip->v8fi_inferred_name != 0) {
 		strp = v8string_load(fip->v8fi_inferred_name, UM_SLEEP);
 		if (strp != NULL) {
 			mdbv8_strbuf_sprintf(strb, " (as ");
@@ -452,7 +456,7 @@ v8funcinfo_definition_location(v8funcinfo_t *fip, mdbv8_strbuf_t *strb,
 	 * print out the position itself (which is basically a character offset
 	 * into the script).
 	 */
-	if (fip->v8fi_line_endings == NULL) {
+	if (fip->v8fi_line_endings == 0) {
 		if (tokpos == V8_VALUE_SMI(-1)) {
 			mdbv8_strbuf_sprintf(strb, "unknown position");
 		} else {
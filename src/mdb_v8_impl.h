@@ -44,9 +44,96 @@ int read_heap_maybesmi(uintptr_t *, uintptr_t, ssize_t);
 int read_heap_ptr(uintptr_t *, uintptr_t, ssize_t);
 int read_heap_smi(uintptr_t *, uintptr_t, ssize_t);
 int read_typebyte(uint8_t *, uintptr_t);
+
+/*
+ * Describes a field of a heap object to be read with read_heap_fields().
+ */
+typedef enum {
+	HF_PTR,			/* any value */
+	HF_HEAPOBJ,		/* must be a heap object pointer */
+	HF_SMI,			/* must be a SMI, whose value is stored */
+	HF_MAYBESMI,		/* see read_heap_maybesmi() */
+	HF_BYTE,		/* a single byte */
+	HF_TYPE			/* a Map, whose instance type is stored */
+} heap_field_kind_t;
+
+typedef struct heap_field {
+	ssize_t			hf_off;		/* offset within object */
+	heap_field_kind_t	hf_kind;	/* how to decode and check */
+	uintptr_t		*hf_valp;	/* where to store value */
+	boolean_t		hf_optional;	/* offset may be -1 */
+} heap_field_t;
+
+int read_heap_fields(uintptr_t, const heap_field_t *, size_t);
 void v8_warn(const char *, ...);
+boolean_t v8_isconfigured(void);
 boolean_t jsobj_is_undefined(uintptr_t);
 
+/*
+ * Cached access to the target's memory (see mdb_v8_mem.c).
+ */
+typedef struct mdbv8_memstats {
+	uint64_t mms_reads;		/* reads requested */
+	uint64_t mms_hits;		/* reads satisfied from the cache */
+	uint64_t mms_misses;		/* reads that filled a page */
+	uint64_t mms_bypassed;		/* reads not using the cache */
+	uint64_t mms_failures;		/* bypassed reads that failed */
+	uint64_t mms_vreads;		/* reads issued to the target */
+	uint64_t mms_vbytes;		/* bytes read from the target */
+	uint64_t mms_evictions;		/* pages evicted to make room */
+	uint64_t mms_mapped;		/* reads from mapped target memory */
+	uint64_t mms_unreadable;	/* reads known to be unreadable */
+	size_t mms_pagesize;		/* size of each page */
+	size_t mms_npages;		/* pages currently cached */
+	size_t mms_maxpages;		/* maximum pages cached */
+	boolean_t mms_enabled;		/* cache currently in use */
+	const char *mms_backend;	/* name of the current backend */
+	boolean_t mms_backmapped;	/* backend maps target memory */
+	size_t mms_nunreadable;		/* known-unreadable ranges */
+} mdbv8_memstats_t;
+
+/*
+ * A source of target memory.  mb_vread has the same semantics as mdb_vread().
+ * mb_vmap and mb_fini are optional; see mdbv8_vmap() and
+ * mdbv8_mem_setbackend().  Each entry point is passed the "arg" given to
+ * mdbv8_mem_setbackend().
+ */
+typedef struct mdbv8_membackend {
+	const char *mb_name;
+	ssize_t (*mb_vread)(void *, void *, size_t, uintptr_t);
+	const void *(*mb_vmap)(void *, size_t, uintptr_t);
+	void (*mb_fini)(void *);
+} mdbv8_membackend_t;
+
+ssize_t mdbv8_vread(void *, size_t, uintptr_t);
+const void *mdbv8_vmap(size_t, uintptr_t);
+void mdbv8_mem_setbackend(const mdbv8_membackend_t *, void *);
+void mdbv8_mem_configure(boolean_t);
+void mdbv8_mem_flush(void);
+void mdbv8_mem_hold(void);
+void mdbv8_mem_rele(void);
+void mdbv8_mem_setsize(size_t);
+void mdbv8_mem_stats(mdbv8_memstats_t *);
+void mdbv8_mem_resetstats(void);
+void mdbv8_mem_unreadable(uintptr_t, size_t);
+
+/*
+ * Linux ELF core files, read by mapping them into our address space (see
+ * mdb_v8_elfcore.c).
+ */
+typedef struct mdbv8_elfcore mdbv8_elfcore_t;
+
+extern const mdbv8_membackend_t mdbv8_elfcore_backend;
+
+mdbv8_elfcore_t *mdbv8_elfcore_open(const char *);
+void mdbv8_elfcore_close(mdbv8_elfcore_t *);
+const char *mdbv8_elfcore_path(mdbv8_elfcore_t *);
+int mdbv8_elfcore_iter(mdbv8_elfcore_t *,
+    int (*)(uintptr_t, size_t, uint_t, const char *, void *), void *);
+int mdbv8_elfcore_file_iter(mdbv8_elfcore_t *,
+    int (*)(uintptr_t, uintptr_t, uint64_t, const char *, void *), void *);
+const void *mdbv8_elfcore_note(mdbv8_elfcore_t *, uint_t, size_t *);
+
 /*
  * We need to find a better way of exposing this information.  For now, these
  * represent all the metadata constants used by multiple C files.
@@ -77,6 +164,7 @@ extern ssize_t V8_OFF_CONSSTRING_SECOND;
 extern ssize_t V8_OFF_EXTERNALSTRING_RESOURCE;
 extern ssize_t V8_OFF_FIXEDARRAY_DATA;
 extern ssize_t V8_OFF_FIXEDARRAY_LENGTH;
+extern ssize_t V8_OFF_HEAPOBJECT_MAP;
 extern ssize_t V8_OFF_JSARRAY_LENGTH;
 extern ssize_t V8_OFF_JSBOUNDFUNCTION_BOUND_ARGUMENTS;
 extern ssize_t V8_OFF_JSBOUNDFUNCTION_BOUND_TARGET_FUNCTION;
@@ -0,0 +1,585 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * Copyright (c) 2018, Joyent, Inc.
+ */
+
+/*
+ * mdb_v8_mem.c: cached access to the target's memory.
+ *
+ * Nearly everything this module does involves reading small fields of heap
+ * objects: a Map pointer here, a length there.  Each of those reads would
+ * otherwise be a separate mdb_vread(), which for a core file means a separate
+ * trip through the target layer to find the mapping and copy out a few bytes.
+ * Instead, the field readers (read_heap_ptr() and friends) go through
+ * mdbv8_vread(), which keeps a bounded set of recently-used pages of target
+ * memory, evicted in least-recently-used order.  Objects near each other in
+ * the heap usually refer to each other, so a single page read typically
+ * satisfies many subsequent field reads.
+ *
+ * The contents of a live process may change between commands, so like the
+ * Map type cache in mdb_v8.c, the page cache is only used when the target is
+ * a core file or while some operation holds it with mdbv8_mem_hold().  The
+ * cache is emptied whenever we're reconfigured for a new target.  Reads
+ * larger than a page bypass the cache, as do reads from pages that can't be
+ * read in full (because they span the end of a mapping, for example).
+ *
+ * Beneath the cache, target memory is read through a backend.  By default,
+ * that's the debugger's own target (mdb_vread()), but another backend may be
+ * installed with mdbv8_mem_setbackend().  A backend that can map target memory
+ * directly into our address space (like the ELF core file backend in
+ * mdb_v8_elfcore.c) provides an mb_vmap entry point.  Reads from such a
+ * backend are just a bounds check and a copy out of the mapping, so they skip
+ * the page cache entirely, and callers that read large ranges can use
+ * mdbv8_vmap() to avoid even that copy.
+ *
+ * Many reads are expected to fail: heuristics like ::v8whatis and the
+ * candidate checks of a heap scan read whatever addresses they're given,
+ * and plenty of those land in unmapped memory or in mappings that weren't
+ * saved in the core file.  Each failed read is a trip through the target's
+ * error path, so we also keep a set of address ranges known to be unreadable,
+ * in an AVL tree of disjoint intervals.  Reads that overlap one of these
+ * ranges fail immediately.  mdb_v8.c seeds the set with the gaps between the
+ * target's mappings, and when a read fails, we probe the pages it spans and
+ * add those that can't be read.  Like the page cache, this set is only kept
+ * while the cache is in use, since a live process's mappings may change,
+ * unless the target is a core file or memory is read from a backend (which
+ * reads a fixed image) rather than from the debugger's target.
+ */
+
+#include "mdb_v8_dbg.h"
+#include "mdb_v8_impl.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stddef.h>
+#include <strings.h>
+#include <sys/avl.h>
+
+#define	MDBV8_MEM_PAGESHIFT	16
+#define	MDBV8_MEM_PAGESIZE	((size_t)1 << MDBV8_MEM_PAGESHIFT)
+#define	MDBV8_MEM_PAGEMASK	(~(uintptr_t)(MDBV8_MEM_PAGESIZE - 1))
+#define	MDBV8_MEM_NBUCKETS	1024
+
+/*
+ * By default, the cache holds up to 16MB of target memory.
+ */
+#define	MDBV8_MEM_NPAGES	256
+
+/*
+ * When a read fails, we find out which parts of it can't be read by probing
+ * one byte at the start of each page it spans, up to a limit.  The probe size
+ * is the smallest page size of any target we support, so a failed probe means
+ * that the whole probe-sized page is unreadable.
+ */
+#define	MDBV8_MEM_PROBESIZE	4096
+#define	MDBV8_MEM_PROBEMAX	16
+
+typedef struct mdbv8_mempage {
+	uintptr_t mmp_addr;			/* target address of page */
+	boolean_t mmp_valid;			/* page could be read */
+	uint8_t *mmp_data;			/* contents of page */
+	struct mdbv8_mempage *mmp_hnext;	/* next in hash bucket */
+	struct mdbv8_mempage *mmp_prev;		/* more recently used */
+	struct mdbv8_mempage *mmp_next;		/* less recently used */
+} mdbv8_mempage_t;
+
+typedef struct mdbv8_memrange {
+	uintptr_t mmr_start;			/* first unreadable address */
+	uintptr_t mmr_last;			/* last unreadable address */
+	avl_node_t mmr_node;			/* node in mm_unreadable */
+} mdbv8_memrange_t;
+
+/* ARGSUSED */
+static ssize_t
+mdbv8_mem_mdb_vread(void *arg, void *buf, size_t nbytes, uintptr_t addr)
+{
+	return (mdb_vread(buf, nbytes, addr));
+}
+
+static const mdbv8_membackend_t mdbv8_mem_mdb = {
+	.mb_name = "debugger target",
+	.mb_vread = mdbv8_mem_mdb_vread
+};
+
+typedef struct mdbv8_mem {
+	mdbv8_mempage_t *mm_buckets[MDBV8_MEM_NBUCKETS];
+	mdbv8_mempage_t mm_lru;			/* list head (not a page) */
+	size_t mm_npages;			/* number of pages cached */
+	size_t mm_maxpages;			/* maximum pages to cache */
+	int mm_holds;				/* see mdbv8_mem_hold() */
+	boolean_t mm_persist;			/* cache across commands */
+	mdbv8_memstats_t mm_stats;		/* statistics */
+	const mdbv8_membackend_t *mm_backend;	/* source of target memory */
+	void *mm_backarg;			/* backend's private state */
+	avl_tree_t mm_unreadable;		/* unreadable ranges */
+	boolean_t mm_unreadable_init;		/* mm_unreadable is created */
+} mdbv8_mem_t;
+
+static mdbv8_mem_t mdbv8_mem = {
+	.mm_lru = { .mmp_prev = &mdbv8_mem.mm_lru,
+	    .mmp_next = &mdbv8_mem.mm_lru },
+	.mm_maxpages = MDBV8_MEM_NPAGES,
+	.mm_backend = &mdbv8_mem_mdb
+};
+
+static ssize_t
+mdbv8_mem_backread(void *buf, size_t nbytes, uintptr_t addr)
+{
+	return (mdbv8_mem.mm_backend->mb_vread(mdbv8_mem.mm_backarg,
+	    buf, nbytes, addr));
+}
+
+static int
+mdbv8_memrange_cmp(const void *l, const void *r)
+{
+	const mdbv8_memrange_t *lhs = l, *rhs = r;
+
+	if (lhs->mmr_start < rhs->mmr_start)
+		return (-1);
+
+	return (lhs->mmr_start > rhs->mmr_start);
+}
+
+static avl_tree_t *
+mdbv8_mem_ranges(void)
+{
+	if (!mdbv8_mem.mm_unreadable_init) {
+		avl_create(&mdbv8_mem.mm_unreadable, mdbv8_memrange_cmp,
+		    sizeof (mdbv8_memrange_t),
+		    offsetof(mdbv8_memrange_t, mmr_node));
+		mdbv8_mem.mm_unreadable_init = B_TRUE;
+	}
+
+	return (&mdbv8_mem.mm_unreadable);
+}
+
+/*
+ * Returns a known-unreadable range that overlaps [addr, last], if any.  The
+ * ranges are disjoint, so only the range starting at or before "addr" and the
+ * one after it can overlap.
+ */
+static mdbv8_memrange_t *
+mdbv8_mem_unreadable_find(uintptr_t addr, uintptr_t last)
+{
+	avl_tree_t *tree = mdbv8_mem_ranges();
+	mdbv8_memrange_t search, *mmr;
+	avl_index_t where;
+
+	search.mmr_start = addr;
+
+	if ((mmr = avl_find(tree, &search, &where)) != NULL)
+		return (mmr);
+
+	if ((mmr = avl_nearest(tree, where, AVL_BEFORE)) != NULL &&
+	    mmr->mmr_last >= addr)
+		return (mmr);
+
+	if ((mmr = avl_nearest(tree, where, AVL_AFTER)) != NULL &&
+	    mmr->mmr_start <= last)
+		return (mmr);
+
+	return (NULL);
+}
+
+/*
+ * Returns true if any part of the "nbytes" at "addr" is known to be
+ * unreadable.
+ */
+static boolean_t
+mdbv8_mem_isunreadable(size_t nbytes, uintptr_t addr)
+{
+	if (nbytes == 0 || addr + (nbytes - 1) < addr ||
+	    avl_is_empty(mdbv8_mem_ranges()))
+		return (B_FALSE);
+
+	return (mdbv8_mem_unreadable_find(addr, addr + (nbytes - 1)) != NULL);
+}
+
+/*
+ * Record that the "nbytes" at "addr" can't be read, merging the range with any
+ * known-unreadable ranges that it overlaps or abuts.
+ */
+void
+mdbv8_mem_unreadable(uintptr_t addr, size_t nbytes)
+{
+	avl_tree_t *tree = mdbv8_mem_ranges();
+	mdbv8_memrange_t *mmr;
+	uintptr_t last;
+
+	if (nbytes == 0)
+		return;
+
+	last = addr + (nbytes - 1) < addr ? UINTPTR_MAX : addr + (nbytes - 1);
+
+	while ((mmr = mdbv8_mem_unreadable_find(addr == 0 ? 0 : addr - 1,
+	    last == UINTPTR_MAX ? last : last + 1)) != NULL) {
+		addr = MIN(addr, mmr->mmr_start);
+		last = MAX(last, mmr->mmr_last);
+		avl_remove(tree, mmr);
+		mdb_free(mmr, sizeof (mdbv8_memrange_t));
+	}
+
+	mmr = mdb_alloc(sizeof (mdbv8_memrange_t), UM_SLEEP);
+	mmr->mmr_start = addr;
+	mmr->mmr_last = last;
+	avl_add(tree, mmr);
+}
+
+/*
+ * Returns true if the known-unreadable ranges remain valid when nothing holds
+ * the cache: the target is a core file, or we're reading memory from a backend
+ * rather than from the debugger's target.
+ */
+static boolean_t
+mdbv8_mem_ranges_static(void)
+{
+	return (mdbv8_mem.mm_persist || mdbv8_mem.mm_backend != &mdbv8_mem_mdb);
+}
+
+/*
+ * Discard all known-unreadable ranges.
+ */
+static void
+mdbv8_mem_unreadable_flush(void)
+{
+	mdbv8_memrange_t *mmr;
+	void *cookie = NULL;
+
+	if (!mdbv8_mem.mm_unreadable_init)
+		return;
+
+	while ((mmr = avl_destroy_nodes(&mdbv8_mem.mm_unreadable,
+	    &cookie)) != NULL)
+		mdb_free(mmr, sizeof (mdbv8_memrange_t));
+
+	avl_destroy(&mdbv8_mem.mm_unreadable);
+	mdbv8_mem.mm_unreadable_init = B_FALSE;
+}
+
+/*
+ * Invoked when a read of the "nbytes" at "addr" has failed.  Find out which of
+ * the pages it spans can't be read, so that later reads from them can fail
+ * without consulting the target.
+ */
+static void
+mdbv8_mem_probe(size_t nbytes, uintptr_t addr)
+{
+	uintptr_t page, last;
+	uint8_t byte;
+	int i;
+
+	if ((mdbv8_mem.mm_holds == 0 && !mdbv8_mem_ranges_static()) ||
+	    nbytes == 0 || addr + (nbytes - 1) < addr)
+		return;
+
+	last = addr + (nbytes - 1);
+	page = addr & ~(uintptr_t)(MDBV8_MEM_PROBESIZE - 1);
+
+	for (i = 0; i < MDBV8_MEM_PROBEMAX; i++) {
+		mdbv8_mem.mm_stats.mms_vreads++;
+		if (mdbv8_mem_backread(&byte, sizeof (byte), page) == -1)
+			mdbv8_mem_unreadable(page, MDBV8_MEM_PROBESIZE);
+
+		if (last - page < MDBV8_MEM_PROBESIZE)
+			break;
+
+		page += MDBV8_MEM_PROBESIZE;
+	}
+}
+
+static mdbv8_mempage_t **
+mdbv8_mem_bucket(uintptr_t pageaddr)
+{
+	uint64_t hash = (uint64_t)(pageaddr >> MDBV8_MEM_PAGESHIFT) *
+	    0x9e3779b97f4a7c15ULL;
+
+	return (&mdbv8_mem.mm_buckets[(hash >> 32) % MDBV8_MEM_NBUCKETS]);
+}
+
+static void
+mdbv8_mem_unlink(mdbv8_mempage_t *mmp)
+{
+	mmp->mmp_prev->mmp_next = mmp->mmp_next;
+	mmp->mmp_next->mmp_prev = mmp->mmp_prev;
+}
+
+static void
+mdbv8_mem_push(mdbv8_mempage_t *mmp)
+{
+	mdbv8_mempage_t *head = &mdbv8_mem.mm_lru;
+
+	mmp->mmp_prev = head;
+	mmp->mmp_next = head->mmp_next;
+	head->mmp_next->mmp_prev = mmp;
+	head->mmp_next = mmp;
+}
+
+/*
+ * Remove the least-recently-used page from the cache and return it, so that
+ * its buffer can be reused.
+ */
+static mdbv8_mempage_t *
+mdbv8_mem_evict(void)
+{
+	mdbv8_mempage_t *mmp = mdbv8_mem.mm_lru.mmp_prev, **pp;
+
+	assert(mmp != &mdbv8_mem.mm_lru);
+
+	for (pp = mdbv8_mem_bucket(mmp->mmp_addr); *pp != mmp;
+	    pp = &(*pp)->mmp_hnext)
+		continue;
+
+	*pp = mmp->mmp_hnext;
+	mdbv8_mem_unlink(mmp);
+	mdbv8_mem.mm_npages--;
+
+	return (mmp);
+}
+
+/*
+ * Returns the cached page at "pageaddr", reading it from the target if it's
+ * not already cached.  *missp is set if the page had to be read.
+ */
+static mdbv8_mempage_t *
+mdbv8_mem_page(uintptr_t pageaddr, boolean_t *missp)
+{
+	mdbv8_mempage_t **bucket, *mmp;
+
+	bucket = mdbv8_mem_bucket(pageaddr);
+
+	for (mmp = *bucket; mmp != NULL; mmp = mmp->mmp_hnext) {
+		if (mmp->mmp_addr == pageaddr) {
+			mdbv8_mem_unlink(mmp);
+			mdbv8_mem_push(mmp);
+			return (mmp);
+		}
+	}
+
+	*missp = B_TRUE;
+
+	if (mdbv8_mem.mm_npages >= mdbv8_mem.mm_maxpages) {
+		mmp = mdbv8_mem_evict();
+		mdbv8_mem.mm_stats.mms_evictions++;
+	} else {
+		mmp = mdb_zalloc(sizeof (mdbv8_mempage_t), UM_SLEEP);
+		mmp->mmp_data = mdb_alloc(MDBV8_MEM_PAGESIZE, UM_SLEEP);
+	}
+
+	mmp->mmp_addr = pageaddr;
+
+	/*
+	 * If part of the page is known to be unreadable, there's no point in
+	 * trying to read all of it.
+	 */
+	if (mdbv8_mem_isunreadable(MDBV8_MEM_PAGESIZE, pageaddr)) {
+		mmp->mmp_valid = B_FALSE;
+	} else {
+		mdbv8_mem.mm_stats.mms_vreads++;
+		mmp->mmp_valid = mdbv8_mem_backread(mmp->mmp_data,
+		    MDBV8_MEM_PAGESIZE, pageaddr) == MDBV8_MEM_PAGESIZE;
+	}
+
+	if (mmp->mmp_valid)
+		mdbv8_mem.mm_stats.mms_vbytes += MDBV8_MEM_PAGESIZE;
+
+	mmp->mmp_hnext = *bucket;
+	*bucket = mmp;
+	mdbv8_mem_push(mmp);
+	mdbv8_mem.mm_npages++;
+
+	return (mmp);
+}
+
+static ssize_t
+mdbv8_mem_direct(void *buf, size_t nbytes, uintptr_t addr)
+{
+	ssize_t rv;
+
+	if (mdbv8_mem_isunreadable(nbytes, addr)) {
+		mdbv8_mem.mm_stats.mms_unreadable++;
+		errno = EFAULT;
+		return (-1);
+	}
+
+	mdbv8_mem.mm_stats.mms_bypassed++;
+	mdbv8_mem.mm_stats.mms_vreads++;
+
+	if ((rv = mdbv8_mem_backread(buf, nbytes, addr)) == -1) {
+		int err = errno;
+
+		mdbv8_mem.mm_stats.mms_failures++;
+		mdbv8_mem_probe(nbytes, addr);
+		errno = err;
+	} else {
+		mdbv8_mem.mm_stats.mms_vbytes += rv;
+	}
+
+	return (rv);
+}
+
+/*
+ * Read "nbytes" of target memory at "addr" into "buf", using the page cache
+ * where possible.  This has the same semantics as mdb_vread().
+ */
+ssize_t
+mdbv8_vread(void *buf, size_t nbytes, uintptr_t addr)
+{
+	mdbv8_mempage_t *mmp;
+	uintptr_t pageaddr, off;
+	size_t n, done;
+	boolean_t miss = B_FALSE;
+	const void *p;
+
+	mdbv8_mem.mm_stats.mms_reads++;
+
+	if ((p = mdbv8_vmap(nbytes, addr)) != NULL) {
+		mdbv8_mem.mm_stats.mms_mapped++;
+		bcopy(p, buf, nbytes);
+		return (nbytes);
+	}
+
+	if ((mdbv8_mem.mm_holds == 0 && !mdbv8_mem.mm_persist) ||
+	    mdbv8_mem.mm_maxpages == 0 || nbytes > MDBV8_MEM_PAGESIZE ||
+	    addr + nbytes < addr)
+		return (mdbv8_mem_direct(buf, nbytes, addr));
+
+	for (done = 0; done < nbytes; done += n) {
+		pageaddr = (addr + done) & MDBV8_MEM_PAGEMASK;
+		off = (addr + done) - pageaddr;
+		n = MIN(nbytes - done, MDBV8_MEM_PAGESIZE - off);
+		mmp = mdbv8_mem_page(pageaddr, &miss);
+
+		if (!mmp->mmp_valid)
+			return (mdbv8_mem_direct(buf, nbytes, addr));
+
+		bcopy(mmp->mmp_data + off, (uint8_t *)buf + done, n);
+	}
+
+	if (miss)
+		mdbv8_mem.mm_stats.mms_misses++;
+	else
+		mdbv8_mem.mm_stats.mms_hits++;
+
+	return (nbytes);
+}
+
+/*
+ * If the backend can map target memory directly, returns a pointer to the
+ * "nbytes" of target memory at "addr", which remains valid until the backend
+ * is changed.  Otherwise (including when the range isn't contiguous in the
+ * backend), returns NULL, and the caller must use mdbv8_vread() instead.
+ */
+const void *
+mdbv8_vmap(size_t nbytes, uintptr_t addr)
+{
+	if (mdbv8_mem.mm_backend->mb_vmap == NULL || addr + nbytes < addr)
+		return (NULL);
+
+	return (mdbv8_mem.mm_backend->mb_vmap(mdbv8_mem.mm_backarg,
+	    nbytes, addr));
+}
+
+/*
+ * Discard all cached pages.
+ */
+void
+mdbv8_mem_flush(void)
+{
+	mdbv8_mempage_t *mmp;
+
+	while (mdbv8_mem.mm_npages > 0) {
+		mmp = mdbv8_mem_evict();
+		mdb_free(mmp->mmp_data, MDBV8_MEM_PAGESIZE);
+		mdb_free(mmp, sizeof (mdbv8_mempage_t));
+	}
+}
+
+/*
+ * Invoked when we (re)configure ourselves for a target.  If "persist" is set
+ * (because the target is a core file), pages are kept across commands.
+ */
+void
+mdbv8_mem_configure(boolean_t persist)
+{
+	mdbv8_mem_flush();
+	mdbv8_mem_unreadable_flush();
+	mdbv8_mem.mm_persist = persist;
+}
+
+/*
+ * Read target memory through "mbp" (with private state "arg") from now on.  If
+ * "mbp" is NULL, go back to reading from the debugger's target.  The previous
+ * backend's mb_fini entry point, if any, is invoked to release its state.
+ */
+void
+mdbv8_mem_setbackend(const mdbv8_membackend_t *mbp, void *arg)
+{
+	const mdbv8_membackend_t *old = mdbv8_mem.mm_backend;
+	void *oldarg = mdbv8_mem.mm_backarg;
+
+	mdbv8_mem_flush();
+	mdbv8_mem_unreadable_flush();
+	mdbv8_mem.mm_backend = mbp != NULL ? mbp : &mdbv8_mem_mdb;
+	mdbv8_mem.mm_backarg = mbp != NULL ? arg : NULL;
+
+	if (old->mb_fini != NULL)
+		old->mb_fini(oldarg);
+}
+
+void
+mdbv8_mem_hold(void)
+{
+	mdbv8_mem.mm_holds++;
+}
+
+void
+mdbv8_mem_rele(void)
+{
+	assert(mdbv8_mem.mm_holds > 0);
+
+	if (--mdbv8_mem.mm_holds == 0 && !mdbv8_mem.mm_persist) {
+		mdbv8_mem_flush();
+
+		if (!mdbv8_mem_ranges_static())
+			mdbv8_mem_unreadable_flush();
+	}
+}
+
+/*
+ * Set the maximum size of the cache, in bytes.  A size of 0 disables it.
+ */
+void
+mdbv8_mem_setsize(size_t nbytes)
+{
+	mdbv8_mem.mm_maxpages = nbytes / MDBV8_MEM_PAGESIZE;
+	mdbv8_mem_flush();
+}
+
+/*
+ * Returns the current statistics, including the cache's configuration.
+ */
+void
+mdbv8_mem_stats(mdbv8_memstats_t *statsp)
+{
+	*statsp = mdbv8_mem.mm_stats;
+	statsp->mms_pagesize = MDBV8_MEM_PAGESIZE;
+	statsp->mms_npages = mdbv8_mem.mm_npages;
+	statsp->mms_maxpages = mdbv8_mem.mm_maxpages;
+	statsp->mms_backend = mdbv8_mem.mm_backend->mb_name;
+	statsp->mms_backmapped = mdbv8_mem.mm_backend->mb_vmap != NULL;
+	statsp->mms_nunreadable = mdbv8_mem.mm_unreadable_init ?
+	    avl_numnodes(&mdbv8_mem.mm_unreadable) : 0;
+	statsp->mms_enabled = mdbv8_mem.mm_maxpages != 0 &&
+	    (mdbv8_mem.mm_holds != 0 || mdbv8_mem.mm_persist);
+}
+
+void
+mdbv8_mem_resetstats(void)
+{
+	bzero(&mdbv8_mem.mm_stats, sizeof (mdbv8_mem.mm_stats));
+}
@@ -15,13 +15,21 @@
 #include "mdb_v8_dbg.h"
 #include "mdb_v8_impl.h"
 
+#include <assert.h>
 #include <ctype.h>
+#include <stdint.h>
 #include <stdio.h>
 
 typedef enum {
 	MSB_NOALLOC	= 0x1,	/* stack-allocated strbuf */
 } mdbv8_strbuf_flags_t;
 
+/*
+ * When a strbuf has a flush function, it's flushed whenever fewer than this
+ * many bytes are left, which is more than any single append writes.
+ */
+#define	MSB_FLUSHSZ	64
+
 mdbv8_strbuf_t *
 mdbv8_strbuf_alloc(size_t nbytes, int memflags)
 {
@@ -83,6 +91,34 @@ mdbv8_strbuf_legacy_update(mdbv8_strbuf_t *strb, char **bufp, size_t *lenp)
 	*lenp = strb->ms_curbufsz;
 }
 
+/*
+ * Turns "strb" into a stream: rather than truncating its contents when the
+ * buffer fills, pass them to "flush" (along with "arg") and start again at the
+ * beginning of the buffer.  This allows arbitrarily long strings to be
+ * processed through a fixed-size buffer.  Callers must call
+ * mdbv8_strbuf_flush() once they've finished writing to consume whatever is
+ * left in the buffer.
+ */
+void
+mdbv8_strbuf_setflush(mdbv8_strbuf_t *strb, mdbv8_strbuf_flush_f flush,
+    void *arg)
+{
+	assert(strb->ms_bufsz > 2 * MSB_FLUSHSZ);
+	strb->ms_flush = flush;
+	strb->ms_flusharg = arg;
+}
+
+void
+mdbv8_strbuf_flush(mdbv8_strbuf_t *strb)
+{
+	if (strb->ms_flush == NULL || strb->ms_curbuf == strb->ms_buf)
+		return;
+
+	strb->ms_flush(strb->ms_flusharg, strb->ms_buf,
+	    strb->ms_curbuf - strb->ms_buf);
+	mdbv8_strbuf_rewind(strb);
+}
+
 size_t
 mdbv8_strbuf_bufsz(mdbv8_strbuf_t *strb)
 {
@@ -92,6 +128,12 @@ mdbv8_strbuf_bufsz(mdbv8_strbuf_t *strb)
 size_t
 mdbv8_strbuf_bytesleft(mdbv8_strbuf_t *strb)
 {
+	/*
+	 * A stream never runs out of space.
+	 */
+	if (strb->ms_flush != NULL)
+		return (SIZE_MAX);
+
 	if (strb->ms_curbufsz - 1 < strb->ms_reservesz)
 		return (0);
 
@@ -143,7 +185,7 @@ mdbv8_strbuf_appendc(mdbv8_strbuf_t *strb, uint16_t c,
 			return;
 
 		case '"':
-			mdbv8_strbuf_sprintf(strb, "\"");
+			mdbv8_strbuf_sprintf(strb, "\\\"");
 			return;
 
 		default:
@@ -155,6 +197,21 @@ mdbv8_strbuf_appendc(mdbv8_strbuf_t *strb, uint16_t c,
 		}
 	}
 
+	if ((flags & MSF_UTF8) != 0 && c >= 0x80) {
+		/*
+		 * Each UTF-16 code unit is encoded separately, so surrogate
+		 * pairs come out as two three-byte sequences.
+		 */
+		if (c < 0x800) {
+			mdbv8_strbuf_sprintf(strb, "%c%c",
+			    0xc0 | (c >> 6), 0x80 | (c & 0x3f));
+		} else {
+			mdbv8_strbuf_sprintf(strb, "%c%c%c", 0xe0 | (c >> 12),
+			    0x80 | ((c >> 6) & 0x3f), 0x80 | (c & 0x3f));
+		}
+		return;
+	}
+
 	mdbv8_strbuf_sprintf(strb, "%c", c);
 }
 
@@ -178,6 +235,10 @@ mdbv8_strbuf_nbytesforchar(uint16_t c, mdbv8_strappend_flags_t flags)
 		}
 	}
 
+	if ((flags & MSF_ASCIIONLY) == 0 && (flags & MSF_UTF8) != 0 &&
+	    c >= 0x80)
+		return (c < 0x800 ? 2 : 3);
+
 	return (1);
 }
 
@@ -196,6 +257,10 @@ mdbv8_strbuf_vsprintf(mdbv8_strbuf_t *strb, const char *format, va_list alist)
 {
 	size_t rv, len;
 
+	if (strb->ms_flush != NULL &&
+	    strb->ms_curbufsz < strb->ms_reservesz + MSB_FLUSHSZ)
+		mdbv8_strbuf_flush(strb);
+
 	if (strb->ms_curbufsz <= strb->ms_reservesz)
 		return;
 
@@ -66,11 +66,17 @@ static size_t v8s_truncate_marker_bytes = sizeof ("[...]") - 1;
 v8string_t *
 v8string_load(uintptr_t addr, int memflags)
 {
-	uint8_t type;
-	uintptr_t length;
+	uintptr_t type, length;
 	v8string_t *strp;
-
-	if (read_typebyte(&type, addr) != 0) {
+	heap_field_t fields[] = {
+		{ V8_OFF_HEAPOBJECT_MAP, HF_TYPE, &type },
+		{ V8_OFF_STRING_LENGTH, HF_PTR, &length }
+	};
+	heap_field_t repfields[2];
+	size_t nrepfields = 0;
+
+	if (read_heap_fields(addr, fields,
+	    sizeof (fields) / sizeof (fields[0])) != 0) {
 		v8_warn("could not read type for string: %p\n", addr);
 		return (NULL);
 	}
@@ -86,7 +92,7 @@ v8string_load(uintptr_t addr, int memflags)
 		return (NULL);
 	}
 
-	if (read_heap_smi(&length, addr, V8_OFF_STRING_LENGTH) != 0) {
+	if (!V8_IS_SMI(length)) {
 		v8_warn("failed to read string length: %p\n", addr);
 		return (NULL);
 	}
@@ -96,25 +102,40 @@ v8string_load(uintptr_t addr, int memflags)
 	}
 
 	strp->v8s_addr = addr;
-	strp->v8s_len = length;
+	strp->v8s_len = V8_SMI_VALUE(length);
 	strp->v8s_type = type;
 	strp->v8s_memflags = memflags;
 
+	/*
+	 * The fields specific to each representation are read in a second
+	 * batch once we know which representation this is.
+	 */
+	bzero(repfields, sizeof (repfields));
+
 	if (V8_STRREP_CONS(type)) {
-		if (read_heap_ptr(&strp->v8s_info.v8s_consinfo.v8s_cons_p1,
-		    addr, V8_OFF_CONSSTRING_FIRST) != 0 ||
-		    read_heap_ptr(&strp->v8s_info.v8s_consinfo.v8s_cons_p2,
-		    addr, V8_OFF_CONSSTRING_SECOND) != 0) {
+		repfields[0].hf_off = V8_OFF_CONSSTRING_FIRST;
+		repfields[0].hf_valp =
+		    &strp->v8s_info.v8s_consinfo.v8s_cons_p1;
+		repfields[1].hf_off = V8_OFF_CONSSTRING_SECOND;
+		repfields[1].hf_valp =
+		    &strp->v8s_info.v8s_consinfo.v8s_cons_p2;
+		nrepfields = 2;
+
+		if (read_heap_fields(addr, repfields, nrepfields) != 0) {
 			v8_warn("failed to read cons ptrs: %p\n", addr);
 			goto fail;
 		}
 	} else if (V8_STRREP_SLICED(type)) {
-		if (read_heap_ptr(
-		    &strp->v8s_info.v8s_slicedinfo.v8s_sliced_parent,
-		    addr, V8_OFF_SLICEDSTRING_PARENT) != 0 ||
-		    read_heap_smi(
-		    &strp->v8s_info.v8s_slicedinfo.v8s_sliced_offset,
-		    addr, V8_OFF_SLICEDSTRING_OFFSET) != 0) {
+		repfields[0].hf_off = V8_OFF_SLICEDSTRING_PARENT;
+		repfields[0].hf_valp =
+		    &strp->v8s_info.v8s_slicedinfo.v8s_sliced_parent;
+		repfields[1].hf_off = V8_OFF_SLICEDSTRING_OFFSET;
+		repfields[1].hf_kind = HF_SMI;
+		repfields[1].hf_valp =
+		    &strp->v8s_info.v8s_slicedinfo.v8s_sliced_offset;
+		nrepfields = 2;
+
+		if (read_heap_fields(addr, repfields, nrepfields) != 0) {
 			v8_warn("failed to read slice info: %p\n", addr);
 			goto fail;
 		}
@@ -227,6 +248,82 @@ v8string_write(v8string_t *strp, mdbv8_strbuf_t *strb,
 	return (err);
 }
 
+/*
+ * Like v8string_write(), but ConsStrings are walked iteratively, using an
+ * explicit stack of the pieces yet to be written, rather than recursively.
+ * Each piece that isn't itself a ConsString is written with v8string_write().
+ * This allows strings built up by many concatenations (whose trees may be far
+ * deeper than JSSTR_MAXDEPTH) to be written in full, which is mostly useful
+ * with a streaming string buffer (see mdbv8_strbuf_setflush()).  Quoting and
+ * verbose output are not supported.
+ */
+int
+v8string_write_pieces(v8string_t *strp, mdbv8_strbuf_t *strb,
+    mdbv8_strappend_flags_t strflags, v8string_flags_t v8flags)
+{
+	uintptr_t *stack, *newstack;
+	size_t depth, nalloc, npieces, maxpieces;
+	v8string_t *piecep;
+	int rv = 0;
+
+	assert((v8flags & (JSSTR_QUOTED | JSSTR_VERBOSE)) == 0);
+
+	if (!V8_STRREP_CONS(strp->v8s_type))
+		return (v8string_write(strp, strb, strflags, v8flags));
+
+	/*
+	 * Every leaf of a well-formed tree is either non-empty or the empty
+	 * second half of a flattened ConsString, so a tree can't have more
+	 * than about four pieces per character.  We use this to bail out of
+	 * cycles in a corrupt heap.
+	 */
+	maxpieces = 4 * (v8string_length(strp) + 1);
+	nalloc = JSSTR_MAXDEPTH;
+	stack = mdb_alloc(nalloc * sizeof (uintptr_t), UM_SLEEP);
+	stack[0] = strp->v8s_info.v8s_consinfo.v8s_cons_p2;
+	stack[1] = strp->v8s_info.v8s_consinfo.v8s_cons_p1;
+	depth = 2;
+
+	for (npieces = 0; depth > 0 && rv == 0; npieces++) {
+		if (npieces > maxpieces) {
+			mdbv8_strbuf_sprintf(strb,
+			    "<string (cons tree too large)>");
+			rv = -1;
+			break;
+		}
+
+		piecep = v8string_load(stack[--depth], UM_SLEEP);
+		if (piecep == NULL) {
+			mdbv8_strbuf_sprintf(strb,
+			    "<string (failed to read cons ptrs)>");
+			rv = -1;
+			break;
+		}
+
+		if (!V8_STRREP_CONS(piecep->v8s_type)) {
+			rv = v8string_write(piecep, strb, strflags, v8flags);
+			v8string_free(piecep);
+			continue;
+		}
+
+		if (depth + 2 > nalloc) {
+			newstack = mdb_alloc(2 * nalloc * sizeof (uintptr_t),
+			    UM_SLEEP);
+			bcopy(stack, newstack, depth * sizeof (uintptr_t));
+			mdb_free(stack, nalloc * sizeof (uintptr_t));
+			stack = newstack;
+			nalloc *= 2;
+		}
+
+		stack[depth++] = piecep->v8s_info.v8s_consinfo.v8s_cons_p2;
+		stack[depth++] = piecep->v8s_info.v8s_consinfo.v8s_cons_p1;
+		v8string_free(piecep);
+	}
+
+	mdb_free(stack, nalloc * sizeof (uintptr_t));
+	return (rv);
+}
+
 /*
  * This structure is used to keep track of state while writing out a sequential
  * string.
@@ -251,7 +348,7 @@ typedef struct {
 	mdbv8_strbuf_t	*v8sw_strb;		/* output buffer */
 	mdbv8_strappend_flags_t v8sw_strflags;	/* output flags */
 
-	char		*v8sw_chunk;		/* raw data (input) buffer */
+	uint8_t		*v8sw_chunk;		/* raw data (input) buffer */
 	size_t		v8sw_chunksz;		/* raw data buffer size */
 	size_t		v8sw_chunki;		/* position in raw buffer */
 	boolean_t	v8sw_chunklast;		/* this is the last chunk */
@@ -287,7 +384,7 @@ v8string_write_seq(v8string_t *strp, mdbv8_strbuf_t *strb,
 	size_t inbytesperchar;	/* bytes per character */
 	uintptr_t charsp;	/* start of string */
 	size_t bufsz;		/* internal buffer size */
-	char buf[8192];		/* internal buffer */
+	uint8_t buf[8192];	/* internal buffer */
 	int err;
 
 	v8string_write_t write;	/* write state */
@@ -399,7 +496,7 @@ v8string_write_seq_chunk(v8string_write_t *writep)
 		writep->v8sw_chunklast = B_TRUE;
 	}
 
-	if (mdb_vread(writep->v8sw_chunk, nbytestoread,
+	if (mdbv8_vread(writep->v8sw_chunk, nbytestoread,
 	    writep->v8sw_charsp + writep->v8sw_readoff) == -1) {
 		mdbv8_strbuf_sprintf(writep->v8sw_strb,
 		    "<string (failed to read data)>");
@@ -413,7 +510,7 @@ v8string_write_seq_chunk(v8string_write_t *writep)
 	 * and we do it as much for historical reasons as anything else.
 	 */
 	if (writep->v8sw_asciicheck) {
-		char firstchar = writep->v8sw_chunk[0];
+		uint8_t firstchar = writep->v8sw_chunk[0];
 		if (firstchar != '\0' && !isascii(firstchar)) {
 			mdbv8_strbuf_sprintf(writep->v8sw_strb,
 			    "<string (contents looks invalid)>");
@@ -646,7 +743,7 @@ static int
 v8string_write_ext(v8string_t *strp, mdbv8_strbuf_t *strb,
     mdbv8_strappend_flags_t strflags, v8string_flags_t v8flags)
 {
-	char buf[8192];
+	uint8_t buf[8192];
 	size_t ntotal;
 	uintptr_t charsp;
 	v8string_write_t write;
@@ -662,17 +759,12 @@ v8string_write_ext(v8string_t *strp, mdbv8_strbuf_t *strb,
 		    strp->v8s_addr, ntotal);
 	}
 
-	if ((v8flags & JSSTR_ISASCII) == 0) {
-		mdbv8_strbuf_sprintf(strb, "<external two-byte string>");
-		return (0);
-	}
-
 	bzero(&write, sizeof (write));
 	write.v8sw_strp = strp;
 	write.v8sw_v8flags = v8flags;
 	write.v8sw_charsp = charsp;
 	write.v8sw_readoff = 0;
-	write.v8sw_inbytesperchar = 1;
+	write.v8sw_inbytesperchar = (v8flags & JSSTR_ISASCII) != 0 ? 1 : 2;
 	write.v8sw_nreadchars = 0;
 	write.v8sw_sliceoffset = 0;
 	write.v8sw_slicelen = ntotal;
@@ -683,7 +775,7 @@ v8string_write_ext(v8string_t *strp, mdbv8_strbuf_t *strb,
 	write.v8sw_chunki = 0;
 	write.v8sw_chunklast = B_FALSE;
 	write.v8sw_done = ntotal == 0;
-	write.v8sw_asciicheck = B_TRUE;
+	write.v8sw_asciicheck = (v8flags & JSSTR_ISASCII) != 0;
 	err = 0;
 
 	while (!write.v8sw_done) {
@@ -33,20 +33,23 @@ struct v8fixedarray {
 v8fixedarray_t *
 v8fixedarray_load(uintptr_t addr, int memflags)
 {
-	uint8_t type;
-	uintptr_t nelts;
+	uintptr_t type, nelts;
 	v8fixedarray_t *arrayp;
-
-	if (!V8_IS_HEAPOBJECT(addr) ||
-	    read_typebyte(&type, addr) != 0 || type != V8_TYPE_FIXEDARRAY ||
-	    read_heap_smi(&nelts, addr, V8_OFF_FIXEDARRAY_LENGTH) != 0 ||
+	heap_field_t fields[] = {
+		{ V8_OFF_HEAPOBJECT_MAP, HF_TYPE, &type },
+		{ V8_OFF_FIXEDARRAY_LENGTH, HF_PTR, &nelts }
+	};
+
+	if (!V8_IS_HEAPOBJECT(addr) || read_heap_fields(addr, fields,
+	    sizeof (fields) / sizeof (fields[0])) != 0 ||
+	    type != V8_TYPE_FIXEDARRAY || !V8_IS_SMI(nelts) ||
 	    (arrayp = mdb_zalloc(sizeof (*arrayp), memflags)) == NULL) {
 		return (NULL);
 	}
 
 	arrayp->v8fa_addr = addr;
 	arrayp->v8fa_memflags = memflags;
-	arrayp->v8fa_nelts = nelts;
+	arrayp->v8fa_nelts = V8_SMI_VALUE(nelts);
 	return (arrayp);
 }
 
@@ -79,6 +82,7 @@ v8fixedarray_iter_elements(v8fixedarray_t *arrayp,
 	int maxnpgelts = 1024;
 	int curnpgelts;
 	uintptr_t *buf;
+	const uintptr_t *elts;
 	uintptr_t addr;
 	unsigned int index, length, i;
 	size_t maxpgsz, curpgsz;
@@ -98,14 +102,19 @@ v8fixedarray_iter_elements(v8fixedarray_t *arrayp,
 	do {
 		curnpgelts = MIN(length - index, maxnpgelts);
 		curpgsz = curnpgelts * sizeof (buf[0]);
-		rv = mdb_vread(buf, curpgsz, addr);
-		if (rv == -1) {
-			v8_warn("failed to read array from index %d", index);
-			break;
+		if ((elts = mdbv8_vmap(curpgsz, addr)) == NULL) {
+			rv = mdbv8_vread(buf, curpgsz, addr);
+			if (rv == -1) {
+				v8_warn("failed to read array from index %d",
+				    index);
+				break;
+			}
+
+			elts = buf;
 		}
 
 		for (i = 0; i < curnpgelts; i++) {
-			rv = func(arrayp, index + i, buf[i], uarg);
+			rv = func(arrayp, index + i, elts[i], uarg);
 			if (rv != 0) {
 				break;
 			}
@@ -148,7 +157,7 @@ v8fixedarray_as_array(v8fixedarray_t *arrayp, int memflags)
 		return (NULL);
 	}
 
-	if (mdb_vread(elts, arraysz,
+	if (mdbv8_vread(elts, arraysz,
 	    arrayp->v8fa_addr + V8_OFF_FIXEDARRAY_DATA) == -1) {
 		maybefree(elts, arraysz, memflags);
 		return (NULL);
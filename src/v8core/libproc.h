@@ -0,0 +1,77 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * Copyright (c) 2018, Joyent, Inc.
+ */
+
+/*
+ * libproc.h: the subset of illumos libproc that mdb_v8 uses, implemented by
+ * mdb_shim.c on top of a Linux ELF core file.  The "process handle" always
+ * refers to the core file that v8core was invoked on.
+ */
+
+#ifndef	_V8CORE_LIBPROC_H
+#define	_V8CORE_LIBPROC_H
+
+#include <time.h>
+
+#define	PRMAPSZ		64
+
+/*
+ * Mapping flags (pr_mflags).  Only the permissions are known for mappings in
+ * a core file.
+ */
+#define	MA_EXEC		0x01
+#define	MA_WRITE	0x02
+#define	MA_READ		0x04
+#define	MA_SHARED	0x08
+#define	MA_BREAK	0x10
+#define	MA_STACK	0x20
+#define	MA_ANON		0x40
+
+/*
+ * Process states returned by Pstate().  Core files are always PS_DEAD.
+ */
+#define	PS_RUN		1
+#define	PS_STOP		2
+#define	PS_LOST		3
+#define	PS_UNDEAD	4
+#define	PS_DEAD		5
+#define	PS_IDLE		6
+
+#define	PR_OBJ_EXEC	((const char *)0)
+
+typedef struct timespec timestruc_t;
+
+typedef struct prmap {
+	uintptr_t	pr_vaddr;		/* virtual address of mapping */
+	size_t		pr_size;		/* size of mapping in bytes */
+	char		pr_mapname[PRMAPSZ];	/* name of mapped file */
+	off_t		pr_offset;		/* offset into mapped file */
+	int		pr_mflags;		/* MA_* flags */
+	int		pr_pagesize;		/* page size of mapping */
+	int		pr_shmid;		/* unused */
+} prmap_t;
+
+typedef struct psinfo {
+	pid_t		pr_pid;			/* process id */
+	pid_t		pr_ppid;		/* parent process id */
+	timestruc_t	pr_start;		/* not known for Linux cores */
+	char		pr_fname[16];		/* name of executable */
+	char		pr_psargs[80];		/* initial arguments */
+} psinfo_t;
+
+struct ps_prochandle;
+
+typedef int proc_map_f(void *, const prmap_t *, const char *);
+
+extern int Pmapping_iter(struct ps_prochandle *, proc_map_f *, void *);
+extern const prmap_t *Pname_to_map(struct ps_prochandle *, const char *);
+extern const psinfo_t *Ppsinfo(struct ps_prochandle *);
+extern int Pstate(struct ps_prochandle *);
+
+#endif	/* _V8CORE_LIBPROC_H */
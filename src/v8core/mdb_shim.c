@@ -0,0 +1,1918 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * Copyright (c) 2018, Joyent, Inc.
+ */
+
+/*
+ * mdb_shim.c: an implementation of the parts of the MDB module API (and of
+ * libproc) that mdb_v8 uses, on top of a Linux ELF core file.  This allows the
+ * module to be linked into the standalone v8core program.
+ *
+ * The "target" is made up of:
+ *
+ *     o the core file itself, opened with mdbv8_elfcore_open().  Its contents
+ *       are also installed as the module's memory backend, so heap reads are
+ *       made directly from the mapped core file.
+ *
+ *     o the executable and shared objects that the core file's NT_FILE note
+ *       says were mapped, which provide symbols (including the "v8dbg_"
+ *       symbols that describe V8's internal structures) and the contents of
+ *       read-only mappings that may be missing from the core file.
+ *
+ * Output from mdb_printf() goes to stdout, indented as MDB would indent it,
+ * and can be captured for use as the input of a pipeline (see v8core.c).
+ * mdb_warn() writes to stderr.  Allocations with UM_GC are released after each
+ * command, as in MDB.
+ *
+ * Much of the MDB API isn't needed by mdb_v8 and isn't provided here.  Of what
+ * is provided, mdb_eval() isn't supported (so mdb_v8 can't disassemble code
+ * or enable C++ demangling), and only the registers of the first thread are
+ * available.
+ */
+
+#include <sys/mdb_modapi.h>
+#include <libproc.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/procfs.h>
+#include <sys/reg.h>
+#include <sys/stat.h>
+
+#include "mdb_v8_impl.h"
+#include "v8core.h"
+
+#ifdef _LP64
+#define	V8CORE_ELF(t)		Elf64_##t
+#define	V8CORE_ELFCLASS		ELFCLASS64
+#define	V8CORE_ST_BIND(i)	ELF64_ST_BIND(i)
+#define	V8CORE_ST_TYPE(i)	ELF64_ST_TYPE(i)
+#else
+#define	V8CORE_ELF(t)		Elf32_##t
+#define	V8CORE_ELFCLASS		ELFCLASS32
+#define	V8CORE_ST_BIND(i)	ELF32_ST_BIND(i)
+#define	V8CORE_ST_TYPE(i)	ELF32_ST_TYPE(i)
+#endif
+
+/*
+ * An executable or shared object mapped by the target.
+ */
+typedef struct v8core_obj {
+	struct v8core_obj *vo_next;		/* next object */
+	char *vo_path;				/* path to file */
+	const char *vo_name;			/* basename of path */
+	boolean_t vo_exec;			/* object is the executable */
+	uintptr_t vo_bias;			/* load address adjustment */
+	uint8_t *vo_base;			/* mapping of the file */
+	size_t vo_size;				/* size of the file */
+	const V8CORE_ELF(Phdr) *vo_phdrs;	/* program headers */
+	size_t vo_phnum;			/* number of program headers */
+	const V8CORE_ELF(Sym) *vo_syms[2];	/* MDB_TBL_SYMTAB, DYNSYM */
+	size_t vo_nsyms[2];			/* number of symbols */
+	const char *vo_strs[2];			/* string tables */
+	size_t vo_strsz[2];			/* size of string tables */
+} v8core_obj_t;
+
+/*
+ * An entry in the table of symbols sorted by address, used to print addresses
+ * symbolically.
+ */
+typedef struct v8core_addrsym {
+	uintptr_t vas_addr;			/* relocated address */
+	size_t vas_size;			/* size of symbol */
+	const char *vas_name;			/* name of symbol */
+	const v8core_obj_t *vas_obj;		/* containing object */
+} v8core_addrsym_t;
+
+/*
+ * Every allocation is preceded by one of these headers so that UM_GC
+ * allocations can be found and released after each command.  The union keeps
+ * the allocation itself suitably aligned.
+ */
+typedef union v8core_alloc {
+	struct {
+		union v8core_alloc *va_prev;	/* previous UM_GC allocation */
+		union v8core_alloc *va_next;	/* next UM_GC allocation */
+		size_t va_size;			/* size requested */
+		uint_t va_flags;		/* UM_* flags */
+	} va_s;
+	long double va_align;
+} v8core_alloc_t;
+
+/*
+ * The process handle returned by mdb_get_xdata("pshandle") refers to the one
+ * target we support.
+ */
+struct ps_prochandle {
+	int ph_unused;
+};
+
+static struct {
+	mdbv8_elfcore_t *vc_core;		/* the core file */
+	mdbv8_membackend_t vc_backend;		/* memory backend for module */
+	v8core_obj_t *vc_objs;			/* executable, then libraries */
+	v8core_addrsym_t *vc_addrsyms;		/* symbols sorted by address */
+	size_t vc_naddrsyms;			/* entries in vc_addrsyms */
+	boolean_t vc_addrsyms_built;		/* vc_addrsyms is built */
+	psinfo_t vc_psinfo;			/* from NT_PRPSINFO */
+	boolean_t vc_have_psinfo;		/* vc_psinfo is valid */
+	prmap_t vc_execmap;			/* mapping of executable */
+	boolean_t vc_have_execmap;		/* vc_execmap is valid */
+	struct ps_prochandle vc_ph;		/* process handle */
+	const mdb_modinfo_t *vc_modinfo;	/* loaded module */
+	uintptr_t vc_dot;			/* see mdb_get_dot() */
+	uintptr_t *vc_pipe;			/* see mdb_get_pipe() */
+	size_t vc_pipelen;			/* entries in vc_pipe */
+	size_t vc_pipendx;			/* next entry in vc_pipe */
+	int vc_indent;				/* see mdb_inc_indent() */
+	boolean_t vc_bol;			/* at beginning of line */
+	FILE *vc_out;				/* output stream */
+	char *vc_capture;			/* captured output */
+	size_t vc_capturelen;			/* bytes captured */
+	size_t vc_capturesz;			/* size of capture buffer */
+	boolean_t vc_capturing;			/* output is being captured */
+	v8core_alloc_t vc_gc;			/* list of UM_GC allocations */
+} v8core = {
+	.vc_bol = B_TRUE
+};
+
+/*
+ * Miscellaneous illumos library functions
+ */
+
+size_t
+v8core_strlcpy(char *dst, const char *src, size_t len)
+{
+	size_t srclen = strlen(src);
+
+	if (len != 0) {
+		size_t n = MIN(srclen, len - 1);
+		bcopy(src, dst, n);
+		dst[n] = '\0';
+	}
+
+	return (srclen);
+}
+
+size_t
+v8core_strlcat(char *dst, const char *src, size_t len)
+{
+	size_t dstlen = strnlen(dst, len);
+
+	if (dstlen == len)
+		return (len + strlen(src));
+
+	return (dstlen + v8core_strlcpy(dst + dstlen, src, len - dstlen));
+}
+
+static hrtime_t
+v8core_clock(clockid_t clock)
+{
+	struct timespec ts;
+
+	(void) clock_gettime(clock, &ts);
+	return ((hrtime_t)ts.tv_sec * NANOSEC + ts.tv_nsec);
+}
+
+hrtime_t
+gethrtime(void)
+{
+	return (v8core_clock(CLOCK_MONOTONIC));
+}
+
+hrtime_t
+gethrvtime(void)
+{
+	return (v8core_clock(CLOCK_THREAD_CPUTIME_ID));
+}
+
+/*
+ * Memory allocation
+ */
+
+void *
+mdb_alloc(size_t size, uint_t flags)
+{
+	v8core_alloc_t *vap;
+
+	if ((vap = malloc(sizeof (*vap) + size)) == NULL) {
+		if (!(flags & UM_SLEEP))
+			return (NULL);
+
+		(void) fprintf(stderr, "v8core: out of memory\n");
+		abort();
+	}
+
+	vap->va_s.va_size = size;
+	vap->va_s.va_flags = flags;
+	vap->va_s.va_prev = NULL;
+	vap->va_s.va_next = NULL;
+
+	if (flags & UM_GC) {
+		if (v8core.vc_gc.va_s.va_next == NULL) {
+			v8core.vc_gc.va_s.va_next = &v8core.vc_gc;
+			v8core.vc_gc.va_s.va_prev = &v8core.vc_gc;
+		}
+
+		vap->va_s.va_next = v8core.vc_gc.va_s.va_next;
+		vap->va_s.va_prev = &v8core.vc_gc;
+		vap->va_s.va_next->va_s.va_prev = vap;
+		v8core.vc_gc.va_s.va_next = vap;
+	}
+
+	return (vap + 1);
+}
+
+void *
+mdb_zalloc(size_t size, uint_t flags)
+{
+	void *buf;
+
+	if ((buf = mdb_alloc(size, flags)) != NULL)
+		bzero(buf, size);
+
+	return (buf);
+}
+
+void
+mdb_free(void *buf, size_t size)
+{
+	v8core_alloc_t *vap;
+
+	if (buf == NULL)
+		return;
+
+	vap = (v8core_alloc_t *)buf - 1;
+	assert(vap->va_s.va_size == size);
+
+	if (vap->va_s.va_flags & UM_GC) {
+		vap->va_s.va_prev->va_s.va_next = vap->va_s.va_next;
+		vap->va_s.va_next->va_s.va_prev = vap->va_s.va_prev;
+	}
+
+	free(vap);
+}
+
+void
+v8core_gc(void)
+{
+	v8core_alloc_t *vap;
+
+	if (v8core.vc_gc.va_s.va_next == NULL)
+		return;
+
+	while ((vap = v8core.vc_gc.va_s.va_next) != &v8core.vc_gc) {
+		v8core.vc_gc.va_s.va_next = vap->va_s.va_next;
+		free(vap);
+	}
+
+	v8core.vc_gc.va_s.va_prev = &v8core.vc_gc;
+}
+
+/*
+ * Output
+ */
+
+typedef struct v8core_sink {
+	char *vs_buf;		/* buffer, for mdb_snprintf() */
+	size_t vs_bufsz;	/* size of buffer */
+	size_t vs_len;		/* total bytes formatted */
+	boolean_t vs_output;	/* write to the output stream instead */
+} v8core_sink_t;
+
+static void
+v8core_emit(const char *s, size_t len)
+{
+	if (!v8core.vc_capturing) {
+		(void) fwrite(s, 1, len, v8core.vc_out);
+		return;
+	}
+
+	if (v8core.vc_capturelen + len + 1 > v8core.vc_capturesz) {
+		size_t sz = MAX(v8core.vc_capturesz * 2,
+		    v8core.vc_capturelen + len + 1);
+		char *buf;
+
+		if ((buf = realloc(v8core.vc_capture, sz)) == NULL) {
+			(void) fprintf(stderr, "v8core: out of memory\n");
+			abort();
+		}
+
+		v8core.vc_capture = buf;
+		v8core.vc_capturesz = sz;
+	}
+
+	bcopy(s, v8core.vc_capture + v8core.vc_capturelen, len);
+	v8core.vc_capturelen += len;
+	v8core.vc_capture[v8core.vc_capturelen] = '\0';
+}
+
+/*
+ * Write "len" bytes of output, indenting each new line by the current
+ * indentation.
+ */
+static void
+v8core_output(const char *s, size_t len)
+{
+	static const char spaces[] = "                                ";
+	const char *nl;
+	size_t n;
+	int indent;
+
+	if (v8core.vc_out == NULL)
+		v8core.vc_out = stdout;
+
+	while (len > 0) {
+		if (v8core.vc_bol && *s != '\n') {
+			for (indent = v8core.vc_indent; indent > 0;
+			    indent -= n) {
+				n = MIN(indent, sizeof (spaces) - 1);
+				v8core_emit(spaces, n);
+			}
+		}
+
+		nl = memchr(s, '\n', len);
+		n = nl == NULL ? len : nl - s + 1;
+		v8core_emit(s, n);
+		v8core.vc_bol = nl != NULL;
+		s += n;
+		len -= n;
+	}
+}
+
+static void
+v8core_sink_write(v8core_sink_t *vsp, const char *s, size_t len)
+{
+	size_t n;
+
+	if (vsp->vs_output) {
+		v8core_output(s, len);
+	} else if (vsp->vs_len + 1 < vsp->vs_bufsz) {
+		n = MIN(len, vsp->vs_bufsz - vsp->vs_len - 1);
+		bcopy(s, vsp->vs_buf + vsp->vs_len, n);
+		vsp->vs_buf[vsp->vs_len + n] = '\0';
+	}
+
+	vsp->vs_len += len;
+}
+
+static void
+v8core_sink_pad(v8core_sink_t *vsp, int n)
+{
+	while (n-- > 0)
+		v8core_sink_write(vsp, " ", 1);
+}
+
+static const v8core_addrsym_t *v8core_addrsym_lookup(uintptr_t);
+
+/*
+ * Formats an address symbolically into "buf", as "[object`]symbol[+offset]".
+ * If there's no symbol and "required" is set, the result is empty; otherwise,
+ * the address is formatted in hexadecimal.
+ */
+static void
+v8core_format_addr(char *buf, size_t bufsz, uintptr_t addr,
+    boolean_t required)
+{
+	const v8core_addrsym_t *vasp;
+	char off[32];
+
+	if ((vasp = v8core_addrsym_lookup(addr)) == NULL) {
+		if (required)
+			buf[0] = '\0';
+		else
+			(void) snprintf(buf, bufsz, "0x%lx", (ulong_t)addr);
+		return;
+	}
+
+	off[0] = '\0';
+	if (addr != vasp->vas_addr) {
+		(void) snprintf(off, sizeof (off), "+0x%lx",
+		    (ulong_t)(addr - vasp->vas_addr));
+	}
+
+	(void) snprintf(buf, bufsz, "%s%s%s%s",
+	    vasp->vas_obj->vo_exec ? "" : vasp->vas_obj->vo_name,
+	    vasp->vas_obj->vo_exec ? "" : "`", vasp->vas_name, off);
+}
+
+/*
+ * Implements the format strings of mdb_printf() and mdb_snprintf().  These
+ * are mostly those of printf(3C), with these differences:
+ *
+ *     %p	a pointer-sized value (not a pointer) in hexadecimal
+ *     %?	a field width of twice the size of a pointer (e.g., "%?p")
+ *     %a	an address, symbolically if possible
+ *     %A	an address, symbolically, or nothing if there's no symbol
+ *     %Y	a time_t, as a date and time
+ *     %<...>	terminal attributes (e.g., "%<b>"), which are ignored here
+ */
+static void
+v8core_vformat(v8core_sink_t *vsp, const char *format, va_list *app)
+{
+	const char *p, *start, *flag;
+	char spec[32], buf[512], *s;
+	int width, prec, len;
+	boolean_t left;
+	char lenmod[3], conv;
+	size_t n;
+	time_t t;
+	struct tm tm;
+
+	for (p = format; *p != '\0'; ) {
+		if (*p != '%') {
+			start = p;
+			while (*p != '\0' && *p != '%')
+				p++;
+			v8core_sink_write(vsp, start, p - start);
+			continue;
+		}
+
+		start = p++;
+
+		if (*p == '<') {
+			while (*p != '\0' && *p++ != '>')
+				continue;
+			continue;
+		}
+
+		left = B_FALSE;
+		while (*p != '\0' && strchr("-+ #0", *p) != NULL) {
+			if (*p == '-')
+				left = B_TRUE;
+			p++;
+		}
+
+		width = -1;
+		if (*p == '*') {
+			width = va_arg(*app, int);
+			if (width < 0) {
+				left = B_TRUE;
+				width = -width;
+			}
+			p++;
+		} else if (*p == '?') {
+			width = sizeof (uintptr_t) * 2;
+			p++;
+		} else if (*p >= '0' && *p <= '9') {
+			width = strtol(p, (char **)&p, 10);
+		}
+
+		prec = -1;
+		if (*p == '.') {
+			p++;
+			if (*p == '*') {
+				prec = va_arg(*app, int);
+				p++;
+			} else {
+				prec = strtol(p, (char **)&p, 10);
+			}
+		}
+
+		n = 0;
+		while (n < sizeof (lenmod) - 1 && *p != '\0' &&
+		    strchr("hlzj", *p) != NULL)
+			lenmod[n++] = *p++;
+		lenmod[n] = '\0';
+
+		if ((conv = *p) == '\0')
+			break;
+		p++;
+
+		/*
+		 * Build a printf(3C) specification with the flags, but without
+		 * the width or length modifier, which we supply ourselves.
+		 */
+		len = 0;
+		spec[len++] = '%';
+		for (flag = start + 1; flag < p && strchr("-+ #0", *flag) !=
+		    NULL && len < sizeof (spec) - 8; flag++)
+			spec[len++] = *flag;
+		spec[len++] = '*';
+		if (prec >= 0) {
+			spec[len++] = '.';
+			spec[len++] = '*';
+		}
+		spec[len] = '\0';
+
+		if (width > (int)sizeof (buf) / 2)
+			width = sizeof (buf) / 2;
+		if (prec > (int)sizeof (buf) / 2 && strchr("sc%", conv) == NULL)
+			prec = sizeof (buf) / 2;
+
+		s = buf;
+		buf[0] = '\0';
+
+		switch (conv) {
+		case '%':
+			v8core_sink_write(vsp, "%", 1);
+			continue;
+
+		case 'c':
+			buf[0] = (char)va_arg(*app, int);
+			buf[1] = '\0';
+			break;
+
+		case 's':
+			if ((s = va_arg(*app, char *)) == NULL)
+				s = "<NULL>";
+			n = prec >= 0 ? strnlen(s, prec) : strlen(s);
+			if (!left)
+				v8core_sink_pad(vsp, width - (int)n);
+			v8core_sink_write(vsp, s, n);
+			if (left)
+				v8core_sink_pad(vsp, width - (int)n);
+			continue;
+
+		case 'd':
+		case 'i':
+		case 'u':
+		case 'x':
+		case 'X':
+		case 'o':
+			spec[len++] = 'l';
+			spec[len++] = 'l';
+			spec[len++] = conv;
+			spec[len] = '\0';
+
+			if (strchr("di", conv) != NULL) {
+				long long v;
+
+				if (strcmp(lenmod, "ll") == 0 ||
+				    strcmp(lenmod, "j") == 0)
+					v = va_arg(*app, long long);
+				else if (lenmod[0] == 'l' || lenmod[0] == 'z')
+					v = va_arg(*app, long);
+				else
+					v = va_arg(*app, int);
+
+				if (prec >= 0)
+					(void) snprintf(buf, sizeof (buf),
+					    spec, width, prec, v);
+				else
+					(void) snprintf(buf, sizeof (buf),
+					    spec, width, v);
+			} else {
+				unsigned long long v;
+
+				if (strcmp(lenmod, "ll") == 0 ||
+				    strcmp(lenmod, "j") == 0)
+					v = va_arg(*app, unsigned long long);
+				else if (lenmod[0] == 'l' || lenmod[0] == 'z')
+					v = va_arg(*app, unsigned long);
+				else
+					v = va_arg(*app, unsigned int);
+
+				if (prec >= 0)
+					(void) snprintf(buf, sizeof (buf),
+					    spec, width, prec, v);
+				else
+					(void) snprintf(buf, sizeof (buf),
+					    spec, width, v);
+			}
+			width = -1;
+			break;
+
+		case 'p':
+			(void) strlcat(spec, "lx", sizeof (spec));
+			(void) snprintf(buf, sizeof (buf), spec, width,
+			    (ulong_t)va_arg(*app, uintptr_t));
+			width = -1;
+			break;
+
+		case 'e':
+		case 'E':
+		case 'f':
+		case 'g':
+		case 'G':
+			spec[len] = conv;
+			spec[len + 1] = '\0';
+			if (prec >= 0)
+				(void) snprintf(buf, sizeof (buf), spec,
+				    width, prec, va_arg(*app, double));
+			else
+				(void) snprintf(buf, sizeof (buf), spec,
+				    width, va_arg(*app, double));
+			width = -1;
+			break;
+
+		case 'a':
+		case 'A':
+			v8core_format_addr(buf, sizeof (buf),
+			    va_arg(*app, uintptr_t), conv == 'A');
+			break;
+
+		case 'Y':
+			t = va_arg(*app, time_t);
+			if (localtime_r(&t, &tm) == NULL ||
+			    strftime(buf, sizeof (buf), "%Y %b %e %T",
+			    &tm) == 0)
+				(void) snprintf(buf, sizeof (buf), "%ld",
+				    (long)t);
+			break;
+
+		default:
+			/*
+			 * Print unknown conversions verbatim.
+			 */
+			v8core_sink_write(vsp, start, p - start);
+			continue;
+		}
+
+		n = strlen(s);
+		if (!left)
+			v8core_sink_pad(vsp, width - (int)n);
+		v8core_sink_write(vsp, s, n);
+		if (left)
+			v8core_sink_pad(vsp, width - (int)n);
+	}
+}
+
+void
+mdb_printf(const char *format, ...)
+{
+	v8core_sink_t sink;
+	va_list ap;
+
+	bzero(&sink, sizeof (sink));
+	sink.vs_output = B_TRUE;
+
+	va_start(ap, format);
+	v8core_vformat(&sink, format, &ap);
+	va_end(ap);
+}
+
+size_t
+mdb_snprintf(char *buf, size_t bufsz, const char *format, ...)
+{
+	v8core_sink_t sink;
+	va_list ap;
+
+	bzero(&sink, sizeof (sink));
+	sink.vs_buf = buf;
+	sink.vs_bufsz = buf == NULL ? 0 : bufsz;
+
+	if (sink.vs_bufsz != 0)
+		buf[0] = '\0';
+
+	va_start(ap, format);
+	v8core_vformat(&sink, format, &ap);
+	va_end(ap);
+
+	return (sink.vs_len);
+}
+
+/*
+ * Like MDB, we append a description of errno to warnings that don't end with
+ * a newline.
+ */
+void
+mdb_warn(const char *format, ...)
+{
+	int err = errno;
+	char buf[1024];
+	v8core_sink_t sink;
+	va_list ap;
+
+	bzero(&sink, sizeof (sink));
+	sink.vs_buf = buf;
+	sink.vs_bufsz = sizeof (buf);
+	buf[0] = '\0';
+
+	va_start(ap, format);
+	v8core_vformat(&sink, format, &ap);
+	va_end(ap);
+
+	(void) fflush(v8core.vc_out != NULL ? v8core.vc_out : stdout);
+
+	if (buf[0] != '\0' && buf[strlen(buf) - 1] == '\n')
+		(void) fprintf(stderr, "v8core: %s", buf);
+	else
+		(void) fprintf(stderr, "v8core: %s: %s\n", buf, strerror(err));
+}
+
+void
+mdb_flush(void)
+{
+	(void) fflush(v8core.vc_out != NULL ? v8core.vc_out : stdout);
+}
+
+int
+mdb_inc_indent(int n)
+{
+	int old = v8core.vc_indent;
+
+	v8core.vc_indent += n;
+	return (old);
+}
+
+int
+mdb_dec_indent(int n)
+{
+	int old = v8core.vc_indent;
+
+	v8core.vc_indent = MAX(0, v8core.vc_indent - n);
+	return (old);
+}
+
+void
+v8core_output_set(FILE *fp)
+{
+	mdb_flush();
+	v8core.vc_out = fp;
+	v8core.vc_bol = B_TRUE;
+}
+
+void
+v8core_capture_begin(void)
+{
+	assert(!v8core.vc_capturing);
+	mdb_flush();
+	v8core.vc_capturing = B_TRUE;
+	v8core.vc_capture = NULL;
+	v8core.vc_capturelen = 0;
+	v8core.vc_capturesz = 0;
+	v8core.vc_bol = B_TRUE;
+}
+
+char *
+v8core_capture_end(void)
+{
+	char *buf = v8core.vc_capture;
+
+	assert(v8core.vc_capturing);
+	v8core.vc_capturing = B_FALSE;
+	v8core.vc_capture = NULL;
+	v8core.vc_bol = B_TRUE;
+
+	return (buf != NULL ? buf : strdup(""));
+}
+
+/*
+ * Numbers
+ */
+
+/*
+ * Like MDB, numbers are hexadecimal unless prefixed with "0t" (decimal),
+ * "0o" (octal), or "0i" (binary).  "0x" is also accepted.
+ */
+int
+v8core_strtonum(const char *s, uint64_t *valp)
+{
+	int base = 16;
+	char *end;
+
+	if (s[0] == '0' && s[1] != '\0') {
+		switch (s[1]) {
+		case 'x':
+		case 'X':
+			base = 16;
+			s += 2;
+			break;
+		case 't':
+		case 'T':
+			base = 10;
+			s += 2;
+			break;
+		case 'o':
+		case 'O':
+			base = 8;
+			s += 2;
+			break;
+		case 'i':
+		case 'I':
+			base = 2;
+			s += 2;
+			break;
+		}
+	}
+
+	if (*s == '\0' || *s == '-' || *s == '+')
+		return (-1);
+
+	errno = 0;
+	*valp = strtoull(s, &end, base);
+	return (*end != '\0' || errno != 0 ? -1 : 0);
+}
+
+u_longlong_t
+mdb_strtoull(const char *s)
+{
+	uint64_t val;
+
+	if (v8core_strtonum(s, &val) != 0) {
+		mdb_warn("failed to parse \"%s\" as a number\n", s);
+		return (0);
+	}
+
+	return (val);
+}
+
+/*
+ * Options
+ */
+
+#define	V8CORE_MAXOPTS	64
+
+typedef struct v8core_opt {
+	char vop_c;		/* option letter */
+	uint_t vop_type;	/* MDB_OPT_* */
+	uint_t vop_bits;	/* for SETBITS and CLRBITS */
+	void *vop_valp;		/* where to store value */
+	boolean_t *vop_setp;	/* for UINTPTR_SET */
+} v8core_opt_t;
+
+int
+mdb_getopts(int argc, const mdb_arg_t *argv, ...)
+{
+	v8core_opt_t opts[V8CORE_MAXOPTS], *op;
+	const char *s, *val;
+	uint64_t num;
+	int nopts = 0, i, j, c;
+	va_list ap;
+
+	va_start(ap, argv);
+	while ((c = va_arg(ap, int)) != 0) {
+		if (nopts == V8CORE_MAXOPTS) {
+			va_end(ap);
+			mdb_warn("too many options\n");
+			return (0);
+		}
+
+		op = &opts[nopts++];
+		op->vop_c = c;
+		op->vop_type = va_arg(ap, uint_t);
+		op->vop_setp = NULL;
+
+		switch (op->vop_type) {
+		case MDB_OPT_SETBITS:
+		case MDB_OPT_CLRBITS:
+			op->vop_bits = va_arg(ap, uint_t);
+			op->vop_valp = va_arg(ap, uint_t *);
+			break;
+		case MDB_OPT_UINTPTR_SET:
+			op->vop_setp = va_arg(ap, boolean_t *);
+			op->vop_valp = va_arg(ap, uintptr_t *);
+			break;
+		default:
+			op->vop_valp = va_arg(ap, void *);
+			break;
+		}
+	}
+	va_end(ap);
+
+	for (i = 0; i < argc; i++) {
+		if (argv[i].a_type != MDB_TYPE_STRING ||
+		    argv[i].a_un.a_str[0] != '-' ||
+		    argv[i].a_un.a_str[1] == '\0')
+			return (i);
+
+		if (strcmp(argv[i].a_un.a_str, "--") == 0)
+			return (i + 1);
+
+		for (s = argv[i].a_un.a_str + 1; *s != '\0'; s++) {
+			for (j = 0; j < nopts && opts[j].vop_c != *s; j++)
+				continue;
+
+			if (j == nopts) {
+				mdb_warn("illegal option -- %c\n", *s);
+				return (i);
+			}
+
+			op = &opts[j];
+
+			if (op->vop_type == MDB_OPT_SETBITS) {
+				*(uint_t *)op->vop_valp |= op->vop_bits;
+				continue;
+			}
+
+			if (op->vop_type == MDB_OPT_CLRBITS) {
+				*(uint_t *)op->vop_valp &= ~op->vop_bits;
+				continue;
+			}
+
+			/*
+			 * The remaining option types take a value, either in
+			 * the rest of this argument or in the next one.
+			 */
+			if (s[1] != '\0') {
+				val = s + 1;
+			} else if (i + 1 < argc) {
+				i++;
+				if (argv[i].a_type == MDB_TYPE_IMMEDIATE &&
+				    op->vop_type != MDB_OPT_STR) {
+					num = argv[i].a_un.a_val;
+					val = NULL;
+				} else if (argv[i].a_type == MDB_TYPE_STRING) {
+					val = argv[i].a_un.a_str;
+				} else {
+					mdb_warn("option requires a string "
+					    "-- %c\n", *s);
+					return (i - 1);
+				}
+			} else {
+				mdb_warn("option requires an argument -- %c\n",
+				    *s);
+				return (i);
+			}
+
+			if (op->vop_type == MDB_OPT_STR) {
+				*(const char **)op->vop_valp = val;
+				break;
+			}
+
+			if (val != NULL && v8core_strtonum(val, &num) != 0) {
+				mdb_warn("failed to parse \"%s\" as a number "
+				    "for -%c\n", val, *s);
+				return (i);
+			}
+
+			if (op->vop_type == MDB_OPT_UINT64) {
+				*(uint64_t *)op->vop_valp = num;
+			} else {
+				*(uintptr_t *)op->vop_valp = (uintptr_t)num;
+				if (op->vop_setp != NULL)
+					*op->vop_setp = B_TRUE;
+			}
+			break;
+		}
+	}
+
+	return (argc);
+}
+
+/*
+ * Target memory
+ */
+
+/*
+ * Reads from the contents of the executable and shared objects, for parts of
+ * file mappings that aren't in the core file.
+ */
+static ssize_t
+v8core_obj_vread(void *buf, size_t nbytes, uintptr_t addr)
+{
+	const V8CORE_ELF(Phdr) *php;
+	const v8core_obj_t *vop;
+	uintptr_t start;
+	size_t i;
+
+	for (vop = v8core.vc_objs; vop != NULL; vop = vop->vo_next) {
+		for (i = 0; i < vop->vo_phnum; i++) {
+			php = &vop->vo_phdrs[i];
+			start = vop->vo_bias + php->p_vaddr;
+
+			if (php->p_type != PT_LOAD || addr < start ||
+			    addr - start >= php->p_filesz ||
+			    nbytes > php->p_filesz - (addr - start) ||
+			    php->p_offset + php->p_filesz > vop->vo_size)
+				continue;
+
+			bcopy(vop->vo_base + php->p_offset + (addr - start),
+			    buf, nbytes);
+			return (nbytes);
+		}
+	}
+
+	return (-1);
+}
+
+static ssize_t
+v8core_backend_vread(void *arg, void *buf, size_t nbytes, uintptr_t addr)
+{
+	if (mdbv8_elfcore_backend.mb_vread(arg, buf, nbytes, addr) != -1)
+		return (nbytes);
+
+	if (v8core_obj_vread(buf, nbytes, addr) != -1)
+		return (nbytes);
+
+	errno = EFAULT;
+	return (-1);
+}
+
+ssize_t
+mdb_vread(void *buf, size_t nbytes, uintptr_t addr)
+{
+	if (v8core.vc_core == NULL) {
+		errno = EFAULT;
+		return (-1);
+	}
+
+	return (v8core_backend_vread(v8core.vc_core, buf, nbytes, addr));
+}
+
+ssize_t
+mdb_vwrite(const void *buf, size_t nbytes, uintptr_t addr)
+{
+	errno = EROFS;
+	return (-1);
+}
+
+ssize_t
+mdb_readstr(char *buf, size_t nbytes, uintptr_t addr)
+{
+	size_t i;
+
+	if (nbytes == 0)
+		return (0);
+
+	for (i = 0; i < nbytes - 1; i++) {
+		if (mdb_vread(&buf[i], 1, addr + i) == -1)
+			return (-1);
+
+		if (buf[i] == '\0')
+			return (i);
+	}
+
+	buf[i] = '\0';
+	return (i);
+}
+
+/*
+ * Symbols
+ */
+
+static int
+v8core_sym_matches(const V8CORE_ELF(Sym) *symp, uint_t type)
+{
+	uint_t bind, stype;
+
+	if (symp->st_shndx == SHN_UNDEF || symp->st_name == 0)
+		return (0);
+
+	switch (V8CORE_ST_BIND(symp->st_info)) {
+	case STB_LOCAL:
+		bind = MDB_BIND_LOCAL;
+		break;
+	case STB_GLOBAL:
+		bind = MDB_BIND_GLOBAL;
+		break;
+	case STB_WEAK:
+		bind = MDB_BIND_WEAK;
+		break;
+	default:
+		return (0);
+	}
+
+	switch (V8CORE_ST_TYPE(symp->st_info)) {
+	case STT_NOTYPE:
+		stype = MDB_TYPE_NOTYPE;
+		break;
+	case STT_OBJECT:
+		stype = MDB_TYPE_OBJECT;
+		break;
+	case STT_FUNC:
+		stype = MDB_TYPE_FUNC;
+		break;
+	default:
+		return (0);
+	}
+
+	return ((type & bind) != 0 && (type & stype) != 0);
+}
+
+static const char *
+v8core_sym_name(const v8core_obj_t *vop, int table,
+    const V8CORE_ELF(Sym) *symp)
+{
+	if (symp->st_name >= vop->vo_strsz[table])
+		return (NULL);
+
+	return (vop->vo_strs[table] + symp->st_name);
+}
+
+int
+mdb_symbol_iter(const char *obj, uint_t which, uint_t type,
+    int (*func)(mdb_symbol_t *, void *), void *arg)
+{
+	const v8core_obj_t *vop;
+	const V8CORE_ELF(Sym) *symp;
+	GElf_Sym sym;
+	mdb_symbol_t msym;
+	int table = which == MDB_DYNSYM ? MDB_TBL_DYNSYM : MDB_TBL_SYMTAB;
+	size_t i;
+	int rv;
+
+	for (vop = v8core.vc_objs; vop != NULL; vop = vop->vo_next) {
+		if (obj == MDB_OBJ_EXEC ? !vop->vo_exec :
+		    obj != MDB_OBJ_EVERY && strcmp(obj, vop->vo_name) != 0)
+			continue;
+
+		for (i = 0; i < vop->vo_nsyms[table]; i++) {
+			symp = &vop->vo_syms[table][i];
+
+			if (!v8core_sym_matches(symp, type) ||
+			    (msym.sym_name = v8core_sym_name(vop, table,
+			    symp)) == NULL)
+				continue;
+
+			sym = *symp;
+			sym.st_value += vop->vo_bias;
+			msym.sym_object = vop->vo_name;
+			msym.sym_sym = &sym;
+			msym.sym_table = table;
+			msym.sym_id = i;
+
+			if ((rv = func(&msym, arg)) != 0)
+				return (rv);
+		}
+	}
+
+	return (0);
+}
+
+static int
+v8core_obj_lookup(const v8core_obj_t *vop, const char *name, GElf_Sym *symp)
+{
+	const V8CORE_ELF(Sym) *esp;
+	const char *symname;
+	int table;
+	size_t i;
+
+	for (table = MDB_TBL_DYNSYM; table >= MDB_TBL_SYMTAB; table--) {
+		for (i = 0; i < vop->vo_nsyms[table]; i++) {
+			esp = &vop->vo_syms[table][i];
+
+			if (esp->st_shndx == SHN_UNDEF ||
+			    (symname = v8core_sym_name(vop, table,
+			    esp)) == NULL || strcmp(symname, name) != 0)
+				continue;
+
+			*symp = *esp;
+			symp->st_value += vop->vo_bias;
+			return (0);
+		}
+	}
+
+	return (-1);
+}
+
+/*
+ * Like MDB, this accepts names of the form "object`symbol".
+ */
+int
+mdb_lookup_by_name(const char *name, GElf_Sym *symp)
+{
+	const v8core_obj_t *vop;
+	const char *symname;
+	size_t objlen = 0;
+
+	if ((symname = strchr(name, '`')) != NULL) {
+		objlen = symname - name;
+		symname++;
+	} else {
+		symname = name;
+	}
+
+	for (vop = v8core.vc_objs; vop != NULL; vop = vop->vo_next) {
+		if (objlen != 0 && (strncmp(vop->vo_name, name, objlen) != 0 ||
+		    vop->vo_name[objlen] != '\0'))
+			continue;
+
+		if (v8core_obj_lookup(vop, symname, symp) == 0)
+			return (0);
+	}
+
+	errno = ENOENT;
+	return (-1);
+}
+
+ssize_t
+mdb_readsym(void *buf, size_t nbytes, const char *name)
+{
+	GElf_Sym sym;
+
+	if (mdb_lookup_by_name(name, &sym) != 0)
+		return (-1);
+
+	return (mdb_vread(buf, nbytes, sym.st_value));
+}
+
+static int
+v8core_addrsym_compare(const void *l, const void *r)
+{
+	const v8core_addrsym_t *lp = l, *rp = r;
+
+	if (lp->vas_addr < rp->vas_addr)
+		return (-1);
+
+	return (lp->vas_addr > rp->vas_addr);
+}
+
+/*
+ * Build the table of function and object symbols sorted by address the first
+ * time we need to print an address symbolically.
+ */
+static void
+v8core_addrsyms_load(void)
+{
+	const v8core_obj_t *vop;
+	const V8CORE_ELF(Sym) *symp;
+	v8core_addrsym_t *vasp;
+	size_t i, n = 0;
+	int table, pass;
+
+	v8core.vc_addrsyms_built = B_TRUE;
+
+	for (pass = 0; pass < 2; pass++) {
+		for (vop = v8core.vc_objs; vop != NULL; vop = vop->vo_next) {
+			table = vop->vo_nsyms[MDB_TBL_SYMTAB] != 0 ?
+			    MDB_TBL_SYMTAB : MDB_TBL_DYNSYM;
+
+			for (i = 0; i < vop->vo_nsyms[table]; i++) {
+				symp = &vop->vo_syms[table][i];
+
+				if (symp->st_size == 0 ||
+				    !v8core_sym_matches(symp, MDB_BIND_ANY |
+				    MDB_TYPE_OBJECT | MDB_TYPE_FUNC))
+					continue;
+
+				if (pass == 0) {
+					n++;
+					continue;
+				}
+
+				vasp = &v8core.vc_addrsyms[
+				    v8core.vc_naddrsyms++];
+				vasp->vas_addr = symp->st_value + vop->vo_bias;
+				vasp->vas_size = symp->st_size;
+				vasp->vas_name = v8core_sym_name(vop, table,
+				    symp);
+				vasp->vas_obj = vop;
+
+				if (vasp->vas_name == NULL)
+					v8core.vc_naddrsyms--;
+			}
+		}
+
+		if (pass == 0) {
+			if (n == 0)
+				return;
+
+			v8core.vc_addrsyms = mdb_alloc(
+			    n * sizeof (v8core_addrsym_t), UM_SLEEP);
+		}
+	}
+
+	qsort(v8core.vc_addrsyms, v8core.vc_naddrsyms,
+	    sizeof (v8core_addrsym_t), v8core_addrsym_compare);
+}
+
+static const v8core_addrsym_t *
+v8core_addrsym_lookup(uintptr_t addr)
+{
+	size_t lo = 0, hi, mid;
+	const v8core_addrsym_t *vasp;
+
+	if (!v8core.vc_addrsyms_built)
+		v8core_addrsyms_load();
+
+	/*
+	 * Find the last symbol that starts at or before "addr".
+	 */
+	hi = v8core.vc_naddrsyms;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (v8core.vc_addrsyms[mid].vas_addr <= addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo == 0)
+		return (NULL);
+
+	vasp = &v8core.vc_addrsyms[lo - 1];
+	return (addr - vasp->vas_addr < vasp->vas_size ? vasp : NULL);
+}
+
+/*
+ * Registers, process information, and mappings
+ */
+
+static const struct {
+	const char *vr_name;
+	int vr_index;
+} v8core_regs[] = {
+#ifdef __x86_64__
+	{ "rbp", RBP },
+	{ "rip", RIP },
+	{ "rsp", RSP },
+#else
+	{ "ebp", EBP },
+	{ "eip", EIP },
+	{ "esp", UESP },
+#endif
+	{ NULL, 0 }
+};
+
+/*
+ * Only the first thread's registers are available.
+ */
+int
+mdb_getareg(uint_t tid, const char *name, mdb_reg_t *regp)
+{
+	const struct elf_prstatus *prp;
+	size_t size;
+	int i;
+
+	if (tid != 1 || v8core.vc_core == NULL ||
+	    (prp = mdbv8_elfcore_note(v8core.vc_core, NT_PRSTATUS,
+	    &size)) == NULL || size < sizeof (*prp)) {
+		errno = ENOENT;
+		return (-1);
+	}
+
+	for (i = 0; v8core_regs[i].vr_name != NULL; i++) {
+		if (strcmp(v8core_regs[i].vr_name, name) == 0) {
+			*regp = prp->pr_reg[v8core_regs[i].vr_index];
+			return (0);
+		}
+	}
+
+	errno = ENOENT;
+	return (-1);
+}
+
+int
+mdb_get_xdata(const char *name, void *buf, size_t nbytes)
+{
+	struct ps_prochandle *Pr = &v8core.vc_ph;
+
+	if (strcmp(name, "pshandle") != 0 || nbytes < sizeof (Pr) ||
+	    v8core.vc_core == NULL) {
+		errno = ENOENT;
+		return (-1);
+	}
+
+	bcopy(&Pr, buf, sizeof (Pr));
+	return (sizeof (Pr));
+}
+
+/* ARGSUSED */
+int
+Pstate(struct ps_prochandle *Pr)
+{
+	return (PS_DEAD);
+}
+
+/* ARGSUSED */
+const psinfo_t *
+Ppsinfo(struct ps_prochandle *Pr)
+{
+	return (v8core.vc_have_psinfo ? &v8core.vc_psinfo : NULL);
+}
+
+/* ARGSUSED */
+const prmap_t *
+Pname_to_map(struct ps_prochandle *Pr, const char *name)
+{
+	if (name != PR_OBJ_EXEC || !v8core.vc_have_execmap)
+		return (NULL);
+
+	return (&v8core.vc_execmap);
+}
+
+typedef struct v8core_mapping_iter {
+	proc_map_f *vmi_func;
+	void *vmi_arg;
+} v8core_mapping_iter_t;
+
+static int
+v8core_mapping_cb(uintptr_t addr, size_t size, uint_t flags,
+    const char *name, void *arg)
+{
+	v8core_mapping_iter_t *vmip = arg;
+	prmap_t map;
+
+	bzero(&map, sizeof (map));
+	map.pr_vaddr = addr;
+	map.pr_size = size;
+	map.pr_pagesize = sysconf(_SC_PAGESIZE);
+	map.pr_mflags = ((flags & PF_R) ? MA_READ : 0) |
+	    ((flags & PF_W) ? MA_WRITE : 0) |
+	    ((flags & PF_X) ? MA_EXEC : 0) |
+	    (name == NULL ? MA_ANON : 0);
+
+	if (name != NULL)
+		(void) strlcpy(map.pr_mapname, name, sizeof (map.pr_mapname));
+
+	return (vmip->vmi_func(vmip->vmi_arg, &map, name));
+}
+
+/*
+ * Iterates the readable mappings in the core file.  Mappings of files are
+ * reported with the file's name, and anonymous mappings with a NULL name.
+ */
+/* ARGSUSED */
+int
+Pmapping_iter(struct ps_prochandle *Pr, proc_map_f *func, void *arg)
+{
+	v8core_mapping_iter_t vmi;
+
+	vmi.vmi_func = func;
+	vmi.vmi_arg = arg;
+	return (mdbv8_elfcore_iter(v8core.vc_core, v8core_mapping_cb, &vmi));
+}
+
+/*
+ * Walkers and dcmds
+ */
+
+static const mdb_walker_t *
+v8core_walker_lookup(const char *name)
+{
+	const mdb_walker_t *wp;
+
+	if (v8core.vc_modinfo == NULL)
+		return (NULL);
+
+	for (wp = v8core.vc_modinfo->mi_walkers; wp->walk_name != NULL; wp++) {
+		if (strcmp(wp->walk_name, name) == 0)
+			return (wp);
+	}
+
+	return (NULL);
+}
+
+const mdb_dcmd_t *
+v8core_dcmd_lookup(const char *name)
+{
+	const mdb_dcmd_t *dcp;
+
+	if (v8core.vc_modinfo == NULL)
+		return (NULL);
+
+	for (dcp = v8core.vc_modinfo->mi_dcmds; dcp->dc_name != NULL; dcp++) {
+		if (strcmp(dcp->dc_name, name) == 0)
+			return (dcp);
+	}
+
+	return (NULL);
+}
+
+const mdb_modinfo_t *
+v8core_modinfo(void)
+{
+	return (v8core.vc_modinfo);
+}
+
+int
+mdb_pwalk(const char *name, mdb_walk_cb_t func, void *arg, uintptr_t addr)
+{
+	const mdb_walker_t *wp;
+	mdb_walk_state_t ws;
+	int status;
+
+	if ((wp = v8core_walker_lookup(name)) == NULL) {
+		mdb_warn("unknown walker: %s\n", name);
+		return (-1);
+	}
+
+	bzero(&ws, sizeof (ws));
+	ws.walk_callback = func;
+	ws.walk_cbdata = arg;
+	ws.walk_addr = addr;
+	ws.walk_arg = wp->walk_init_arg;
+
+	if ((status = wp->walk_init(&ws)) == WALK_ERR)
+		return (-1);
+
+	if (status == WALK_NEXT) {
+		while ((status = wp->walk_step(&ws)) == WALK_NEXT)
+			continue;
+	}
+
+	if (wp->walk_fini != NULL)
+		wp->walk_fini(&ws);
+
+	return (status == WALK_ERR ? -1 : 0);
+}
+
+int
+mdb_walk(const char *name, mdb_walk_cb_t func, void *arg)
+{
+	return (mdb_pwalk(name, func, arg, 0));
+}
+
+typedef struct v8core_walk_dcmd {
+	const mdb_dcmd_t *vwd_dcmd;
+	int vwd_argc;
+	const mdb_arg_t *vwd_argv;
+	uint_t vwd_flags;
+} v8core_walk_dcmd_t;
+
+/* ARGSUSED */
+static int
+v8core_walk_dcmd_cb(uintptr_t addr, const void *data, void *arg)
+{
+	v8core_walk_dcmd_t *vwdp = arg;
+	int rv;
+
+	rv = vwdp->vwd_dcmd->dc_funcp(addr, vwdp->vwd_flags,
+	    vwdp->vwd_argc, vwdp->vwd_argv);
+	vwdp->vwd_flags &= ~DCMD_LOOPFIRST;
+
+	return (rv == DCMD_OK ? WALK_NEXT : WALK_ERR);
+}
+
+int
+mdb_pwalk_dcmd(const char *wname, const char *dname, int argc,
+    const mdb_arg_t *argv, uintptr_t addr)
+{
+	v8core_walk_dcmd_t vwd;
+
+	if ((vwd.vwd_dcmd = v8core_dcmd_lookup(dname)) == NULL) {
+		mdb_warn("unknown dcmd: %s\n", dname);
+		return (-1);
+	}
+
+	vwd.vwd_argc = argc;
+	vwd.vwd_argv = argv;
+	vwd.vwd_flags = DCMD_ADDRSPEC | DCMD_LOOP | DCMD_LOOPFIRST;
+
+	return (mdb_pwalk(wname, v8core_walk_dcmd_cb, &vwd, addr));
+}
+
+int
+mdb_walk_dcmd(const char *wname, const char *dname, int argc,
+    const mdb_arg_t *argv)
+{
+	return (mdb_pwalk_dcmd(wname, dname, argc, argv, 0));
+}
+
+int
+mdb_call_dcmd(const char *name, uintptr_t addr, uint_t flags, int argc,
+    const mdb_arg_t *argv)
+{
+	const mdb_dcmd_t *dcp;
+
+	if ((dcp = v8core_dcmd_lookup(name)) == NULL) {
+		mdb_warn("unknown dcmd: %s\n", name);
+		return (DCMD_ERR);
+	}
+
+	return (dcp->dc_funcp(addr, flags, argc, argv));
+}
+
+/*
+ * MDB's own language isn't available.
+ */
+/* ARGSUSED */
+int
+mdb_eval(const char *cmd)
+{
+	errno = ENOTSUP;
+	return (-1);
+}
+
+uintptr_t
+mdb_get_dot(void)
+{
+	return (v8core.vc_dot);
+}
+
+void
+mdb_set_dot(uintptr_t dot)
+{
+	v8core.vc_dot = dot;
+}
+
+void
+v8core_pipe_set(uintptr_t *addrs, size_t naddrs)
+{
+	v8core.vc_pipe = addrs;
+	v8core.vc_pipelen = naddrs;
+	v8core.vc_pipendx = 0;
+}
+
+int
+v8core_pipe_next(uintptr_t *addrp)
+{
+	if (v8core.vc_pipendx == v8core.vc_pipelen)
+		return (-1);
+
+	*addrp = v8core.vc_pipe[v8core.vc_pipendx++];
+	return (0);
+}
+
+/*
+ * As with MDB, the addresses returned include the one with which the dcmd was
+ * just invoked, and the dcmd won't be invoked for any of them again.
+ */
+void
+mdb_get_pipe(mdb_pipe_t *p)
+{
+	if (v8core.vc_pipendx == 0) {
+		p->pipe_data = NULL;
+		p->pipe_len = 0;
+		return;
+	}
+
+	p->pipe_data = &v8core.vc_pipe[v8core.vc_pipendx - 1];
+	p->pipe_len = v8core.vc_pipelen - v8core.vc_pipendx + 1;
+	v8core.vc_pipendx = v8core.vc_pipelen;
+}
+
+/*
+ * Loading the target
+ */
+
+static void
+v8core_obj_free(v8core_obj_t *vop)
+{
+	if (vop->vo_base != NULL)
+		(void) munmap(vop->vo_base, vop->vo_size);
+
+	free(vop->vo_path);
+	free(vop);
+}
+
+/*
+ * Load the object at "path", which is mapped at "base" in the target.
+ */
+static v8core_obj_t *
+v8core_obj_load(const char *path, uintptr_t base, boolean_t exec)
+{
+	const V8CORE_ELF(Ehdr) *ehp;
+	const V8CORE_ELF(Shdr) *shp, *strshp;
+	v8core_obj_t *vop;
+	struct stat st;
+	uintptr_t first = UINTPTR_MAX;
+	size_t i;
+	int fd, table;
+	void *addr;
+
+	if ((fd = open(path, O_RDONLY)) == -1)
+		return (NULL);
+
+	if (fstat(fd, &st) != 0 || st.st_size < sizeof (*ehp) ||
+	    (addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd,
+	    0)) == MAP_FAILED) {
+		(void) close(fd);
+		return (NULL);
+	}
+
+	(void) close(fd);
+
+	if ((vop = calloc(1, sizeof (*vop))) == NULL ||
+	    (vop->vo_path = strdup(path)) == NULL) {
+		(void) munmap(addr, st.st_size);
+		free(vop);
+		return (NULL);
+	}
+
+	vop->vo_name = strrchr(vop->vo_path, '/') != NULL ?
+	    strrchr(vop->vo_path, '/') + 1 : vop->vo_path;
+	vop->vo_exec = exec;
+	vop->vo_base = addr;
+	vop->vo_size = st.st_size;
+	ehp = addr;
+
+	if (memcmp(ehp->e_ident, ELFMAG, SELFMAG) != 0 ||
+	    ehp->e_ident[EI_CLASS] != V8CORE_ELFCLASS ||
+	    ehp->e_phentsize != sizeof (V8CORE_ELF(Phdr)) ||
+	    ehp->e_phoff > vop->vo_size || ehp->e_phnum >
+	    (vop->vo_size - ehp->e_phoff) / sizeof (V8CORE_ELF(Phdr))) {
+		v8core_obj_free(vop);
+		return (NULL);
+	}
+
+	vop->vo_phdrs = (const V8CORE_ELF(Phdr) *)(vop->vo_base +
+	    ehp->e_phoff);
+	vop->vo_phnum = ehp->e_phnum;
+
+	/*
+	 * The load address adjustment is the difference between where the
+	 * object was mapped and where its first loadable segment says it
+	 * should be (which is 0 for shared objects and position-independent
+	 * executables).
+	 */
+	for (i = 0; i < vop->vo_phnum; i++) {
+		if (vop->vo_phdrs[i].p_type == PT_LOAD) {
+			first = vop->vo_phdrs[i].p_vaddr -
+			    vop->vo_phdrs[i].p_offset;
+			break;
+		}
+	}
+
+	if (first == UINTPTR_MAX) {
+		v8core_obj_free(vop);
+		return (NULL);
+	}
+
+	vop->vo_bias = base - first;
+
+	if (ehp->e_shentsize != sizeof (V8CORE_ELF(Shdr)) ||
+	    ehp->e_shoff > vop->vo_size || ehp->e_shnum >
+	    (vop->vo_size - ehp->e_shoff) / sizeof (V8CORE_ELF(Shdr)))
+		return (vop);
+
+	shp = (const V8CORE_ELF(Shdr) *)(vop->vo_base + ehp->e_shoff);
+
+	for (i = 0; i < ehp->e_shnum; i++) {
+		if (shp[i].sh_type == SHT_SYMTAB)
+			table = MDB_TBL_SYMTAB;
+		else if (shp[i].sh_type == SHT_DYNSYM)
+			table = MDB_TBL_DYNSYM;
+		else
+			continue;
+
+		if (shp[i].sh_link >= ehp->e_shnum ||
+		    shp[i].sh_entsize != sizeof (V8CORE_ELF(Sym)) ||
+		    shp[i].sh_offset > vop->vo_size ||
+		    shp[i].sh_size > vop->vo_size - shp[i].sh_offset)
+			continue;
+
+		strshp = &shp[shp[i].sh_link];
+		if (strshp->sh_offset > vop->vo_size ||
+		    strshp->sh_size > vop->vo_size - strshp->sh_offset ||
+		    strshp->sh_size == 0 ||
+		    vop->vo_base[strshp->sh_offset + strshp->sh_size - 1] !=
+		    '\0')
+			continue;
+
+		vop->vo_syms[table] = (const V8CORE_ELF(Sym) *)(vop->vo_base +
+		    shp[i].sh_offset);
+		vop->vo_nsyms[table] = shp[i].sh_size /
+		    sizeof (V8CORE_ELF(Sym));
+		vop->vo_strs[table] = (const char *)vop->vo_base +
+		    strshp->sh_offset;
+		vop->vo_strsz[table] = strshp->sh_size;
+	}
+
+	return (vop);
+}
+
+typedef struct v8core_load {
+	uintptr_t vl_phdr;		/* AT_PHDR: executable's headers */
+	const char *vl_execpath;	/* executable to use instead */
+	v8core_obj_t **vl_tailp;	/* end of list of objects */
+} v8core_load_t;
+
+static int
+v8core_load_cb(uintptr_t start, uintptr_t end, uint64_t offset,
+    const char *name, void *arg)
+{
+	v8core_load_t *vlp = arg;
+	v8core_obj_t *vop, **vopp;
+	boolean_t exec;
+
+	/*
+	 * Each object is loaded once, at the mapping of its beginning.
+	 */
+	if (offset != 0)
+		return (0);
+
+	for (vop = v8core.vc_objs; vop != NULL; vop = vop->vo_next) {
+		if (strcmp(vop->vo_path, name) == 0)
+			return (0);
+	}
+
+	exec = vlp->vl_phdr >= start && vlp->vl_phdr < end;
+
+	if ((vop = v8core_obj_load(exec && vlp->vl_execpath != NULL ?
+	    vlp->vl_execpath : name, start, exec)) == NULL) {
+		if (exec) {
+			mdb_warn("failed to load executable \"%s\"\n",
+			    vlp->vl_execpath != NULL ? vlp->vl_execpath : name);
+		}
+		return (0);
+	}
+
+	if (exec) {
+		/*
+		 * The executable goes first in the list, since symbols are
+		 * looked up there first.
+		 */
+		vop->vo_next = v8core.vc_objs;
+		v8core.vc_objs = vop;
+
+		bzero(&v8core.vc_execmap, sizeof (v8core.vc_execmap));
+		v8core.vc_execmap.pr_vaddr = start;
+		v8core.vc_execmap.pr_size = end - start;
+		v8core.vc_execmap.pr_mflags = MA_READ;
+		(void) strlcpy(v8core.vc_execmap.pr_mapname, name,
+		    sizeof (v8core.vc_execmap.pr_mapname));
+		v8core.vc_have_execmap = B_TRUE;
+	} else {
+		for (vopp = &v8core.vc_objs; *vopp != NULL;
+		    vopp = &(*vopp)->vo_next)
+			continue;
+		*vopp = vop;
+	}
+
+	return (0);
+}
+
+/*
+ * Open the core file at "corepath", along with the objects it maps.  If
+ * "execpath" is given, it's used in place of the executable named in the core
+ * file (e.g., for a core file from another system).
+ */
+int
+v8core_target_open(const char *corepath, const char *execpath)
+{
+	const struct elf_prpsinfo *psp;
+	const uintptr_t *auxv;
+	v8core_load_t vl;
+	size_t size, i;
+
+	if ((v8core.vc_core = mdbv8_elfcore_open(corepath)) == NULL)
+		return (-1);
+
+	bzero(&vl, sizeof (vl));
+	vl.vl_execpath = execpath;
+
+	if ((auxv = mdbv8_elfcore_note(v8core.vc_core, NT_AUXV,
+	    &size)) != NULL) {
+		for (i = 0; i + 1 < size / sizeof (uintptr_t); i += 2) {
+			if (auxv[i] == AT_PHDR)
+				vl.vl_phdr = auxv[i + 1];
+		}
+	}
+
+	(void) mdbv8_elfcore_file_iter(v8core.vc_core, v8core_load_cb, &vl);
+
+	if (!v8core.vc_have_execmap && execpath != NULL) {
+		mdb_warn("couldn't find the executable's mapping in \"%s\"\n",
+		    corepath);
+	}
+
+	if ((psp = mdbv8_elfcore_note(v8core.vc_core, NT_PRPSINFO,
+	    &size)) != NULL && size >= sizeof (*psp)) {
+		v8core.vc_psinfo.pr_pid = psp->pr_pid;
+		v8core.vc_psinfo.pr_ppid = psp->pr_ppid;
+		bcopy(psp->pr_fname, v8core.vc_psinfo.pr_fname,
+		    MIN(sizeof (v8core.vc_psinfo.pr_fname) - 1,
+		    sizeof (psp->pr_fname)));
+		bcopy(psp->pr_psargs, v8core.vc_psinfo.pr_psargs,
+		    MIN(sizeof (v8core.vc_psinfo.pr_psargs) - 1,
+		    sizeof (psp->pr_psargs)));
+		v8core.vc_have_psinfo = B_TRUE;
+	}
+
+	/*
+	 * The module reads heap objects through this backend, which reads from
+	 * the core file (and falls back to the objects it maps).  The core file
+	 * remains ours, so the backend has no mb_fini entry point.
+	 */
+	v8core.vc_backend = mdbv8_elfcore_backend;
+	v8core.vc_backend.mb_vread = v8core_backend_vread;
+	v8core.vc_backend.mb_fini = NULL;
+
+	return (0);
+}
+
+void
+v8core_target_close(void)
+{
+	v8core_obj_t *vop;
+
+	while ((vop = v8core.vc_objs) != NULL) {
+		v8core.vc_objs = vop->vo_next;
+		v8core_obj_free(vop);
+	}
+
+	if (v8core.vc_addrsyms != NULL) {
+		mdb_free(v8core.vc_addrsyms,
+		    v8core.vc_naddrsyms * sizeof (v8core_addrsym_t));
+	}
+
+	mdbv8_elfcore_close(v8core.vc_core);
+	v8core.vc_core = NULL;
+}
+
+/*
+ * Load the debugger module.  Messages it prints while configuring itself go
+ * to stderr so that stdout contains only the output of commands.  Returns -1
+ * if the module couldn't configure itself for the target's version of V8.
+ */
+int
+v8core_module_load(void)
+{
+	v8core_output_set(stderr);
+	v8core.vc_modinfo = _mdb_init();
+	mdbv8_mem_setbackend(&v8core.vc_backend, v8core.vc_core);
+	v8core_output_set(stdout);
+
+	return (v8_isconfigured() ? 0 : -1);
+}
+
+void
+v8core_module_unload(void)
+{
+	_mdb_fini();
+	v8core.vc_modinfo = NULL;
+}
@@ -0,0 +1,21 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * Copyright (c) 2018, Joyent, Inc.
+ */
+
+/*
+ * sys/elf.h: mdb_v8 includes the illumos <sys/elf.h> for ELF definitions.  On
+ * Linux, these come from <elf.h>.
+ */
+
+#ifndef	_V8CORE_SYS_ELF_H
+#define	_V8CORE_SYS_ELF_H
+
+#include <elf.h>
+
+#endif	/* _V8CORE_SYS_ELF_H */
@@ -0,0 +1,200 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * Copyright (c) 2018, Joyent, Inc.
+ */
+
+/*
+ * mdb_modapi.h: the subset of the MDB module API that mdb_v8 uses, implemented
+ * by mdb_shim.c so that the module can be linked into the standalone v8core
+ * program.  The definitions here match the illumos ones closely enough for
+ * mdb_v8's purposes, but they're not binary compatible with them.
+ */
+
+#ifndef	_V8CORE_MDB_MODAPI_H
+#define	_V8CORE_MDB_MODAPI_H
+
+#include <elf.h>
+#include <stdarg.h>
+
+#ifdef _LP64
+typedef Elf64_Sym GElf_Sym;
+#else
+typedef Elf32_Sym GElf_Sym;
+#endif
+
+/*
+ * Memory allocation flags.  UM_GC allocations are freed when the current
+ * command completes.
+ */
+#define	UM_NOSLEEP	0x0
+#define	UM_SLEEP	0x1
+#define	UM_GC		0x2
+
+/*
+ * Return values and flags for dcmds.
+ */
+#define	DCMD_OK		0
+#define	DCMD_ERR	1
+#define	DCMD_USAGE	2
+#define	DCMD_NEXT	3
+#define	DCMD_ABORT	4
+
+#define	DCMD_ADDRSPEC	0x01	/* address specified */
+#define	DCMD_LOOP	0x02	/* invoked for each address in a list */
+#define	DCMD_LOOPFIRST	0x04	/* first invocation of a loop */
+#define	DCMD_PIPE	0x08	/* addresses come from a pipeline */
+#define	DCMD_PIPE_OUT	0x10	/* output goes to a pipeline */
+
+#define	DCMD_HDRSPEC(fl)	(((fl) & DCMD_LOOPFIRST) || !((fl) & DCMD_LOOP))
+
+/*
+ * Return values for walkers.
+ */
+#define	WALK_ERR	-1
+#define	WALK_NEXT	0
+#define	WALK_DONE	1
+
+#define	MDB_TYPE_STRING		0
+#define	MDB_TYPE_IMMEDIATE	1
+#define	MDB_TYPE_CHAR		2
+
+/*
+ * Option types for mdb_getopts().
+ */
+#define	MDB_OPT_SETBITS		1	/* uint_t bits, uint_t *p */
+#define	MDB_OPT_CLRBITS		2	/* uint_t bits, uint_t *p */
+#define	MDB_OPT_STR		3	/* const char **p */
+#define	MDB_OPT_UINTPTR		4	/* uintptr_t *p */
+#define	MDB_OPT_UINT64		5	/* uint64_t *p */
+#define	MDB_OPT_UINTPTR_SET	6	/* boolean_t *setp, uintptr_t *p */
+
+/*
+ * Symbol table and symbol type selectors for mdb_symbol_iter().
+ */
+#define	MDB_TBL_SYMTAB		0x0
+#define	MDB_TBL_DYNSYM		0x1
+#define	MDB_SYMTAB		MDB_TBL_SYMTAB
+#define	MDB_DYNSYM		MDB_TBL_DYNSYM
+
+#define	MDB_BIND_LOCAL		0x0100
+#define	MDB_BIND_GLOBAL		0x0200
+#define	MDB_BIND_WEAK		0x0400
+#define	MDB_BIND_ANY		0x0700
+
+#define	MDB_TYPE_NOTYPE		0x01000
+#define	MDB_TYPE_OBJECT		0x02000
+#define	MDB_TYPE_FUNC		0x04000
+#define	MDB_TYPE_ANY		0x7f000
+
+#define	MDB_SYM_FUZZY		0
+#define	MDB_SYM_EXACT		1
+
+#define	MDB_OBJ_EXEC		((const char *)0L)
+#define	MDB_OBJ_RTLD		((const char *)1L)
+#define	MDB_OBJ_EVERY		((const char *)-1L)
+
+typedef uint64_t mdb_reg_t;
+
+typedef struct mdb_arg {
+	uint_t a_type;
+	union {
+		const char *a_str;
+		uint64_t a_val;
+		char a_char;
+	} a_un;
+} mdb_arg_t;
+
+typedef struct mdb_symbol {
+	const char *sym_name;		/* name of symbol */
+	const char *sym_object;		/* name of containing object */
+	const GElf_Sym *sym_sym;	/* symbol, relocated to target */
+	uint_t sym_table;		/* MDB_TBL_* */
+	uint_t sym_id;			/* index in symbol table */
+} mdb_symbol_t;
+
+typedef int mdb_dcmd_f(uintptr_t, uint_t, int, const mdb_arg_t *);
+
+typedef struct mdb_dcmd {
+	const char *dc_name;		/* command name */
+	const char *dc_usage;		/* usage message */
+	const char *dc_descr;		/* description */
+	mdb_dcmd_f *dc_funcp;		/* command entry point */
+	void (*dc_help)(void);		/* command help */
+} mdb_dcmd_t;
+
+typedef int (*mdb_walk_cb_t)(uintptr_t, const void *, void *);
+
+typedef struct mdb_walk_state {
+	mdb_walk_cb_t walk_callback;	/* callback to issue */
+	void *walk_cbdata;		/* callback private data */
+	uintptr_t walk_addr;		/* current address */
+	void *walk_data;		/* walker private data */
+	void *walk_arg;			/* walker argument */
+	const void *walk_layer;		/* unused */
+} mdb_walk_state_t;
+
+typedef struct mdb_walker {
+	const char *walk_name;		/* walker name */
+	const char *walk_descr;		/* walker description */
+	int (*walk_init)(mdb_walk_state_t *);
+	int (*walk_step)(mdb_walk_state_t *);
+	void (*walk_fini)(mdb_walk_state_t *);
+	void *walk_init_arg;		/* walker argument */
+} mdb_walker_t;
+
+typedef struct mdb_pipe {
+	uintptr_t *pipe_data;		/* addresses */
+	size_t pipe_len;		/* number of addresses */
+} mdb_pipe_t;
+
+typedef struct mdb_modinfo {
+	ushort_t mi_dvers;		/* MDB_API_VERSION */
+	const mdb_dcmd_t *mi_dcmds;	/* NULL-terminated dcmds */
+	const mdb_walker_t *mi_walkers;	/* NULL-terminated walkers */
+} mdb_modinfo_t;
+
+extern ssize_t mdb_vread(void *, size_t, uintptr_t);
+extern ssize_t mdb_vwrite(const void *, size_t, uintptr_t);
+extern ssize_t mdb_readstr(char *, size_t, uintptr_t);
+extern ssize_t mdb_readsym(void *, size_t, const char *);
+
+extern int mdb_lookup_by_name(const char *, GElf_Sym *);
+extern int mdb_symbol_iter(const char *, uint_t, uint_t,
+    int (*)(mdb_symbol_t *, void *), void *);
+extern int mdb_getareg(uint_t, const char *, mdb_reg_t *);
+extern int mdb_get_xdata(const char *, void *, size_t);
+
+extern int mdb_walk(const char *, mdb_walk_cb_t, void *);
+extern int mdb_pwalk(const char *, mdb_walk_cb_t, void *, uintptr_t);
+extern int mdb_walk_dcmd(const char *, const char *, int, const mdb_arg_t *);
+extern int mdb_pwalk_dcmd(const char *, const char *, int,
+    const mdb_arg_t *, uintptr_t);
+extern int mdb_call_dcmd(const char *, uintptr_t, uint_t, int,
+    const mdb_arg_t *);
+extern int mdb_getopts(int, const mdb_arg_t *, ...);
+extern int mdb_eval(const char *);
+extern uintptr_t mdb_get_dot(void);
+extern void mdb_set_dot(uintptr_t);
+extern void mdb_get_pipe(mdb_pipe_t *);
+extern u_longlong_t mdb_strtoull(const char *);
+
+extern void *mdb_alloc(size_t, uint_t);
+extern void *mdb_zalloc(size_t, uint_t);
+extern void mdb_free(void *, size_t);
+
+extern void mdb_printf(const char *, ...);
+extern void mdb_warn(const char *, ...);
+extern size_t mdb_snprintf(char *, size_t, const char *, ...);
+extern void mdb_flush(void);
+extern int mdb_inc_indent(int);
+extern int mdb_dec_indent(int);
+
+extern const mdb_modinfo_t *_mdb_init(void);
+extern void _mdb_fini(void);
+
+#endif	/* _V8CORE_MDB_MODAPI_H */
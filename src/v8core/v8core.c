@@ -0,0 +1,450 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * Copyright (c) 2018, Joyent, Inc.
+ */
+
+/*
+ * v8core: runs mdb_v8's dcmds against a Linux core file of a Node.js process,
+ * without mdb.  Usage:
+ *
+ *     v8core [-f] [-e executable] core [command ...]
+ *
+ * Each command is an MDB-style command line, like "::jsstack -v" or
+ * "::findjsobjects -c Foo | ::findjsobjects | ::jsprint".  If no commands are
+ * given on the command line, they're read from stdin, one per line.  Only the
+ * dcmds provided by mdb_v8 (plus "::help" and "::dcmds") are available.
+ *
+ * Pipelines work as they do in MDB: the output of each stage but the last is
+ * parsed as a list of addresses, and the next stage is invoked once for each
+ * one.
+ *
+ * If mdb_v8 can't configure itself for the core file's version of V8, we fail
+ * without running any commands, unless "-f" is given (e.g., to configure it by
+ * hand with "::v8load").
+ */
+
+#include <sys/mdb_modapi.h>
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <alloca.h>
+
+#include "v8core.h"
+
+#define	V8CORE_MAXARGS		128
+#define	V8CORE_MAXSTAGES	16
+
+#define	V8CORE_EXIT_OK		0
+#define	V8CORE_EXIT_FAIL	1
+#define	V8CORE_EXIT_USAGE	2
+
+/*
+ * One stage of a pipeline: "[addr]::dcmd [args ...]".
+ */
+typedef struct v8core_stage {
+	boolean_t vs_addrspec;		/* address was specified */
+	uintptr_t vs_addr;		/* address, if specified */
+	const char *vs_name;		/* dcmd name */
+	int vs_argc;			/* number of arguments */
+	mdb_arg_t vs_argv[V8CORE_MAXARGS];	/* arguments */
+} v8core_stage_t;
+
+static const char *v8core_progname;
+
+static void
+v8core_usage(void)
+{
+	(void) fprintf(stderr, "usage: %s [-f] [-e executable] core "
+	    "[command ...]\n", v8core_progname);
+	(void) fprintf(stderr, "\nRuns mdb_v8 commands (e.g., "
+	    "\"::jsstack\") against a Linux core file.\nIf no commands "
+	    "are given, they're read from stdin.\n");
+	(void) fprintf(stderr, "\n    -e executable  read symbols from "
+	    "\"executable\" rather than the\n                   "
+	    "executable named in the core file\n");
+	(void) fprintf(stderr, "    -f             run commands even if "
+	    "mdb_v8 can't configure itself\n                   "
+	    "for the core file's version of V8\n");
+}
+
+/*
+ * Splits "line" into whitespace-separated words, honoring single and double
+ * quotes.  Each "|" outside quotes is returned as a separate word, with the
+ * corresponding entry of "pipes" set.  The words are stored in "buf", which
+ * must be at least twice the length of "line".  Returns the number of words,
+ * or -1 on error.
+ */
+static int
+v8core_tokenize(const char *line, char *buf, char **words, boolean_t *pipes,
+    int maxwords)
+{
+	const char *src = line;
+	char *dst = buf, quote;
+	int nwords = 0;
+
+	for (;;) {
+		while (isspace(*src))
+			src++;
+
+		if (*src == '\0')
+			return (nwords);
+
+		if (nwords == maxwords) {
+			(void) fprintf(stderr, "v8core: too many arguments\n");
+			return (-1);
+		}
+
+		words[nwords] = dst;
+		pipes[nwords++] = *src == '|';
+
+		if (*src == '|') {
+			*dst++ = *src++;
+			*dst++ = '\0';
+			continue;
+		}
+
+		while (*src != '\0' && !isspace(*src) && *src != '|') {
+			if (*src != '"' && *src != '\'') {
+				*dst++ = *src++;
+				continue;
+			}
+
+			quote = *src++;
+			while (*src != '\0' && *src != quote)
+				*dst++ = *src++;
+
+			if (*src == '\0') {
+				(void) fprintf(stderr,
+				    "v8core: unterminated quote\n");
+				return (-1);
+			}
+
+			src++;
+		}
+
+		*dst++ = '\0';
+	}
+}
+
+/*
+ * Parses the words of one pipeline stage.
+ */
+static int
+v8core_stage_parse(char **words, int nwords, v8core_stage_t *vsp)
+{
+	const char *word = words[0];
+	const char *colons;
+	uint64_t addr;
+	char *addrstr;
+	size_t len;
+	int i;
+
+	bzero(vsp, sizeof (*vsp));
+
+	if (nwords == 0) {
+		(void) fprintf(stderr, "v8core: missing command\n");
+		return (-1);
+	}
+
+	if ((colons = strstr(word, "::")) != NULL) {
+		if (colons != word) {
+			len = colons - word;
+			addrstr = alloca(len + 1);
+			bcopy(word, addrstr, len);
+			addrstr[len] = '\0';
+
+			if (v8core_strtonum(addrstr, &addr) != 0) {
+				(void) fprintf(stderr, "v8core: invalid "
+				    "address: \"%s\"\n", addrstr);
+				return (-1);
+			}
+
+			vsp->vs_addrspec = B_TRUE;
+			vsp->vs_addr = (uintptr_t)addr;
+		}
+
+		word = colons + 2;
+	}
+
+	if (*word == '\0') {
+		(void) fprintf(stderr, "v8core: missing command\n");
+		return (-1);
+	}
+
+	vsp->vs_name = word;
+	vsp->vs_argc = nwords - 1;
+	for (i = 1; i < nwords; i++) {
+		vsp->vs_argv[i - 1].a_type = MDB_TYPE_STRING;
+		vsp->vs_argv[i - 1].a_un.a_str = words[i];
+	}
+
+	return (0);
+}
+
+static void
+v8core_dcmd_usage(const mdb_dcmd_t *dcp)
+{
+	(void) fprintf(stderr, "Usage: %s %s\n", dcp->dc_name,
+	    dcp->dc_usage != NULL ? dcp->dc_usage : "");
+}
+
+static int
+v8core_builtin_dcmds(void)
+{
+	const mdb_dcmd_t *dcp;
+
+	for (dcp = v8core_modinfo()->mi_dcmds; dcp->dc_name != NULL; dcp++)
+		mdb_printf("%-20s - %s\n", dcp->dc_name, dcp->dc_descr);
+
+	return (DCMD_OK);
+}
+
+static int
+v8core_builtin_help(const v8core_stage_t *vsp)
+{
+	const mdb_dcmd_t *dcp;
+	const char *name;
+
+	if (vsp->vs_argc != 1) {
+		mdb_printf("Use \"::dcmds\" to list the available commands "
+		    "and \"::help NAME\" for\nhelp with a specific one.\n");
+		return (DCMD_OK);
+	}
+
+	name = vsp->vs_argv[0].a_un.a_str;
+	if (strncmp(name, "::", 2) == 0)
+		name += 2;
+
+	if ((dcp = v8core_dcmd_lookup(name)) == NULL) {
+		mdb_warn("unknown dcmd: %s\n", name);
+		return (DCMD_ERR);
+	}
+
+	mdb_printf("NAME\n  %s - %s\n\nSYNOPSIS\n  [ addr ] ::%s %s\n",
+	    dcp->dc_name, dcp->dc_descr, dcp->dc_name,
+	    dcp->dc_usage != NULL ? dcp->dc_usage : "");
+
+	if (dcp->dc_help != NULL) {
+		mdb_printf("\nDESCRIPTION\n");
+		(void) mdb_inc_indent(2);
+		dcp->dc_help();
+		(void) mdb_dec_indent(2);
+	}
+
+	return (DCMD_OK);
+}
+
+/*
+ * Invokes one stage of a pipeline.  If "input" is non-NULL, it's the output of
+ * the previous stage, and the dcmd is invoked once for each address in it.
+ */
+static int
+v8core_stage_run(const v8core_stage_t *vsp, char *input, uint_t flags)
+{
+	const mdb_dcmd_t *dcp;
+	char *word, *last;
+	uint64_t addr;
+	uintptr_t *addrs, dot;
+	size_t naddrs = 0;
+	int rv = DCMD_OK;
+
+	if (strcmp(vsp->vs_name, "dcmds") == 0)
+		return (v8core_builtin_dcmds());
+
+	if (strcmp(vsp->vs_name, "help") == 0)
+		return (v8core_builtin_help(vsp));
+
+	if ((dcp = v8core_dcmd_lookup(vsp->vs_name)) == NULL) {
+		mdb_warn("unknown dcmd: %s\n", vsp->vs_name);
+		return (DCMD_ERR);
+	}
+
+	if (input == NULL) {
+		if (vsp->vs_addrspec) {
+			flags |= DCMD_ADDRSPEC;
+			mdb_set_dot(vsp->vs_addr);
+		}
+
+		rv = dcp->dc_funcp(vsp->vs_addr, flags, vsp->vs_argc,
+		    vsp->vs_argv);
+	} else {
+		flags |= DCMD_ADDRSPEC | DCMD_LOOP | DCMD_LOOPFIRST | DCMD_PIPE;
+
+		/*
+		 * The input has at most one address for every two bytes.
+		 */
+		addrs = mdb_alloc((strlen(input) / 2 + 1) * sizeof (uintptr_t),
+		    UM_SLEEP | UM_GC);
+
+		for (word = strtok_r(input, " \t\n", &last); word != NULL;
+		    word = strtok_r(NULL, " \t\n", &last)) {
+			if (v8core_strtonum(word, &addr) != 0) {
+				mdb_warn("pipeline input is not an address: "
+				    "\"%s\"\n", word);
+				return (DCMD_ERR);
+			}
+
+			addrs[naddrs++] = (uintptr_t)addr;
+		}
+
+		v8core_pipe_set(addrs, naddrs);
+
+		while (v8core_pipe_next(&dot) == 0) {
+			mdb_set_dot(dot);
+			if ((rv = dcp->dc_funcp(dot, flags,
+			    vsp->vs_argc, vsp->vs_argv)) != DCMD_OK)
+				break;
+
+			flags &= ~DCMD_LOOPFIRST;
+		}
+
+		v8core_pipe_set(NULL, 0);
+	}
+
+	if (rv == DCMD_USAGE)
+		v8core_dcmd_usage(dcp);
+
+	return (rv);
+}
+
+/*
+ * Runs one command line.  Returns 0 on success and -1 on failure.
+ */
+static int
+v8core_run(const char *line)
+{
+	char *words[V8CORE_MAXARGS * 2];
+	boolean_t pipes[V8CORE_MAXARGS * 2];
+	v8core_stage_t *stages;
+	char *buf, *input = NULL;
+	int nwords, nstages = 0, start, i, rv = DCMD_OK;
+
+	buf = mdb_alloc(strlen(line) * 2 + 1, UM_SLEEP | UM_GC);
+	if ((nwords = v8core_tokenize(line, buf, words, pipes,
+	    V8CORE_MAXARGS * 2)) <= 0)
+		return (nwords);
+
+	stages = mdb_zalloc(sizeof (v8core_stage_t) * V8CORE_MAXSTAGES,
+	    UM_SLEEP | UM_GC);
+
+	for (start = 0, i = 0; i <= nwords; i++) {
+		if (i < nwords && !pipes[i])
+			continue;
+
+		if (nstages == V8CORE_MAXSTAGES) {
+			(void) fprintf(stderr, "v8core: too many pipeline "
+			    "stages\n");
+			return (-1);
+		}
+
+		if (i - start > V8CORE_MAXARGS) {
+			(void) fprintf(stderr, "v8core: too many arguments\n");
+			return (-1);
+		}
+
+		if (v8core_stage_parse(&words[start], i - start,
+		    &stages[nstages++]) != 0)
+			return (-1);
+
+		start = i + 1;
+	}
+
+	for (i = 0; i < nstages && rv == DCMD_OK; i++) {
+		if (i < nstages - 1)
+			v8core_capture_begin();
+
+		rv = v8core_stage_run(&stages[i], input,
+		    i < nstages - 1 ? DCMD_PIPE_OUT : 0);
+
+		free(input);
+		input = i < nstages - 1 ? v8core_capture_end() : NULL;
+	}
+
+	free(input);
+	mdb_flush();
+
+	return (rv == DCMD_OK ? 0 : -1);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const char *execpath = NULL;
+	boolean_t force = B_FALSE;
+	char *line = NULL;
+	size_t linesz = 0;
+	ssize_t len;
+	int c, i, status = V8CORE_EXIT_OK;
+
+	if ((v8core_progname = strrchr(argv[0], '/')) != NULL)
+		v8core_progname++;
+	else
+		v8core_progname = argv[0];
+
+	while ((c = getopt(argc, argv, "+e:fh")) != -1) {
+		switch (c) {
+		case 'e':
+			execpath = optarg;
+			break;
+		case 'f':
+			force = B_TRUE;
+			break;
+		case 'h':
+			v8core_usage();
+			return (V8CORE_EXIT_OK);
+		default:
+			v8core_usage();
+			return (V8CORE_EXIT_USAGE);
+		}
+	}
+
+	if (optind >= argc) {
+		v8core_usage();
+		return (V8CORE_EXIT_USAGE);
+	}
+
+	if (v8core_target_open(argv[optind], execpath) != 0)
+		return (V8CORE_EXIT_FAIL);
+
+	if (v8core_module_load() != 0 && !force) {
+		(void) fprintf(stderr, "%s: mdb_v8 could not configure itself "
+		    "for this core file (use -f to run commands anyway)\n",
+		    v8core_progname);
+		status = V8CORE_EXIT_FAIL;
+	} else if (optind + 1 < argc) {
+		for (i = optind + 1; i < argc; i++) {
+			if (v8core_run(argv[i]) != 0)
+				status = V8CORE_EXIT_FAIL;
+
+			v8core_gc();
+		}
+	} else {
+		while ((len = getline(&line, &linesz, stdin)) != -1) {
+			for (i = 0; isspace(line[i]); i++)
+				continue;
+
+			if (line[i] == '\0' || line[i] == '#')
+				continue;
+
+			if (v8core_run(line) != 0)
+				status = V8CORE_EXIT_FAIL;
+
+			v8core_gc();
+		}
+
+		free(line);
+	}
+
+	v8core_module_unload();
+	v8core_target_close();
+
+	return (status);
+}
@@ -0,0 +1,64 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * Copyright (c) 2018, Joyent, Inc.
+ */
+
+/*
+ * v8core.h: interfaces between the v8core program (v8core.c) and its
+ * implementation of the MDB module API (mdb_shim.c).
+ */
+
+#ifndef	_V8CORE_H
+#define	_V8CORE_H
+
+#include <stdio.h>
+#include <sys/mdb_modapi.h>
+
+/*
+ * Loading the target: the core file, and the executable and shared objects
+ * that it maps.
+ */
+int v8core_target_open(const char *, const char *);
+void v8core_target_close(void);
+
+/*
+ * Loading the debugger module and finding its commands.
+ */
+int v8core_module_load(void);
+void v8core_module_unload(void);
+const mdb_dcmd_t *v8core_dcmd_lookup(const char *);
+const mdb_modinfo_t *v8core_modinfo(void);
+
+/*
+ * Output from mdb_printf() goes to stdout by default.  It can be redirected to
+ * another stream, or captured into a buffer (for the left-hand side of a
+ * pipeline).  The captured buffer must be released with free().
+ */
+void v8core_output_set(FILE *);
+void v8core_capture_begin(void);
+char *v8core_capture_end(void);
+
+/*
+ * Sets the addresses with which the current pipeline stage is invoked, and
+ * returns them one at a time.  A dcmd can take all of the remaining addresses
+ * (including the current one) at once with mdb_get_pipe().
+ */
+void v8core_pipe_set(uintptr_t *, size_t);
+int v8core_pipe_next(uintptr_t *);
+
+/*
+ * Releases all UM_GC allocations.  This is invoked after each command.
+ */
+void v8core_gc(void);
+
+/*
+ * Parses an address or number the way MDB does (hexadecimal by default).
+ */
+int v8core_strtonum(const char *, uint64_t *);
+
+#endif	/* _V8CORE_H */
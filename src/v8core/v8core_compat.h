@@ -0,0 +1,65 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * Copyright (c) 2018, Joyent, Inc.
+ */
+
+/*
+ * v8core_compat.h: illumos definitions used throughout mdb_v8 that aren't
+ * available on Linux.  When building v8core, this file is included ahead of
+ * every source file (with "-include"), since those sources expect these
+ * definitions to come from the system headers they already include.
+ */
+
+#ifndef	_V8CORE_COMPAT_H
+#define	_V8CORE_COMPAT_H
+
+#ifndef	_GNU_SOURCE
+#define	_GNU_SOURCE
+#endif
+
+#include <sys/types.h>
+#include <sys/param.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+
+typedef enum { B_FALSE = 0, B_TRUE = 1 } boolean_t;
+typedef unsigned char uchar_t;
+typedef unsigned short ushort_t;
+typedef unsigned int uint_t;
+typedef unsigned long ulong_t;
+typedef long long longlong_t;
+typedef unsigned long long u_longlong_t;
+typedef long long hrtime_t;
+#ifndef _PTRDIFF_T
+typedef __PTRDIFF_TYPE__ ptrdiff_t;
+#endif
+
+#define	NANOSEC		1000000000LL
+#define	MICROSEC	1000000LL
+#define	MILLISEC	1000LL
+
+#define	ISP2(x)			(((x) & ((x) - 1)) == 0)
+#define	IS_P2ALIGNED(v, a)	((((uintptr_t)(v)) & ((uintptr_t)(a) - 1)) == 0)
+#define	P2ALIGN(x, align)	((x) & -(align))
+#define	P2PHASE(x, align)	((x) & ((align) - 1))
+#define	P2ROUNDUP(x, align)	(-(-(x) & -(align)))
+
+/*
+ * These are implemented in mdb_shim.c.  glibc may provide its own strlcpy()
+ * and strlcat(), so ours are renamed to avoid colliding with them.
+ */
+#define	strlcpy		v8core_strlcpy
+#define	strlcat		v8core_strlcat
+
+extern size_t v8core_strlcpy(char *, const char *, size_t);
+extern size_t v8core_strlcat(char *, const char *, size_t);
+extern hrtime_t gethrtime(void);
+extern hrtime_t gethrvtime(void);
+
+#endif	/* _V8CORE_COMPAT_H */
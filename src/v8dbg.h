@@ -41,7 +41,7 @@
  */
 #define	V8_SMI_VALUE(smi)	((smi) >> (V8_SmiValueShift + V8_SmiShiftSize))
 #define	V8_VALUE_SMI(value)	\
-	((value) << (V8_SmiValueShift + V8_SmiShiftSize))
+	((uintptr_t)(value) << (V8_SmiValueShift + V8_SmiShiftSize))
 
 /*
  * Check compiler hints, which hang off of SharedFunctionInfo objects.
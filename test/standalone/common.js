@@ -30,6 +30,7 @@ exports.finalizeTestObject = finalizeTestObject;
 exports.standaloneTest = standaloneTest;
 exports.findTestObject = findTestObject;
 exports.splitMdbLines = splitMdbLines;
+exports.parseMemcacheStats = parseMemcacheStats;
 
 var MDB_SENTINEL = 'MDB_SENTINEL';
 
@@ -416,3 +417,18 @@ function splitMdbLines(output, options)
 
 	return (lines.slice(0, lines.length - 1));
 }
+
+/*
+ * Parses the output of "::v8memcache" into an object mapping each statistic's
+ * name to its value.
+ */
+function parseMemcacheStats(output)
+{
+	var stats = {};
+
+	splitMdbLines(output, {}).forEach(function (line) {
+		stats[line.substr(0, 28).trim()] = line.substr(29).trim();
+	});
+
+	return (stats);
+}
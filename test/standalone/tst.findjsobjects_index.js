@@ -0,0 +1,328 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * Copyright (c) 2018, Joyent, Inc.
+ */
+
+/*
+ * tst.findjsobjects_index.js: exercises saving the results of
+ * "::findjsobjects" to an index file with -S and loading them with -L.
+ *
+ * After saving the index, we unload and reload the dmod to discard the results
+ * of the heap scan, load the index, and verify that the results are the same,
+ * including when we look up an object by the address of one of its instances.
+ * We also list objects by shallow size with "-s bytes", write a heap summary
+ * with "::jsheapdiff -o" and compare it against the loaded heap, which should
+ * show no growth, compare an empty summary (one with no shapes, and so an
+ * empty string table) against it, and write a heap snapshot with
+ * "::jsheapsnapshot" and check that it's consistent.
+ */
+
+var assert = require('assert');
+var fs = require('fs');
+var util = require('util');
+
+var common = require('./common');
+
+function Widget(i)
+{
+	this.widgetIndex = i;
+	this.widgetName = 'widget ' + i;
+}
+
+var testObject = {
+    'widgets': []
+};
+
+function main()
+{
+	var testFuncs, indexfile, garbagefile, summaryfile, emptyfile, snapfile;
+	var scanOutput, i;
+
+	indexfile = util.format('/var/tmp/mdbv8.findjsobjects.%d.idx',
+	    process.pid);
+	garbagefile = util.format('/var/tmp/mdbv8.findjsobjects.%d.bad',
+	    process.pid);
+	summaryfile = util.format('/var/tmp/mdbv8.findjsobjects.%d.sum',
+	    process.pid);
+	emptyfile = util.format('/var/tmp/mdbv8.findjsobjects.%d.empty',
+	    process.pid);
+	snapfile = util.format('/var/tmp/mdbv8.findjsobjects.%d.heapsnapshot',
+	    process.pid);
+
+	for (i = 0; i < 32; i++) {
+		testObject['widgets'].push(new Widget(i));
+	}
+
+	testFuncs = [];
+
+	testFuncs.push(function saveIndex(mdb, callback) {
+		console.error('test: saving index');
+		mdb.runCmd('::findjsobjects -S ' + indexfile + '\n',
+		    function (output, erroutput) {
+			assert.strictEqual(erroutput, '');
+			assert.ok(/Widget: widgetIndex, widgetName/.test(
+			    output), 'expected Widget objects in output');
+			assert.ok(fs.statSync(indexfile).size > 0);
+			scanOutput = output;
+			callback();
+		});
+	});
+
+	testFuncs.push(function reloadDmod(mdb, callback) {
+		mdb.runCmd('::unload mdb_v8\n', function () {
+			mdb.runCmd('::load ' + common.dmodpath() + '\n',
+			    function () { callback(); });
+		});
+	});
+
+	testFuncs.push(function loadGarbage(mdb, callback) {
+		console.error('test: loading a file that is not an index');
+		fs.writeFileSync(garbagefile, new Buffer(4096).fill('x'));
+		mdb.runCmd('::findjsobjects -L ' + garbagefile + '\n',
+		    function (output, erroutput) {
+			fs.unlinkSync(garbagefile);
+			assert.strictEqual(output, '');
+			assert.ok(/is not a findjsobjects index/.test(
+			    erroutput));
+			callback();
+		});
+	});
+
+	testFuncs.push(function loadIndex(mdb, callback) {
+		console.error('test: loading index');
+		mdb.runCmd('::findjsobjects -L ' + indexfile + '\n',
+		    function (output, erroutput) {
+			assert.strictEqual(erroutput, '');
+			assert.strictEqual(output, scanOutput);
+			callback();
+		});
+	});
+
+	testFuncs.push(function loadIndexTwice(mdb, callback) {
+		console.error('test: loading index after scan');
+		mdb.runCmd('::findjsobjects -L ' + indexfile + '\n',
+		    function (output, erroutput) {
+			assert.strictEqual(output, '');
+			assert.ok(/cannot load an index/.test(erroutput));
+			callback();
+		});
+	});
+
+	testFuncs.push(function listInstances(mdb, callback) {
+		console.error('test: listing instances from loaded index');
+		mdb.runCmd('::findjsobjects -c Widget | ::findjsobjects | ' +
+		    '::jsprint -b widgetIndex\n', function (output) {
+			var lines = common.splitMdbLines(output, {});
+			assert.ok(lines.length >= 32,
+			    'expected at least 32 Widgets');
+			callback();
+		});
+	});
+
+	testFuncs.push(function lookupInstance(mdb, callback) {
+		console.error('test: looking up an instance in loaded index');
+		mdb.runCmd('::findjsobjects -c Widget | ::findjsobjects\n',
+		    function (output) {
+			var addrs = common.splitMdbLines(output, {});
+			assert.ok(addrs.length >= 32,
+			    'expected at least 32 Widgets');
+
+			/*
+			 * The last instance isn't the representative object,
+			 * so it can only be found through the index's table of
+			 * instance addresses.
+			 */
+			mdb.runCmd(addrs[addrs.length - 1] +
+			    '::findjsobjects\n', function (output2, erroutput) {
+				assert.strictEqual(erroutput, '');
+				assert.strictEqual(output2, output);
+				callback();
+			});
+		});
+	});
+
+	testFuncs.push(function sortBytes(mdb, callback) {
+		console.error('test: listing objects by shallow size');
+		mdb.runCmd('::findjsobjects -s bytes\n',
+		    function (output, erroutput) {
+			var lines, fields, widget, prev;
+
+			assert.strictEqual(erroutput, '');
+			lines = common.splitMdbLines(output, {});
+			assert.ok(/#PROPS\s+BYTES\s+CONSTRUCTOR/.test(
+			    lines[0]));
+			prev = 0;
+			lines.slice(1).forEach(function (line) {
+				fields = line.trim().split(/\s+/);
+				assert.ok(parseInt(fields[3], 10) >= prev,
+				    'expected objects sorted by bytes');
+				prev = parseInt(fields[3], 10);
+				if (/Widget: widgetIndex/.test(line))
+					widget = fields;
+			});
+			assert.ok(widget !== undefined);
+			assert.ok(parseInt(widget[3], 10) >=
+			    parseInt(widget[1], 10) * 16);
+			callback();
+		});
+	});
+
+	testFuncs.push(function saveSummary(mdb, callback) {
+		console.error('test: saving heap summary');
+		mdb.runCmd('::jsheapdiff -o ' + summaryfile + '\n',
+		    function (output, erroutput) {
+			assert.strictEqual(erroutput, '');
+			assert.strictEqual(output, '');
+			assert.ok(fs.statSync(summaryfile).size > 0);
+			callback();
+		});
+	});
+
+	testFuncs.push(function diffSummary(mdb, callback) {
+		console.error('test: comparing heap summary with heap');
+		mdb.runCmd('::jsheapdiff ' + summaryfile + '\n',
+		    function (output, erroutput) {
+			var re, lines, before, after;
+
+			assert.strictEqual(erroutput, '');
+			re = /pid (\d+): (\d+) objects, (\d+) bytes/;
+			lines = common.splitMdbLines(output, {});
+			before = re.exec(lines[0]);
+			after = re.exec(lines[1]);
+			assert.ok(/^before/.test(lines[0]) && before !== null);
+			assert.ok(/^after/.test(lines[1]) && after !== null);
+			assert.deepEqual(before.slice(1), after.slice(1));
+			assert.ok(parseInt(after[2], 10) >= 32);
+			assert.ok(/\+BYTES/.test(lines[3]));
+			assert.strictEqual(lines.length, 4,
+			    'expected no shapes to have grown');
+			callback();
+		});
+	});
+
+	testFuncs.push(function diffEmpty(mdb, callback) {
+		var hdr;
+
+		/*
+		 * Write a summary of a heap with no shapes by hand: just the
+		 * header, with zero shapes and an empty string table, both at
+		 * the end of the header.
+		 */
+		console.error('test: comparing an empty summary with heap');
+		hdr = new Buffer(80);
+		hdr.fill(0);
+		hdr.write('MDBV8FJD', 0, 'ascii');
+		hdr.writeUInt32LE(2, 8);		/* version */
+		hdr.writeUInt32LE(1, 16);		/* pid */
+		hdr.writeUInt32LE(80, 64);		/* shapes offset */
+		hdr.writeUInt32LE(80, 72);		/* strtab offset */
+		fs.writeFileSync(emptyfile, hdr);
+
+		mdb.runCmd('::jsheapdiff ' + emptyfile + '\n',
+		    function (output, erroutput) {
+			var lines;
+
+			fs.unlinkSync(emptyfile);
+			assert.strictEqual(erroutput, '');
+			lines = common.splitMdbLines(output, {});
+			assert.ok(/^before.*pid 1: 0 objects, 0 bytes/.test(
+			    lines[0]));
+			assert.ok(lines.length > 4,
+			    'expected every shape to have grown');
+			callback();
+		});
+	});
+
+	testFuncs.push(function diffGarbage(mdb, callback) {
+		console.error('test: comparing a file that is not a summary');
+		mdb.runCmd('::jsheapdiff ' + summaryfile + ' ' + indexfile +
+		    '\n', function (output, erroutput) {
+			assert.strictEqual(output, '');
+			assert.ok(/is not a heap summary/.test(erroutput));
+			callback();
+		});
+	});
+
+	testFuncs.push(function writeSnapshot(mdb, callback) {
+		console.error('test: writing heap snapshot');
+		mdb.runCmd('::jsheapsnapshot ' + snapfile + '\n',
+		    function (output, erroutput) {
+			var snap, meta, nf, ef, strings, nodes, edges;
+			var n, e, nedges, widgets, names, iswidget, target;
+
+			assert.strictEqual(erroutput, '');
+			assert.strictEqual(output, '');
+			snap = JSON.parse(fs.readFileSync(snapfile, 'utf8'));
+			meta = snap.snapshot.meta;
+			nf = meta.node_fields.length;
+			ef = meta.edge_fields.length;
+			strings = snap.strings;
+			nodes = snap.nodes;
+			edges = snap.edges;
+			assert.strictEqual(nodes.length,
+			    snap.snapshot.node_count * nf);
+			assert.strictEqual(edges.length,
+			    snap.snapshot.edge_count * ef);
+
+			/*
+			 * Walk the edges of each node, checking that they add
+			 * up, and collect the values of each Widget's
+			 * widgetName property.
+			 */
+			nedges = 0;
+			widgets = 0;
+			names = {};
+			for (n = 0; n < nodes.length; n += nf) {
+				iswidget = strings[nodes[n + 1]] == 'Widget';
+				if (iswidget)
+					widgets++;
+
+				for (e = nedges * ef;
+				    e < (nedges + nodes[n + 4]) * ef; e += ef) {
+					target = edges[e + 2];
+					assert.ok(target % nf === 0);
+					assert.ok(target < nodes.length);
+					if (iswidget && strings[edges[e + 1]] ==
+					    'widgetName') {
+						names[strings[
+						    nodes[target + 1]]] = true;
+					}
+				}
+
+				nedges += nodes[n + 4];
+			}
+
+			assert.strictEqual(nedges, snap.snapshot.edge_count);
+			assert.ok(widgets >= 32,
+			    'expected at least 32 Widgets');
+			assert.ok(names['widget 31'],
+			    'expected reference to "widget 31"');
+			callback();
+		});
+	});
+
+	testFuncs.push(function findObject(mdb, callback) {
+		common.findTestObject(mdb, function (err) {
+			fs.unlinkSync(indexfile);
+			fs.unlinkSync(summaryfile);
+			fs.unlinkSync(snapfile);
+			callback(err);
+		});
+	});
+
+	common.finalizeTestObject(testObject);
+	common.standaloneTest(testFuncs, function (err) {
+		if (err) {
+			throw (err);
+		}
+
+		console.log('%s passed', process.argv[1]);
+	});
+}
+
+main();
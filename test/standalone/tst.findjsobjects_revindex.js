@@ -0,0 +1,102 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * Copyright (c) 2018, Joyent, Inc.
+ */
+
+/*
+ * tst.findjsobjects_revindex.js: exercises "::findjsobjects -R", which answers
+ * reference queries from a reverse reference index.
+ *
+ * Our test object refers to two instances of RevindexTarget.  We pipe both of
+ * them into "::findjsobjects -R" at once and check that it reports the test
+ * object as the referrer of each, through the right property.  Then we pipe
+ * the output of -R onward, which should emit only the referring objects.
+ */
+
+var assert = require('assert');
+
+var common = require('./common');
+
+function RevindexTarget(name)
+{
+	this.revindexTargetName = name;
+}
+
+var testObject = {
+    'revindexName': 'revindex test object',
+    'revindexFirst': new RevindexTarget('first'),
+    'revindexSecond': new RevindexTarget('second')
+};
+
+var TARGETS = '::findjsobjects -c RevindexTarget | ::findjsobjects | ';
+var REF_REGEXP = /^[0-9a-f]+ referred to by ([0-9a-f]+)\.(\w+)$/;
+
+function main()
+{
+	var testFuncs, addr;
+
+	testFuncs = [];
+
+	testFuncs.push(function findObject(mdb, callback) {
+		common.findTestObject(mdb, function (err, found) {
+			addr = found;
+			callback(err);
+		});
+	});
+
+	testFuncs.push(function reverseIndex(mdb, callback) {
+		console.error('test: ::findjsobjects -R');
+		mdb.runCmd(TARGETS + '::findjsobjects -R\n',
+		    function (output, erroutput) {
+			var lines, props;
+
+			assert.strictEqual(erroutput, '');
+			lines = common.splitMdbLines(output, {});
+			props = [];
+			lines.forEach(function (line) {
+				var match = line.match(REF_REGEXP);
+				if (match !== null && match[1] == addr)
+					props.push(match[2]);
+			});
+
+			assert.deepEqual(props.sort(),
+			    [ 'revindexFirst', 'revindexSecond' ],
+			    'expected the test object to refer to both ' +
+			    'targets');
+			callback();
+		});
+	});
+
+	testFuncs.push(function reverseIndexPiped(mdb, callback) {
+		console.error('test: ::findjsobjects -R in a pipeline');
+		mdb.runCmd(TARGETS +
+		    '::findjsobjects -R | ::jsprint revindexName\n',
+		    function (output, erroutput) {
+			var lines;
+
+			assert.strictEqual(erroutput, '');
+			lines = common.splitMdbLines(output, {});
+			assert.strictEqual(lines.filter(function (line) {
+				return (line == '"revindex test object"');
+			}).length, 2,
+			    'expected the test object once per target');
+			callback();
+		});
+	});
+
+	common.finalizeTestObject(testObject);
+	common.standaloneTest(testFuncs, function (err) {
+		if (err) {
+			throw (err);
+		}
+
+		console.log('%s passed', process.argv[1]);
+	});
+}
+
+main();
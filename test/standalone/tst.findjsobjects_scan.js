@@ -0,0 +1,141 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * Copyright (c) 2018, Joyent, Inc.
+ */
+
+/*
+ * tst.findjsobjects_scan.js: checks that the different ways of scanning the
+ * heap for "::findjsobjects" find the same objects.  We scan the heap with no
+ * options, then with several worker processes (-P), with the smallest read
+ * window (-w), and with a time budget (-T) that may stop the scan before it's
+ * done, in which case we run "::findjsobjects" again until the scan finishes.
+ * The output of each must match that of the plain scan exactly, including the
+ * representative object chosen for each shape.
+ *
+ * The results of a scan are kept for the rest of the session, so before each
+ * scan, we unload and reload the dmod to start over.  Long scans report their
+ * progress on stderr, so we don't expect it to be empty.
+ */
+
+var assert = require('assert');
+
+var common = require('./common');
+
+var PARTIAL = 'results are partial';
+
+/*
+ * Enough objects of a few shapes to give the scan something to find.
+ */
+function Widget(i)
+{
+	this.widgetIndex = i;
+	this.widgetName = 'widget ' + i;
+}
+
+function Gadget(i)
+{
+	this.gadgetIndex = i;
+	this.gadgetWidget = new Widget(i);
+}
+
+var testObject = {
+    'scanWidgets': [],
+    'scanGadgets': []
+};
+
+/*
+ * Unload and reload the dmod, so that the next "::findjsobjects" scans the
+ * heap from scratch, then run "::findjsobjects" with "options" and invoke
+ * "callback" with its output and error output.
+ */
+function rescan(mdb, options, callback)
+{
+	mdb.runCmd('::unload mdb_v8\n', function (output, erroutput) {
+		assert.strictEqual(erroutput, '');
+		mdb.runCmd('::load ' + common.dmodpath() + '\n',
+		    function (output2, erroutput2) {
+			assert.strictEqual(erroutput2, '');
+			mdb.runCmd('::findjsobjects ' + options + '\n',
+			    callback);
+		});
+	});
+}
+
+function main()
+{
+	var testFuncs, plain, i;
+
+	for (i = 0; i < 1000; i++) {
+		testObject.scanWidgets.push(new Widget(i));
+		testObject.scanGadgets.push(new Gadget(i));
+	}
+
+	testFuncs = [];
+
+	testFuncs.push(function scanPlain(mdb, callback) {
+		console.error('test: ::findjsobjects');
+		rescan(mdb, '', function (output) {
+			assert.ok(output.indexOf(
+			    'Widget: widgetIndex, widgetName') != -1,
+			    'expected to find Widgets');
+			assert.ok(output.indexOf(
+			    'Gadget: gadgetIndex, gadgetWidget') != -1,
+			    'expected to find Gadgets');
+			plain = output;
+			callback();
+		});
+	});
+
+	testFuncs.push(function scanParallel(mdb, callback) {
+		console.error('test: ::findjsobjects -P 4');
+		rescan(mdb, '-P 4', function (output, erroutput) {
+			assert.ok(erroutput.indexOf('scanning serially') == -1,
+			    'expected a parallel scan');
+			assert.strictEqual(output, plain);
+			callback();
+		});
+	});
+
+	testFuncs.push(function scanWindow(mdb, callback) {
+		console.error('test: ::findjsobjects -w 0t4096');
+		rescan(mdb, '-w 0t4096', function (output) {
+			assert.strictEqual(output, plain);
+			callback();
+		});
+	});
+
+	testFuncs.push(function scanBudget(mdb, callback) {
+		var nruns = 1;
+
+		console.error('test: ::findjsobjects -T 1 (repeated)');
+		rescan(mdb, '-T 1', function onScan(output, erroutput) {
+			if (erroutput.indexOf(PARTIAL) != -1) {
+				assert.ok(nruns < 1000, 'scan never finished');
+				nruns++;
+				mdb.runCmd('::findjsobjects -T 1\n', onScan);
+				return;
+			}
+
+			console.error('scan finished after %d run%s', nruns,
+			    nruns == 1 ? '' : 's');
+			assert.strictEqual(output, plain);
+			callback();
+		});
+	});
+
+	common.finalizeTestObject(testObject);
+	common.standaloneTest(testFuncs, function (err) {
+		if (err) {
+			throw (err);
+		}
+
+		console.log('%s passed', process.argv[1]);
+	});
+}
+
+main();
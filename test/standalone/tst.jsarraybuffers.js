@@ -0,0 +1,108 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * Copyright (c) 2018, Joyent, Inc.
+ */
+
+/*
+ * tst.jsarraybuffers.js: exercises "::jsarraybuffers".  We create several
+ * Uint16Array views of one ArrayBuffer, whose backing store should be counted
+ * once, and several Int16Arrays, each with its own ArrayBuffer, whose backing
+ * stores should each be counted.  (Node itself doesn't use these two kinds of
+ * typed array.)
+ */
+
+var assert = require('assert');
+
+var common = require('./common');
+
+var NVIEWS = 4;
+var SHARED_BYTES = 1048576;
+var NSEPARATE = 3;
+var SEPARATE_BYTES = 65536;
+
+var testObject = {
+    'sharedBuffer': new ArrayBuffer(SHARED_BYTES),
+    'sharedViews': [],
+    'separateArrays': []
+};
+
+/*
+ * Returns the object count, backing store count and bytes that
+ * "::jsarraybuffers" reported for the constructor "name" in "lines".
+ */
+function censusFor(lines, name)
+{
+	var rowRegexp, rows;
+
+	rowRegexp = new RegExp('^\\s*[0-9a-f]+\\s+(\\d+)\\s+(\\d+)\\s+(\\d+) ' +
+	    name + '$');
+	rows = lines.map(function (line) {
+		return (line.match(rowRegexp));
+	}).filter(function (match) {
+		return (match !== null);
+	});
+
+	assert.strictEqual(rows.length, 1,
+	    '::jsarraybuffers should report ' + name + ' objects');
+	return ({
+	    'nobjs': parseInt(rows[0][1], 10),
+	    'nstores': parseInt(rows[0][2], 10),
+	    'bytes': parseInt(rows[0][3], 10)
+	});
+}
+
+function main()
+{
+	var testFuncs, i;
+
+	for (i = 0; i < NVIEWS; i++) {
+		testObject.sharedViews.push(new Uint16Array(
+		    testObject.sharedBuffer, i * 4096, 2048));
+	}
+
+	for (i = 0; i < NSEPARATE; i++) {
+		testObject.separateArrays.push(
+		    new Int16Array(SEPARATE_BYTES / 2));
+	}
+
+	testFuncs = [];
+
+	testFuncs.push(function jsarraybuffers(mdb, callback) {
+		console.error('test: ::jsarraybuffers');
+		mdb.runCmd('::jsarraybuffers\n', function (output, erroutput) {
+			var lines, shared, separate;
+
+			assert.strictEqual(erroutput, '');
+			lines = common.splitMdbLines(output, {});
+
+			shared = censusFor(lines, 'Uint16Array');
+			assert.ok(shared.nobjs >= NVIEWS);
+			assert.ok(shared.nstores <= shared.nobjs - NVIEWS + 1,
+			    'expected the shared backing store to be ' +
+			    'counted once');
+			assert.ok(shared.bytes >= SHARED_BYTES);
+
+			separate = censusFor(lines, 'Int16Array');
+			assert.ok(separate.nstores >= NSEPARATE,
+			    'expected each backing store to be counted');
+			assert.ok(separate.bytes >= NSEPARATE * SEPARATE_BYTES);
+			callback();
+		});
+	});
+
+	common.finalizeTestObject(testObject);
+	common.standaloneTest(testFuncs, function (err) {
+		if (err) {
+			throw (err);
+		}
+
+		console.log('%s passed', process.argv[1]);
+	});
+}
+
+main();
@@ -0,0 +1,84 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * Copyright (c) 2018, Joyent, Inc.
+ */
+
+/*
+ * tst.jselements.js: exercises "::jselements".  Creating an array with a
+ * length gives it a holey backing store with room for all of its elements.
+ * We fill in only a few of them, so "::jselements" should list the array
+ * among the most wasteful objects, with nearly all of its elements holes.
+ */
+
+var assert = require('assert');
+
+var common = require('./common');
+
+var LENGTH = 5000;
+var NFILLED = 10;
+var PTRSIZE = process.arch == 'x64' ? 8 : 4;
+
+var testObject = {
+    'holeyArray': new Array(LENGTH)
+};
+
+function main()
+{
+	var testFuncs, i;
+
+	for (i = 0; i < NFILLED; i++)
+		testObject.holeyArray[i * (LENGTH / NFILLED)] = i;
+
+	testFuncs = [];
+
+	testFuncs.push(function jselements(mdb, callback) {
+		console.error('test: ::jselements');
+		mdb.runCmd('::jselements -n 100\n',
+		    function (output, erroutput) {
+			var rowRegexp, rows, holes;
+
+			assert.strictEqual(erroutput, '');
+
+			/*
+			 * The array is listed on its own (as a group of one)
+			 * among the most wasteful objects.
+			 */
+			rowRegexp = new RegExp('^\\s*[0-9a-f]+\\s+1\\s+' +
+			    '(\\d+)\\s+(\\d+)\\s+(\\d+)\\s+(\\d+)\\s+\\S+\\s+' +
+			    'Array$');
+			rows = common.splitMdbLines(output, {}).map(
+			    function (line) {
+				return (line.match(rowRegexp));
+			}).filter(function (match) {
+				return (match !== null &&
+				    parseInt(match[2], 10) == LENGTH);
+			});
+
+			assert.ok(rows.length > 0,
+			    '::jselements should report the holey array');
+			holes = parseInt(rows[0][3], 10);
+			assert.ok(parseInt(rows[0][1], 10) >= LENGTH);
+			assert.ok(holes >= LENGTH - NFILLED,
+			    'expected the holey array to be mostly holes');
+			assert.ok(parseInt(rows[0][4], 10) >= holes * PTRSIZE,
+			    'expected each hole to count as wasted');
+			callback();
+		});
+	});
+
+	common.finalizeTestObject(testObject);
+	common.standaloneTest(testFuncs, function (err) {
+		if (err) {
+			throw (err);
+		}
+
+		console.log('%s passed', process.argv[1]);
+	});
+}
+
+main();
@@ -0,0 +1,117 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * Copyright (c) 2018, Joyent, Inc.
+ */
+
+/*
+ * tst.jsfunctions_contexts.js: exercises "::jsfunctions -c", which reports
+ * the contexts kept alive by each function's closures.  Each of our
+ * counterClosure closures keeps its own context alive, while all of our
+ * sharedClosure closures share one, so "::jsfunctions -c" should report many
+ * more distinct contexts for the former than for the latter.
+ */
+
+var assert = require('assert');
+
+var common = require('./common');
+
+var NCLOSURES = 20;
+
+function makeCounter(i)
+{
+	var state = { 'count': i };
+	return (function counterClosure() { return (state.count++ + i); });
+}
+
+function makeShared(n)
+{
+	var state = { 'count': 0 };
+	var closures = [];
+	var i;
+
+	for (i = 0; i < n; i++) {
+		closures.push(function sharedClosure() {
+			return (state.count++);
+		});
+	}
+
+	return (closures);
+}
+
+var testObject = {
+    'counters': [],
+    'shared': makeShared(NCLOSURES)
+};
+
+/*
+ * Returns the instance count, context count and context bytes that
+ * "::jsfunctions -c" reported for the function "name" in "output".
+ */
+function contextsFor(output, name)
+{
+	var rowRegexp, rows;
+
+	rowRegexp = new RegExp('^\\s*[0-9a-f]+\\s+(\\d+)\\s+(\\d+)\\s+(\\d+) ' +
+	    name + ' ');
+	rows = common.splitMdbLines(output, {}).map(function (line) {
+		return (line.match(rowRegexp));
+	}).filter(function (match) {
+		return (match !== null);
+	});
+
+	assert.strictEqual(rows.length, 1,
+	    '::jsfunctions -c should report ' + name);
+	return ({
+	    'ninstances': parseInt(rows[0][1], 10),
+	    'ncontexts': parseInt(rows[0][2], 10),
+	    'ctxbytes': parseInt(rows[0][3], 10)
+	});
+}
+
+function main()
+{
+	var testFuncs, i;
+
+	for (i = 0; i < NCLOSURES; i++)
+		testObject.counters.push(makeCounter(i));
+
+	testFuncs = [];
+
+	testFuncs.push(function jsfunctionsContexts(mdb, callback) {
+		console.error('test: ::jsfunctions -c');
+		mdb.runCmd('::jsfunctions -c -n Closure\n',
+		    function (output, erroutput) {
+			var counter, shared;
+
+			assert.strictEqual(erroutput, '');
+			counter = contextsFor(output, 'counterClosure');
+			shared = contextsFor(output, 'sharedClosure');
+
+			assert.ok(counter.ninstances >= NCLOSURES);
+			assert.ok(counter.ncontexts >= NCLOSURES,
+			    'each counterClosure should keep its own ' +
+			    'context alive');
+			assert.ok(counter.ctxbytes > 0);
+			assert.ok(shared.ninstances >= NCLOSURES);
+			assert.ok(shared.ncontexts < counter.ncontexts,
+			    'sharedClosures should share their context');
+			callback();
+		});
+	});
+
+	common.finalizeTestObject(testObject);
+	common.standaloneTest(testFuncs, function (err) {
+		if (err) {
+			throw (err);
+		}
+
+		console.log('%s passed', process.argv[1]);
+	});
+}
+
+main();
@@ -0,0 +1,92 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * Copyright (c) 2018, Joyent, Inc.
+ */
+
+/*
+ * tst.jslargest.js: exercises "::jslargest".  We create an array whose
+ * elements alone take more than a megabyte and a string of two megabytes, and
+ * check that "::jslargest" lists both among the largest objects, in decreasing
+ * order of size.
+ */
+
+var assert = require('assert');
+
+var common = require('./common');
+
+var NLARGEST = 10;
+var ARRAY_LENGTH = 200000;
+var STRING_LENGTH = 2 * 1024 * 1024;
+var PTRSIZE = process.arch == 'x64' ? 8 : 4;
+
+var testObject = {
+    'largeArray': [],
+    'largeString': null
+};
+
+function main()
+{
+	var testFuncs, i;
+
+	for (i = 0; i < ARRAY_LENGTH; i++)
+		testObject.largeArray.push(i);
+	testObject.largeString = new Array(STRING_LENGTH + 1).join('x');
+
+	testFuncs = [];
+
+	testFuncs.push(function jslargest(mdb, callback) {
+		console.error('test: ::jslargest');
+		mdb.runCmd('::jslargest -n 0t' + NLARGEST + '\n',
+		    function (output, erroutput) {
+			var rowRegexp, rows, prev;
+
+			assert.strictEqual(erroutput, '');
+			rowRegexp = /^\s*[0-9a-f]+\s+(\S+)\s+(\d+) (.*)$/;
+			rows = common.splitMdbLines(output, {}).map(
+			    function (line) {
+				return (line.match(rowRegexp));
+			}).filter(function (match) {
+				return (match !== null);
+			});
+
+			assert.strictEqual(rows.length, NLARGEST,
+			    '::jslargest should report ' + NLARGEST +
+			    ' objects');
+
+			prev = Infinity;
+			rows.forEach(function (row) {
+				assert.ok(parseInt(row[2], 10) <= prev,
+				    'expected objects sorted by decreasing ' +
+				    'size');
+				prev = parseInt(row[2], 10);
+			});
+
+			assert.ok(rows.some(function (row) {
+				return (row[1] == 'JSArray' &&
+				    row[3] == 'Array' && parseInt(row[2], 10) >=
+				    ARRAY_LENGTH * PTRSIZE);
+			}), '::jslargest should report the large array');
+			assert.ok(rows.some(function (row) {
+				return (row[3] == '<string>' &&
+				    parseInt(row[2], 10) >= STRING_LENGTH);
+			}), '::jslargest should report the large string');
+			callback();
+		});
+	});
+
+	common.finalizeTestObject(testObject);
+	common.standaloneTest(testFuncs, function (err) {
+		if (err) {
+			throw (err);
+		}
+
+		console.log('%s passed', process.argv[1]);
+	});
+}
+
+main();
@@ -0,0 +1,82 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * Copyright (c) 2018, Joyent, Inc.
+ */
+
+/*
+ * tst.jspath.js: exercises "::jspath".  The only way to reach our PathLeaf is
+ * from the test object, through an intermediate object, so the path that
+ * "::jspath" prints for it should end with those two references.
+ */
+
+var assert = require('assert');
+
+var common = require('./common');
+
+function PathLeaf()
+{
+	this.pathLeafName = 'path leaf';
+}
+
+var testObject = {
+    'pathMiddle': {
+        'pathLeaf': new PathLeaf()
+    }
+};
+
+function main()
+{
+	var testFuncs, addr;
+
+	testFuncs = [];
+
+	testFuncs.push(function findObject(mdb, callback) {
+		common.findTestObject(mdb, function (err, found) {
+			addr = found;
+			callback(err);
+		});
+	});
+
+	testFuncs.push(function jspath(mdb, callback) {
+		console.error('test: ::jspath');
+		mdb.runCmd('::findjsobjects -c PathLeaf | ::findjsobjects | ' +
+		    '::jspath\n', function (output, erroutput) {
+			var lines, stepRegexp, steps, n;
+
+			assert.strictEqual(erroutput, '');
+			lines = common.splitMdbLines(output, {});
+			assert.strictEqual(lines[0], 'path 1:');
+
+			stepRegexp = /^    ([0-9a-f]+)\.(\w+) => ([0-9a-f]+)$/;
+			steps = lines.map(function (line) {
+				return (line.match(stepRegexp));
+			}).filter(function (match) {
+				return (match !== null);
+			});
+
+			n = steps.length;
+			assert.ok(n >= 2, 'expected at least two references');
+			assert.strictEqual(steps[n - 2][1], addr);
+			assert.strictEqual(steps[n - 2][2], 'pathMiddle');
+			assert.strictEqual(steps[n - 1][1], steps[n - 2][3]);
+			assert.strictEqual(steps[n - 1][2], 'pathLeaf');
+			callback();
+		});
+	});
+
+	common.finalizeTestObject(testObject);
+	common.standaloneTest(testFuncs, function (err) {
+		if (err) {
+			throw (err);
+		}
+
+		console.log('%s passed', process.argv[1]);
+	});
+}
+
+main();
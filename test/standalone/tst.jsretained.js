@@ -0,0 +1,95 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * Copyright (c) 2018, Joyent, Inc.
+ */
+
+/*
+ * tst.jsretained.js: exercises "::jsretained".  Our test object is the only
+ * referrer of an array of objects, so its retained size should include all of
+ * them and be well beyond its own shallow size.
+ */
+
+var assert = require('assert');
+
+var common = require('./common');
+
+var NPAYLOADS = 1000;
+var PTRSIZE = process.arch == 'x64' ? 8 : 4;
+
+function RetainedPayload(i)
+{
+	this.payloadIndex = i;
+}
+
+function RetainedHolder()
+{
+	var i;
+
+	this.retainedPayloads = [];
+	for (i = 0; i < NPAYLOADS; i++)
+		this.retainedPayloads.push(new RetainedPayload(i));
+}
+
+var testObject = new RetainedHolder();
+
+function main()
+{
+	var testFuncs, addr;
+
+	testFuncs = [];
+
+	testFuncs.push(function findObject(mdb, callback) {
+		common.findTestObject(mdb, function (err, found) {
+			addr = found;
+			callback(err);
+		});
+	});
+
+	testFuncs.push(function retained(mdb, callback) {
+		console.error('test: ::jsretained');
+		mdb.runCmd('0x' + addr + '::jsretained\n',
+		    function (output, erroutput) {
+			var rowRegexp, rows, shallow, size;
+
+			assert.strictEqual(erroutput, '');
+			rowRegexp = /^\s*([0-9a-f]+)\s+(\d+)\s+(\d+) (\S+)$/;
+			rows = common.splitMdbLines(output, {}).map(
+			    function (line) {
+				return (line.match(rowRegexp));
+			}).filter(function (match) {
+				return (match !== null && match[1] == addr);
+			});
+
+			assert.strictEqual(rows.length, 1,
+			    '::jsretained should report the test object');
+			assert.strictEqual(rows[0][4], 'RetainedHolder');
+			shallow = parseInt(rows[0][2], 10);
+			size = parseInt(rows[0][3], 10);
+			assert.ok(shallow > 0);
+
+			/*
+			 * Each payload has at least a Map pointer, properties,
+			 * elements, and one in-object property.
+			 */
+			assert.ok(size >= shallow + NPAYLOADS * 4 * PTRSIZE,
+			    'expected the test object to retain its payloads');
+			callback();
+		});
+	});
+
+	common.finalizeTestObject(testObject);
+	common.standaloneTest(testFuncs, function (err) {
+		if (err) {
+			throw (err);
+		}
+
+		console.log('%s passed', process.argv[1]);
+	});
+}
+
+main();
@@ -0,0 +1,90 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * Copyright (c) 2018, Joyent, Inc.
+ */
+
+/*
+ * tst.jsstrdups.js: exercises "::jsstrdups".  We make many separate copies of
+ * two different strings of the same length (joining the pieces of each at
+ * runtime makes a new copy each time), and check that each is reported once,
+ * with all of its copies, and that the two aren't merged.
+ */
+
+var assert = require('assert');
+
+var common = require('./common');
+
+var NCOPIES = 2000;
+var VALUES = [ [ 'strdups', 'alpha' ], [ 'strdups', 'bravo' ] ];
+
+var testObject = {
+    'strdupsCopies': []
+};
+
+/*
+ * Checks that "value" is reported exactly once in "lines" of output from
+ * "::jsstrdups", with all of its copies.
+ */
+function checkValue(lines, value)
+{
+	var rowRegexp, rows;
+
+	rowRegexp = new RegExp('^\\s*[0-9a-f]+\\s+(\\d+)\\s+(\\d+)\\s+' +
+	    '(\\d+) "' + value + '"$');
+	rows = lines.map(function (line) {
+		return (line.match(rowRegexp));
+	}).filter(function (match) {
+		return (match !== null);
+	});
+
+	assert.strictEqual(rows.length, 1,
+	    'expected "' + value + '" to be reported once');
+	assert.ok(parseInt(rows[0][1], 10) >= NCOPIES,
+	    'expected at least ' + NCOPIES + ' copies of "' + value + '"');
+	assert.ok(parseInt(rows[0][3], 10) < parseInt(rows[0][2], 10),
+	    'interning should save less than the total');
+}
+
+function main()
+{
+	var testFuncs, i;
+
+	for (i = 0; i < NCOPIES; i++) {
+		VALUES.forEach(function (pieces) {
+			testObject.strdupsCopies.push(pieces.join(' '));
+		});
+	}
+
+	testFuncs = [];
+
+	testFuncs.push(function jsstrdups(mdb, callback) {
+		console.error('test: ::jsstrdups');
+		mdb.runCmd('::jsstrdups -n 100\n',
+		    function (output, erroutput) {
+			var lines;
+
+			assert.strictEqual(erroutput, '');
+			lines = common.splitMdbLines(output, {});
+			VALUES.forEach(function (pieces) {
+				checkValue(lines, pieces.join(' '));
+			});
+			callback();
+		});
+	});
+
+	common.finalizeTestObject(testObject);
+	common.standaloneTest(testFuncs, function (err) {
+		if (err) {
+			throw (err);
+		}
+
+		console.log('%s passed', process.argv[1]);
+	});
+}
+
+main();
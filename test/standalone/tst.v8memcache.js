@@ -0,0 +1,153 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * Copyright (c) 2018, Joyent, Inc.
+ */
+
+/*
+ * tst.v8memcache.js: exercises the cache of target memory pages through the
+ * statistics reported by "::v8memcache".
+ *
+ * We discard the cache and reset its statistics, then look up the object
+ * containing an address in the middle of our test object with "::v8whatis"
+ * (which reads the object's Map and in-object property count to find its
+ * size), twice.  The first lookup should fill pages from the target, and the
+ * second should make the same reads, all of them (other than any too large
+ * to cache) from cached pages.  Finally, we scan the heap with
+ * "::findjsobjects", whose many small reads of nearby heap objects should
+ * mostly be satisfied from cached pages.
+ */
+
+var assert = require('assert');
+
+var common = require('./common');
+
+var testObject = {
+    'memcacheName': 'memcache test object',
+    'memcacheValue': 42
+};
+
+/*
+ * Checks the statistics for a heap scan with "::findjsobjects".
+ */
+function checkScanStats(stats)
+{
+	var reads = parseInt(stats['reads'], 10);
+
+	assert.ok(reads > 0);
+	assert.ok(parseInt(stats['reads from cached pages'], 10) > 0,
+	    'expected cache hits');
+	assert.ok(parseInt(stats['target reads'], 10) < reads,
+	    'expected fewer reads from the target than requested');
+}
+
+function main()
+{
+	var testFuncs, addr, first;
+
+	testFuncs = [];
+
+	testFuncs.push(function findObject(mdb, callback) {
+		common.findTestObject(mdb, function (err, found) {
+			addr = found;
+			callback(err);
+		});
+	});
+
+	testFuncs.push(function resetCache(mdb, callback) {
+		console.error('test: resetting cache');
+		mdb.runCmd('::v8memcache -f\n', function (output, erroutput) {
+			assert.strictEqual(erroutput, '');
+			mdb.runCmd('::v8memcache -z\n', function (output2) {
+				assert.strictEqual(output2, '');
+				callback();
+			});
+		});
+	});
+
+	testFuncs.push(function whatisCold(mdb, callback) {
+		console.error('test: ::v8whatis with an empty cache');
+		mdb.runCmd('0x' + addr + '+8::v8whatis\n',
+		    function (output, erroutput) {
+			assert.strictEqual(erroutput, '');
+			assert.strictEqual(output.trim(), addr);
+			mdb.runCmd('::v8memcache\n', function (output2) {
+				first = common.parseMemcacheStats(output2);
+				assert.strictEqual(first['cache state'],
+				    'enabled',
+				    'the cache should be used for a core file');
+				assert.ok(parseInt(first['reads'], 10) > 0);
+				assert.ok(parseInt(
+				    first['reads filling pages'], 10) > 0,
+				    'expected pages to be filled');
+				assert.ok(parseInt(first['target reads'], 10) >
+				    0, 'expected reads from the target');
+				callback();
+			});
+		});
+	});
+
+	testFuncs.push(function whatisWarm(mdb, callback) {
+		console.error('test: ::v8whatis with a warm cache');
+		mdb.runCmd('::v8memcache -z\n', function () {
+			mdb.runCmd('0x' + addr + '+8::v8whatis\n',
+			    function (output, erroutput) {
+				assert.strictEqual(erroutput, '');
+				assert.strictEqual(output.trim(), addr);
+				mdb.runCmd('::v8memcache\n',
+				    function (output2) {
+					var second =
+					    common.parseMemcacheStats(output2);
+					var bypassed;
+
+					assert.strictEqual(second['reads'],
+					    first['reads'],
+					    'expected the same reads again');
+					bypassed = second[
+					    'reads bypassing cache'];
+					assert.strictEqual(
+					    second['reads from cached pages'],
+					    String(parseInt(second['reads'],
+					    10) - parseInt(bypassed, 10)),
+					    'expected every cacheable read ' +
+					    'to hit');
+					assert.strictEqual(
+					    second['reads filling pages'], '0');
+					assert.strictEqual(
+					    second['target reads'], bypassed,
+					    'expected no other reads from ' +
+					    'the target');
+					callback();
+				});
+			});
+		});
+	});
+
+	testFuncs.push(function findjsobjectsScan(mdb, callback) {
+		console.error('test: ::findjsobjects');
+		mdb.runCmd('::v8memcache -z\n', function () {
+			mdb.runCmd('::findjsobjects\n', function () {
+				mdb.runCmd('::v8memcache\n', function (output) {
+					checkScanStats(
+					    common.parseMemcacheStats(output));
+					callback();
+				});
+			});
+		});
+	});
+
+	common.finalizeTestObject(testObject);
+	common.standaloneTest(testFuncs, function (err) {
+		if (err) {
+			throw (err);
+		}
+
+		console.log('%s passed', process.argv[1]);
+	});
+}
+
+main();
@@ -0,0 +1,139 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * Copyright (c) 2018, Joyent, Inc.
+ */
+
+/*
+ * tst.v8memcache_unreadable.js: checks that reads of memory known to be
+ * unreadable fail without consulting the target, through the statistics
+ * reported by "::v8memcache".
+ *
+ * We find the lowest mapping in the core file with "::mappings".  The word
+ * just below it is in the gap beneath it, which is unmapped.  We read that word
+ * twice (with "::v8type", which starts by reading the Map pointer of the
+ * object at that address), and check that the second read fails without a
+ * target read.  Then we check that the first word of the mapping, right next to
+ * the gap, can still be read.
+ */
+
+var assert = require('assert');
+
+var common = require('./common');
+
+var testObject = {
+    'unreadableName': 'unreadable memory test object'
+};
+
+/*
+ * Returns the number of reads described by "stats" (as returned by
+ * common.parseMemcacheStats()) that succeeded.
+ */
+function readsSucceeded(stats)
+{
+	return (parseInt(stats['reads from mapped memory'], 10) +
+	    parseInt(stats['reads from cached pages'], 10) +
+	    parseInt(stats['reads filling pages'], 10) +
+	    parseInt(stats['reads bypassing cache'], 10) -
+	    parseInt(stats['failed reads'], 10));
+}
+
+/*
+ * Runs "::v8type" on the heap object whose Map pointer is at "addr" (a
+ * hexadecimal string), after resetting the cache statistics, and invokes
+ * "callback" with the statistics for that command.
+ */
+function readWord(mdb, addr, callback)
+{
+	mdb.runCmd('::v8memcache -z\n', function () {
+		mdb.runCmd('0x' + addr + '+1::v8type\n', function () {
+			mdb.runCmd('::v8memcache\n', function (output) {
+				callback(common.parseMemcacheStats(output));
+			});
+		});
+	});
+}
+
+function main()
+{
+	var testFuncs, base, gapaddr;
+
+	testFuncs = [];
+
+	testFuncs.push(function findMapping(mdb, callback) {
+		console.error('test: finding the lowest mapping');
+		mdb.runCmd('::mappings\n', function (output, erroutput) {
+			var lines, bases;
+
+			assert.strictEqual(erroutput, '');
+			lines = common.splitMdbLines(output, {});
+			assert.ok(/BASE/.test(lines[0]),
+			    'expected header line');
+			bases = lines.slice(1).map(function (line) {
+				return (parseInt(line.trim().split(/\s+/)[0],
+				    16));
+			});
+			base = Math.min.apply(null, bases);
+			assert.ok(base > 0x10000,
+			    'expected the lowest page to be unmapped');
+			gapaddr = (base - 8).toString(16);
+			console.error('lowest mapping: %s', base.toString(16));
+			callback();
+		});
+	});
+
+	testFuncs.push(function readGapCold(mdb, callback) {
+		console.error('test: reading unmapped memory');
+		mdb.runCmd('::v8memcache -f\n', function () {
+			readWord(mdb, gapaddr, function (stats) {
+				assert.strictEqual(stats['cache state'],
+				    'enabled',
+				    'the cache should be used for a core file');
+				assert.strictEqual(readsSucceeded(stats), 0,
+				    'expected the read to fail');
+				callback();
+			});
+		});
+	});
+
+	testFuncs.push(function readGapWarm(mdb, callback) {
+		console.error('test: reading unmapped memory again');
+		readWord(mdb, gapaddr, function (stats) {
+			assert.ok(parseInt(stats['reads'], 10) > 0);
+			assert.strictEqual(readsSucceeded(stats), 0,
+			    'expected the read to fail');
+			assert.strictEqual(stats['target reads'], '0',
+			    'expected the read to fail without consulting ' +
+			    'the target');
+			assert.ok(parseInt(stats['reads known unreadable'],
+			    10) > 0, 'expected a read known to be unreadable');
+			assert.ok(parseInt(stats['unreadable ranges'], 10) > 0);
+			callback();
+		});
+	});
+
+	testFuncs.push(function readNextToGap(mdb, callback) {
+		console.error('test: reading memory next to the gap');
+		readWord(mdb, base.toString(16), function (stats) {
+			assert.ok(readsSucceeded(stats) > 0,
+			    'expected the first word of the mapping to be ' +
+			    'readable');
+			callback();
+		});
+	});
+
+	common.finalizeTestObject(testObject);
+	common.standaloneTest(testFuncs, function (err) {
+		if (err) {
+			throw (err);
+		}
+
+		console.log('%s passed', process.argv[1]);
+	});
+}
+
+main();
@@ -0,0 +1,135 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * Copyright (c) 2018, Joyent, Inc.
+ */
+
+/*
+ * tst.elfcore_truncated.js: checks that the ELF core backend only reads the
+ * parts of a core file's segments that are actually in the file.  We write a
+ * small core file by hand with three PT_LOAD segments: one whose contents are
+ * all present, one whose p_filesz runs past the end of the file, and one whose
+ * p_offset is past the end of the file.  Then we open it with "::v8target" in
+ * "build/v8core" and check the segments and bytes it reports.  "make v8core"
+ * must have been run first.  On systems other than GNU/Linux on x86-64, this
+ * test does nothing.
+ */
+
+var assert = require('assert');
+var childprocess = require('child_process');
+var fs = require('fs');
+var os = require('os');
+var path = require('path');
+
+var V8CORE = path.join(__dirname, '..', '..', 'build', 'v8core');
+
+var ELF_HEADER_SIZE = 64;
+var ELF_PHDR_SIZE = 56;
+var ET_CORE = 4;
+var EM_X86_64 = 62;
+var PT_LOAD = 1;
+var PF_R = 4;
+var PF_W = 2;
+var PAGESIZE = 4096;
+
+/*
+ * The segments we write.  Each one claims PAGESIZE * "npages" bytes of memory
+ * at "vaddr", stored in the file at "offset".  The file itself ends after
+ * FILESIZE bytes, so the second segment is only half present, and the third is
+ * missing entirely.
+ */
+var SEGMENTS = [
+    { 'vaddr': 0x100000, 'offset': PAGESIZE, 'npages': 1 },
+    { 'vaddr': 0x200000, 'offset': 2 * PAGESIZE, 'npages': 2 },
+    { 'vaddr': 0x300000, 'offset': 16 * PAGESIZE, 'npages': 1 }
+];
+var FILESIZE = 3 * PAGESIZE;
+
+function writeU64(buf, value, offset)
+{
+	buf.writeUInt32LE(value % 0x100000000, offset);
+	buf.writeUInt32LE(Math.floor(value / 0x100000000), offset + 4);
+}
+
+/*
+ * Returns the contents of a core file with the program headers described by
+ * SEGMENTS.  Each page present in the file is filled with a distinct byte.
+ */
+function makeCore()
+{
+	var buf, i, off, size;
+
+	buf = Buffer.alloc(FILESIZE);
+	for (off = PAGESIZE; off < FILESIZE; off += PAGESIZE)
+		buf.fill(off / PAGESIZE, off, off + PAGESIZE);
+
+	buf.write('\u007fELF', 0, 'latin1');
+	buf[4] = 2;				/* ELFCLASS64 */
+	buf[5] = 1;				/* ELFDATA2LSB */
+	buf[6] = 1;				/* EV_CURRENT */
+	buf.writeUInt16LE(ET_CORE, 16);
+	buf.writeUInt16LE(EM_X86_64, 18);
+	buf.writeUInt32LE(1, 20);
+	writeU64(buf, ELF_HEADER_SIZE, 32);	/* e_phoff */
+	buf.writeUInt16LE(ELF_HEADER_SIZE, 52);
+	buf.writeUInt16LE(ELF_PHDR_SIZE, 54);
+	buf.writeUInt16LE(SEGMENTS.length, 56);
+
+	for (i = 0; i < SEGMENTS.length; i++) {
+		off = ELF_HEADER_SIZE + i * ELF_PHDR_SIZE;
+		size = SEGMENTS[i].npages * PAGESIZE;
+		buf.writeUInt32LE(PT_LOAD, off);
+		buf.writeUInt32LE(PF_R | PF_W, off + 4);
+		writeU64(buf, SEGMENTS[i].offset, off + 8);
+		writeU64(buf, SEGMENTS[i].vaddr, off + 16);
+		writeU64(buf, size, off + 32);		/* p_filesz */
+		writeU64(buf, size, off + 40);		/* p_memsz */
+		writeU64(buf, PAGESIZE, off + 48);
+	}
+
+	assert.ok(ELF_HEADER_SIZE + SEGMENTS.length * ELF_PHDR_SIZE <=
+	    PAGESIZE);
+	return (buf);
+}
+
+function main()
+{
+	var corefile, stdout, expected;
+
+	if (os.platform() != 'linux' || os.arch() != 'x64') {
+		console.log('%s skipped (GNU/Linux on x86-64 only)',
+		    process.argv[1]);
+		return;
+	}
+
+	assert.ok(fs.existsSync(V8CORE),
+	    'missing ' + V8CORE + ' (run "make v8core" first)');
+
+	corefile = path.join(process.env.CATMPDIR || os.tmpdir(),
+	    'truncated.' + process.pid);
+	fs.writeFileSync(corefile, makeCore());
+
+	/*
+	 * The core file has no notes, so mdb_v8 can't configure itself, and
+	 * v8core needs "-f" to run commands anyway.  Only the first segment and
+	 * the first page of the second are in the file.
+	 */
+	console.error('test: ::v8target on %s', corefile);
+	stdout = childprocess.execFileSync(V8CORE, [ '-f', corefile,
+	    '::v8target ' + corefile, '::v8target' ], {
+	    'encoding': 'utf8',
+	    'stdio': [ 'ignore', 'pipe', 'ignore' ]
+	});
+	expected = 'reading target memory from ELF core file "' + corefile +
+	    '" (2 segments, ' + (2 * PAGESIZE) + ' bytes)\n';
+	assert.strictEqual(stdout, expected);
+
+	fs.unlinkSync(corefile);
+	console.log('%s passed', process.argv[1]);
+}
+
+main();
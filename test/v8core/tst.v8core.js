@@ -0,0 +1,137 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * Copyright (c) 2018, Joyent, Inc.
+ */
+
+/*
+ * tst.v8core.js: smoke test for "v8core" on GNU/Linux.  We start a Node
+ * program that spins in a known stack of functions, save a core file of it
+ * with gcore(1) (from gdb), and run "build/v8core" on that core file to check
+ * that "::jsstack" finds those functions and "::findjsobjects" finds the
+ * object they were passed.  "make v8core" must have been run first.  On other
+ * systems, this test does nothing.
+ */
+
+var assert = require('assert');
+var childprocess = require('child_process');
+var fs = require('fs');
+var os = require('os');
+var path = require('path');
+var vasync = require('vasync');
+
+var V8CORE = path.join(__dirname, '..', '..', 'build', 'v8core');
+var PROGRAM = path.join(__dirname, '..', 'test-programs', 'gcore-loop.js');
+
+/*
+ * The first properties of the object passed down the stack by PROGRAM, as
+ * "::findjsobjects" prints them.
+ */
+var PROPS = 'obj1smalldate, obj2bigdate';
+
+/*
+ * How long to give the program to start up and reach its loop before we save
+ * its core file.
+ */
+var STARTUP_MS = 2000;
+
+function main()
+{
+	var child, corebase, corefile;
+
+	if (os.platform() != 'linux') {
+		console.log('%s skipped (GNU/Linux only)', process.argv[1]);
+		return;
+	}
+
+	assert.ok(fs.existsSync(V8CORE),
+	    'missing ' + V8CORE + ' (run "make v8core" first)');
+
+	corebase = path.join(process.env.CATMPDIR || os.tmpdir(), 'v8core');
+
+	vasync.pipeline({
+	    'funcs': [
+		function startProgram(_, callback) {
+			console.error('test: starting %s', PROGRAM);
+			child = childprocess.spawn(process.execPath,
+			    [ PROGRAM ], { 'stdio': 'ignore' });
+			corefile = corebase + '.' + child.pid;
+			setTimeout(callback, STARTUP_MS);
+		},
+
+		function saveCore(_, callback) {
+			console.error('test: saving core file %s', corefile);
+			childprocess.execFile('gcore', [ '-o', corebase,
+			    String(child.pid) ], function (err) {
+				child.kill('SIGKILL');
+				callback(err);
+			});
+		},
+
+		function jsstack(_, callback) {
+			console.error('test: ::jsstack');
+			childprocess.execFile(V8CORE, [ corefile, '::jsstack' ],
+			    function (err, stdout, stderr) {
+				var funcs;
+
+				if (err) {
+					console.error(stderr);
+					callback(err);
+					return;
+				}
+
+				funcs = stdout.split('\n').filter(function (l) {
+					return (/^js:/.test(l));
+				}).map(function (l) {
+					return (l.split(/\s+/)[1]);
+				});
+				console.error(stdout);
+				assert.deepEqual(funcs.slice(0, 3),
+				    [ 'func2', 'func1', 'main' ]);
+				callback();
+			});
+		},
+
+		function findjsobjects(_, callback) {
+			console.error('test: ::findjsobjects');
+			childprocess.execFile(V8CORE,
+			    [ corefile, '::findjsobjects' ],
+			    { 'maxBuffer': 64 * 1024 * 1024 },
+			    function (err, stdout, stderr) {
+				var lines;
+
+				if (err) {
+					console.error(stderr);
+					callback(err);
+					return;
+				}
+
+				lines = stdout.split('\n').filter(function (l) {
+					return (l.indexOf(PROPS) != -1);
+				});
+				assert.equal(lines.length, 1,
+				    'expected one shape with the test ' +
+				    'object\'s properties');
+				callback();
+			});
+		}
+	]
+	}, function (err) {
+		if (child !== undefined && child.exitCode === null)
+			child.kill('SIGKILL');
+
+		if (err) {
+			console.error('core file: %s', corefile);
+			throw (err);
+		}
+
+		fs.unlinkSync(corefile);
+		console.log('%s passed', process.argv[1]);
+	});
+}
+
+main();